@@ -0,0 +1,42 @@
+//===-- BinaryIO.h - ClangDoc on-disk formats -------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The files clang-doc writes during a run (bitcode shards, incremental cache
+// records) are read and written with llvm's binary streams, in little-endian
+// order. Strings are prefixed with their size, as a 32-bit integer.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_DOC_BINARYIO_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_DOC_BINARYIO_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/BinaryStreamReader.h"
+#include "llvm/Support/BinaryStreamWriter.h"
+#include "llvm/Support/Error.h"
+
+namespace clang {
+namespace doc {
+
+inline llvm::Error writeString(llvm::BinaryStreamWriter &W, llvm::StringRef S) {
+  if (llvm::Error Err = W.writeInteger<uint32_t>(S.size()))
+    return Err;
+  return W.writeFixedString(S);
+}
+
+inline llvm::Error readString(llvm::BinaryStreamReader &R, llvm::StringRef &S) {
+  uint32_t Size;
+  if (llvm::Error Err = R.readInteger(Size))
+    return Err;
+  return R.readFixedString(S, Size);
+}
+
+} // namespace doc
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_DOC_BINARYIO_H
@@ -0,0 +1,114 @@
+//===-- BitcodeShards.cpp - ClangDoc on-disk map results --------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "BitcodeShards.h"
+#include "BinaryIO.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/BinaryByteStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+
+namespace clang {
+namespace doc {
+
+// Each shard is a sequence of records of the form
+//   <key> <bitcode>
+// where both are strings prefixed with their size, see BinaryIO.h.
+
+llvm::Expected<std::unique_ptr<BitcodeShards>>
+BitcodeShards::create(unsigned NumShards) {
+  assert(NumShards > 0 && "need at least one shard");
+  llvm::SmallString<128> Directory;
+  if (std::error_code EC =
+          llvm::sys::fs::createUniqueDirectory("clang-doc-shards", Directory))
+    return llvm::createStringError(EC, "failed to create shard directory");
+  std::unique_ptr<BitcodeShards> Result(
+      new BitcodeShards(std::string(Directory.str())));
+  for (unsigned I = 0; I < NumShards; ++I) {
+    auto S = std::make_unique<Shard>();
+    llvm::SmallString<128> Path(Directory);
+    llvm::sys::path::append(Path, "shard-" + llvm::Twine(I));
+    S->Path = std::string(Path.str());
+    std::error_code EC;
+    S->OS = std::make_unique<llvm::raw_fd_ostream>(S->Path, EC,
+                                                   llvm::sys::fs::OF_None);
+    if (EC)
+      return llvm::createStringError(EC, "failed to create " + S->Path);
+    Result->Shards.push_back(std::move(S));
+  }
+  return std::move(Result);
+}
+
+BitcodeShards::~BitcodeShards() {
+  for (auto &S : Shards)
+    S->OS.reset();
+  llvm::sys::fs::remove_directories(Directory);
+}
+
+void BitcodeShards::add(llvm::StringRef Key, llvm::StringRef Bitcode) {
+  // Appending to a byte stream can't fail.
+  llvm::AppendingBinaryByteStream Stream(llvm::support::little);
+  llvm::BinaryStreamWriter W(Stream);
+  llvm::cantFail(writeString(W, Key));
+  llvm::cantFail(writeString(W, Bitcode));
+
+  Shard &S = *Shards[llvm::hash_value(Key) % Shards.size()];
+  std::lock_guard<std::mutex> Lock(S.Mutex);
+  assert(S.OS && "bitcode added after finish()");
+  *S.OS << llvm::toStringRef(Stream.data());
+}
+
+llvm::Error BitcodeShards::finish() {
+  for (auto &S : Shards) {
+    std::lock_guard<std::mutex> Lock(S->Mutex);
+    if (!S->OS)
+      continue;
+    S->OS->close();
+    if (S->OS->has_error()) {
+      std::error_code EC = S->OS->error();
+      S->OS->clear_error();
+      return llvm::createStringError(EC, "failed to write " + S->Path);
+    }
+    S->OS.reset();
+  }
+  return llvm::Error::success();
+}
+
+llvm::Error BitcodeShards::forEachGroup(
+    unsigned I,
+    llvm::function_ref<void(llvm::StringRef Key,
+                            llvm::ArrayRef<llvm::StringRef> Bitcode)>
+        Callback) const {
+  const Shard &S = *Shards[I];
+  assert(!S.OS && "shard read before finish()");
+  auto Buffer = llvm::MemoryBuffer::getFile(S.Path);
+  if (!Buffer)
+    return llvm::createStringError(Buffer.getError(),
+                                   "failed to read " + S.Path);
+
+  llvm::BinaryStreamReader R(Buffer.get()->getBuffer(), llvm::support::little);
+  llvm::StringMap<std::vector<llvm::StringRef>> Groups;
+  while (!R.empty()) {
+    llvm::StringRef Key, Bitcode;
+    if (llvm::errorToBool(readString(R, Key)) ||
+        llvm::errorToBool(readString(R, Bitcode)))
+      return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                     "truncated shard " + S.Path);
+    Groups[Key].push_back(Bitcode);
+  }
+  for (auto &Group : Groups)
+    Callback(Group.getKey(), Group.getValue());
+  return llvm::Error::success();
+}
+
+} // namespace doc
+} // namespace clang
@@ -0,0 +1,75 @@
+//===-- BitcodeShards.h - ClangDoc on-disk map results ----------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements storage for the results of the mapping phase that
+// spills them to disk instead of keeping them in memory. The bitcode for each
+// info is appended to one of several shard files, chosen by hashing its USR,
+// so all the bitcode for a given USR ends up in the same shard. The shards can
+// then be reduced independently, and only need to be read one at a time.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_DOC_BITCODESHARDS_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_DOC_BITCODESHARDS_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace doc {
+
+class BitcodeShards {
+public:
+  // Creates NumShards empty shard files in a new temporary directory, which is
+  // removed with the shards.
+  static llvm::Expected<std::unique_ptr<BitcodeShards>>
+  create(unsigned NumShards);
+  ~BitcodeShards();
+
+  // Appends the bitcode of an info, whose key is its hashed USR.
+  // This is safe to call from several threads at once.
+  void add(llvm::StringRef Key, llvm::StringRef Bitcode);
+
+  // Closes the shard files. No more bitcode can be added after this, and it
+  // must be called before the shards are read.
+  llvm::Error finish();
+
+  unsigned size() const { return Shards.size(); }
+
+  // Reads shard I, and calls Callback with each key in it and all the bitcode
+  // added for that key. The shard is only kept in memory during the call.
+  llvm::Error forEachGroup(
+      unsigned I,
+      llvm::function_ref<void(llvm::StringRef Key,
+                              llvm::ArrayRef<llvm::StringRef> Bitcode)>
+          Callback) const;
+
+private:
+  struct Shard {
+    std::mutex Mutex;
+    std::string Path;
+    std::unique_ptr<llvm::raw_fd_ostream> OS;
+  };
+
+  BitcodeShards(std::string Directory) : Directory(std::move(Directory)) {}
+
+  std::string Directory;
+  std::vector<std::unique_ptr<Shard>> Shards;
+};
+
+} // namespace doc
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_DOC_BITCODESHARDS_H
@@ -13,43 +13,163 @@
 //===----------------------------------------------------------------------===//
 
 #include "ClangDoc.h"
+#include "BitcodeShards.h"
+#include "IncrementalCache.h"
 #include "Mapper.h"
 #include "Representation.h"
 #include "clang/AST/AST.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Frontend/ASTConsumers.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendActions.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/StringSaver.h"
 
 namespace clang {
 namespace doc {
 
+namespace {
+
+// Records the files that a TU looks up but doesn't find, e.g. a header in the
+// include directories before the one that has it.
+class MissingFilesRecorder : public FileSystemStatCache {
+public:
+  MissingFilesRecorder(llvm::StringSet<> &Missing) : Missing(Missing) {}
+
+protected:
+  std::error_code getStat(StringRef Path, llvm::vfs::Status &Status,
+                          bool isFile, std::unique_ptr<llvm::vfs::File> *F,
+                          llvm::vfs::FileSystem &FS) override {
+    std::error_code EC =
+        FileSystemStatCache::get(Path, Status, isFile, F, nullptr, FS);
+    if (EC == std::errc::no_such_file_or_directory) {
+      llvm::SmallString<128> Absolute(Path);
+      if (!FS.makeAbsolute(Absolute))
+        Missing.insert(Absolute);
+    }
+    return EC;
+  }
+
+private:
+  llvm::StringSet<> &Missing;
+};
+
+class ClangDocAction : public clang::ASTFrontendAction {
+public:
+  ClangDocAction(ClangDocContext CDCtx, std::string Command,
+                 const llvm::StringSet<> *Missing)
+      : CDCtx(CDCtx), Command(std::move(Command)), Missing(Missing) {}
+
+  std::unique_ptr<clang::ASTConsumer>
+  CreateASTConsumer(clang::CompilerInstance &Compiler,
+                    llvm::StringRef InFile) override {
+    return std::make_unique<MapASTVisitor>(&Compiler.getASTContext(), CDCtx,
+                                           CDCtx.Cache ? &Results : nullptr);
+  }
+
+  void EndSourceFileAction() override {
+    if (!CDCtx.Cache)
+      return;
+    // Record every file this TU read, so that the next run can tell whether
+    // it needs to be mapped again.
+    const SourceManager &SM = getCompilerInstance().getSourceManager();
+    std::vector<IncrementalCache::Dependency> Dependencies;
+    for (auto It = SM.fileinfo_begin(), End = SM.fileinfo_end(); It != End;
+         ++It) {
+      auto Contents = It->second->getBufferDataIfLoaded();
+      if (!Contents)
+        continue;
+      llvm::SmallString<128> Path(It->first->getName());
+      SM.getFileManager().makeAbsolutePath(Path);
+      Dependencies.push_back({std::string(Path.str()),
+                              IncrementalCache::hashContents(*Contents)});
+    }
+    std::vector<std::string> MissingFiles;
+    if (Missing)
+      for (const auto &Path : *Missing)
+        MissingFiles.push_back(Path.first().str());
+    CDCtx.Cache->store(getCurrentFile(), Command, Dependencies, MissingFiles,
+                       Results);
+  }
+
+private:
+  ClangDocContext CDCtx;
+  std::string Command;
+  const llvm::StringSet<> *Missing;
+  std::vector<std::pair<std::string, std::string>> Results;
+};
+
 class MapperActionFactory : public tooling::FrontendActionFactory {
 public:
-  MapperActionFactory(ClangDocContext CDCtx) : CDCtx(CDCtx) {}
+  MapperActionFactory(ClangDocContext CDCtx, std::string Command = "",
+                      const llvm::StringSet<> *Missing = nullptr)
+      : CDCtx(CDCtx), Command(std::move(Command)), Missing(Missing) {}
   std::unique_ptr<FrontendAction> create() override;
+  bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
+                     FileManager *Files,
+                     std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+                     DiagnosticConsumer *DiagConsumer) override;
 
 private:
   ClangDocContext CDCtx;
+  // The command of the TU being mapped, and the files it missed, when running
+  // incrementally.
+  std::string Command;
+  const llvm::StringSet<> *Missing;
 };
 
+} // namespace
+
 std::unique_ptr<FrontendAction> MapperActionFactory::create() {
-  class ClangDocAction : public clang::ASTFrontendAction {
-  public:
-    ClangDocAction(ClangDocContext CDCtx) : CDCtx(CDCtx) {}
-
-    std::unique_ptr<clang::ASTConsumer>
-    CreateASTConsumer(clang::CompilerInstance &Compiler,
-                      llvm::StringRef InFile) override {
-      return std::make_unique<MapASTVisitor>(&Compiler.getASTContext(), CDCtx);
-    }
+  return std::make_unique<ClangDocAction>(CDCtx, Command, Missing);
+}
+
+bool MapperActionFactory::runInvocation(
+    std::shared_ptr<CompilerInvocation> Invocation, FileManager *Files,
+    std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+    DiagnosticConsumer *DiagConsumer) {
+  if (!CDCtx.Cache || Invocation->getFrontendOpts().Inputs.size() != 1)
+    return FrontendActionFactory::runInvocation(
+        std::move(Invocation), Files, std::move(PCHContainerOps),
+        DiagConsumer);
+
+  llvm::BumpPtrAllocator Alloc;
+  llvm::StringSaver Saver(Alloc);
+  llvm::SmallVector<const char *, 32> Args;
+  Invocation->generateCC1CommandLine(
+      Args, [&](const llvm::Twine &Arg) { return Saver.save(Arg).data(); });
+  std::string Command;
+  for (const char *Arg : Args) {
+    Command += Arg;
+    Command += '\0';
+  }
+
+  StringRef MainFile = Invocation->getFrontendOpts().Inputs[0].getFile();
+  if (CDCtx.Cache->replay(MainFile, Command,
+                          [&](StringRef Key, StringRef Bitcode) {
+                            if (CDCtx.Shards)
+                              CDCtx.Shards->add(Key, Bitcode);
+                            else
+                              CDCtx.ECtx->reportResult(Key, Bitcode);
+                          }))
+    return true;
 
-  private:
-    ClangDocContext CDCtx;
-  };
-  return std::make_unique<ClangDocAction>(CDCtx);
+  // A FileManager of its own, so that every lookup of the TU reaches the
+  // recorder, even those an earlier command of the same file already made.
+  llvm::StringSet<> Missing;
+  IntrusiveRefCntPtr<FileManager> TUFiles(
+      new FileManager(Files->getFileSystemOpts(),
+                      &Files->getVirtualFileSystem()));
+  TUFiles->setStatCache(std::make_unique<MissingFilesRecorder>(Missing));
+  // This factory is shared by all the TUs, so map this one with a factory of
+  // its own that knows its command.
+  MapperActionFactory TUFactory(CDCtx, std::move(Command), &Missing);
+  return TUFactory.FrontendActionFactory::runInvocation(
+      std::move(Invocation), TUFiles.get(), std::move(PCHContainerOps),
+      DiagConsumer);
 }
 
 std::unique_ptr<tooling::FrontendActionFactory>
@@ -0,0 +1,253 @@
+//===-- IncrementalCache.cpp - ClangDoc per-TU map results ------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "IncrementalCache.h"
+#include "BinaryIO.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/BinaryByteStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+namespace clang {
+namespace doc {
+
+// Each TU is recorded in its own file, named after the hashes of its main file
+// and of its command:
+//   <main file> <command>
+//   <dependency count> { <path> <contents hash> }
+//   <missing file count> { <path> }
+//   <result count> { <key> <bitcode> }
+// Strings are prefixed with their size, see BinaryIO.h. Counts are 32-bit,
+// and hashes 64-bit, little-endian integers.
+
+namespace {
+
+constexpr llvm::StringLiteral RecordExtension = ".tu";
+constexpr llvm::StringLiteral ConfigName = "config";
+
+struct Record {
+  llvm::StringRef MainFile;
+  llvm::StringRef Command;
+  std::vector<std::pair<llvm::StringRef, uint64_t>> Dependencies;
+  std::vector<llvm::StringRef> Missing;
+  std::vector<std::pair<llvm::StringRef, llvm::StringRef>> Results;
+};
+
+llvm::Error readRecord(llvm::StringRef Data, Record &R) {
+  llvm::BinaryStreamReader Reader(Data, llvm::support::little);
+  uint32_t Count;
+  if (llvm::Error Err = readString(Reader, R.MainFile))
+    return Err;
+  if (llvm::Error Err = readString(Reader, R.Command))
+    return Err;
+  if (llvm::Error Err = Reader.readInteger(Count))
+    return Err;
+  for (uint32_t I = 0; I < Count; ++I) {
+    llvm::StringRef Path;
+    uint64_t Hash;
+    if (llvm::Error Err = readString(Reader, Path))
+      return Err;
+    if (llvm::Error Err = Reader.readInteger(Hash))
+      return Err;
+    R.Dependencies.emplace_back(Path, Hash);
+  }
+  if (llvm::Error Err = Reader.readInteger(Count))
+    return Err;
+  for (uint32_t I = 0; I < Count; ++I) {
+    llvm::StringRef Path;
+    if (llvm::Error Err = readString(Reader, Path))
+      return Err;
+    R.Missing.push_back(Path);
+  }
+  if (llvm::Error Err = Reader.readInteger(Count))
+    return Err;
+  for (uint32_t I = 0; I < Count; ++I) {
+    llvm::StringRef Key, Bitcode;
+    if (llvm::Error Err = readString(Reader, Key))
+      return Err;
+    if (llvm::Error Err = readString(Reader, Bitcode))
+      return Err;
+    R.Results.emplace_back(Key, Bitcode);
+  }
+  if (!Reader.empty())
+    return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                   "trailing data in cache record");
+  return llvm::Error::success();
+}
+
+} // namespace
+
+llvm::Expected<std::unique_ptr<IncrementalCache>>
+IncrementalCache::open(llvm::StringRef Directory, llvm::StringRef Config) {
+  if (std::error_code EC = llvm::sys::fs::create_directories(Directory))
+    return llvm::createStringError(EC, "failed to create cache directory " +
+                                           Directory);
+  std::unique_ptr<IncrementalCache> Cache(
+      new IncrementalCache(std::string(Directory)));
+
+  llvm::SmallString<128> ConfigPath(Directory);
+  llvm::sys::path::append(ConfigPath, ConfigName);
+  auto OldConfig = llvm::MemoryBuffer::getFile(ConfigPath);
+  if (OldConfig && OldConfig.get()->getBuffer() == Config)
+    return std::move(Cache);
+
+  // The cache was written with other options, or not at all: start afresh.
+  Cache->AllAffected = true;
+  std::error_code EC;
+  for (llvm::sys::fs::directory_iterator It(Directory, EC), End;
+       It != End && !EC; It.increment(EC))
+    if (llvm::sys::path::extension(It->path()) == RecordExtension)
+      llvm::sys::fs::remove(It->path());
+  llvm::raw_fd_ostream OS(ConfigPath, EC, llvm::sys::fs::OF_None);
+  if (EC)
+    return llvm::createStringError(EC, "failed to write " + ConfigPath);
+  OS << Config;
+  return std::move(Cache);
+}
+
+uint64_t IncrementalCache::hashContents(llvm::StringRef Contents) {
+  return llvm::xxHash64(Contents);
+}
+
+std::string IncrementalCache::recordPath(llvm::StringRef MainFile,
+                                         llvm::StringRef Command) const {
+  llvm::SmallString<128> Name;
+  llvm::raw_svector_ostream(Name)
+      << llvm::format_hex_no_prefix(llvm::xxHash64(MainFile), 16) << '-'
+      << llvm::format_hex_no_prefix(llvm::xxHash64(Command), 16)
+      << RecordExtension;
+  llvm::SmallString<128> Path(Directory);
+  llvm::sys::path::append(Path, Name);
+  return std::string(Path.str());
+}
+
+bool IncrementalCache::replay(
+    llvm::StringRef MainFile, llvm::StringRef Command,
+    llvm::function_ref<void(llvm::StringRef Key, llvm::StringRef Bitcode)>
+        Report) {
+  std::string Path = recordPath(MainFile, Command);
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Seen.insert(Path);
+  }
+  auto Buffer = llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return false;
+  Record R;
+  if (llvm::errorToBool(readRecord(Buffer.get()->getBuffer(), R)) ||
+      R.MainFile != MainFile)
+    return false;
+
+  bool Fresh = R.Command == Command;
+  for (const auto &Dep : R.Dependencies) {
+    if (!Fresh)
+      break;
+    auto Contents = llvm::MemoryBuffer::getFile(Dep.first);
+    Fresh = Contents && hashContents(Contents.get()->getBuffer()) == Dep.second;
+  }
+  for (llvm::StringRef Missing : R.Missing) {
+    if (!Fresh)
+      break;
+    Fresh = !llvm::sys::fs::exists(Missing);
+  }
+
+  if (!Fresh) {
+    // Whatever this TU contributed before has to be regenerated, even if it
+    // doesn't contribute to it anymore.
+    std::lock_guard<std::mutex> Lock(Mutex);
+    for (const auto &Result : R.Results)
+      Affected.insert(Result.first);
+    return false;
+  }
+  for (const auto &Result : R.Results)
+    Report(Result.first, Result.second);
+  return true;
+}
+
+void IncrementalCache::store(
+    llvm::StringRef MainFile, llvm::StringRef Command,
+    llvm::ArrayRef<Dependency> Dependencies,
+    llvm::ArrayRef<std::string> Missing,
+    llvm::ArrayRef<std::pair<std::string, std::string>> Results) {
+  std::string Path = recordPath(MainFile, Command);
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Seen.insert(Path);
+    for (const auto &Result : Results)
+      Affected.insert(Result.first);
+  }
+
+  // Write to a unique temporary file first, so that an interrupted run doesn't
+  // leave a truncated record behind, and that concurrent stores of the same
+  // record, e.g. for a file with several compile commands, don't interleave.
+  llvm::Error Err = llvm::writeFileAtomically(
+      Path + ".tmp.%%%%%%%%", Path, [&](llvm::raw_ostream &OS) {
+        // Appending to a byte stream can't fail.
+        llvm::AppendingBinaryByteStream Stream(llvm::support::little);
+        llvm::BinaryStreamWriter W(Stream);
+        llvm::cantFail(writeString(W, MainFile));
+        llvm::cantFail(writeString(W, Command));
+        llvm::cantFail(W.writeInteger<uint32_t>(Dependencies.size()));
+        for (const auto &Dep : Dependencies) {
+          llvm::cantFail(writeString(W, Dep.Path));
+          llvm::cantFail(W.writeInteger<uint64_t>(Dep.Hash));
+        }
+        llvm::cantFail(W.writeInteger<uint32_t>(Missing.size()));
+        for (const auto &MissingPath : Missing)
+          llvm::cantFail(writeString(W, MissingPath));
+        llvm::cantFail(W.writeInteger<uint32_t>(Results.size()));
+        for (const auto &Result : Results) {
+          llvm::cantFail(writeString(W, Result.first));
+          llvm::cantFail(writeString(W, Result.second));
+        }
+        OS << llvm::toStringRef(Stream.data());
+        return llvm::Error::success();
+      });
+  // Failing to store the record only costs a rebuild of the TU next time.
+  llvm::consumeError(std::move(Err));
+}
+
+llvm::Error IncrementalCache::finish() {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  std::error_code EC;
+  for (llvm::sys::fs::directory_iterator It(Directory, EC), End;
+       It != End && !EC; It.increment(EC)) {
+    if (llvm::sys::path::extension(It->path()) != RecordExtension ||
+        Seen.count(It->path()))
+      continue;
+    // This TU was removed from the project, so the infos it contributed to
+    // are affected.
+    if (auto Buffer = llvm::MemoryBuffer::getFile(It->path())) {
+      Record R;
+      if (!llvm::errorToBool(readRecord(Buffer.get()->getBuffer(), R)))
+        for (const auto &Result : R.Results)
+          Affected.insert(Result.first);
+    }
+    llvm::sys::fs::remove(It->path());
+  }
+  if (EC)
+    return llvm::createStringError(EC, "failed to list cache directory " +
+                                           Directory);
+  return llvm::Error::success();
+}
+
+bool IncrementalCache::isAffected(llvm::StringRef Key) const {
+  if (AllAffected)
+    return true;
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return Affected.count(Key);
+}
+
+} // namespace doc
+} // namespace clang
@@ -0,0 +1,98 @@
+//===-- IncrementalCache.h - ClangDoc per-TU map results --------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the cache used by clang-doc's incremental mode. For
+// each TU it records the compile command, the contents hash of every file the
+// TU read, the files it looked up but didn't find, and the bitcode the mapper
+// produced for it. On a later run, TUs
+// whose inputs are unchanged replay their recorded bitcode instead of being
+// parsed again, and only the infos that changed TUs contributed to (before or
+// after the change) need to be reduced and written out.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_DOC_INCREMENTALCACHE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_DOC_INCREMENTALCACHE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Error.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace clang {
+namespace doc {
+
+class IncrementalCache {
+public:
+  // A file read by a TU, and the hash of its contents at the time.
+  struct Dependency {
+    std::string Path;
+    uint64_t Hash;
+  };
+
+  // Opens the cache in Directory, creating it if needed. Config describes the
+  // options that affect the output; if it differs from the one the cache was
+  // written with, the cache is discarded and every info is out of date.
+  static llvm::Expected<std::unique_ptr<IncrementalCache>>
+  open(llvm::StringRef Directory, llvm::StringRef Config);
+
+  // If the TU for MainFile was recorded with the same command, none of its
+  // dependencies changed since and none of the files it missed was created,
+  // calls Report with each recorded key and bitcode and returns true.
+  // Otherwise returns false, and the TU has to be mapped again and stored.
+  // A file compiled with several commands has a TU for each.
+  bool replay(llvm::StringRef MainFile, llvm::StringRef Command,
+              llvm::function_ref<void(llvm::StringRef Key,
+                                      llvm::StringRef Bitcode)>
+                  Report);
+
+  // Records the results of mapping the TU for MainFile. Missing are the files
+  // the TU looked up but didn't find, like a header in the include directories
+  // before the one that has it: if one is created, the TU may read it instead.
+  void store(llvm::StringRef MainFile, llvm::StringRef Command,
+             llvm::ArrayRef<Dependency> Dependencies,
+             llvm::ArrayRef<std::string> Missing,
+             llvm::ArrayRef<std::pair<std::string, std::string>> Results);
+
+  // Forgets the TUs that were neither replayed nor stored in this run, as
+  // they are no longer part of the project. Must be called after mapping.
+  llvm::Error finish();
+
+  // Whether the info with this key may differ from the one generated in the
+  // previous run, and has to be reduced and written again.
+  bool isAffected(llvm::StringRef Key) const;
+
+  // Hashes a file's contents for use in a Dependency.
+  static uint64_t hashContents(llvm::StringRef Contents);
+
+private:
+  IncrementalCache(std::string Directory) : Directory(std::move(Directory)) {}
+
+  std::string recordPath(llvm::StringRef MainFile,
+                         llvm::StringRef Command) const;
+
+  std::string Directory;
+  // Set when the cache was discarded, so every info is affected.
+  bool AllAffected = false;
+  mutable std::mutex Mutex;
+  // Records that were replayed or stored in this run.
+  llvm::StringSet<> Seen;
+  // Keys of the infos contributed to by changed TUs.
+  llvm::StringSet<> Affected;
+};
+
+} // namespace doc
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_DOC_INCREMENTALCACHE_H
@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "Mapper.h"
+#include "BitcodeShards.h"
 #include "BitcodeWriter.h"
 #include "Serialize.h"
 #include "clang/AST/Comment.h"
@@ -44,14 +45,23 @@ template <typename T> bool MapASTVisitor::mapDecl(const T *D) {
   // A null in place of I indicates that the serializer is skipping this decl
   // for some reason (e.g. we're only reporting public decls).
   if (I.first)
-    CDCtx.ECtx->reportResult(llvm::toHex(llvm::toStringRef(I.first->USR)),
-                             serialize::serialize(I.first));
+    reportInfo(I.first);
   if (I.second)
-    CDCtx.ECtx->reportResult(llvm::toHex(llvm::toStringRef(I.second->USR)),
-                             serialize::serialize(I.second));
+    reportInfo(I.second);
   return true;
 }
 
+void MapASTVisitor::reportInfo(std::unique_ptr<Info> &I) {
+  std::string Key = llvm::toHex(llvm::toStringRef(I->USR));
+  std::string Bitcode = serialize::serialize(I);
+  if (Recorded)
+    Recorded->emplace_back(Key, Bitcode);
+  if (CDCtx.Shards)
+    CDCtx.Shards->add(Key, Bitcode);
+  else
+    CDCtx.ECtx->reportResult(Key, Bitcode);
+}
+
 bool MapASTVisitor::VisitNamespaceDecl(const NamespaceDecl *D) {
   return mapDecl(D);
 }
@@ -30,8 +30,11 @@ namespace doc {
 class MapASTVisitor : public clang::RecursiveASTVisitor<MapASTVisitor>,
                       public ASTConsumer {
 public:
-  explicit MapASTVisitor(ASTContext *Ctx, ClangDocContext CDCtx)
-      : CDCtx(CDCtx) {}
+  // If Recorded is set, the reported results are also appended to it.
+  explicit MapASTVisitor(
+      ASTContext *Ctx, ClangDocContext CDCtx,
+      std::vector<std::pair<std::string, std::string>> *Recorded = nullptr)
+      : CDCtx(CDCtx), Recorded(Recorded) {}
 
   void HandleTranslationUnit(ASTContext &Context) override;
   bool VisitNamespaceDecl(const NamespaceDecl *D);
@@ -42,6 +45,8 @@ public:
 
 private:
   template <typename T> bool mapDecl(const T *D);
+  // Reports the bitcode of I, keyed by its USR.
+  void reportInfo(std::unique_ptr<Info> &I);
 
   int getLine(const NamedDecl *D, const ASTContext &Context) const;
   llvm::SmallString<128> getFile(const NamedDecl *D, const ASTContext &Context,
@@ -51,6 +56,7 @@ private:
                                     const ASTContext &Context) const;
 
   ClangDocContext CDCtx;
+  std::vector<std::pair<std::string, std::string>> *Recorded;
 };
 
 } // namespace doc
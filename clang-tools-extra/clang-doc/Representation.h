@@ -423,6 +423,9 @@ struct Index : public Reference {
 llvm::Expected<std::unique_ptr<Info>>
 mergeInfos(std::vector<std::unique_ptr<Info>> &Values);
 
+class BitcodeShards;
+class IncrementalCache;
+
 struct ClangDocContext {
   ClangDocContext() = default;
   ClangDocContext(tooling::ExecutionContext *ECtx, StringRef ProjectName,
@@ -431,6 +434,12 @@ struct ClangDocContext {
                   std::vector<std::string> UserStylesheets,
                   std::vector<std::string> JsScripts);
   tooling::ExecutionContext *ECtx;
+  // If set, the mapper spills its results here instead of reporting them to
+  // ECtx.
+  BitcodeShards *Shards = nullptr;
+  // If set, TUs whose inputs didn't change since the last run replay their
+  // results from here instead of being mapped again.
+  IncrementalCache *Cache = nullptr;
   std::string ProjectName; // Name of project clang-doc is documenting.
   bool PublicOnly; // Indicates if only public declarations are documented.
   std::string OutDirectory; // Directory for outputting generated files.
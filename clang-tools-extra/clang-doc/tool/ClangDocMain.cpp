@@ -18,14 +18,17 @@
 //===----------------------------------------------------------------------===//
 
 #include "BitcodeReader.h"
+#include "BitcodeShards.h"
 #include "BitcodeWriter.h"
 #include "ClangDoc.h"
 #include "Generators.h"
+#include "IncrementalCache.h"
 #include "Representation.h"
 #include "clang/AST/AST.h"
 #include "clang/AST/Decl.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
 #include "clang/ASTMatchers/ASTMatchersInternal.h"
+#include "clang/Basic/Version.h"
 #include "clang/Driver/Options.h"
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Tooling/AllTUsExecution.h"
@@ -80,6 +83,22 @@ static llvm::cl::list<std::string> UserStylesheets(
     llvm::cl::desc("CSS stylesheets to extend the default styles."),
     llvm::cl::cat(ClangDocCategory));
 
+static llvm::cl::opt<unsigned> Shards("shards", llvm::cl::desc(R"(
+Number of shards to spill the mapped decls to on disk,
+instead of keeping them all in memory. Each shard is
+reduced and generated on its own, so peak memory is
+bounded by the largest shard. 0 disables spilling.)"),
+                                      llvm::cl::init(0),
+                                      llvm::cl::cat(ClangDocCategory));
+
+static llvm::cl::opt<std::string> IncrementalCacheDir(
+    "incremental-cache", llvm::cl::desc(R"(
+Directory for the per-TU results of previous runs.
+If set, only TUs whose inputs changed since are
+mapped again, and only the infos they contribute
+to are reduced and written again.)"),
+    llvm::cl::cat(ClangDocCategory));
+
 static llvm::cl::opt<std::string> SourceRoot("source-root", llvm::cl::desc(R"(
 Directory where processed files are stored.
 Links to definition locations will only be
@@ -178,6 +197,99 @@ llvm::Expected<llvm::SmallString<128>> getInfoOutputFile(StringRef Root,
   return Path;
 }
 
+// Returns the options that affect the generated files, so that the results
+// of an incremental run are discarded when they change.
+static std::string getIncrementalConfig(const doc::ClangDocContext &CDCtx) {
+  std::string Config;
+  llvm::raw_string_ostream OS(Config);
+  OS << clang::getClangToolFullVersion("clang-doc") << "\n"
+     << getFormatString() << "\n"
+     << CDCtx.ProjectName << "\n"
+     << CDCtx.PublicOnly << "\n"
+     << CDCtx.OutDirectory << "\n"
+     << CDCtx.SourceRoot << "\n"
+     << CDCtx.RepositoryUrl.getValueOr("") << "\n";
+  for (const auto &Stylesheet : CDCtx.UserStylesheets)
+    OS << Stylesheet << "\n";
+  for (const auto &Script : CDCtx.JsScripts)
+    OS << Script << "\n";
+  return OS.str();
+}
+
+// Reduces the infos for one USR, given as bitcode, and generates their
+// documentation. Returns false on a fatal error.
+static bool reduceAndGenerate(StringRef Key, llvm::ArrayRef<StringRef> Bitcodes,
+                              doc::Generator &G, doc::ClangDocContext &CDCtx,
+                              llvm::sys::Mutex &IndexMutex) {
+  std::vector<std::unique_ptr<doc::Info>> Infos;
+
+  // When running incrementally, infos that no changed TU contributed to were
+  // already written by a previous run. They only need an entry in the index,
+  // which any one of their parts provides.
+  if (CDCtx.Cache && !CDCtx.Cache->isAffected(Key)) {
+    llvm::BitstreamCursor Stream(Bitcodes.front());
+    doc::ClangDocBitcodeReader Reader(Stream);
+    auto ReadInfos = Reader.readBitcode();
+    if (ReadInfos && !ReadInfos->empty()) {
+      doc::Info *I = ReadInfos->front().get();
+      llvm::SmallString<128> InfoPath;
+      llvm::sys::path::native(OutDirectory, InfoPath);
+      llvm::sys::path::append(InfoPath, I->getRelativeFilePath(""),
+                              I->getFileBaseName() + "." + getFormatString());
+      if (llvm::sys::fs::exists(InfoPath)) {
+        IndexMutex.lock();
+        clang::doc::Generator::addInfoToIndex(CDCtx.Idx, I);
+        IndexMutex.unlock();
+        return true;
+      }
+    } else if (!ReadInfos) {
+      llvm::consumeError(ReadInfos.takeError());
+    }
+  }
+
+  for (auto &Bitcode : Bitcodes) {
+    llvm::BitstreamCursor Stream(Bitcode);
+    doc::ClangDocBitcodeReader Reader(Stream);
+    auto ReadInfos = Reader.readBitcode();
+    if (!ReadInfos) {
+      llvm::errs() << toString(ReadInfos.takeError()) << "\n";
+      return false;
+    }
+    std::move(ReadInfos->begin(), ReadInfos->end(), std::back_inserter(Infos));
+  }
+
+  auto Reduced = doc::mergeInfos(Infos);
+  if (!Reduced) {
+    llvm::errs() << llvm::toString(Reduced.takeError());
+    return true;
+  }
+
+  doc::Info *I = Reduced.get().get();
+  auto InfoPath =
+      getInfoOutputFile(OutDirectory, I->getRelativeFilePath(""),
+                        I->getFileBaseName(), "." + getFormatString());
+  if (!InfoPath) {
+    llvm::errs() << toString(InfoPath.takeError()) << "\n";
+    return false;
+  }
+  std::error_code FileErr;
+  llvm::raw_fd_ostream InfoOS(InfoPath.get(), FileErr, llvm::sys::fs::OF_None);
+  if (FileErr) {
+    llvm::errs() << "Error opening info file " << InfoPath.get() << ": "
+                 << FileErr.message() << "\n";
+    return true;
+  }
+
+  IndexMutex.lock();
+  // Add a reference to this Info in the Index
+  clang::doc::Generator::addInfoToIndex(CDCtx.Idx, I);
+  IndexMutex.unlock();
+
+  if (auto Err = G.generateDocForInfo(I, InfoOS, CDCtx))
+    llvm::errs() << toString(std::move(Err)) << "\n";
+  return true;
+}
+
 int main(int argc, const char **argv) {
   llvm::sys::PrintStackTraceOnErrorSignal(argv[0]);
   std::error_code OK;
@@ -236,6 +348,29 @@ int main(int argc, const char **argv) {
     CDCtx.FilesToCopy.emplace_back(IndexJS.str());
   }
 
+  std::unique_ptr<doc::BitcodeShards> MapShards;
+  if (Shards) {
+    auto Created = doc::BitcodeShards::create(Shards);
+    if (!Created) {
+      llvm::errs() << toString(Created.takeError()) << "\n";
+      return 1;
+    }
+    MapShards = std::move(*Created);
+    CDCtx.Shards = MapShards.get();
+  }
+
+  std::unique_ptr<doc::IncrementalCache> Cache;
+  if (!IncrementalCacheDir.empty()) {
+    auto Opened = doc::IncrementalCache::open(IncrementalCacheDir,
+                                              getIncrementalConfig(CDCtx));
+    if (!Opened) {
+      llvm::errs() << toString(Opened.takeError()) << "\n";
+      return 1;
+    }
+    Cache = std::move(*Opened);
+    CDCtx.Cache = Cache.get();
+  }
+
   // Mapping phase
   llvm::outs() << "Mapping decls...\n";
   auto Err =
@@ -251,73 +386,62 @@ int main(int argc, const char **argv) {
     }
   }
 
-  // Collect values into output by key.
-  // In ToolResults, the Key is the hashed USR and the value is the
-  // bitcode-encoded representation of the Info object.
-  llvm::outs() << "Collecting infos...\n";
-  llvm::StringMap<std::vector<StringRef>> USRToBitcode;
-  Exec->get()->getToolResults()->forEachResult(
-      [&](StringRef Key, StringRef Value) {
-        auto R = USRToBitcode.try_emplace(Key, std::vector<StringRef>());
-        R.first->second.emplace_back(Value);
-      });
+  if (Cache) {
+    if (auto Err = Cache->finish()) {
+      llvm::errs() << toString(std::move(Err)) << "\n";
+      return 1;
+    }
+  }
 
-  // First reducing phase (reduce all decls into one info per decl).
-  llvm::outs() << "Reducing " << USRToBitcode.size() << " infos...\n";
   std::atomic<bool> Error;
   Error = false;
   llvm::sys::Mutex IndexMutex;
   // ExecutorConcurrency is a flag exposed by AllTUsExecution.h
   llvm::ThreadPool Pool(llvm::hardware_concurrency(ExecutorConcurrency));
-  for (auto &Group : USRToBitcode) {
-    Pool.async([&]() {
-      std::vector<std::unique_ptr<doc::Info>> Infos;
-
-      for (auto &Bitcode : Group.getValue()) {
-        llvm::BitstreamCursor Stream(Bitcode);
-        doc::ClangDocBitcodeReader Reader(Stream);
-        auto ReadInfos = Reader.readBitcode();
-        if (!ReadInfos) {
-          llvm::errs() << toString(ReadInfos.takeError()) << "\n";
+
+  if (MapShards) {
+    if (auto Err = MapShards->finish()) {
+      llvm::errs() << toString(std::move(Err)) << "\n";
+      return 1;
+    }
+    // Each shard holds all the infos for its USRs, so the shards can be
+    // reduced independently. Only the shards being reduced are in memory.
+    llvm::outs() << "Reducing infos in " << MapShards->size() << " shards...\n";
+    for (unsigned I = 0; I < MapShards->size(); ++I) {
+      Pool.async([&, I]() {
+        auto Err = MapShards->forEachGroup(
+            I, [&](StringRef Key, llvm::ArrayRef<StringRef> Bitcodes) {
+              if (!reduceAndGenerate(Key, Bitcodes, *G->get(), CDCtx,
+                                     IndexMutex))
+                Error = true;
+            });
+        if (Err) {
+          llvm::errs() << toString(std::move(Err)) << "\n";
           Error = true;
-          return;
         }
-        std::move(ReadInfos->begin(), ReadInfos->end(),
-                  std::back_inserter(Infos));
-      }
-
-      auto Reduced = doc::mergeInfos(Infos);
-      if (!Reduced) {
-        llvm::errs() << llvm::toString(Reduced.takeError());
-        return;
-      }
-
-      doc::Info *I = Reduced.get().get();
-      auto InfoPath =
-          getInfoOutputFile(OutDirectory, I->getRelativeFilePath(""),
-                            I->getFileBaseName(), "." + Format);
-      if (!InfoPath) {
-        llvm::errs() << toString(InfoPath.takeError()) << "\n";
-        Error = true;
-        return;
-      }
-      std::error_code FileErr;
-      llvm::raw_fd_ostream InfoOS(InfoPath.get(), FileErr,
-                                  llvm::sys::fs::OF_None);
-      if (FileErr) {
-        llvm::errs() << "Error opening info file " << InfoPath.get() << ": "
-                     << FileErr.message() << "\n";
-        return;
-      }
-
-      IndexMutex.lock();
-      // Add a reference to this Info in the Index
-      clang::doc::Generator::addInfoToIndex(CDCtx.Idx, I);
-      IndexMutex.unlock();
-
-      if (auto Err = G->get()->generateDocForInfo(I, InfoOS, CDCtx))
-        llvm::errs() << toString(std::move(Err)) << "\n";
-    });
+      });
+    }
+  } else {
+    // Collect values into output by key.
+    // In ToolResults, the Key is the hashed USR and the value is the
+    // bitcode-encoded representation of the Info object.
+    llvm::outs() << "Collecting infos...\n";
+    llvm::StringMap<std::vector<StringRef>> USRToBitcode;
+    Exec->get()->getToolResults()->forEachResult(
+        [&](StringRef Key, StringRef Value) {
+          auto R = USRToBitcode.try_emplace(Key, std::vector<StringRef>());
+          R.first->second.emplace_back(Value);
+        });
+
+    // First reducing phase (reduce all decls into one info per decl).
+    llvm::outs() << "Reducing " << USRToBitcode.size() << " infos...\n";
+    for (auto &Group : USRToBitcode) {
+      Pool.async([&]() {
+        if (!reduceAndGenerate(Group.getKey(), Group.getValue(), *G->get(),
+                               CDCtx, IndexMutex))
+          Error = true;
+      });
+    }
   }
 
   Pool.wait();
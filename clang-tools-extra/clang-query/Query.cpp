@@ -13,6 +13,8 @@
 #include "clang/Frontend/ASTUnit.h"
 #include "clang/Frontend/TextDiagnostic.h"
 #include "clang/Tooling/NodeIntrospection.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace clang::ast_matchers;
@@ -175,28 +177,112 @@ void dumpLocations(llvm::raw_ostream &OS, DynTypedNode Node, ASTContext &Ctx,
 
 } // namespace
 
+namespace {
+
+/// Matches \p Matcher against \p AST, and returns the output for each match.
+/// \p Colors is whether the stream the output is destined to shows colors.
+std::vector<std::string> renderMatches(const DynTypedMatcher &Matcher,
+                                       ASTUnit &AST, const QuerySession &QS,
+                                       bool Colors) {
+  MatchFinder Finder;
+  std::vector<BoundNodes> Matches;
+  CollectBoundNodes Collect(Matches);
+  // Validity of the matcher was checked by the caller.
+  Finder.addDynamicMatcher(Matcher, &Collect);
+
+  auto &Ctx = AST.getASTContext();
+  const auto &SM = Ctx.getSourceManager();
+  Ctx.getParentMapContext().setTraversalKind(QS.TK);
+  Finder.matchAST(Ctx);
+
+  std::vector<std::string> Rendered;
+  Rendered.reserve(Matches.size());
+  for (const BoundNodes &Match : Matches) {
+    std::string Text;
+    llvm::raw_string_ostream OS(Text);
+    OS.enable_colors(Colors);
+    for (auto BI = Match.getMap().begin(), BE = Match.getMap().end(); BI != BE;
+         ++BI) {
+      if (QS.DiagOutput) {
+        clang::SourceRange R = BI->second.getSourceRange();
+        if (R.isValid()) {
+          TextDiagnostic TD(OS, Ctx.getLangOpts(),
+                            &AST.getDiagnostics().getDiagnosticOptions());
+          TD.emitDiagnostic(FullSourceLoc(R.getBegin(), SM),
+                            DiagnosticsEngine::Note,
+                            "\"" + BI->first + "\" binds here",
+                            CharSourceRange::getTokenRange(R), None);
+        }
+      }
+      if (QS.PrintOutput) {
+        OS << "Binding for \"" << BI->first << "\":\n";
+        BI->second.print(OS, Ctx.getPrintingPolicy());
+        OS << "\n";
+      }
+      if (QS.DetailedASTOutput) {
+        OS << "Binding for \"" << BI->first << "\":\n";
+        ASTDumper Dumper(OS, Ctx, AST.getDiagnostics().getShowColors());
+        Dumper.SetTraversalKind(QS.TK);
+        Dumper.Visit(BI->second);
+        OS << "\n";
+      }
+      if (QS.SrcLocOutput) {
+        OS << "\n  \"" << BI->first << "\" Source locations\n";
+        OS << "  " << std::string(19 + BI->first.size(), '-') << '\n';
+
+        dumpLocations(OS, BI->second, Ctx, AST.getDiagnostics(), SM);
+        OS << "\n";
+      }
+    }
+
+    if (Match.getMap().empty())
+      OS << "No bindings.\n";
+    OS.flush();
+    Rendered.push_back(std::move(Text));
+  }
+  return Rendered;
+}
+
+} // namespace
+
 bool MatchQuery::run(llvm::raw_ostream &OS, QuerySession &QS) const {
   unsigned MatchCount = 0;
 
-  for (auto &AST : QS.ASTs) {
+  DynTypedMatcher MaybeBoundMatcher = Matcher;
+  if (QS.BindRoot) {
+    llvm::Optional<DynTypedMatcher> M = Matcher.tryBind("root");
+    if (M)
+      MaybeBoundMatcher = *M;
+  }
+  if (!QS.ASTs.empty()) {
     MatchFinder Finder;
     std::vector<BoundNodes> Matches;
-    DynTypedMatcher MaybeBoundMatcher = Matcher;
-    if (QS.BindRoot) {
-      llvm::Optional<DynTypedMatcher> M = Matcher.tryBind("root");
-      if (M)
-        MaybeBoundMatcher = *M;
-    }
     CollectBoundNodes Collect(Matches);
     if (!Finder.addDynamicMatcher(MaybeBoundMatcher, &Collect)) {
       OS << "Not a valid top-level matcher.\n";
       return false;
     }
+  }
 
-    auto &Ctx = AST->getASTContext();
-    const auto &SM = Ctx.getSourceManager();
-    Ctx.getParentMapContext().setTraversalKind(QS.TK);
-    Finder.matchAST(Ctx);
+  // With several jobs, the ASTs are matched concurrently and the results are
+  // printed afterwards, in the order of the ASTs. Otherwise the results for
+  // each AST are printed as soon as they are available.
+  std::vector<std::vector<std::string>> Rendered(QS.ASTs.size());
+  bool Parallel = QS.Jobs != 1 && QS.ASTs.size() > 1;
+  if (Parallel) {
+    llvm::ThreadPool Pool(llvm::hardware_concurrency(QS.Jobs));
+    for (size_t I = 0; I < QS.ASTs.size(); ++I)
+      Pool.async([&, I] {
+        Rendered[I] = renderMatches(MaybeBoundMatcher, *QS.ASTs[I], QS,
+                                    OS.colors_enabled());
+      });
+    Pool.wait();
+  }
+
+  for (size_t I = 0; I < QS.ASTs.size(); ++I) {
+    if (!Parallel)
+      Rendered[I] = renderMatches(MaybeBoundMatcher, *QS.ASTs[I], QS,
+                                  OS.colors_enabled());
 
     if (QS.PrintMatcher) {
       SmallVector<StringRef, 4> Lines;
@@ -219,47 +305,9 @@ bool MatchQuery::run(llvm::raw_ostream &OS, QuerySession &QS) const {
          << "  " << std::string(PrefixText.size() + MaxLength, '=') << "\n\n";
     }
 
-    for (auto MI = Matches.begin(), ME = Matches.end(); MI != ME; ++MI) {
-      OS << "\nMatch #" << ++MatchCount << ":\n\n";
-
-      for (auto BI = MI->getMap().begin(), BE = MI->getMap().end(); BI != BE;
-           ++BI) {
-        if (QS.DiagOutput) {
-          clang::SourceRange R = BI->second.getSourceRange();
-          if (R.isValid()) {
-            TextDiagnostic TD(OS, AST->getASTContext().getLangOpts(),
-                              &AST->getDiagnostics().getDiagnosticOptions());
-            TD.emitDiagnostic(
-                FullSourceLoc(R.getBegin(), AST->getSourceManager()),
-                DiagnosticsEngine::Note, "\"" + BI->first + "\" binds here",
-                CharSourceRange::getTokenRange(R), None);
-          }
-        }
-        if (QS.PrintOutput) {
-          OS << "Binding for \"" << BI->first << "\":\n";
-          BI->second.print(OS, AST->getASTContext().getPrintingPolicy());
-          OS << "\n";
-        }
-        if (QS.DetailedASTOutput) {
-          OS << "Binding for \"" << BI->first << "\":\n";
-          const ASTContext &Ctx = AST->getASTContext();
-          ASTDumper Dumper(OS, Ctx, AST->getDiagnostics().getShowColors());
-          Dumper.SetTraversalKind(QS.TK);
-          Dumper.Visit(BI->second);
-          OS << "\n";
-        }
-        if (QS.SrcLocOutput) {
-          OS << "\n  \"" << BI->first << "\" Source locations\n";
-          OS << "  " << std::string(19 + BI->first.size(), '-') << '\n';
-
-          dumpLocations(OS, BI->second, Ctx, AST->getDiagnostics(), SM);
-          OS << "\n";
-        }
-      }
-
-      if (MI->getMap().empty())
-        OS << "No bindings.\n";
-    }
+    for (const std::string &Match : Rendered[I])
+      OS << "\nMatch #" << ++MatchCount << ":\n\n" << Match;
+    Rendered[I].clear();
   }
 
   OS << MatchCount << (MatchCount == 1 ? " match.\n" : " matches.\n");
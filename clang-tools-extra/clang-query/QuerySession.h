@@ -26,7 +26,7 @@ public:
   QuerySession(llvm::ArrayRef<std::unique_ptr<ASTUnit>> ASTs)
       : ASTs(ASTs), PrintOutput(false), DiagOutput(true),
         DetailedASTOutput(false), SrcLocOutput(false), BindRoot(true),
-        PrintMatcher(false), Terminate(false), TK(TK_AsIs) {}
+        PrintMatcher(false), Terminate(false), TK(TK_AsIs), Jobs(1) {}
 
   llvm::ArrayRef<std::unique_ptr<ASTUnit>> ASTs;
 
@@ -40,6 +40,8 @@ public:
   bool Terminate;
 
   TraversalKind TK;
+  /// The number of threads used to match the ASTs; 0 means one per core.
+  unsigned Jobs;
   llvm::StringMap<ast_matchers::dynamic::VariantValue> NamedValues;
 };
 
@@ -0,0 +1,125 @@
+//===--- MatcherBenchmark.cpp - clang-query matcher benchmarks --*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Compares matchers parsed from clang-query expressions with the equivalent
+// matchers written in C++, on a generated translation unit.
+//
+// Note: make sure to build the benchmark in Release mode.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/ASTMatchers/Dynamic/Diagnostics.h"
+#include "clang/ASTMatchers/Dynamic/Parser.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+#include <string>
+
+namespace clang {
+namespace query {
+namespace {
+
+using namespace ast_matchers;
+using ast_matchers::internal::DynTypedMatcher;
+
+// Many functions, a few of which call target().
+std::string generateCode() {
+  std::string Code = "void target(int);\nstruct S { int X; int get(); };\n";
+  llvm::raw_string_ostream OS(Code);
+  for (int I = 0; I < 2000; ++I) {
+    OS << "int f" << I << "(S s, int N) {\n"
+       << "  int Sum = 0;\n"
+       << "  for (int J = 0; J < N; ++J) {\n"
+       << "    if (J % 3 == 0) Sum += s.get(); else Sum -= s.X * J;\n"
+       << "  }\n";
+    if (I % 100 == 0)
+      OS << "  target(Sum);\n";
+    OS << "  return Sum;\n}\n";
+  }
+  return OS.str();
+}
+
+ASTUnit &ast() {
+  static std::unique_ptr<ASTUnit> AST =
+      tooling::buildASTFromCode(generateCode(), "input.cc");
+  return *AST;
+}
+
+class Counter : public MatchFinder::MatchCallback {
+public:
+  void run(const MatchFinder::MatchResult &) override { ++Count; }
+  unsigned Count = 0;
+};
+
+void runMatcher(benchmark::State &State, const DynTypedMatcher &Matcher) {
+  ASTContext &Ctx = ast().getASTContext();
+  Counter Matches;
+  MatchFinder Finder;
+  Finder.addDynamicMatcher(Matcher, &Matches);
+  for (auto _ : State)
+    Finder.matchAST(Ctx);
+  State.counters["matches"] = Matches.Count / State.iterations();
+}
+
+DynTypedMatcher parse(llvm::StringRef Code) {
+  dynamic::Diagnostics Diag;
+  auto Matcher = dynamic::Parser::parseMatcherExpression(Code, &Diag);
+  if (!Matcher) {
+    llvm::errs() << Diag.toStringFull() << "\n";
+    std::exit(1);
+  }
+  return *Matcher;
+}
+
+// The name check is written last, as is common in exploratory queries.
+const char NameQuery[] =
+    "functionDecl(hasDescendant(callExpr(callee(functionDecl("
+    "hasName(\"target\"))))), hasName(\"f100\"))";
+
+static void nameHandWritten(benchmark::State &State) {
+  runMatcher(State,
+             functionDecl(hasDescendant(callExpr(
+                              callee(functionDecl(hasName("target"))))),
+                          hasName("f100")));
+}
+BENCHMARK(nameHandWritten);
+
+static void nameDynamic(benchmark::State &State) {
+  runMatcher(State, parse(NameQuery));
+}
+BENCHMARK(nameDynamic);
+
+// Nested operators, as produced by composing "let" bindings.
+const char NestedQuery[] =
+    "functionDecl(allOf(allOf(isDefinition(), hasName(\"f100\")), "
+    "anyOf(anyOf(hasDescendant(ifStmt()), hasDescendant(whileStmt())), "
+    "hasDescendant(doStmt()))))";
+
+static void nestedHandWritten(benchmark::State &State) {
+  runMatcher(State, functionDecl(isDefinition(), hasName("f100"),
+                                 anyOf(hasDescendant(ifStmt()),
+                                       hasDescendant(whileStmt()),
+                                       hasDescendant(doStmt()))));
+}
+BENCHMARK(nestedHandWritten);
+
+static void nestedDynamic(benchmark::State &State) {
+  runMatcher(State, parse(NestedQuery));
+}
+BENCHMARK(nestedDynamic);
+
+} // namespace
+} // namespace query
+} // namespace clang
+
+BENCHMARK_MAIN();
@@ -28,15 +28,26 @@
 #include "Query.h"
 #include "QueryParser.h"
 #include "QuerySession.h"
+#include "clang/Basic/Version.h"
 #include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/CompilerInstance.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/LineEditor/LineEditor.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/VirtualFileSystem.h"
 #include "llvm/Support/WithColor.h"
+#include <algorithm>
+#include <mutex>
 #include <string>
 
 using namespace clang;
@@ -71,6 +82,39 @@ static cl::opt<std::string> PreloadFile(
     cl::desc("Preload commands from file and start interactive mode"),
     cl::value_desc("file"), cl::cat(ClangQueryCategory));
 
+static cl::opt<unsigned> Jobs(
+    "j",
+    cl::desc("Number of threads used to build and match the ASTs. "
+             "0 uses one thread per core."),
+    cl::init(1), cl::cat(ClangQueryCategory));
+
+static cl::opt<bool> Streaming(
+    "streaming",
+    cl::desc(R"(Build the ASTs one at a time, run the -c or -f
+commands on each, and discard it before building
+the next. This bounds memory use on large inputs.
+The results for each file are printed separately.)"),
+    cl::init(false), cl::cat(ClangQueryCategory));
+
+static cl::opt<std::string> ASTCache(
+    "ast-cache",
+    cl::desc(R"(Directory in which to save the ASTs that are built,
+and from which to load them in later runs, if their
+compile command and inputs haven't changed.)"),
+    cl::value_desc("directory"), cl::cat(ClangQueryCategory));
+
+/// Runs the commands in \p Source, stopping at the first one that fails.
+/// \return true if a command failed.
+bool runCommands(StringRef Source, QuerySession &QS, llvm::raw_ostream &OS) {
+  while (!Source.empty()) {
+    QueryRef Q = QueryParser::parse(Source, QS);
+    if (!Q->run(OS, QS))
+      return true;
+    Source = Q->RemainingContent;
+  }
+  return false;
+}
+
 bool runCommandsInFile(const char *ExeName, std::string const &FileName,
                        QuerySession &QS) {
   auto Buffer = llvm::MemoryBuffer::getFile(FileName);
@@ -80,15 +124,242 @@ bool runCommandsInFile(const char *ExeName, std::string const &FileName,
     return true;
   }
 
-  StringRef FileContentRef(Buffer.get()->getBuffer());
+  return runCommands(Buffer.get()->getBuffer(), QS, llvm::outs());
+}
 
-  while (!FileContentRef.empty()) {
-    QueryRef Q = QueryParser::parse(FileContentRef, QS);
-    if (!Q->run(llvm::outs(), QS))
-      return true;
-    FileContentRef = Q->RemainingContent;
+void addColorAdjuster(ClangTool &Tool) {
+  if (UseColor.getNumOccurrences() > 0) {
+    ArgumentsAdjuster colorAdjustor = [](const CommandLineArguments &Args,
+                                         StringRef /*unused*/) {
+      CommandLineArguments AdjustedArgs = Args;
+      if (UseColor)
+        AdjustedArgs.push_back("-fdiagnostics-color");
+      else
+        AdjustedArgs.push_back("-fno-diagnostics-color");
+      return AdjustedArgs;
+    };
+    Tool.appendArgumentsAdjuster(colorAdjustor);
   }
-  return false;
+}
+
+/// Returns the paths of the cached ASTs for \p File in the -ast-cache
+/// directory, one per compile command. The names contain a hash of the compiler
+/// version, the compile commands and the contents of \p File. Changes to the
+/// headers are found when loading.
+/// Returns no paths if \p File can't be read.
+std::vector<std::string>
+cachedASTPaths(const CompilationDatabase &Compilations, StringRef File) {
+  auto Buffer = llvm::MemoryBuffer::getFile(File);
+  if (!Buffer)
+    return {};
+  llvm::SHA1 Hasher;
+  auto AddString = [&](StringRef S) {
+    Hasher.update(S);
+    Hasher.update(StringRef("\0", 1));
+  };
+  AddString(getClangFullVersion());
+  AddString(UseColor.getNumOccurrences() ? (UseColor ? "color" : "no-color")
+                                         : "");
+  std::vector<CompileCommand> Commands = Compilations.getCompileCommands(File);
+  for (const CompileCommand &Cmd : Commands) {
+    AddString(Cmd.Directory);
+    for (const std::string &Arg : Cmd.CommandLine)
+      AddString(Arg);
+  }
+  AddString(Buffer.get()->getBuffer());
+
+  std::string Name = (llvm::sys::path::filename(File) + "-" +
+                      llvm::toHex(Hasher.final()))
+                         .str();
+  std::vector<std::string> Paths;
+  for (size_t I = 0; I < Commands.size(); ++I) {
+    SmallString<256> Path(ASTCache);
+    llvm::sys::path::append(Path, Name + "-" + Twine(I) + ".ast");
+    Paths.push_back(std::string(Path.str()));
+  }
+  return Paths;
+}
+
+/// Loads a cached AST, if it exists and none of its inputs have changed.
+std::unique_ptr<ASTUnit> loadCachedAST(const std::string &Path) {
+  if (!llvm::sys::fs::exists(Path))
+    return nullptr;
+  // A stale AST fails to load with an error, which isn't interesting.
+  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
+  DiagOpts->ShowColors = UseColor.getNumOccurrences()
+                             ? UseColor
+                             : llvm::outs().has_colors();
+  IntrusiveRefCntPtr<DiagnosticsEngine> Diags =
+      CompilerInstance::createDiagnostics(DiagOpts.get(),
+                                          new IgnoringDiagConsumer());
+  // Declarations are only deserialized when matching reaches them.
+  return ASTUnit::LoadFromASTFile(
+      Path, PCHContainerOperations().getRawReader(), ASTUnit::LoadEverything,
+      Diags, FileSystemOptions(), /*UseDebugInfo=*/false,
+      /*OnlyLocalDecls=*/false, CaptureDiagsKind::None,
+      /*AllowASTWithCompilerErrors=*/false, /*UserFilesAreVolatile=*/false,
+      llvm::vfs::createPhysicalFileSystem());
+}
+
+/// Provides one of the compile commands of a file.
+class SingleCommandDatabase : public CompilationDatabase {
+public:
+  SingleCommandDatabase(CompileCommand Command) : Command(std::move(Command)) {}
+
+  std::vector<CompileCommand>
+  getCompileCommands(StringRef FilePath) const override {
+    return {Command};
+  }
+
+private:
+  CompileCommand Command;
+};
+
+/// Combines the ClangTool::buildASTs() statuses of two sets of files.
+int mergeStatus(int A, int B) {
+  return (A == 1 || B == 1) ? 1 : std::max(A, B);
+}
+
+/// Builds the ASTs for a single file, one per compile command, or loads them
+/// from the -ast-cache. Each AST gets a filesystem and a FileManager of its
+/// own, so that it can be built and matched concurrently with others.
+/// \return the status of ClangTool::buildASTs().
+int buildAST(const CompilationDatabase &Compilations, const std::string &File,
+             std::vector<std::unique_ptr<ASTUnit>> &ASTs) {
+  std::vector<std::string> CachePaths;
+  if (!ASTCache.empty()) {
+    CachePaths = cachedASTPaths(Compilations, File);
+    std::vector<std::unique_ptr<ASTUnit>> Cached;
+    for (const std::string &Path : CachePaths) {
+      std::unique_ptr<ASTUnit> AST = loadCachedAST(Path);
+      if (!AST)
+        break;
+      Cached.push_back(std::move(AST));
+    }
+    if (!Cached.empty() && Cached.size() == CachePaths.size()) {
+      for (auto &AST : Cached)
+        ASTs.push_back(std::move(AST));
+      return 0;
+    }
+  }
+
+  auto Build = [&](const CompilationDatabase &DB,
+                   std::vector<std::unique_ptr<ASTUnit>> &Built) {
+    ClangTool Tool(DB, {File}, std::make_shared<PCHContainerOperations>(),
+                   llvm::vfs::createPhysicalFileSystem());
+    addColorAdjuster(Tool);
+    return Tool.buildASTs(Built);
+  };
+  std::vector<std::unique_ptr<ASTUnit>> Built;
+  int Status = 0;
+  std::vector<CompileCommand> Commands = Compilations.getCompileCommands(File);
+  if (Commands.size() <= 1) {
+    Status = Build(Compilations, Built);
+  } else {
+    // The ASTs built by one ClangTool share its FileManager.
+    for (CompileCommand &Cmd : Commands)
+      Status = mergeStatus(
+          Status, Build(SingleCommandDatabase(std::move(Cmd)), Built));
+  }
+  // Only cache the ASTs if all of them were built without errors, so that
+  // later runs still report the failures and the compiler errors.
+  bool Cache = Status == 0 && Built.size() == CachePaths.size() &&
+               llvm::none_of(Built, [](const std::unique_ptr<ASTUnit> &AST) {
+                 return AST->getDiagnostics().hasErrorOccurred();
+               });
+  for (size_t I = 0; I < Built.size(); ++I) {
+    // Failing to save is harmless: the AST is rebuilt next time.
+    if (Cache)
+      Built[I]->Save(CachePaths[I]);
+    ASTs.push_back(std::move(Built[I]));
+  }
+  return Status;
+}
+
+/// Builds the ASTs for \p Files on up to -j threads, keeping them in the order
+/// of \p Files.
+/// \return the status of ClangTool::buildASTs().
+int buildASTs(const CompilationDatabase &Compilations,
+              ArrayRef<std::string> Files,
+              std::vector<std::unique_ptr<ASTUnit>> &ASTs) {
+  std::vector<std::vector<std::unique_ptr<ASTUnit>>> Built(Files.size());
+  std::vector<int> Statuses(Files.size());
+  {
+    llvm::ThreadPool Pool(llvm::hardware_concurrency(Jobs));
+    for (size_t I = 0; I < Files.size(); ++I)
+      Pool.async([&, I] {
+        Statuses[I] = buildAST(Compilations, Files[I], Built[I]);
+      });
+    Pool.wait();
+  }
+  int Status = 0;
+  for (size_t I = 0; I < Files.size(); ++I) {
+    Status = mergeStatus(Status, Statuses[I]);
+    for (auto &AST : Built[I])
+      ASTs.push_back(std::move(AST));
+  }
+  return Status;
+}
+
+/// Runs \p Scripts on each of \p Files in turn, on up to -j threads. Each
+/// thread keeps the ASTs of a single file in memory. The output for a file is
+/// printed once the files before it are done, so it doesn't depend on the
+/// number of threads.
+/// \return the exit code of the tool.
+int runStreaming(const CompilationDatabase &Compilations,
+                 ArrayRef<std::string> Files, ArrayRef<std::string> Scripts) {
+  std::mutex Mu;
+  std::vector<llvm::Optional<std::string>> Outputs(Files.size());
+  size_t NextOutput = 0;
+  int Status = 0;
+  bool CommandFailed = false;
+
+  llvm::ThreadPool Pool(llvm::hardware_concurrency(Jobs));
+  for (size_t I = 0; I < Files.size(); ++I) {
+    Pool.async([&, I] {
+      bool Failed = false;
+      {
+        std::lock_guard<std::mutex> Lock(Mu);
+        Failed = CommandFailed;
+      }
+      std::string Output;
+      int BuildStatus = 0;
+      // Once a command has failed, the remaining files are skipped.
+      if (!Failed) {
+        std::vector<std::unique_ptr<ASTUnit>> ASTs;
+        BuildStatus = buildAST(Compilations, Files[I], ASTs);
+        if (!ASTs.empty()) {
+          QuerySession QS(ASTs);
+          llvm::raw_string_ostream OS(Output);
+          OS.enable_colors(llvm::outs().colors_enabled());
+          for (const std::string &Script : Scripts)
+            if ((Failed = runCommands(Script, QS, OS)))
+              break;
+        }
+      }
+
+      std::lock_guard<std::mutex> Lock(Mu);
+      Status = mergeStatus(Status, BuildStatus);
+      CommandFailed |= Failed;
+      Outputs[I] = std::move(Output);
+      for (; NextOutput < Outputs.size() && Outputs[NextOutput]; ++NextOutput) {
+        llvm::outs() << *Outputs[NextOutput];
+        Outputs[NextOutput].reset();
+      }
+      llvm::outs().flush();
+    });
+  }
+  Pool.wait();
+
+  if (CommandFailed || Status == 1)
+    return 1;
+  if (Status == 2) {
+    llvm::errs() << "Failed to build AST for some of the files, "
+                 << "results may be incomplete."
+                 << "\n";
+    return 1;
+  }
+  return 0;
 }
 
 int main(int argc, const char **argv) {
@@ -114,24 +385,47 @@ int main(int argc, const char **argv) {
     return 1;
   }
 
-  ClangTool Tool(OptionsParser->getCompilations(),
-                 OptionsParser->getSourcePathList());
+  if (!ASTCache.empty()) {
+    if (std::error_code EC = llvm::sys::fs::create_directories(ASTCache)) {
+      llvm::errs() << argv[0] << ": cannot create " << ASTCache << ": "
+                   << EC.message() << "\n";
+      return 1;
+    }
+  }
 
-  if (UseColor.getNumOccurrences() > 0) {
-    ArgumentsAdjuster colorAdjustor = [](const CommandLineArguments &Args, StringRef /*unused*/) {
-      CommandLineArguments AdjustedArgs = Args;
-      if (UseColor)
-        AdjustedArgs.push_back("-fdiagnostics-color");
-      else
-        AdjustedArgs.push_back("-fno-diagnostics-color");
-      return AdjustedArgs;
-    };
-    Tool.appendArgumentsAdjuster(colorAdjustor);
+  if (Streaming) {
+    if (Commands.empty() && CommandFiles.empty()) {
+      llvm::errs() << argv[0] << ": --streaming requires -c or -f\n";
+      return 1;
+    }
+    std::vector<std::string> Scripts(Commands.begin(), Commands.end());
+    for (auto &CommandFile : CommandFiles) {
+      auto Buffer = llvm::MemoryBuffer::getFile(CommandFile);
+      if (!Buffer) {
+        llvm::errs() << argv[0] << ": cannot open " << CommandFile << ": "
+                     << Buffer.getError().message() << "\n";
+        return 1;
+      }
+      Scripts.push_back(Buffer.get()->getBuffer().str());
+    }
+    return runStreaming(OptionsParser->getCompilations(),
+                        OptionsParser->getSourcePathList(), Scripts);
   }
 
   std::vector<std::unique_ptr<ASTUnit>> ASTs;
+  int BuildStatus;
+  if (Jobs == 1 && ASTCache.empty()) {
+    ClangTool Tool(OptionsParser->getCompilations(),
+                   OptionsParser->getSourcePathList());
+    addColorAdjuster(Tool);
+    BuildStatus = Tool.buildASTs(ASTs);
+  } else {
+    BuildStatus = buildASTs(OptionsParser->getCompilations(),
+                            OptionsParser->getSourcePathList(), ASTs);
+  }
+
   int ASTStatus = 0;
-  switch (Tool.buildASTs(ASTs)) {
+  switch (BuildStatus) {
   case 0:
     break;
   case 1: // Building ASTs failed.
@@ -147,6 +441,7 @@ int main(int argc, const char **argv) {
   }
 
   QuerySession QS(ASTs);
+  QS.Jobs = Jobs;
 
   if (!Commands.empty()) {
     for (auto &Command : Commands) {
@@ -0,0 +1,219 @@
+//===--- CachingFileSystem.cpp - clang-tidy -------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "CachingFileSystem.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Path.h"
+
+namespace clang {
+namespace tidy {
+
+namespace {
+
+/// A buffer that keeps cached contents alive, even after the cache was
+/// invalidated.
+class SharedBuffer : public llvm::MemoryBuffer {
+public:
+  SharedBuffer(std::shared_ptr<llvm::MemoryBuffer> Contents, std::string Name)
+      : Contents(std::move(Contents)), Name(std::move(Name)) {
+    init(this->Contents->getBufferStart(), this->Contents->getBufferEnd(),
+         /*RequiresNullTerminator=*/false);
+  }
+
+  llvm::StringRef getBufferIdentifier() const override { return Name; }
+  BufferKind getBufferKind() const override {
+    return Contents->getBufferKind();
+  }
+
+private:
+  std::shared_ptr<llvm::MemoryBuffer> Contents;
+  std::string Name;
+};
+
+class CachedFile : public llvm::vfs::File {
+public:
+  CachedFile(llvm::vfs::Status Status,
+             std::shared_ptr<llvm::MemoryBuffer> Contents)
+      : Status(std::move(Status)), Contents(std::move(Contents)) {}
+
+  llvm::ErrorOr<llvm::vfs::Status> status() override { return Status; }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+  getBuffer(const llvm::Twine &Name, int64_t FileSize,
+            bool RequiresNullTerminator, bool IsVolatile) override {
+    // The cached contents are always null terminated.
+    return std::make_unique<SharedBuffer>(Contents, Name.str());
+  }
+
+  std::error_code close() override { return {}; }
+
+private:
+  llvm::vfs::Status Status;
+  std::shared_ptr<llvm::MemoryBuffer> Contents;
+};
+
+} // namespace
+
+std::string CachingFileSystem::getKey(const llvm::Twine &Path) const {
+  llvm::SmallString<256> Key;
+  Path.toVector(Key);
+  makeAbsolute(Key);
+  // '..' may follow a symbolic link, so it has to be kept.
+  llvm::sys::path::remove_dots(Key, /*remove_dot_dot=*/false);
+  return std::string(Key.str());
+}
+
+bool CachingFileSystem::isCacheable(
+    const llvm::ErrorOr<llvm::vfs::Status> &Status) {
+  // Other errors, like permissions or too many open files, may not last.
+  return Status || Status.getError() == std::errc::no_such_file_or_directory;
+}
+
+llvm::Optional<llvm::ErrorOr<llvm::vfs::Status>>
+CachingFileSystem::lookupStatus(llvm::StringRef Key) const {
+  auto It = Entries.find(Key);
+  if (It != Entries.end())
+    return It->second.Status;
+  auto Dir = ScannedDirs.find(llvm::sys::path::parent_path(Key));
+  if (Dir != ScannedDirs.end() &&
+      !Dir->second.count(llvm::sys::path::filename(Key)))
+    return llvm::ErrorOr<llvm::vfs::Status>(
+        std::make_error_code(std::errc::no_such_file_or_directory));
+  return llvm::None;
+}
+
+llvm::ErrorOr<llvm::vfs::Status>
+CachingFileSystem::status(const llvm::Twine &Path) {
+  std::string Key = getKey(Path);
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (auto Status = lookupStatus(Key)) {
+      ++StatHits;
+      if (!*Status)
+        return *Status;
+      return llvm::vfs::Status::copyWithNewName(**Status, Path);
+    }
+  }
+
+  ++StatMisses;
+  llvm::ErrorOr<llvm::vfs::Status> Status = getUnderlyingFS().status(Path);
+  if (isCacheable(Status)) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Entries[Key].Status = Status;
+  }
+  return Status;
+}
+
+llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+CachingFileSystem::openFileForRead(const llvm::Twine &Path) {
+  std::string Key = getKey(Path);
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto It = Entries.find(Key);
+    if (It != Entries.end() && It->second.Contents) {
+      ++ReadHits;
+      return std::make_unique<CachedFile>(
+          llvm::vfs::Status::copyWithNewName(*It->second.Status, Path),
+          It->second.Contents);
+    }
+    // Looking up headers mostly opens files that don't exist.
+    auto Status = lookupStatus(Key);
+    if (Status && !*Status) {
+      ++ReadHits;
+      return Status->getError();
+    }
+  }
+
+  ++ReadMisses;
+  auto File = getUnderlyingFS().openFileForRead(Path);
+  if (!File) {
+    if (isCacheable(File.getError())) {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      Entries[Key].Status = File.getError();
+    }
+    return File;
+  }
+  llvm::ErrorOr<llvm::vfs::Status> Status = (*File)->status();
+  if (!Status || !Status->isRegularFile())
+    return File;
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Entry &E = Entries[Key];
+    E.Status = *Status;
+    // Files read once, like the main files, aren't worth keeping.
+    bool Keep = E.Read && ContentsSize + Status->getSize() <= MaxContentsSize;
+    E.Read = true;
+    if (!Keep)
+      return File;
+  }
+  auto Buffer = (*File)->getBuffer(Path);
+  if (!Buffer)
+    return File;
+
+  std::shared_ptr<llvm::MemoryBuffer> Contents = std::move(*Buffer);
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Entry &E = Entries[Key];
+    if (!E.Contents) {
+      E.Contents = Contents;
+      ContentsSize += Contents->getBufferSize();
+    }
+  }
+  return std::make_unique<CachedFile>(
+      llvm::vfs::Status::copyWithNewName(*Status, Path), std::move(Contents));
+}
+
+void CachingFileSystem::scanDirectory(const llvm::Twine &Dir) {
+  std::string Key = getKey(Dir);
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (ScannedDirs.count(Key))
+      return;
+  }
+
+  llvm::StringSet<> Names;
+  std::error_code EC;
+  for (llvm::vfs::directory_iterator It = getUnderlyingFS().dir_begin(Key, EC),
+                                     End;
+       It != End && !EC; It.increment(EC))
+    Names.insert(llvm::sys::path::filename(It->path()));
+  if (EC)
+    return;
+  std::lock_guard<std::mutex> Lock(Mutex);
+  ScannedDirs.try_emplace(Key, std::move(Names));
+}
+
+void CachingFileSystem::invalidate() {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  Entries.clear();
+  ScannedDirs.clear();
+  ContentsSize = 0;
+}
+
+void CachingFileSystem::invalidate(const llvm::Twine &Path) {
+  std::string Key = getKey(Path);
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto It = Entries.find(Key);
+  if (It == Entries.end())
+    return;
+  if (It->second.Contents)
+    ContentsSize -= It->second.Contents->getBufferSize();
+  Entries.erase(It);
+}
+
+CachingFileSystem::Statistics CachingFileSystem::getStatistics() const {
+  Statistics Stats;
+  Stats.StatHits = StatHits;
+  Stats.StatMisses = StatMisses;
+  Stats.ReadHits = ReadHits;
+  Stats.ReadMisses = ReadMisses;
+  return Stats;
+}
+
+} // namespace tidy
+} // namespace clang
@@ -0,0 +1,106 @@
+//===--- CachingFileSystem.h - clang-tidy -----------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CACHINGFILESYSTEM_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CACHINGFILESYSTEM_H
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace clang {
+namespace tidy {
+
+/// A file system that remembers the status and the contents of the files read
+/// through it, so that the translation units of a run, and the lookups of
+/// configuration files, don't access the same files over and over.
+///
+/// The contents of a file are only kept from its second read on, so that the
+/// main files, which are read once, don't fill the cache; and only up to a
+/// total size, past which files are read from the underlying file system.
+///
+/// Directories can be scanned up front, so that looking up a file that isn't
+/// there, like a header in all but one of the include directories, doesn't
+/// access the underlying file system either.
+///
+/// Only the files that exist and the files that don't are cached: other errors,
+/// like a permission denied, may be transient.
+///
+/// The cache assumes that files aren't modified behind its back; call
+/// \c invalidate() after writing to them. It can be used by several threads.
+class CachingFileSystem : public llvm::vfs::ProxyFileSystem {
+public:
+  struct Statistics {
+    unsigned StatHits = 0;
+    unsigned StatMisses = 0;
+    unsigned ReadHits = 0;
+    unsigned ReadMisses = 0;
+  };
+
+  static constexpr size_t DefaultMaxContentsSize = 512 << 20;
+
+  explicit CachingFileSystem(llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS,
+                             size_t MaxContentsSize = DefaultMaxContentsSize)
+      : ProxyFileSystem(std::move(FS)), MaxContentsSize(MaxContentsSize) {}
+
+  llvm::ErrorOr<llvm::vfs::Status> status(const llvm::Twine &Path) override;
+  llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+  openFileForRead(const llvm::Twine &Path) override;
+
+  /// Lists the entries of \p Dir, so that the status of any other file in it
+  /// is known not to exist.
+  void scanDirectory(const llvm::Twine &Dir);
+
+  /// Forgets everything about the files, after they were modified.
+  void invalidate();
+
+  /// Forgets the status and the contents of \p Path, after it was modified.
+  void invalidate(const llvm::Twine &Path);
+
+  Statistics getStatistics() const;
+
+private:
+  struct Entry {
+    llvm::ErrorOr<llvm::vfs::Status> Status = std::error_code();
+    // Shared with the files opened from the entry, which may outlive it.
+    std::shared_ptr<llvm::MemoryBuffer> Contents;
+    // Whether the file was read before, through the underlying file system.
+    bool Read = false;
+  };
+
+  /// Returns the absolute path without '.' used as key for \p Path.
+  std::string getKey(const llvm::Twine &Path) const;
+  /// Returns whether \p Status is worth caching.
+  static bool isCacheable(const llvm::ErrorOr<llvm::vfs::Status> &Status);
+  /// Returns the cached status of \p Key, if any. Must be called with the
+  /// mutex held.
+  llvm::Optional<llvm::ErrorOr<llvm::vfs::Status>>
+  lookupStatus(llvm::StringRef Key) const;
+
+  const size_t MaxContentsSize;
+  mutable std::mutex Mutex;
+  llvm::StringMap<Entry> Entries;
+  llvm::StringMap<llvm::StringSet<>> ScannedDirs;
+  /// Total size of the cached contents.
+  size_t ContentsSize = 0;
+
+  std::atomic<unsigned> StatHits{0};
+  std::atomic<unsigned> StatMisses{0};
+  std::atomic<unsigned> ReadHits{0};
+  std::atomic<unsigned> ReadMisses{0};
+};
+
+} // namespace tidy
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CACHINGFILESYSTEM_H
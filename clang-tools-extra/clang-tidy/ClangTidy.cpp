@@ -39,11 +39,17 @@
 #include "clang/Tooling/Refactoring.h"
 #include "clang/Tooling/ReplacementsYaml.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/Regex.h"
 #include <algorithm>
 #include <utility>
 
 #if CLANG_TIDY_ENABLE_STATIC_ANALYZER
+#include "clang/Analysis/AnalysisDeclContext.h"
 #include "clang/Analysis/PathDiagnostic.h"
 #include "clang/StaticAnalyzer/Frontend/AnalysisConsumer.h"
 #endif // CLANG_TIDY_ENABLE_STATIC_ANALYZER
@@ -166,6 +172,7 @@ public:
                 Replacements = Replacements.merge(tooling::Replacements(R));
                 CanBeApplied = true;
                 ++AppliedFixes;
+                ++FileAppliedFixes[R.getFilePath()];
               } else {
                 llvm::errs()
                     << "Can't resolve conflict, skipping the replacement.\n";
@@ -173,6 +180,7 @@ public:
             } else {
               CanBeApplied = true;
               ++AppliedFixes;
+              ++FileAppliedFixes[R.getFilePath()];
             }
             FixLoc = getLocation(FixAbsoluteFilePath, Repl.getOffset());
             FixLocations.push_back(std::make_pair(FixLoc, CanBeApplied));
@@ -190,57 +198,155 @@ public:
   }
 
   void finish() {
-    if (TotalFixes > 0) {
-      Rewriter Rewrite(SourceMgr, LangOpts);
-      for (const auto &FileAndReplacements : FileReplacements) {
-        StringRef File = FileAndReplacements.first();
-        llvm::ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
-            SourceMgr.getFileManager().getBufferForFile(File);
-        if (!Buffer) {
-          llvm::errs() << "Can't get buffer for file " << File << ": "
-                       << Buffer.getError().message() << "\n";
-          // FIXME: Maybe don't apply fixes for other files as well.
-          continue;
-        }
-        StringRef Code = Buffer.get()->getBuffer();
-        auto Style = format::getStyle(
-            *Context.getOptionsForFile(File).FormatStyle, File, "none");
-        if (!Style) {
-          llvm::errs() << llvm::toString(Style.takeError()) << "\n";
-          continue;
-        }
-        llvm::Expected<tooling::Replacements> Replacements =
-            format::cleanupAroundReplacements(Code, FileAndReplacements.second,
-                                              *Style);
-        if (!Replacements) {
-          llvm::errs() << llvm::toString(Replacements.takeError()) << "\n";
+    if (TotalFixes == 0)
+      return;
+
+    // Files are fixed independently of each other. Read them and look up
+    // their styles first, then clean up and format the replacements in
+    // parallel, and only start writing files once all of them are done.
+    struct FileFix {
+      StringRef File;
+      const Replacements *Replaces;
+      std::unique_ptr<MemoryBuffer> Buffer;
+      const format::FormatStyle *Style;
+      // The fixes counted as applied to the file, and those that weren't.
+      unsigned Applied;
+      unsigned Dropped;
+      std::string Errors;
+      llvm::Optional<std::string> NewCode;
+    };
+    std::vector<FileFix> Fixes;
+    unsigned DroppedFixes = 0;
+    for (const auto &FileAndReplacements : FileReplacements) {
+      StringRef File = FileAndReplacements.first();
+      unsigned Applied = FileAppliedFixes.lookup(File);
+      llvm::ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+          SourceMgr.getFileManager().getBufferForFile(File);
+      if (!Buffer) {
+        llvm::errs() << "Can't get buffer for file " << File << ": "
+                     << Buffer.getError().message() << "\n";
+        // FIXME: Maybe don't apply fixes for other files as well.
+        DroppedFixes += Applied;
+        continue;
+      }
+      const format::FormatStyle *Style = getStyle(File);
+      if (!Style) {
+        DroppedFixes += Applied;
+        continue;
+      }
+      Fixes.push_back({File, &FileAndReplacements.second,
+                       std::move(Buffer.get()), Style, Applied, 0, "",
+                       llvm::None});
+    }
+
+    llvm::parallelFor(0, Fixes.size(), [&](size_t I) {
+      FileFix &Fix = Fixes[I];
+      StringRef Code = Fix.Buffer->getBuffer();
+      llvm::raw_string_ostream Errors(Fix.Errors);
+      // The file may have changed since it was analyzed: keep the fixes that
+      // still fit in it.
+      Replacements Fitting;
+      unsigned Dropped = 0;
+      for (const Replacement &R : *Fix.Replaces) {
+        if (R.getOffset() + R.getLength() > Code.size()) {
+          ++Dropped;
           continue;
         }
-        if (llvm::Expected<tooling::Replacements> FormattedReplacements =
-                format::formatReplacements(Code, *Replacements, *Style)) {
-          Replacements = std::move(FormattedReplacements);
-          if (!Replacements)
-            llvm_unreachable("!Replacements");
-        } else {
-          llvm::errs() << llvm::toString(FormattedReplacements.takeError())
-                       << ". Skipping formatting.\n";
-        }
-        if (!tooling::applyAllReplacements(Replacements.get(), Rewrite)) {
-          llvm::errs() << "Can't apply replacements for file " << File << "\n";
+        if (llvm::Error Err = Fitting.add(R)) {
+          llvm::consumeError(std::move(Err));
+          ++Dropped;
         }
       }
-      if (Rewrite.overwriteChangedFiles()) {
-        llvm::errs() << "clang-tidy failed to apply suggested fixes.\n";
+      if (Dropped)
+        Errors << "Can't apply " << Dropped << " replacements to file "
+               << Fix.File << ", which changed since it was analyzed.\n";
+
+      llvm::Expected<tooling::Replacements> Replacements =
+          format::cleanupAroundReplacements(Code, Fitting, *Fix.Style);
+      if (!Replacements) {
+        Errors << llvm::toString(Replacements.takeError())
+               << ". Skipping cleanup.\n";
+        Replacements = Fitting;
+      } else if (llvm::Expected<tooling::Replacements> FormattedReplacements =
+                     format::formatReplacements(Code, *Replacements,
+                                                *Fix.Style)) {
+        Replacements = std::move(FormattedReplacements);
       } else {
-        llvm::errs() << "clang-tidy applied " << AppliedFixes << " of "
-                     << TotalFixes << " suggested fixes.\n";
+        Errors << llvm::toString(FormattedReplacements.takeError())
+               << ". Skipping formatting.\n";
+      }
+      llvm::Expected<std::string> NewCode =
+          tooling::applyAllReplacements(Code, *Replacements);
+      if (!NewCode) {
+        // The cleanup or the formatting may be at fault: apply the fixes as
+        // they are.
+        llvm::consumeError(NewCode.takeError());
+        Errors << "Can't apply cleaned up replacements for file " << Fix.File
+               << ", applying them as they are.\n";
+        NewCode = tooling::applyAllReplacements(Code, Fitting);
+      }
+      if (!NewCode) {
+        llvm::consumeError(NewCode.takeError());
+        Errors << "Can't apply replacements for file " << Fix.File << "\n";
+        Fix.Dropped = Fix.Applied;
+        return;
+      }
+      Fix.Dropped = std::min(Dropped, Fix.Applied);
+      Fix.NewCode = std::move(*NewCode);
+    });
+
+    bool WriteFailed = false;
+    for (const FileFix &Fix : Fixes) {
+      llvm::errs() << Fix.Errors;
+      DroppedFixes += Fix.Dropped;
+      if (!Fix.NewCode || *Fix.NewCode == Fix.Buffer->getBuffer())
+        continue;
+      std::string TempPathModel = (Fix.File + "-%%%%%%%%").str();
+      if (llvm::Error Err = llvm::writeFileAtomically(TempPathModel, Fix.File,
+                                                      *Fix.NewCode)) {
+        llvm::errs() << llvm::toString(std::move(Err)) << "\n";
+        WriteFailed = true;
       }
     }
+    if (WriteFailed) {
+      llvm::errs() << "clang-tidy failed to apply suggested fixes.\n";
+    } else {
+      llvm::errs() << "clang-tidy applied " << AppliedFixes - DroppedFixes
+                   << " of " << TotalFixes << " suggested fixes.\n";
+    }
   }
 
   unsigned getWarningsAsErrorsCount() const { return WarningsAsErrors; }
 
 private:
+  // Returns the style to format the fixes in File with, or null if there is
+  // none. Files in the same directory share their styles, unless the
+  // options or the language of the files differ.
+  const format::FormatStyle *getStyle(StringRef File) {
+    StringRef StyleName = *Context.getOptionsForFile(File).FormatStyle;
+    SmallString<128> Key(StyleName);
+    Key += '\0';
+    Key += llvm::sys::path::parent_path(File);
+    Key += '\0';
+    Key += std::to_string(format::guessLanguage(File, /*Code=*/""));
+    auto It = Styles.try_emplace(Key);
+    CachedStyle &Cached = It.first->second;
+    if (It.second) {
+      llvm::Expected<format::FormatStyle> Style =
+          format::getStyle(StyleName, File, "none", /*Code=*/"",
+                           &Files.getVirtualFileSystem());
+      if (Style)
+        Cached.Style = std::move(*Style);
+      else
+        Cached.Error = llvm::toString(Style.takeError());
+    }
+    if (!Cached.Style) {
+      llvm::errs() << Cached.Error << "\n";
+      return nullptr;
+    }
+    return Cached.Style.getPointer();
+  }
+
   SourceLocation getLocation(StringRef FilePath, unsigned Offset) {
     if (FilePath.empty())
       return SourceLocation();
@@ -298,6 +404,13 @@ private:
   DiagnosticsEngine Diags;
   SourceManager SourceMgr;
   llvm::StringMap<Replacements> FileReplacements;
+  // The number of fixes counted in AppliedFixes for each file.
+  llvm::StringMap<unsigned> FileAppliedFixes;
+  struct CachedStyle {
+    llvm::Optional<format::FormatStyle> Style;
+    std::string Error;
+  };
+  llvm::StringMap<CachedStyle> Styles;
   ClangTidyContext &Context;
   FixBehaviour ApplyFixes;
   unsigned TotalFixes;
@@ -305,6 +418,20 @@ private:
   unsigned WarningsAsErrors;
 };
 
+/// Whether the reports in \p D can pass the header filter. Declarations
+/// outside of the main file and of the headers it accepts aren't worth
+/// analyzing, or even parsing, since their reports would be dropped.
+static bool isInUserCode(const Decl &D, const SourceManager &SM,
+                         const llvm::Regex &HeaderFilter) {
+  const Stmt *Body = D.getBody();
+  SourceLocation Loc =
+      SM.getExpansionLoc(Body ? Body->getBeginLoc() : D.getLocation());
+  if (Loc.isInvalid() || SM.isInMainFile(Loc))
+    return true;
+  const FileEntry *File = SM.getFileEntryForID(SM.getFileID(Loc));
+  return !File || HeaderFilter.match(File->getName());
+}
+
 class ClangTidyASTConsumer : public MultiplexConsumer {
 public:
   ClangTidyASTConsumer(std::vector<std::unique_ptr<ASTConsumer>> Consumers,
@@ -315,7 +442,20 @@ public:
         Profiling(std::move(Profiling)), Finder(std::move(Finder)),
         Checks(std::move(Checks)) {}
 
+  /// When the frontend skips function bodies, only skip those of the
+  /// declarations that \p Filter accepts.
+  void setFunctionBodySkipFilter(std::function<bool(const Decl &)> Filter) {
+    SkipFilter = std::move(Filter);
+  }
+
+  bool shouldSkipFunctionBody(Decl *D) override {
+    if (SkipFilter && !SkipFilter(*D))
+      return false;
+    return MultiplexConsumer::shouldSkipFunctionBody(D);
+  }
+
 private:
+  std::function<bool(const Decl &)> SkipFilter;
   // Destructor order matters! Profiling must be destructed last.
   // Or at least after Finder.
   std::unique_ptr<ClangTidyProfiling> Profiling;
@@ -323,23 +463,135 @@ private:
   std::vector<std::unique_ptr<ClangTidyCheck>> Checks;
 };
 
+/// Tells which declarations overlap the line ranges of a line filter, and may
+/// thus produce diagnostics that pass it.
+class LineFilterScope {
+public:
+  LineFilterScope(ArrayRef<FileFilter> LineFilter, const SourceManager &SM)
+      : LineFilter(LineFilter), SM(SM) {}
+
+  bool overlaps(const Decl &D) const {
+    SourceRange Range = D.getSourceRange();
+    if (Range.isInvalid())
+      return false;
+    CharSourceRange Expansion = SM.getExpansionRange(Range);
+    std::pair<FileID, unsigned> Begin =
+        SM.getDecomposedLoc(Expansion.getBegin());
+    std::pair<FileID, unsigned> End = SM.getDecomposedLoc(Expansion.getEnd());
+    // Be conservative with declarations that span several files, or that come
+    // from the command line.
+    const FileEntry *File = SM.getFileEntryForID(Begin.first);
+    if (Begin.first != End.first || !File)
+      return true;
+
+    for (const FileFilter &Filter : LineFilter) {
+      if (!File->getName().endswith(Filter.Name))
+        continue;
+      if (Filter.LineRanges.empty())
+        return true;
+      unsigned BeginLine = SM.getLineNumber(Begin.first, Begin.second);
+      unsigned EndLine = SM.getLineNumber(End.first, End.second);
+      return llvm::any_of(
+          Filter.LineRanges, [&](const FileFilter::LineRange &Range) {
+            return Range.first <= EndLine && BeginLine <= Range.second;
+          });
+    }
+    return false;
+  }
+
+  /// Whether the AST matchers need to traverse \p D. Declarations nested in
+  /// functions or classes are traversed with them, and so are only filtered
+  /// by their enclosing declaration.
+  bool shouldTraverse(const Decl &D) const {
+    const DeclContext *DC = D.getLexicalDeclContext();
+    if (!DC || !DC->getRedeclContext()->isFileContext())
+      return true;
+    return overlaps(D);
+  }
+
+private:
+  ArrayRef<FileFilter> LineFilter;
+  const SourceManager &SM;
+};
+
+/// Runs the AST matchers of the checks that can be limited to a line filter,
+/// over the declarations that overlap it only.
+class LineFilteredMatchConsumer : public ASTConsumer {
+public:
+  LineFilteredMatchConsumer(std::shared_ptr<LineFilterScope> Scope,
+                            ClangTidyProfiling *Profiling,
+                            bool IgnoreTemplateInstantiations)
+      : Profiling(Profiling) {
+    ast_matchers::MatchFinder::MatchFinderOptions Options;
+    Options.IgnoreTemplateInstantiations = IgnoreTemplateInstantiations;
+    Options.TraversalFilter = [Scope(std::move(Scope))](const Decl &D) {
+      return Scope->shouldTraverse(D);
+    };
+    if (Profiling)
+      Options.CheckProfiling.emplace(Records);
+    Finder = std::make_unique<ast_matchers::MatchFinder>(std::move(Options));
+  }
+
+  ast_matchers::MatchFinder &getFinder() { return *Finder; }
+
+  void HandleTranslationUnit(ASTContext &Context) override {
+    Finder->matchAST(Context);
+    // This runs after the unfiltered MatchFinder, which replaces the records.
+    if (Profiling)
+      for (const auto &Record : Records)
+        Profiling->Records[Record.getKey()] += Record.getValue();
+  }
+
+private:
+  ClangTidyProfiling *Profiling;
+  llvm::StringMap<llvm::TimeRecord> Records;
+  std::unique_ptr<ast_matchers::MatchFinder> Finder;
+};
+
 } // namespace
 
-ClangTidyASTConsumerFactory::ClangTidyASTConsumerFactory(
-    ClangTidyContext &Context,
-    IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> OverlayFS)
-    : Context(Context), OverlayFS(std::move(OverlayFS)),
-      CheckFactories(new ClangTidyCheckFactories) {
+std::shared_ptr<ClangTidyCheckFactories> createCheckFactories() {
+  auto CheckFactories = std::make_shared<ClangTidyCheckFactories>();
   for (ClangTidyModuleRegistry::entry E : ClangTidyModuleRegistry::entries()) {
     std::unique_ptr<ClangTidyModule> Module = E.instantiate();
     Module->addCheckFactories(*CheckFactories);
   }
+  return CheckFactories;
 }
 
+ClangTidyASTConsumerFactory::ClangTidyASTConsumerFactory(
+    ClangTidyContext &Context,
+    IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> OverlayFS,
+    std::shared_ptr<ClangTidyCheckFactories> CheckFactories)
+    : Context(Context), OverlayFS(std::move(OverlayFS)),
+      CheckFactories(CheckFactories ? std::move(CheckFactories)
+                                    : createCheckFactories()) {}
+
 #if CLANG_TIDY_ENABLE_STATIC_ANALYZER
+static bool parseAnalyzerConfig(StringRef Value, bool &Field) {
+  llvm::Optional<bool> Parsed = llvm::StringSwitch<llvm::Optional<bool>>(Value)
+                                    .Case("true", true)
+                                    .Case("false", false)
+                                    .Default(llvm::None);
+  if (!Parsed)
+    return false;
+  Field = *Parsed;
+  return true;
+}
+
+static bool parseAnalyzerConfig(StringRef Value, unsigned &Field) {
+  return !Value.getAsInteger(0, Field);
+}
+
+static bool parseAnalyzerConfig(StringRef Value, StringRef &Field) {
+  Field = Value;
+  return true;
+}
+
 static void
-setStaticAnalyzerCheckerOpts(const ClangTidyOptions &Opts,
+setStaticAnalyzerCheckerOpts(ClangTidyContext &Context,
                              clang::AnalyzerOptions &AnalyzerOptions) {
+  const ClangTidyOptions &Opts = Context.getOptions();
   StringRef AnalyzerPrefix(AnalyzerCheckNamePrefix);
   for (const auto &Opt : Opts.CheckOptions) {
     StringRef OptName(Opt.getKey());
@@ -348,6 +600,26 @@ setStaticAnalyzerCheckerOpts(const ClangTidyOptions &Opts,
     // Analyzer options are always local options so we can ignore priority.
     AnalyzerOptions.Config[OptName] = Opt.getValue().Value;
   }
+
+  // The options of the analyzer itself, as opposed to those of its checkers,
+  // were read from the configuration when the invocation was created. Update
+  // the ones set here, e.g. the 'max-nodes' budget of each function.
+  auto Update = [&](StringRef Name, auto &Field) {
+    std::string Key = (AnalyzerPrefix + Name).str();
+    if (!Opts.CheckOptions.count(Key))
+      return;
+    StringRef Value = AnalyzerOptions.Config[Name];
+    if (!parseAnalyzerConfig(Value, Field))
+      Context.configurationDiag(
+          "invalid configuration value '%0' for option '%1'")
+          << Value << Key;
+  };
+#define ANALYZER_OPTION(TYPE, NAME, CMDFLAG, DESC, DEFAULT_VAL)                \
+  Update(CMDFLAG, AnalyzerOptions.NAME);
+#define ANALYZER_OPTION_DEPENDS_ON_USER_MODE(TYPE, NAME, CMDFLAG, DESC,        \
+                                             SHALLOW_VAL, DEEP_VAL)            \
+  Update(CMDFLAG, AnalyzerOptions.NAME);
+#include "clang/StaticAnalyzer/Core/AnalyzerOptions.def"
 }
 
 typedef std::vector<std::pair<std::string, bool>> CheckersList;
@@ -384,9 +656,26 @@ static CheckersList getAnalyzerCheckersAndPackages(ClangTidyContext &Context,
 }
 #endif // CLANG_TIDY_ENABLE_STATIC_ANALYZER
 
+/// Returns whether compiler warnings or remarks are enabled as checks, i.e.
+/// clang-diagnostic-* checks other than clang-diagnostic-error, which is
+/// always reported. Most of them come from Sema, so they need a full parse.
+static bool hasCompilerWarningChecks(ClangTidyContext &Context) {
+  if (Context.isCheckEnabled("clang-diagnostic-warning") ||
+      Context.isCheckEnabled("clang-diagnostic-remark"))
+    return true;
+  // The flags are listed as -W<group> and -Wno-<group>.
+  for (StringRef Flag : DiagnosticIDs::getDiagnosticFlags()) {
+    if (!Flag.consume_front("-W") || Flag.empty() || Flag.startswith("no-"))
+      continue;
+    if (Context.isCheckEnabled(("clang-diagnostic-" + Flag).str()))
+      return true;
+  }
+  return false;
+}
+
 std::unique_ptr<clang::ASTConsumer>
 ClangTidyASTConsumerFactory::createASTConsumer(
-    clang::CompilerInstance &Compiler, StringRef File) {
+    clang::CompilerInstance &Compiler, StringRef File, Pipeline *Pipeline) {
   // FIXME: Move this to a separate method, so that CreateASTConsumer doesn't
   // modify Compiler.
   SourceManager *SM = &Compiler.getSourceManager();
@@ -404,7 +693,21 @@ ClangTidyASTConsumerFactory::createASTConsumer(
   std::vector<std::unique_ptr<ClangTidyCheck>> Checks =
       CheckFactories->createChecksForLanguage(&Context);
 
+  // Whether the frontend can skip something that no check needs.
+  auto AllChecks =
+      [&Checks](llvm::function_ref<bool(const ClangTidyCheck &)> Predicate) {
+        return !Checks.empty() &&
+               llvm::all_of(Checks,
+                            [&](const std::unique_ptr<ClangTidyCheck> &Check) {
+                              return Predicate(*Check);
+                            });
+      };
+  bool IgnoreTemplateInstantiations = AllChecks([](const ClangTidyCheck &C) {
+    return !C.needsTemplateInstantiations();
+  });
+
   ast_matchers::MatchFinder::MatchFinderOptions FinderOptions;
+  FinderOptions.IgnoreTemplateInstantiations = IgnoreTemplateInstantiations;
 
   std::unique_ptr<ClangTidyProfiling> Profiling;
   if (Context.getEnableProfiling()) {
@@ -419,40 +722,114 @@ ClangTidyASTConsumerFactory::createASTConsumer(
   Preprocessor *PP = &Compiler.getPreprocessor();
   Preprocessor *ModuleExpanderPP = PP;
 
-  if (Context.getLangOpts().Modules && OverlayFS != nullptr) {
+  if (Context.getLangOpts().Modules && OverlayFS != nullptr &&
+      llvm::any_of(Checks, [](const std::unique_ptr<ClangTidyCheck> &Check) {
+        return Check->needsExpandedModularHeaders();
+      })) {
     auto ModuleExpander = std::make_unique<ExpandModularHeadersPPCallbacks>(
         &Compiler, OverlayFS);
     ModuleExpanderPP = ModuleExpander->getPreprocessor();
     PP->addPPCallbacks(std::move(ModuleExpander));
   }
 
+  // With a line filter, diagnostics outside of the filtered lines are dropped,
+  // so there is no point in analyzing most of the AST.
+  std::shared_ptr<LineFilterScope> Scope;
+  std::unique_ptr<LineFilteredMatchConsumer> FilteredConsumer;
+  if (!Context.getGlobalOptions().LineFilter.empty()) {
+    Scope = std::make_shared<LineFilterScope>(
+        Context.getGlobalOptions().LineFilter, *SM);
+    FilteredConsumer = std::make_unique<LineFilteredMatchConsumer>(
+        Scope, Profiling.get(), IgnoreTemplateInstantiations);
+  }
+
+  bool HasFilteredChecks = false;
+  bool HasUnfilteredChecks = false;
   for (auto &Check : Checks) {
-    Check->registerMatchers(&*Finder);
+    if (FilteredConsumer && !Check->needsWholeTranslationUnit()) {
+      Check->registerMatchers(&FilteredConsumer->getFinder());
+      HasFilteredChecks = true;
+    } else {
+      Check->registerMatchers(&*Finder);
+      HasUnfilteredChecks = true;
+    }
     Check->registerPPCallbacks(*SM, PP, ModuleExpanderPP);
   }
 
   std::vector<std::unique_ptr<ASTConsumer>> Consumers;
-  if (!Checks.empty())
+  if (HasUnfilteredChecks)
     Consumers.push_back(Finder->newASTConsumer());
+  if (HasFilteredChecks)
+    Consumers.push_back(std::move(FilteredConsumer));
 
+  bool RunsAnalyzer = false;
 #if CLANG_TIDY_ENABLE_STATIC_ANALYZER
   AnalyzerOptionsRef AnalyzerOptions = Compiler.getAnalyzerOpts();
   AnalyzerOptions->CheckersAndPackages = getAnalyzerCheckersAndPackages(
       Context, Context.canEnableAnalyzerAlphaCheckers());
   if (!AnalyzerOptions->CheckersAndPackages.empty()) {
-    setStaticAnalyzerCheckerOpts(Context.getOptions(), *AnalyzerOptions);
+    RunsAnalyzer = true;
+    setStaticAnalyzerCheckerOpts(Context, *AnalyzerOptions);
     AnalyzerOptions->AnalysisDiagOpt = PD_NONE;
     AnalyzerOptions->eagerlyAssumeBinOpBifurcation = true;
     std::unique_ptr<ento::AnalysisASTConsumer> AnalysisConsumer =
         ento::CreateAnalysisConsumer(Compiler);
     AnalysisConsumer->AddDiagnosticConsumer(
         new AnalyzerDiagnosticConsumer(Context));
+    auto HeaderFilter =
+        std::make_shared<llvm::Regex>(*Context.getOptions().HeaderFilterRegex);
+    AnalysisConsumer->SetDeclFilter([Scope, HeaderFilter, SM](const Decl *D) {
+      return isInUserCode(*D, *SM, *HeaderFilter) &&
+             (!Scope || Scope->overlaps(*D));
+    });
+    if (Profiling) {
+      AnalysisConsumer->SetDeclTimeCallback(
+          [Records = &Profiling->Records](const Decl *D,
+                                          const llvm::TimeRecord &Time) {
+            std::string Name = AnalysisDeclContext::getFunctionName(D);
+            // The names end up as JSON keys when the profile is stored.
+            std::replace(Name.begin(), Name.end(), '"', '\'');
+            (*Records)["clang-analyzer: " + Name] += Time;
+          });
+    }
     Consumers.push_back(std::move(AnalysisConsumer));
   }
 #endif // CLANG_TIDY_ENABLE_STATIC_ANALYZER
-  return std::make_unique<ClangTidyASTConsumer>(
+  if (Pipeline && !RunsAnalyzer && !hasCompilerWarningChecks(Context)) {
+    // The static analyzer and the compiler warnings need the whole AST.
+    Pipeline->PreprocessorOnly = AllChecks([](const ClangTidyCheck &Check) {
+      return Check.needsOnlyPreprocessor();
+    });
+    Pipeline->SkipFunctionBodies = AllChecks([](const ClangTidyCheck &Check) {
+      return !Check.needsFunctionBodies();
+    });
+  }
+
+  // Checks that report on a declaration based on its uses may find them in
+  // the bodies of header functions, like those that follow calls do.
+  bool SkipHeaderFunctionBodies =
+      !RunsAnalyzer &&
+      Context.getOptions().SkipHeaderFunctionBodies.getValueOr(false) &&
+      llvm::none_of(Checks, [](const std::unique_ptr<ClangTidyCheck> &Check) {
+        return Check->needsHeaderFunctionBodies() ||
+               Check->needsWholeTranslationUnit();
+      });
+  if (Pipeline)
+    Pipeline->SkipHeaderFunctionBodies = SkipHeaderFunctionBodies;
+
+  auto Consumer = std::make_unique<ClangTidyASTConsumer>(
       std::move(Consumers), std::move(Profiling), std::move(Finder),
       std::move(Checks));
+  if (SkipHeaderFunctionBodies && !(Pipeline && Pipeline->SkipFunctionBodies)) {
+    // Diagnostics in the bodies of the functions of other headers would be
+    // dropped anyway.
+    auto HeaderFilter =
+        std::make_shared<llvm::Regex>(*Context.getOptions().HeaderFilterRegex);
+    Consumer->setFunctionBodySkipFilter([HeaderFilter, SM](const Decl &D) {
+      return !isInUserCode(D, *SM, *HeaderFilter);
+    });
+  }
+  return Consumer;
 }
 
 std::vector<std::string> ClangTidyASTConsumerFactory::getCheckNames() {
@@ -509,7 +886,8 @@ runClangTidy(clang::tidy::ClangTidyContext &Context,
              ArrayRef<std::string> InputFiles,
              llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
              bool ApplyAnyFix, bool EnableCheckProfile,
-             llvm::StringRef StoreCheckProfile) {
+             llvm::StringRef StoreCheckProfile,
+             std::shared_ptr<ClangTidyCheckFactories> CheckFactories) {
   ClangTool Tool(Compilations, InputFiles,
                  std::make_shared<PCHContainerOperations>(), BaseFS);
 
@@ -545,8 +923,10 @@ runClangTidy(clang::tidy::ClangTidyContext &Context,
   class ActionFactory : public FrontendActionFactory {
   public:
     ActionFactory(ClangTidyContext &Context,
-                  IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS)
-        : ConsumerFactory(Context, std::move(BaseFS)) {}
+                  IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
+                  std::shared_ptr<ClangTidyCheckFactories> CheckFactories)
+        : ConsumerFactory(Context, std::move(BaseFS),
+                          std::move(CheckFactories)) {}
     std::unique_ptr<FrontendAction> create() override {
       return std::make_unique<Action>(&ConsumerFactory);
     }
@@ -567,17 +947,34 @@ runClangTidy(clang::tidy::ClangTidyContext &Context,
       Action(ClangTidyASTConsumerFactory *Factory) : Factory(Factory) {}
       std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &Compiler,
                                                      StringRef File) override {
-        return Factory->createASTConsumer(Compiler, File);
+        return Factory->createASTConsumer(Compiler, File, &Pipeline);
+      }
+
+      void ExecuteAction() override {
+        if (!Pipeline.PreprocessorOnly) {
+          if (Pipeline.SkipFunctionBodies || Pipeline.SkipHeaderFunctionBodies)
+            getCompilerInstance().getFrontendOpts().SkipFunctionBodies = true;
+          return ASTFrontendAction::ExecuteAction();
+        }
+        // The checks only listen to the preprocessor, so don't parse.
+        Preprocessor &PP = getCompilerInstance().getPreprocessor();
+        PP.IgnorePragmas();
+        PP.EnterMainSourceFile();
+        Token Tok;
+        do
+          PP.Lex(Tok);
+        while (Tok.isNot(tok::eof));
       }
 
     private:
       ClangTidyASTConsumerFactory *Factory;
+      ClangTidyASTConsumerFactory::Pipeline Pipeline;
     };
 
     ClangTidyASTConsumerFactory ConsumerFactory;
   };
 
-  ActionFactory Factory(Context, std::move(BaseFS));
+  ActionFactory Factory(Context, std::move(BaseFS), std::move(CheckFactories));
   Tool.run(&Factory);
   return DiagConsumer.take();
 }
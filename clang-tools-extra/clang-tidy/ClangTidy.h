@@ -31,15 +31,39 @@ namespace tidy {
 
 class ClangTidyCheckFactories;
 
+/// Instantiates every registered module and collects its check factories.
+/// They don't depend on the options, so several runs may share them.
+std::shared_ptr<ClangTidyCheckFactories> createCheckFactories();
+
 class ClangTidyASTConsumerFactory {
 public:
+  /// If \p CheckFactories is null, the factories of all registered modules
+  /// are created.
   ClangTidyASTConsumerFactory(
       ClangTidyContext &Context,
-      IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> OverlayFS = nullptr);
+      IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> OverlayFS = nullptr,
+      std::shared_ptr<ClangTidyCheckFactories> CheckFactories = nullptr);
+
+  /// The cheapest frontend that runs the checks of a translation unit.
+  struct Pipeline {
+    /// Only preprocess the translation unit, don't parse it.
+    bool PreprocessorOnly = false;
+    /// Don't parse the bodies of functions.
+    bool SkipFunctionBodies = false;
+    /// Don't parse the bodies of functions in headers whose diagnostics
+    /// aren't reported.
+    bool SkipHeaderFunctionBodies = false;
+  };
 
   /// Returns an ASTConsumer that runs the specified clang-tidy checks.
+  ///
+  /// If \p Pipeline is given, it is set to the frontend that the checks need,
+  /// from what they tell of themselves, e.g. with
+  /// ClangTidyCheck::needsOnlyPreprocessor(). The caller may then run less
+  /// than a full parse of the translation unit.
   std::unique_ptr<clang::ASTConsumer>
-  createASTConsumer(clang::CompilerInstance &Compiler, StringRef File);
+  createASTConsumer(clang::CompilerInstance &Compiler, StringRef File,
+                    Pipeline *Pipeline = nullptr);
 
   /// Get the list of enabled checks.
   std::vector<std::string> getCheckNames();
@@ -50,7 +74,7 @@ public:
 private:
   ClangTidyContext &Context;
   IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> OverlayFS;
-  std::unique_ptr<ClangTidyCheckFactories> CheckFactories;
+  std::shared_ptr<ClangTidyCheckFactories> CheckFactories;
 };
 
 /// Fills the list of check names that are enabled when the provided
@@ -83,13 +107,16 @@ getCheckOptions(const ClangTidyOptions &Options,
 /// \param StoreCheckProfile If provided, and EnableCheckProfile is true,
 /// the profile will not be output to stderr, but will instead be stored
 /// as a JSON file in the specified directory.
+/// \param CheckFactories If provided, the checks are created from these
+/// instead of instantiating the modules again, see createCheckFactories().
 std::vector<ClangTidyError>
 runClangTidy(clang::tidy::ClangTidyContext &Context,
              const tooling::CompilationDatabase &Compilations,
              ArrayRef<std::string> InputFiles,
              llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
              bool ApplyAnyFix, bool EnableCheckProfile = false,
-             llvm::StringRef StoreCheckProfile = StringRef());
+             llvm::StringRef StoreCheckProfile = StringRef(),
+             std::shared_ptr<ClangTidyCheckFactories> CheckFactories = nullptr);
 
 /// Controls what kind of fixes clang-tidy is allowed to apply.
 enum FixBehaviour {
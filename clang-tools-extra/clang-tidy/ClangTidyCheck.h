@@ -69,6 +69,57 @@ public:
     return true;
   }
 
+  /// Override this to return true if the check needs to traverse the whole
+  /// translation unit even when clang-tidy runs with a line filter.
+  ///
+  /// With a line filter, the AST matchers of other checks only traverse the
+  /// declarations that overlap the filtered lines, as diagnostics outside of
+  /// them are dropped anyway. Checks that report on one declaration based on
+  /// what they find in others, e.g. on its uses, need to see all of them.
+  virtual bool needsWholeTranslationUnit() const { return false; }
+
+  /// Override this to return true if the check registers ``PPCallbacks`` in
+  /// the ``ModuleExpanderPP`` passed to registerPPCallbacks().
+  ///
+  /// Expanding modular headers preprocesses the whole translation unit a
+  /// second time, so clang-tidy only does it if an enabled check needs it.
+  virtual bool needsExpandedModularHeaders() const { return false; }
+
+  /// Override this to return true if the check only uses the ``PPCallbacks``
+  /// it registers in registerPPCallbacks(), and no AST matchers.
+  ///
+  /// When all enabled checks only need the preprocessor, clang-tidy skips
+  /// parsing and just preprocesses the translation unit. The check must then
+  /// report everything from its ``PPCallbacks``, as onEndOfTranslationUnit()
+  /// isn't called.
+  virtual bool needsOnlyPreprocessor() const { return false; }
+
+  /// Override this to return false if the check doesn't need to match nodes
+  /// in implicit template instantiations, e.g. if all its matchers are
+  /// restricted with ``unless(isInTemplateInstantiation())``.
+  ///
+  /// When no enabled check needs them, the AST matchers don't traverse
+  /// template instantiations.
+  virtual bool needsTemplateInstantiations() const { return true; }
+
+  /// Override this to return false if the check doesn't need to match nodes
+  /// in function bodies.
+  ///
+  /// When no enabled check needs them, clang-tidy skips parsing the bodies of
+  /// functions, like ``-fskip-function-bodies``. Bodies that are needed to
+  /// parse the rest of the code, like those of constexpr functions, are still
+  /// parsed.
+  virtual bool needsFunctionBodies() const { return true; }
+
+  /// Override this to return true if the check needs the bodies of functions
+  /// in headers whose diagnostics aren't reported, e.g. to follow the calls
+  /// made by the functions it reports on.
+  ///
+  /// With the ``SkipHeaderFunctionBodies`` option, clang-tidy skips parsing
+  /// these bodies, unless an enabled check needs them. Checks that need the
+  /// whole translation unit are assumed to need them as well.
+  virtual bool needsHeaderFunctionBodies() const { return false; }
+
   /// Override this to register ``PPCallbacks`` in the preprocessor.
   ///
   /// This should be used for clang-tidy checks that analyze preprocessor-
@@ -85,8 +136,9 @@ public:
   ///    non-modular mode, which allows it to generate PPCallbacks not only for
   ///    the main file and textual headers, but also for all transitively
   ///    included modular headers when the analysis runs with modules enabled.
-  ///    When modules are not enabled ModuleExpanderPP just points to the real
-  ///    preprocessor.
+  ///    When modules are not enabled, or no enabled check returns true from
+  ///    needsExpandedModularHeaders(), ModuleExpanderPP just points to the
+  ///    real preprocessor.
   virtual void registerPPCallbacks(const SourceManager &SM, Preprocessor *PP,
                                    Preprocessor *ModuleExpanderPP) {}
 
@@ -131,6 +131,8 @@ template <> struct MappingTraits<ClangTidyOptions> {
     IO.mapOptional("ExtraArgsBefore", Options.ExtraArgsBefore);
     IO.mapOptional("InheritParentConfig", Options.InheritParentConfig);
     IO.mapOptional("UseColor", Options.UseColor);
+    IO.mapOptional("SkipHeaderFunctionBodies",
+                   Options.SkipHeaderFunctionBodies);
   }
 };
 
@@ -185,6 +187,7 @@ ClangTidyOptions &ClangTidyOptions::mergeWith(const ClangTidyOptions &Other,
   overrideValue(FormatStyle, Other.FormatStyle);
   overrideValue(User, Other.User);
   overrideValue(UseColor, Other.UseColor);
+  overrideValue(SkipHeaderFunctionBodies, Other.SkipHeaderFunctionBodies);
   mergeVectors(ExtraArgs, Other.ExtraArgs);
   mergeVectors(ExtraArgsBefore, Other.ExtraArgsBefore);
 
@@ -136,6 +136,10 @@ struct ClangTidyOptions {
 
   /// Use colors in diagnostics. If missing, it will be auto detected.
   llvm::Optional<bool> UseColor;
+
+  /// Don't parse the bodies of functions in headers whose warnings aren't
+  /// displayed, unless an enabled check needs them.
+  llvm::Optional<bool> SkipHeaderFunctionBodies;
 };
 
 /// Abstract interface for retrieving various ClangTidy options.
@@ -49,6 +49,9 @@ public:
     FilesToRecord.erase(File);
   }
 
+  /// Whether some files still need their contents to be recorded.
+  bool hasFilesToRecord() const { return !FilesToRecord.empty(); }
+
   /// Makes sure we have contents for all the files we were interested in. Ideally
   /// `FilesToRecord` should be empty.
   void checkAllFilesRecorded() {
@@ -130,15 +133,22 @@ void ExpandModularHeadersPPCallbacks::handleModuleFile(
 }
 
 void ExpandModularHeadersPPCallbacks::parseToLocation(SourceLocation Loc) {
-  // Load all source locations present in the external sources.
-  for (unsigned I = 0, N = Sources.loaded_sloc_entry_size(); I != N; ++I) {
-    Sources.getLoadedSLocEntry(I, nullptr);
-  }
-  // Record contents of files we are interested in and add to the FileSystem.
-  for (auto It = Sources.fileinfo_begin(); It != Sources.fileinfo_end(); ++It) {
-    Recorder->recordFileContent(It->getFirst(), *It->getSecond(), *InMemoryFs);
+  // This runs for every callback, e.g. for every macro expansion, so only walk
+  // the source manager when an imported module added files to record.
+  if (Recorder->hasFilesToRecord()) {
+    // Load all source locations present in the external sources.
+    for (unsigned I = 0, N = Sources.loaded_sloc_entry_size(); I != N; ++I) {
+      Sources.getLoadedSLocEntry(I, nullptr);
+    }
+    // Record contents of files we are interested in and add to the
+    // FileSystem.
+    for (auto It = Sources.fileinfo_begin(); It != Sources.fileinfo_end();
+         ++It) {
+      Recorder->recordFileContent(It->getFirst(), *It->getSecond(),
+                                  *InMemoryFs);
+    }
+    Recorder->checkAllFilesRecorded();
   }
-  Recorder->checkAllFilesRecorded();
 
   if (!StartedLexing) {
     StartedLexing = true;
@@ -30,6 +30,7 @@ class BoolPointerImplicitConversionCheck : public ClangTidyCheck {
 public:
   BoolPointerImplicitConversionCheck(StringRef Name, ClangTidyContext *Context)
       : ClangTidyCheck(Name, Context) {}
+  bool needsTemplateInstantiations() const override { return false; }
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
 };
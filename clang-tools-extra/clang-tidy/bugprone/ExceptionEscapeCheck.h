@@ -31,6 +31,7 @@ public:
     return LangOpts.CPlusPlus && LangOpts.CXXExceptions;
   }
   void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
+  bool needsHeaderFunctionBodies() const override { return true; }
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
 
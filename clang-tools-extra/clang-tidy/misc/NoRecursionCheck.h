@@ -28,6 +28,7 @@ class NoRecursionCheck : public ClangTidyCheck {
 public:
   NoRecursionCheck(StringRef Name, ClangTidyContext *Context)
       : ClangTidyCheck(Name, Context) {}
+  bool needsHeaderFunctionBodies() const override { return true; }
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
 
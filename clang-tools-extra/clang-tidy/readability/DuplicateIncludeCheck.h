@@ -24,6 +24,7 @@ public:
   DuplicateIncludeCheck(StringRef Name, ClangTidyContext *Context)
       : ClangTidyCheck(Name, Context) {}
 
+  bool needsOnlyPreprocessor() const override { return true; }
   void registerPPCallbacks(const SourceManager &SM, Preprocessor *PP,
                            Preprocessor *ModuleExpanderPP) override;
 };
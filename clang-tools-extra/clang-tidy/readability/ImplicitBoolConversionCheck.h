@@ -26,6 +26,7 @@ public:
     return LangOpts.Bool;
   }
   void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
+  bool needsTemplateInstantiations() const override { return false; }
   void registerMatchers(ast_matchers::MatchFinder *Finder) override;
   void check(const ast_matchers::MatchFinder::MatchResult &Result) override;
 
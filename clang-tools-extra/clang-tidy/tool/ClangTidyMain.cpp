@@ -15,17 +15,21 @@
 //===----------------------------------------------------------------------===//
 
 #include "ClangTidyMain.h"
+#include "../CachingFileSystem.h"
 #include "../ClangTidy.h"
 #include "../ClangTidyForceLinker.h"
 #include "../GlobList.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/PluginLoader.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/WithColor.h"
+#include <cstdio>
 
 using namespace clang::tooling;
 using namespace llvm;
@@ -109,6 +113,9 @@ JSON array of objects:
     {"name":"file1.cpp","lines":[[1,3],[5,7]]},
     {"name":"file2.h"}
   ]
+Declarations outside of these line ranges are
+not analyzed, except by checks that need the
+whole translation unit.
 )"),
                                        cl::init(""),
                                        cl::cat(ClangTidyCategory));
@@ -256,12 +263,60 @@ This option overrides the 'UseColor' option in
 )"),
                               cl::init(false), cl::cat(ClangTidyCategory));
 
+static cl::opt<bool> SkipHeaderFunctionBodies("skip-header-function-bodies",
+                                              cl::desc(R"(
+Don't parse the bodies of the functions in
+headers whose warnings aren't displayed, unless
+an enabled check needs them. Compiler errors in
+these bodies go unnoticed.
+This option overrides the
+'SkipHeaderFunctionBodies' option in
+.clang-tidy file, if any.
+)"),
+                                              cl::init(false),
+                                              cl::cat(ClangTidyCategory));
+
 static cl::opt<bool> VerifyConfig("verify-config", cl::desc(R"(
 Check the config files to ensure each check and
 option is recognized.
 )"),
                                   cl::init(false), cl::cat(ClangTidyCategory));
 
+static cl::opt<bool> Batch("batch", cl::desc(R"(
+Read jobs from standard input instead of
+analyzing the files given on the command line.
+Each line is a job, either the path of a file
+to analyze, or -line-filter=<filter>: clang-tidy
+analyzes the files the filter names and only
+reports diagnostics in their line ranges. After
+the diagnostics of each job, clang-tidy prints
+the line
+  --- clang-tidy: end of job ---
+to standard output, preceded by the line
+  --- clang-tidy: job failed ---
+if the job found compiler errors or failed. Configuration files, the
+checks' modules and the compilation database are
+only loaded once. Unless given with -p or after
+'--', the database is found from the first file
+to analyze. With -export-fixes=<dir>/fixes.yaml,
+the fixes of each job are written as soon as it
+is done, to <dir>/fixes-<N>.yaml for the Nth job.
+The files read are cached for the whole run, so
+they must not be modified by others meanwhile.
+)"),
+                           cl::init(false), cl::cat(ClangTidyCategory));
+
+static cl::opt<bool> PrescanIncludeDirs("prescan-include-dirs", cl::desc(R"(
+List the include directories of each file before
+analyzing it, so that looking up a header in the
+directories that don't have it doesn't access
+the file system. Assumes that the file system is
+case sensitive, and that no files are created in
+these directories while clang-tidy runs.
+)"),
+                                        cl::init(false),
+                                        cl::cat(ClangTidyCategory));
+
 namespace clang {
 namespace tidy {
 
@@ -326,6 +381,8 @@ static std::unique_ptr<ClangTidyOptionsProvider> createOptionsProvider(
     OverrideOptions.FormatStyle = FormatStyle;
   if (UseColor.getNumOccurrences() > 0)
     OverrideOptions.UseColor = UseColor;
+  if (SkipHeaderFunctionBodies.getNumOccurrences() > 0)
+    OverrideOptions.SkipHeaderFunctionBodies = SkipHeaderFunctionBodies;
 
   auto LoadConfig =
       [&](StringRef Configuration,
@@ -458,6 +515,253 @@ static bool verifyChecks(const StringSet<> &AllChecks, StringRef CheckGlob,
   return AnyInvalid;
 }
 
+static void printCacheStats(const CachingFileSystem &Cache) {
+  CachingFileSystem::Statistics Stats = Cache.getStatistics();
+  auto Print = [](StringRef Name, unsigned Hits, unsigned Misses) {
+    unsigned Total = Hits + Misses;
+    llvm::errs() << "  " << Name << ": " << Hits << " of " << Total
+                 << " from the cache ("
+                 << llvm::format("%.1f", Total ? 100.0 * Hits / Total : 0.0)
+                 << "%)\n";
+  };
+  llvm::errs() << "File system cache:\n";
+  Print("stats", Stats.StatHits, Stats.StatMisses);
+  Print("reads", Stats.ReadHits, Stats.ReadMisses);
+}
+
+/// Lists the directory of each of \p Files and its include directories, see
+/// -prescan-include-dirs.
+static void prescanIncludeDirectories(CachingFileSystem &Cache,
+                                      const CompilationDatabase &Compilations,
+                                      ArrayRef<std::string> Files) {
+  static const StringRef IncludeFlags[] = {"-isystem", "-iquote", "-idirafter",
+                                           "-I"};
+  for (const std::string &File : Files) {
+    for (const CompileCommand &Command :
+         Compilations.getCompileCommands(File)) {
+      auto Scan = [&](StringRef Dir) {
+        SmallString<256> Path(Dir);
+        llvm::sys::fs::make_absolute(Command.Directory, Path);
+        Cache.scanDirectory(Path);
+      };
+      Scan(llvm::sys::path::parent_path(Command.Filename));
+      for (size_t I = 0, E = Command.CommandLine.size(); I < E; ++I) {
+        StringRef Arg = Command.CommandLine[I];
+        for (StringRef Flag : IncludeFlags) {
+          if (!Arg.startswith(Flag))
+            continue;
+          if (Arg.size() > Flag.size())
+            Scan(Arg.drop_front(Flag.size()));
+          else if (I + 1 < E)
+            Scan(Command.CommandLine[++I]);
+          break;
+        }
+      }
+    }
+  }
+}
+
+/// Analyzes \p Files, reports their diagnostics and applies their fixes.
+/// Appends the diagnostics to \p Errors, and returns the exit code.
+static int runAndReport(ClangTidyContext &Context,
+                        const CompilationDatabase &Compilations,
+                        ArrayRef<std::string> Files,
+                        IntrusiveRefCntPtr<vfs::OverlayFileSystem> BaseFS,
+                        CachingFileSystem &Cache, StringRef ProfilePrefix,
+                        std::vector<ClangTidyError> &Errors,
+                        std::shared_ptr<ClangTidyCheckFactories>
+                            CheckFactories = nullptr) {
+  if (PrescanIncludeDirs)
+    prescanIncludeDirectories(Cache, Compilations, Files);
+  std::vector<ClangTidyError> FileErrors =
+      runClangTidy(Context, Compilations, Files, BaseFS, FixNotes,
+                   EnableCheckProfile, ProfilePrefix,
+                   std::move(CheckFactories));
+  bool FoundErrors = llvm::find_if(FileErrors, [](const ClangTidyError &E) {
+                       return E.DiagLevel == ClangTidyError::Error;
+                     }) != FileErrors.end();
+
+  // --fix-errors and --fix-notes imply --fix.
+  FixBehaviour Behaviour = FixNotes             ? FB_FixNotes
+                           : (Fix || FixErrors) ? FB_Fix
+                                                : FB_NoFix;
+
+  const bool DisableFixes = FoundErrors && !FixErrors;
+
+  unsigned WErrorCount = 0;
+
+  handleErrors(FileErrors, Context, DisableFixes ? FB_NoFix : Behaviour,
+               WErrorCount, BaseFS);
+  // The cache would hide the fixes from the files analyzed next.
+  if (!DisableFixes && Behaviour != FB_NoFix)
+    for (const ClangTidyError &Error : FileErrors) {
+      for (const auto &FileAndReplacements : Error.Message.Fix)
+        Cache.invalidate(FileAndReplacements.first());
+      for (const auto &Note : Error.Notes)
+        for (const auto &FileAndReplacements : Note.Fix)
+          Cache.invalidate(FileAndReplacements.first());
+    }
+  Errors.insert(Errors.end(), FileErrors.begin(), FileErrors.end());
+
+  if (!Quiet) {
+    printStats(Context.getStats());
+    if (DisableFixes && Behaviour != FB_NoFix)
+      llvm::errs()
+          << "Found compiler errors, but -fix-errors was not specified.\n"
+             "Fixes have NOT been applied.\n\n";
+  }
+
+  if (WErrorCount) {
+    if (!Quiet) {
+      StringRef Plural = WErrorCount == 1 ? "" : "s";
+      llvm::errs() << WErrorCount << " warning" << Plural << " treated as error"
+                   << Plural << "\n";
+    }
+    return 1;
+  }
+
+  if (FoundErrors) {
+    // TODO: Figure out when zero exit code should be used with -fix-errors:
+    //   a. when a fix has been applied for an error
+    //   b. when a fix has been applied for all errors
+    //   c. some other condition.
+    // For now always returning zero when -fix-errors is used.
+    if (FixErrors)
+      return 0;
+    if (!Quiet)
+      llvm::errs() << "Found compiler error(s).\n";
+    return 1;
+  }
+
+  return 0;
+}
+
+namespace {
+
+/// Forwards to the options provider of a batch, so that the configuration
+/// files it caches are shared by all its jobs, with the line filter of one job.
+class JobOptionsProvider : public ClangTidyOptionsProvider {
+public:
+  JobOptionsProvider(ClangTidyOptionsProvider &BatchOptions,
+                     ClangTidyGlobalOptions GlobalOptions)
+      : BatchOptions(BatchOptions), GlobalOptions(std::move(GlobalOptions)) {}
+
+  const ClangTidyGlobalOptions &getGlobalOptions() override {
+    return GlobalOptions;
+  }
+
+  std::vector<OptionsSource> getRawOptions(StringRef FileName) override {
+    return BatchOptions.getRawOptions(FileName);
+  }
+
+private:
+  ClangTidyOptionsProvider &BatchOptions;
+  ClangTidyGlobalOptions GlobalOptions;
+};
+
+} // namespace
+
+/// Reads a line from \p In into \p Line, without the line break. Returns
+/// false at the end of the input.
+static bool readLine(std::FILE *In, std::string &Line) {
+  Line.clear();
+  char Buffer[4096];
+  while (std::fgets(Buffer, sizeof(Buffer), In)) {
+    Line += Buffer;
+    if (Line.back() == '\n') {
+      Line.pop_back();
+      return true;
+    }
+  }
+  return !Line.empty();
+}
+
+/// Writes the fixes of the job \p Job of a batch next to -export-fixes.
+static bool exportJobFixes(unsigned Job,
+                           const std::vector<ClangTidyError> &Errors) {
+  SmallString<256> Path(ExportFixes);
+  std::string Extension = std::string(llvm::sys::path::extension(Path));
+  llvm::sys::path::replace_extension(Path, "");
+  Path += "-" + std::to_string(Job) + Extension;
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::OF_None);
+  if (EC) {
+    llvm::errs() << "Error opening output file: " << EC.message() << '\n';
+    return false;
+  }
+  exportReplacements("", Errors, OS);
+  return true;
+}
+
+/// Runs the jobs read from standard input, see -batch.
+/// Each job still gets its own FileManager: one kept across jobs would hold the
+/// old sizes of the files that -fix rewrote. \p Cache keeps the file system
+/// accesses warm instead.
+static int runBatch(ClangTidyOptionsProvider &OptionsProvider,
+                    CommonOptionsParser &OptionsParser,
+                    IntrusiveRefCntPtr<vfs::OverlayFileSystem> BaseFS,
+                    CachingFileSystem &Cache, StringRef ProfilePrefix) {
+  CompilationDatabase *Compilations = nullptr;
+  std::shared_ptr<ClangTidyCheckFactories> CheckFactories =
+      createCheckFactories();
+  int ExitCode = 0;
+  unsigned Job = 0;
+  std::string Line;
+  while (readLine(stdin, Line)) {
+    ++Job;
+    bool Failed = false;
+    ClangTidyGlobalOptions GlobalOptions;
+    std::vector<std::string> Files;
+    std::error_code Err;
+    StringRef JobLine = StringRef(Line).trim();
+    if (JobLine.consume_front("-line-filter=")) {
+      Err = parseLineFilter(JobLine, GlobalOptions);
+      for (const FileFilter &Filter : GlobalOptions.LineFilter)
+        if (!llvm::is_contained(Files, Filter.Name))
+          Files.push_back(Filter.Name);
+    } else {
+      // A file analyzed with the options of the command line.
+      GlobalOptions = OptionsProvider.getGlobalOptions();
+      if (!JobLine.empty())
+        Files.push_back(std::string(JobLine));
+    }
+    if (Err) {
+      llvm::errs() << "Invalid job: " << Err.message() << "\n";
+      Failed = true;
+    } else {
+      ClangTidyContext Context(
+          std::make_unique<JobOptionsProvider>(OptionsProvider,
+                                               std::move(GlobalOptions)),
+          AllowEnablingAnalyzerAlphaCheckers);
+      if (!Files.empty()) {
+        // -batch takes no files on the command line, so the database is
+        // detected from the first job, unless given with -p or after '--'.
+        if (!Compilations)
+          Compilations = &OptionsParser.loadCompilations(Files.front());
+        std::vector<ClangTidyError> Errors;
+        Failed = runAndReport(Context, *Compilations, Files, BaseFS, Cache,
+                              ProfilePrefix, Errors, CheckFactories);
+        // Written now rather than at the end, so that they aren't lost if the
+        // process is killed during a later job.
+        if (!ExportFixes.empty() && !Errors.empty() &&
+            !exportJobFixes(Job, Errors))
+          Failed = true;
+      }
+    }
+    llvm::errs().flush();
+    if (Failed) {
+      ExitCode = 1;
+      llvm::outs() << "--- clang-tidy: job failed ---\n";
+    }
+    llvm::outs() << "--- clang-tidy: end of job ---\n";
+    llvm::outs().flush();
+  }
+
+  if (EnableCheckProfile && !Quiet)
+    printCacheStats(Cache);
+  return ExitCode;
+}
+
 int clangTidyMain(int argc, const char **argv) {
   llvm::InitLLVM X(argc, argv);
 
@@ -473,8 +777,11 @@ int clangTidyMain(int argc, const char **argv) {
     return 1;
   }
 
+  // Shared by the translation units, the configuration files and the fixes.
+  llvm::IntrusiveRefCntPtr<CachingFileSystem> Cache(
+      new CachingFileSystem(vfs::getRealFileSystem()));
   llvm::IntrusiveRefCntPtr<vfs::OverlayFileSystem> BaseFS(
-      new vfs::OverlayFileSystem(vfs::getRealFileSystem()));
+      new vfs::OverlayFileSystem(Cache));
 
   if (!VfsOverlay.empty()) {
     IntrusiveRefCntPtr<vfs::FileSystem> VfsFromFile =
@@ -589,7 +896,13 @@ int clangTidyMain(int argc, const char **argv) {
     return 1;
   }
 
-  if (PathList.empty()) {
+  if (Batch) {
+    if (!PathList.empty()) {
+      llvm::errs() << "Error: -batch reads the files to analyze from standard "
+                      "input.\n";
+      return 1;
+    }
+  } else if (PathList.empty()) {
     llvm::errs() << "Error: no input files specified.\n";
     llvm::cl::PrintHelpMessage(/*Hidden=*/false, /*Categorized=*/true);
     return 1;
@@ -599,26 +912,17 @@ int clangTidyMain(int argc, const char **argv) {
   llvm::InitializeAllTargetMCs();
   llvm::InitializeAllAsmParsers();
 
+  if (Batch)
+    return runBatch(*OptionsProvider, *OptionsParser, BaseFS, *Cache,
+                    ProfilePrefix);
+
   ClangTidyContext Context(std::move(OwningOptionsProvider),
                            AllowEnablingAnalyzerAlphaCheckers);
-  std::vector<ClangTidyError> Errors =
-      runClangTidy(Context, OptionsParser->getCompilations(), PathList, BaseFS,
-                   FixNotes, EnableCheckProfile, ProfilePrefix);
-  bool FoundErrors = llvm::find_if(Errors, [](const ClangTidyError &E) {
-                       return E.DiagLevel == ClangTidyError::Error;
-                     }) != Errors.end();
-
-  // --fix-errors and --fix-notes imply --fix.
-  FixBehaviour Behaviour = FixNotes             ? FB_FixNotes
-                           : (Fix || FixErrors) ? FB_Fix
-                                                : FB_NoFix;
-
-  const bool DisableFixes = FoundErrors && !FixErrors;
-
-  unsigned WErrorCount = 0;
-
-  handleErrors(Errors, Context, DisableFixes ? FB_NoFix : Behaviour,
-               WErrorCount, BaseFS);
+  std::vector<ClangTidyError> Errors;
+  int ExitCode = runAndReport(Context, OptionsParser->getCompilations(),
+                              PathList, BaseFS, *Cache, ProfilePrefix, Errors);
+  if (EnableCheckProfile && !Quiet)
+    printCacheStats(*Cache);
 
   if (!ExportFixes.empty() && !Errors.empty()) {
     std::error_code EC;
@@ -630,37 +934,7 @@ int clangTidyMain(int argc, const char **argv) {
     exportReplacements(FilePath.str(), Errors, OS);
   }
 
-  if (!Quiet) {
-    printStats(Context.getStats());
-    if (DisableFixes && Behaviour != FB_NoFix)
-      llvm::errs()
-          << "Found compiler errors, but -fix-errors was not specified.\n"
-             "Fixes have NOT been applied.\n\n";
-  }
-
-  if (WErrorCount) {
-    if (!Quiet) {
-      StringRef Plural = WErrorCount == 1 ? "" : "s";
-      llvm::errs() << WErrorCount << " warning" << Plural << " treated as error"
-                   << Plural << "\n";
-    }
-    return 1;
-  }
-
-  if (FoundErrors) {
-    // TODO: Figure out when zero exit code should be used with -fix-errors:
-    //   a. when a fix has been applied for an error
-    //   b. when a fix has been applied for all errors
-    //   c. some other condition.
-    // For now always returning zero when -fix-errors is used.
-    if (FixErrors)
-      return 0;
-    if (!Quiet)
-      llvm::errs() << "Found compiler error(s).\n";
-    return 1;
-  }
-
-  return 0;
+  return ExitCode;
 }
 
 } // namespace tidy
@@ -49,45 +49,112 @@ else:
     import queue as queue
 
 
-def run_tidy(task_queue, lock, timeout):
-  watchdog = None
+# Printed by clang-tidy -batch after the diagnostics of each job, preceded by
+# JOB_FAILED if the job failed.
+JOB_END = '--- clang-tidy: end of job ---'
+JOB_FAILED = '--- clang-tidy: job failed ---'
+
+
+def forward_stderr(stream, lock):
+  for line in iter(stream.readline, b''):
+    with lock:
+      sys.stderr.write(line.decode('utf-8'))
+      sys.stderr.flush()
+
+
+def start_tidy(command, tmpdir, lock):
+  """Starts a clang-tidy process that runs the jobs it reads on stdin"""
+  command = list(command)
+  if tmpdir is not None:
+    # Get a unique temporary name. clang-tidy writes the fixes of each job as
+    # soon as it is done, to this name with the number of the job appended, so
+    # they are kept even if the process is killed later on.
+    (handle, tmp_name) = tempfile.mkstemp(suffix='.yaml', dir=tmpdir)
+    os.close(handle)
+    command.insert(1, '-export-fixes=' + tmp_name)
+  proc = subprocess.Popen(command,
+                          stdin=subprocess.PIPE,
+                          stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE)
+  t = threading.Thread(target=forward_stderr, args=(proc.stderr, lock))
+  t.daemon = True
+  t.start()
+  return proc
+
+
+def run_tidy(task_queue, lock, timeout, command, tmpdir):
+  # Each worker keeps one clang-tidy process for all its jobs, so that the
+  # compilation database and the configuration files are only read once.
+  proc = None
   while True:
-    command = task_queue.get()
-    try:
-      proc = subprocess.Popen(command,
-                              stdout=subprocess.PIPE,
-                              stderr=subprocess.PIPE)
+    job = task_queue.get()
+    if job is None:
+      if proc is not None:
+        proc.stdin.close()
+        proc.wait()
+      task_queue.task_done()
+      return
 
+    watchdog = None
+    try:
+      if proc is None:
+        proc = start_tidy(command, tmpdir, lock)
       if timeout is not None:
         watchdog = threading.Timer(timeout, proc.kill)
         watchdog.start()
 
-      stdout, stderr = proc.communicate()
+      proc.stdin.write((job + '\n').encode('utf-8'))
+      proc.stdin.flush()
+      output = []
+      finished = False
+      failed = False
+      for line in iter(proc.stdout.readline, b''):
+        line = line.decode('utf-8')
+        if line.rstrip('\r\n') == JOB_FAILED:
+          failed = True
+          continue
+        if line.rstrip('\r\n') == JOB_END:
+          finished = True
+          break
+        output.append(line)
 
       with lock:
-        sys.stdout.write(stdout.decode('utf-8') + '\n')
+        sys.stdout.write(''.join(output) + '\n')
         sys.stdout.flush()
-        if stderr:
-          sys.stderr.write(stderr.decode('utf-8') + '\n')
-          sys.stderr.flush()
+        if not finished:
+          if watchdog is not None and not watchdog.is_alive():
+            sys.stderr.write('Terminated by timeout: ' + job + '\n')
+          else:
+            sys.stderr.write('Failed: ' + job + '\n')
+        elif failed:
+          sys.stderr.write('Failed: ' + job + '\n')
+      if not finished:
+        # Start afresh for the next job.
+        proc.wait()
+        proc = None
     except Exception as e:
       with lock:
-        sys.stderr.write('Failed: ' + str(e) + ': '.join(command) + '\n')
+        sys.stderr.write('Failed: ' + str(e) + ': ' + job + '\n')
+      if proc is not None:
+        proc.kill()
+        proc.wait()
+        proc = None
     finally:
-      with lock:
-        if not (timeout is None or watchdog is None):
-          if not watchdog.is_alive():
-              sys.stderr.write('Terminated by timeout: ' +
-                               ' '.join(command) + '\n')
-          watchdog.cancel()
+      if watchdog is not None:
+        watchdog.cancel()
       task_queue.task_done()
 
 
-def start_workers(max_tasks, tidy_caller, task_queue, lock, timeout):
+def start_workers(max_tasks, tidy_caller, task_queue, lock, timeout, command,
+                  tmpdir):
+  workers = []
   for _ in range(max_tasks):
-    t = threading.Thread(target=tidy_caller, args=(task_queue, lock, timeout))
+    t = threading.Thread(target=tidy_caller,
+                         args=(task_queue, lock, timeout, command, tmpdir))
     t.daemon = True
     t.start()
+    workers.append(t)
+  return workers
 
 
 def merge_replacement_files(tmpdir, mergefile):
@@ -213,14 +280,6 @@ def main():
   if yaml and args.export_fixes:
     tmpdir = tempfile.mkdtemp()
 
-  # Tasks for clang-tidy.
-  task_queue = queue.Queue(max_task_count)
-  # A lock for console output.
-  lock = threading.Lock()
-
-  # Run a pool of clang-tidy workers.
-  start_workers(max_task_count, run_tidy, task_queue, lock, args.timeout)
-
   # Form the common args list.
   common_clang_tidy_args = []
   if args.fix:
@@ -240,28 +299,30 @@ def main():
   for plugin in args.plugins:
     common_clang_tidy_args.append('-load=%s' % plugin)
 
+  command = [args.clang_tidy_binary, '-batch']
+  command.extend(common_clang_tidy_args)
+  command.extend(clang_tidy_args)
+
+  # Tasks for clang-tidy.
+  task_queue = queue.Queue(max_task_count)
+  # A lock for console output.
+  lock = threading.Lock()
+
+  # Run a pool of clang-tidy workers.
+  workers = start_workers(max_task_count, run_tidy, task_queue, lock,
+                          args.timeout, command, tmpdir)
+
   for name in lines_by_file:
-    line_filter_json = json.dumps(
+    # Run clang-tidy on files containing changes.
+    task_queue.put('-line-filter=' + json.dumps(
       [{"name": name, "lines": lines_by_file[name]}],
-      separators=(',', ':'))
+      separators=(',', ':')))
 
-    # Run clang-tidy on files containing changes.
-    command = [args.clang_tidy_binary]
-    command.append('-line-filter=' + line_filter_json)
-    if yaml and args.export_fixes:
-      # Get a temporary file. We immediately close the handle so clang-tidy can
-      # overwrite it.
-      (handle, tmp_name) = tempfile.mkstemp(suffix='.yaml', dir=tmpdir)
-      os.close(handle)
-      command.append('-export-fixes=' + tmp_name)
-    command.extend(common_clang_tidy_args)
-    command.append(name)
-    command.extend(clang_tidy_args)
-
-    task_queue.put(command)
-
-  # Wait for all threads to be done.
-  task_queue.join()
+  # Stop the workers once all the jobs are done.
+  for _ in workers:
+    task_queue.put(None)
+  for worker in workers:
+    worker.join()
 
   if yaml and args.export_fixes:
     print('Writing fixes to ' + args.export_fixes + ' ...')
@@ -37,9 +37,11 @@ http://clang.llvm.org/docs/HowToSetupToolingForLLVM.html
 from __future__ import print_function
 
 import argparse
+import collections
 import glob
 import json
 import multiprocessing
+import multiprocessing.pool
 import os
 import queue
 import re
@@ -48,6 +50,7 @@ import subprocess
 import sys
 import tempfile
 import threading
+import time
 import traceback
 
 try:
@@ -128,10 +131,108 @@ def get_tidy_invocation(f, clang_tidy_binary, checks, tmpdir, build_path,
       start.append('-config=' + config)
   for plugin in plugins:
       start.append('-load=' + plugin)
-  start.append(f)
+  if f is not None:
+    start.append(f)
   return start
 
 
+# Printed by clang-tidy -batch after the diagnostics of each job, preceded by
+# JOB_FAILED if the job failed.
+JOB_END = b'--- clang-tidy: end of job ---'
+JOB_FAILED = b'--- clang-tidy: job failed ---'
+
+# The rough cost of an #include, in bytes of source, used to estimate the cost
+# of files that were not timed yet.
+INCLUDE_COST = 20000
+
+INCLUDE_RE = re.compile(
+    r'^[ \t]*#[ \t]*(?:include|import)[ \t]*[<"]([^>"]+)[>"]', re.MULTILINE)
+
+
+def scan_file(name):
+  """Returns the estimated cost of a file and the headers it includes."""
+  try:
+    with open(name, 'rb') as f:
+      content = f.read().decode('utf-8', 'replace')
+  except EnvironmentError:
+    return 0, frozenset()
+  includes = frozenset(INCLUDE_RE.findall(content))
+  return len(content) + INCLUDE_COST * len(includes), includes
+
+
+def load_timings(path):
+  """Reads the analysis time of each file recorded by a previous run."""
+  if not path or not os.path.isfile(path):
+    return {}
+  try:
+    with open(path, 'r') as f:
+      return json.load(f)
+  except ValueError:
+    return {}
+
+
+def save_timings(path, timings):
+  tmp_path = path + '.tmp'
+  with open(tmp_path, 'w') as f:
+    json.dump(timings, f, indent=0, sort_keys=True)
+  os.replace(tmp_path, path)
+
+
+def estimate_costs(estimates, timings):
+  """Returns the expected analysis time of each file: the recorded one if any,
+  or its estimate scaled like the files that were timed."""
+  timed = [f for f in estimates if f in timings and estimates[f] > 0]
+  scale = 1.0
+  if timed:
+    scale = (sum(timings[f] for f in timed) /
+             sum(estimates[f] for f in timed))
+  return dict((f, timings[f] if f in timings else estimates[f] * scale)
+              for f in estimates)
+
+
+def make_batches(costs, includes, max_task):
+  """Groups the files that include the same headers, so that the same
+  clang-tidy process analyzes them one after the other, and orders the groups
+  from the most to the least expensive."""
+  # Keep the batches small enough for the workers to stay balanced.
+  max_cost = sum(costs.values()) / (4 * max_task)
+  # Headers that are included everywhere don't tell files apart, and would
+  # make this quadratic.
+  max_users = 64
+  users = collections.defaultdict(list)
+  for name in costs:
+    for header in includes[name]:
+      users[header].append(name)
+
+  remaining = set(costs)
+  batches = []
+  for seed in sorted(costs, key=lambda f: costs[f], reverse=True):
+    if seed not in remaining:
+      continue
+    remaining.discard(seed)
+    batch = [seed]
+    cost = costs[seed]
+    candidates = set()
+    for header in includes[seed]:
+      if len(users[header]) <= max_users:
+        candidates.update(f for f in users[header] if f in remaining)
+
+    def similarity(f):
+      return (len(includes[seed] & includes[f]) /
+              float(len(includes[seed] | includes[f])))
+
+    for f in sorted(candidates, key=similarity, reverse=True):
+      if cost >= max_cost or similarity(f) < 0.5:
+        break
+      batch.append(f)
+      remaining.discard(f)
+      cost += costs[f]
+    batches.append((cost, batch))
+
+  batches.sort(key=lambda b: b[0], reverse=True)
+  return [batch for _, batch in batches]
+
+
 def merge_replacement_files(tmpdir, mergefile):
   """Merge all replacement files in a directory into a single file"""
   # The fixes suggested by clang-tidy >= 4.0.0 are given under
@@ -189,31 +290,81 @@ def apply_fixes(args, clang_apply_replacements_binary, tmpdir):
   subprocess.call(invocation)
 
 
+def start_tidy(args, clang_tidy_binary, tmpdir, build_path):
+  """Starts a clang-tidy process that analyzes the files it reads on stdin."""
+  invocation = get_tidy_invocation(None, clang_tidy_binary, args.checks,
+                                   tmpdir, build_path, args.header_filter,
+                                   args.allow_enabling_alpha_checkers,
+                                   args.extra_arg, args.extra_arg_before,
+                                   args.quiet, args.config_file, args.config,
+                                   args.line_filter, args.use_color,
+                                   args.plugins)
+  invocation.append('-batch')
+  # With -export-fixes, clang-tidy writes the fixes of each file as soon as it
+  # is done, so they are kept even if the process is restarted later on.
+  # Errors go along with the diagnostics, so that they are printed with the
+  # file they belong to.
+  proc = subprocess.Popen(invocation, stdin=subprocess.PIPE,
+                          stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+  return proc, ' '.join(invocation)
+
+
 def run_tidy(args, clang_tidy_binary, tmpdir, build_path, queue, lock,
-             failed_files):
-  """Takes filenames out of queue and runs clang-tidy on them."""
+             failed_files, timings):
+  """Takes batches of filenames out of queue and runs clang-tidy on them.
+
+  Each worker keeps one clang-tidy process for all its files, so that the
+  files of a batch are analyzed while the headers they share are warm. The
+  process is started right away, so that it starts up while the files are
+  scanned."""
+  proc, command = start_tidy(args, clang_tidy_binary, tmpdir, build_path)
   while True:
-    name = queue.get()
-    invocation = get_tidy_invocation(name, clang_tidy_binary, args.checks,
-                                     tmpdir, build_path, args.header_filter,
-                                     args.allow_enabling_alpha_checkers,
-                                     args.extra_arg, args.extra_arg_before,
-                                     args.quiet, args.config_file, args.config,
-                                     args.line_filter, args.use_color,
-                                     args.plugins)
-
-    proc = subprocess.Popen(invocation, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    output, err = proc.communicate()
-    if proc.returncode != 0:
-      if proc.returncode < 0:
-        msg = "%s: terminated by signal %d\n" % (name, -proc.returncode)
-        err += msg.encode('utf-8')
-      failed_files.append(name)
-    with lock:
-      sys.stdout.write(' '.join(invocation) + '\n' + output.decode('utf-8'))
-      if len(err) > 0:
+    batch = queue.get()
+    if batch is None:
+      if proc is not None:
+        # Failures were reported with each file.
+        proc.stdin.close()
+        proc.wait()
+      queue.task_done()
+      return
+
+    for name in batch:
+      if proc is None:
+        proc, command = start_tidy(args, clang_tidy_binary, tmpdir, build_path)
+      start = time.time()
+      output = []
+      finished = False
+      failed = False
+      try:
+        proc.stdin.write((name + '\n').encode('utf-8'))
+        proc.stdin.flush()
+        for line in iter(proc.stdout.readline, b''):
+          if line.rstrip(b'\r\n') == JOB_FAILED:
+            failed = True
+            continue
+          if line.rstrip(b'\r\n') == JOB_END:
+            finished = True
+            break
+          output.append(line)
+      except EnvironmentError:
+        pass
+      output = b''.join(output).decode('utf-8')
+
+      if finished:
+        timings[name] = time.time() - start
+        if failed:
+          failed_files.append(name)
+      else:
+        # The process died with this file, start afresh for the next one.
+        returncode = proc.wait()
+        if returncode < 0:
+          output += "%s: terminated by signal %d\n" % (name, -returncode)
+        failed_files.append(name)
+        proc = None
+      with lock:
+        # The file was analyzed by a -batch process that read it on stdin.
+        sys.stdout.write('%s <<< %s\n%s' % (command, name, output))
         sys.stdout.flush()
-        sys.stderr.write(err.decode('utf-8'))
     queue.task_done()
 
 
@@ -260,6 +411,11 @@ def main():
                         'which can be applied with clang-apply-replacements.')
   parser.add_argument('-j', type=int, default=0,
                       help='number of tidy instances to be run in parallel.')
+  parser.add_argument('-timings-file', metavar='filename', dest='timings_file',
+                      help='Read the analysis time of each file from a '
+                      'previous run to analyze the slowest files first, and '
+                      'record the times of this run. Without it, the cost '
+                      'of a file is estimated from its size and includes.')
   parser.add_argument('files', nargs='*', default=['.*'],
                       help='files to be processed (regex on path)')
   parser.add_argument('-fix', action='store_true', help='apply fix-its')
@@ -337,28 +493,49 @@ def main():
 
   # Build up a big regexy filter from all command line arguments.
   file_name_re = re.compile('|'.join(args.files))
+  files = [name for name in files if file_name_re.search(name)]
+
+  timings = load_timings(args.timings_file)
 
   return_code = 0
   try:
-    # Spin up a bunch of tidy-launching threads.
-    task_queue = queue.Queue(max_task)
+    # Spin up a bunch of tidy-launching threads. Their clang-tidy processes
+    # start up while the files are scanned.
+    task_queue = queue.Queue()
     # List of files with a non-zero return code.
     failed_files = []
     lock = threading.Lock()
+    workers = []
     for _ in range(max_task):
       t = threading.Thread(target=run_tidy,
                            args=(args, clang_tidy_binary, tmpdir, build_path,
-                                 task_queue, lock, failed_files))
+                                 task_queue, lock, failed_files, timings))
       t.daemon = True
       t.start()
-
-    # Fill the queue with files.
-    for name in files:
-      if file_name_re.search(name):
-        task_queue.put(name)
+      workers.append(t)
+
+    # Start with the most expensive files, so that a large one doesn't run
+    # alone at the end.
+    pool = multiprocessing.pool.ThreadPool(max_task)
+    scans = pool.map(scan_file, files)
+    pool.close()
+    estimates = {}
+    includes = {}
+    for name, (estimate, file_includes) in zip(files, scans):
+      estimates[name] = estimate
+      includes[name] = file_includes
+    costs = estimate_costs(estimates, timings)
+    batches = make_batches(costs, includes, max_task)
+
+    # Fill the queue with batches of files, then stop the workers.
+    for batch in batches:
+      task_queue.put(batch)
+    for _ in workers:
+      task_queue.put(None)
 
     # Wait for all threads to be done.
-    task_queue.join()
+    for t in workers:
+      t.join()
     if len(failed_files):
       return_code = 1
 
@@ -370,6 +547,13 @@ def main():
       shutil.rmtree(tmpdir)
     os.kill(0, 9)
 
+  if args.timings_file:
+    try:
+      save_timings(args.timings_file, timings)
+    except EnvironmentError:
+      print('Error writing timings.\n', file=sys.stderr)
+      traceback.print_exc()
+
   if yaml and args.export_fixes:
     print('Writing fixes to ' + args.export_fixes + ' ...')
     try:
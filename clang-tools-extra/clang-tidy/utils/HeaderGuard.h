@@ -35,6 +35,7 @@ public:
                                utils::defaultFileExtensionDelimiters());
   }
   void storeOptions(ClangTidyOptions::OptionMap &Opts) override;
+  bool needsOnlyPreprocessor() const override { return true; }
   void registerPPCallbacks(const SourceManager &SM, Preprocessor *PP,
                            Preprocessor *ModuleExpanderPP) override;
 
@@ -30,6 +30,12 @@ public:
   RenamerClangTidyCheck(StringRef CheckName, ClangTidyContext *Context);
   ~RenamerClangTidyCheck();
 
+  /// Renaming a declaration needs to find all of its uses.
+  bool needsWholeTranslationUnit() const override { return true; }
+
+  /// Macros may be defined and used in modular headers.
+  bool needsExpandedModularHeaders() const override { return true; }
+
   /// Derived classes should not implement any matching logic themselves; this
   /// class will do the matching and call the derived class'
   /// getDeclFailureInfo() and getMacroFailureInfo() for determining whether a
@@ -167,6 +167,7 @@ ClangdServer::Options::operator TUScheduler::Options() const {
   Opts.UpdateDebounce = UpdateDebounce;
   Opts.ContextProvider = ContextProvider;
   Opts.PreambleThrottler = PreambleThrottler;
+  Opts.PreambleStore = PreambleStore;
   return Opts;
 }
 
@@ -200,8 +201,10 @@ ClangdServer::ClangdServer(const GlobalCompilationDatabase &CDB,
       this->Index = Idx;
     }
   };
-  if (Opts.StaticIndex)
+  if (Opts.StaticIndex) {
+    StaticIdx = Opts.StaticIndex;
     AddIndex(Opts.StaticIndex);
+  }
   if (Opts.BackgroundIndex) {
     BackgroundIndex::Options BGOpts;
     BGOpts.ThreadPoolSize = std::max(Opts.AsyncThreadsCount, 1u);
@@ -1037,6 +1040,8 @@ ClangdServer::blockUntilIdleForTest(llvm::Optional<double> TimeoutSeconds) {
 }
 
 void ClangdServer::profile(MemoryTree &MT) const {
+  if (StaticIdx)
+    StaticIdx->profile(MT.child("static_index"));
   if (DynamicIdx)
     DynamicIdx->profile(MT.child("dynamic_index"));
   if (BackgroundIdx)
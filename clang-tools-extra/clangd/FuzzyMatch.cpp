@@ -64,6 +64,7 @@ namespace clangd {
 
 constexpr int FuzzyMatcher::MaxPat;
 constexpr int FuzzyMatcher::MaxWord;
+constexpr int FuzzyMatcher::BatchLanes;
 
 static char lower(char C) { return C >= 'A' && C <= 'Z' ? C + ('a' - 'A') : C; }
 // A "negative infinity" score that won't overflow.
@@ -73,6 +74,17 @@ static constexpr int AwfulScore = -(1 << 13);
 static bool isAwful(int S) { return S < AwfulScore / 2; }
 static constexpr int PerfectBonus = 4; // Perfect per-pattern-char score.
 
+// A bitmap of the characters in LowText, which is already lowercase.
+// Characters share bits, so this can only show that a word doesn't contain
+// some character: if a word's bitmap lacks a bit of the pattern's, they can't
+// match.
+static uint64_t charBitmap(llvm::StringRef LowText) {
+  uint64_t Bits = 0;
+  for (unsigned char C : LowText)
+    Bits |= uint64_t{1} << (C & 63);
+  return Bits;
+}
+
 FuzzyMatcher::FuzzyMatcher(llvm::StringRef Pattern)
     : PatN(std::min<int>(MaxPat, Pattern.size())),
       ScoreScale(PatN ? float{1} / (PerfectBonus * PatN) : 0), WordN(0) {
@@ -87,6 +99,7 @@ FuzzyMatcher::FuzzyMatcher(llvm::StringRef Pattern)
         Scores[P][W][A] = {AwfulScore, Miss};
   PatTypeSet = calculateRoles(llvm::StringRef(Pat, PatN),
                               llvm::makeMutableArrayRef(PatRole, PatN));
+  PatChars = charBitmap(llvm::StringRef(LowPat, PatN));
 }
 
 llvm::Optional<float> FuzzyMatcher::match(llvm::StringRef Word) {
@@ -248,6 +261,162 @@ void FuzzyMatcher::buildGraph() {
   }
 }
 
+// matchBatch() computes the same scores as buildGraph(), for BatchLanes words
+// at once. The per-word data is transposed so that the index of the word is
+// innermost, and the loops over words are simple enough to be vectorized.
+// The allowMatch(), skipPenalty() and matchBonus() rules are inlined, and must
+// be kept in sync.
+//
+// Only the score is needed, not the path through the table, so two rows of the
+// table are enough.
+void FuzzyMatcher::matchBatch(
+    llvm::ArrayRef<llvm::StringRef> Words,
+    llvm::MutableArrayRef<llvm::Optional<float>> Results) const {
+  assert(Words.size() == Results.size());
+  if (!PatN) {
+    for (auto &Result : Results)
+      Result = 1;
+    return;
+  }
+  constexpr int Lanes = BatchLanes;
+  const bool IsPatSingleCase =
+      (PatTypeSet == 1 << Lower) || (PatTypeSet == 1 << Upper);
+
+  // Data for the words in the current group, indexed by [W][Lane].
+  char GroupWord[MaxWord][Lanes], GroupLowWord[MaxWord][Lanes];
+  CharRole GroupRole[MaxWord][Lanes];
+  int16_t GroupSkip[MaxWord][Lanes]; // skipPenalty()
+  int16_t GroupStrong[MaxWord][Lanes]; // Can match after a Miss.
+  int16_t Table[2][MaxWord + 1][2][Lanes];
+  size_t GroupIndex[Lanes];
+  int GroupWordN[Lanes];
+  int GroupSize = 0;
+
+  auto ScoreGroup = [&] {
+    int MaxN = 0;
+    for (int L = 0; L < GroupSize; ++L)
+      MaxN = std::max(MaxN, GroupWordN[L]);
+    // Cells past the end of a word don't affect its score, but mustn't be
+    // garbage either.
+    for (int L = 0; L < Lanes; ++L) {
+      for (int W = L < GroupSize ? GroupWordN[L] : 0; W < MaxN; ++W) {
+        GroupWord[W][L] = GroupLowWord[W][L] = 0;
+        GroupRole[W][L] = Unknown;
+        GroupSkip[W][L] = 0;
+        GroupStrong[W][L] = 0;
+      }
+    }
+
+    auto *Prev = Table[0], *Cur = Table[1];
+    for (int L = 0; L < Lanes; ++L) {
+      Prev[0][Miss][L] = 0;
+      Prev[0][Match][L] = AwfulScore;
+    }
+    for (int W = 0; W < MaxN; ++W) {
+      for (int L = 0; L < Lanes; ++L) {
+        Prev[W + 1][Miss][L] = Prev[W][Miss][L] - GroupSkip[W][L];
+        Prev[W + 1][Match][L] = AwfulScore;
+      }
+    }
+    for (int P = 0; P < PatN; ++P) {
+      // Skipping trailing characters is always free.
+      const bool SkipIsFree = P == PatN - 1;
+      const char PatChar = Pat[P], LowPatChar = LowPat[P];
+      const bool PatIsHead = PatRole[P] == Head;
+      for (int L = 0; L < Lanes; ++L)
+        Cur[P][Miss][L] = Cur[P][Match][L] = AwfulScore;
+      // The lane loop is kept free of branches so that it can be vectorized.
+      const int16_t SkipScale = SkipIsFree ? 0 : 1;
+      const int16_t HeadBonus = IsPatSingleCase || PatIsHead ? 1 : 0;
+      const int16_t TailPenalty = (PatIsHead ? 1 : 0) + (P == 0 ? 4 : 0);
+      const int16_t MissTailPenalty = P ? 3 : 0;
+      for (int W = P; W < MaxN; ++W) {
+        const int16_t FirstBonus = W == 0 ? 2 : 0;
+        for (int L = 0; L < Lanes; ++L) {
+          int16_t Skip = GroupSkip[W][L] * SkipScale;
+          int16_t MatchMiss = Cur[W][Match][L] - Skip;
+          int16_t MissMiss = Cur[W][Miss][L] - Skip;
+          Cur[W + 1][Miss][L] = MatchMiss > MissMiss ? MatchMiss : MissMiss;
+
+          int16_t IsTail = GroupRole[W][L] == Tail;
+          int16_t IsHead = GroupRole[W][L] == Head;
+          int16_t SameCase = GroupWord[W][L] == PatChar;
+          int16_t Bonus = 1 + (SameCase | (IsHead & HeadBonus)) -
+                          IsTail * TailPenalty;
+          int16_t Matches = GroupLowWord[W][L] == LowPatChar;
+          int16_t MatchMatch = Prev[W][Match][L] + Bonus + 2;
+          int16_t MissMatch = Prev[W][Miss][L] + Bonus + FirstBonus -
+                              IsTail * MissTailPenalty;
+          MatchMatch = Matches ? MatchMatch : int16_t(AwfulScore);
+          MissMatch = (Matches & GroupStrong[W][L]) ? MissMatch
+                                                    : int16_t(AwfulScore);
+          Cur[W + 1][Match][L] =
+              MatchMatch > MissMatch ? MatchMatch : MissMatch;
+        }
+      }
+      std::swap(Prev, Cur);
+    }
+
+    for (int L = 0; L < GroupSize; ++L) {
+      int WordN = GroupWordN[L];
+      int Best = std::max(Prev[WordN][Miss][L], Prev[WordN][Match][L]);
+      if (isAwful(Best))
+        continue;
+      float Score =
+          ScoreScale * std::min(PerfectBonus * PatN, std::max<int>(0, Best));
+      if (WordN == PatN)
+        Score *= 2;
+      Results[GroupIndex[L]] = Score;
+    }
+    GroupSize = 0;
+  };
+
+  char LowWord[MaxWord];
+  CharRole WordRole[MaxWord];
+  for (size_t I = 0; I < Words.size(); ++I) {
+    Results[I] = llvm::None;
+    llvm::StringRef Word = Words[I].take_front(MaxWord);
+    int WordN = Word.size();
+    if (PatN > WordN)
+      continue;
+    for (int W = 0; W < WordN; ++W)
+      LowWord[W] = lower(Word[W]);
+    if ((charBitmap(llvm::StringRef(LowWord, WordN)) & PatChars) != PatChars)
+      continue;
+    // Cheap subsequence check, as in init().
+    bool IsSubsequence = true;
+    for (int W = 0, P = 0; P != PatN; ++W) {
+      if (W == WordN) {
+        IsSubsequence = false;
+        break;
+      }
+      if (LowWord[W] == LowPat[P])
+        ++P;
+    }
+    if (!IsSubsequence)
+      continue;
+
+    CharTypeSet WordTypeSet =
+        calculateRoles(Word, llvm::makeMutableArrayRef(WordRole, WordN));
+    int L = GroupSize++;
+    GroupIndex[L] = I;
+    GroupWordN[L] = WordN;
+    for (int W = 0; W < WordN; ++W) {
+      GroupWord[W][L] = Word[W];
+      GroupLowWord[W][L] = LowWord[W];
+      GroupRole[W][L] = WordRole[W];
+      GroupSkip[W][L] = W == 0 ? 3 : WordRole[W] == Head ? 1 : 0;
+      GroupStrong[W][L] =
+          !(WordRole[W] == Tail &&
+            (Word[W] == LowWord[W] || !(WordTypeSet & 1 << Lower)));
+    }
+    if (GroupSize == Lanes)
+      ScoreGroup();
+  }
+  if (GroupSize)
+    ScoreGroup();
+}
+
 bool FuzzyMatcher::allowMatch(int P, int W, Action Last) const {
   if (LowPat[P] != LowWord[W])
     return false;
@@ -79,6 +79,15 @@ public:
   // Characters beyond MaxWord are ignored.
   llvm::Optional<float> match(llvm::StringRef Word);
 
+  // Matches each of Words against the pattern: Results[I] is set to what
+  // match(Words[I]) would return.
+  // This is faster than calling match() in a loop. Words that can't match are
+  // rejected by comparing character bitmaps, and the rest are scored several
+  // at a time, so the compiler can use SIMD instructions.
+  // Doesn't affect dumpLast().
+  void matchBatch(llvm::ArrayRef<llvm::StringRef> Words,
+                  llvm::MutableArrayRef<llvm::Optional<float>> Results) const;
+
   llvm::StringRef pattern() const { return llvm::StringRef(Pat, PatN); }
   bool empty() const { return PatN == 0; }
 
@@ -90,6 +99,8 @@ public:
 private:
   // We truncate the pattern and the word to bound the cost of matching.
   constexpr static int MaxPat = 63, MaxWord = 127;
+  // Number of words scored together by matchBatch().
+  constexpr static int BatchLanes = 16;
   // Action describes how a word character was matched to the pattern.
   // It should be an enum, but this causes bitfield problems:
   //   - for MSVC the enum type must be explicitly unsigned for correctness
@@ -110,6 +121,7 @@ private:
   char LowPat[MaxPat];      // Pattern in lowercase
   CharRole PatRole[MaxPat]; // Pattern segmentation info
   CharTypeSet PatTypeSet;   // Bitmask of 1<<CharType for all Pattern characters
+  uint64_t PatChars;        // Bitmap of lowercase Pattern characters
   float ScoreScale;         // Normalizes scores for the pattern length.
 
   // Word data is initialized on each call to match(), mostly by init().
@@ -271,6 +271,23 @@ IncludeStructure::HeaderID IncludeStructure::getOrCreateID(FileEntryRef Entry) {
   return Result;
 }
 
+void IncludeStructure::restoreHeader(HeaderID ID, llvm::StringRef RealPath,
+                                     llvm::sys::fs::UniqueID UID,
+                                     bool SelfContained, bool IWYUExport) {
+  if (ID == MainFileID) {
+    RealPathNames.front() = RealPath.str();
+  } else {
+    assert(static_cast<unsigned>(ID) == RealPathNames.size() &&
+           "Headers must be restored in order");
+    UIDToIndex.try_emplace(UID, ID);
+    RealPathNames.push_back(RealPath.str());
+  }
+  if (!SelfContained)
+    NonSelfContained.insert(ID);
+  if (IWYUExport)
+    HasIWYUExport.insert(ID);
+}
+
 llvm::DenseMap<IncludeStructure::HeaderID, unsigned>
 IncludeStructure::includeDepth(HeaderID Root) const {
   // Include depth 0 is the main file only.
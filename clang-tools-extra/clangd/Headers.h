@@ -136,6 +136,13 @@ public:
   llvm::Optional<HeaderID> getID(const FileEntry *Entry) const;
   HeaderID getOrCreateID(FileEntryRef Entry);
 
+  // Restores a header recorded by an earlier build, e.g. when loading a
+  // preamble from disk. Headers other than the main file must be restored in
+  // order of their IDs, and \p UID identifies the file in the current VFS.
+  void restoreHeader(HeaderID ID, llvm::StringRef RealPath,
+                     llvm::sys::fs::UniqueID UID, bool SelfContained,
+                     bool IWYUExport);
+
   StringRef getRealPath(HeaderID ID) const {
     assert(static_cast<unsigned>(ID) <= RealPathNames.size());
     return RealPathNames[static_cast<unsigned>(ID)];
@@ -21,9 +21,12 @@
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/Lexer.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Tooling/Syntax/Tokens.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/STLFunctionalExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringSet.h"
@@ -149,6 +152,10 @@ public:
     return true;
   }
 
+  /// Whether a record without a definition was referenced. Code after the
+  /// traversed decls may define it, which changes the result.
+  bool referencedIncompleteRecord() const { return IncompleteRecord; }
+
 private:
   using Base = RecursiveASTVisitor<ReferencedLocationCrawler>;
 
@@ -171,6 +178,7 @@ private:
         Result.User.insert(Definition->getLocation());
         return;
       }
+      IncompleteRecord = true;
       if (SM.isInMainFile(RD->getMostRecentDecl()->getLocation()))
         return;
     }
@@ -184,6 +192,7 @@ private:
   llvm::DenseSet<const void *> Visited;
   const SourceManager &SM;
   tooling::stdlib::Recognizer StdRecognizer;
+  bool IncompleteRecord = false;
 };
 
 // Given a set of referenced FileIDs, determines all the potentially-referenced
@@ -322,6 +331,19 @@ FileID headerResponsible(FileID ID, const SourceManager &SM,
   return ID;
 }
 
+// Returns the spelling of the public header that should be included for the
+// symbols in a private header, if any.
+Optional<StringRef> umbrellaHeader(FileID ID, const SourceManager &SM,
+                                   const CanonicalIncludes &CanonIncludes) {
+  auto Entry = SM.getFileEntryRefForID(ID);
+  if (!Entry)
+    return llvm::None;
+  auto PublicHeader = CanonIncludes.mapHeader(*Entry);
+  if (PublicHeader.empty())
+    return llvm::None;
+  return PublicHeader;
+}
+
 } // namespace
 
 ReferencedLocations findReferencedLocations(ASTContext &Ctx, Preprocessor &PP,
@@ -389,14 +411,8 @@ ReferencedFiles findReferencedFiles(const ReferencedLocations &Locs,
       [&SM, &Includes](FileID ID) {
         return headerResponsible(ID, SM, Includes);
       },
-      [&SM, &CanonIncludes](FileID ID) -> Optional<StringRef> {
-        auto Entry = SM.getFileEntryRefForID(ID);
-        if (!Entry)
-          return llvm::None;
-        auto PublicHeader = CanonIncludes.mapHeader(*Entry);
-        if (PublicHeader.empty())
-          return llvm::None;
-        return PublicHeader;
+      [&SM, &CanonIncludes](FileID ID) {
+        return umbrellaHeader(ID, SM, CanonIncludes);
       });
 }
 
@@ -457,9 +473,163 @@ translateToHeaderIDs(const ReferencedFiles &Files,
   return TranslatedHeaderIDs;
 }
 
+FileID IncludeCleanerCache::headerResponsible(
+    FileID ID, const SourceManager &SM, const IncludeStructure &Includes) {
+  // Only files from the preamble have the same FileID in every rebuild.
+  if (!SM.isLoadedFileID(ID))
+    return clangd::headerResponsible(ID, SM, Includes);
+  std::lock_guard<std::mutex> Lock(Mu);
+  auto It = Responsible.find(ID);
+  if (It == Responsible.end())
+    It = Responsible
+             .try_emplace(ID, clangd::headerResponsible(ID, SM, Includes))
+             .first;
+  return It->second;
+}
+
+Optional<StringRef>
+IncludeCleanerCache::umbrellaHeader(FileID ID, const SourceManager &SM,
+                                    const CanonicalIncludes &CanonIncludes) {
+  if (!SM.isLoadedFileID(ID))
+    return clangd::umbrellaHeader(ID, SM, CanonIncludes);
+  std::lock_guard<std::mutex> Lock(Mu);
+  auto It = Umbrellas.find(ID);
+  if (It == Umbrellas.end()) {
+    Optional<StringRef> Header = clangd::umbrellaHeader(ID, SM, CanonIncludes);
+    if (Header)
+      Header = Saver.save(*Header);
+    It = Umbrellas.try_emplace(ID, Header).first;
+  }
+  return It->second;
+}
+
+std::shared_ptr<const IncludeCleanerCache::DeclReferences>
+IncludeCleanerCache::lookupDecl(unsigned Index, uint64_t Key) const {
+  std::lock_guard<std::mutex> Lock(Mu);
+  if (Index < Decls.size() && Decls[Index].first == Key)
+    return Decls[Index].second;
+  return nullptr;
+}
+
+void IncludeCleanerCache::setDecls(std::vector<DeclEntry> NewDecls) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  Decls = std::move(NewDecls);
+}
+
+// Finds the headers referenced from the main file, reusing the results for
+// the files from the preamble and the unchanged top-level decls in Cache.
+// \p PreambleSize is the size of the main file's preamble region.
+static void findReferencedHeadersCached(
+    ParsedAST &AST, IncludeCleanerCache &Cache, unsigned PreambleSize,
+    llvm::DenseSet<IncludeStructure::HeaderID> &Headers,
+    llvm::StringSet<> &SpelledUmbrellas) {
+  trace::Span Tracer("IncludeCleaner::findReferencedHeadersCached");
+  const auto &SM = AST.getSourceManager();
+  const auto &Includes = AST.getIncludeStructure();
+  auto Analyze = [&](const ReferencedLocations &Locs) {
+    auto Files = findReferencedFiles(
+        Locs, SM,
+        [&](FileID ID) { return Cache.headerResponsible(ID, SM, Includes); },
+        [&](FileID ID) {
+          return Cache.umbrellaHeader(ID, SM, AST.getCanonicalIncludes());
+        });
+    auto Refs = std::make_shared<IncludeCleanerCache::DeclReferences>();
+    Refs->Headers = translateToHeaderIDs(Files, Includes, SM);
+    for (const auto &Umbrella : Files.SpelledUmbrellas)
+      Refs->SpelledUmbrellas.push_back(Umbrella.getKey().str());
+    return Refs;
+  };
+  auto Merge = [&](const IncludeCleanerCache::DeclReferences &Refs) {
+    Headers.insert(Refs.Headers.begin(), Refs.Headers.end());
+    for (const auto &Umbrella : Refs.SpelledUmbrellas)
+      SpelledUmbrellas.insert(Umbrella);
+  };
+
+  // The references of a decl depend on the preamble and the code before its
+  // end, so Key hashes the main file up to the end of each decl in turn.
+  // Redecls add() follows may come later, so decls that resolve through them
+  // aren't recorded.
+  llvm::StringRef Code = SM.getBufferData(SM.getMainFileID());
+  llvm::hash_code Key = 0;
+  unsigned Consumed = 0;
+  std::vector<IncludeCleanerCache::DeclEntry> Decls;
+  // Headers included after the preamble may change without the main file
+  // changing, and may add redecls of anything referenced before them, so
+  // nothing is recorded if there are any.
+  bool Cacheable = llvm::none_of(
+      Includes.MainFileIncludes,
+      [&](const Inclusion &Inc) { return Inc.HashOffset >= PreambleSize; });
+  // Whether the references at Loc are known before the main file offset End.
+  auto IsBefore = [&](SourceLocation Loc, unsigned End) {
+    for (SourceLocation L : {SM.getExpansionLoc(Loc), SM.getSpellingLoc(Loc)}) {
+      FileID FID = SM.getFileID(L);
+      if (FID == SM.getMainFileID()) {
+        if (SM.getFileOffset(L) >= End)
+          return false;
+      } else if (!SM.isLoadedFileID(FID) && SM.getFileEntryForID(FID)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  for (Decl *D : AST.getLocalTopLevelDecls()) {
+    SourceLocation End = SM.getExpansionLoc(D->getEndLoc());
+    unsigned Offset = 0;
+    Cacheable = Cacheable && End.isValid() && SM.isWrittenInMainFile(End);
+    if (Cacheable) {
+      Offset = SM.getFileOffset(End) +
+               Lexer::MeasureTokenLength(End, SM, AST.getLangOpts());
+      if (Offset > Consumed) {
+        Key = llvm::hash_combine(Key, Code.slice(Consumed, Offset));
+        Consumed = Offset;
+      }
+      // Several decls may end at the same place, e.g. in `int a, b;`.
+      Key = llvm::hash_combine(Key, Decls.size());
+      if (auto Refs = Cache.lookupDecl(Decls.size(), Key)) {
+        Merge(*Refs);
+        Decls.emplace_back(Key, std::move(Refs));
+        continue;
+      }
+    }
+
+    ReferencedLocations Locs;
+    ReferencedLocationCrawler Crawler(Locs, SM);
+    Crawler.TraverseDecl(D);
+    auto Refs = Analyze(Locs);
+    Merge(*Refs);
+    if (!Cacheable)
+      continue;
+    // Keep an empty entry in place of a decl that can't be reused, so that
+    // the following decls keep their index.
+    if (Crawler.referencedIncompleteRecord() ||
+        !llvm::all_of(Locs.User,
+                      [&](SourceLocation L) { return IsBefore(L, Offset); }))
+      Refs = nullptr;
+    Decls.emplace_back(Key, std::move(Refs));
+  }
+  Cache.setDecls(std::move(Decls));
+
+  // Macro references are cheap to find and not cached.
+  ReferencedLocations MacroLocs;
+  findReferencedMacros(SM, AST.getPreprocessor(), &AST.getTokens(),
+                       MacroLocs);
+  Merge(*Analyze(MacroLocs));
+}
+
 std::vector<const Inclusion *> computeUnusedIncludes(ParsedAST &AST) {
   const auto &SM = AST.getSourceManager();
 
+  if (const PreambleData *Preamble = AST.getExactPreamble()) {
+    if (Preamble->IncludeCleaner) {
+      llvm::DenseSet<IncludeStructure::HeaderID> ReferencedHeaders;
+      llvm::StringSet<> SpelledUmbrellas;
+      findReferencedHeadersCached(AST, *Preamble->IncludeCleaner,
+                                  Preamble->Preamble.getBounds().Size,
+                                  ReferencedHeaders, SpelledUmbrellas);
+      return getUnused(AST, ReferencedHeaders, SpelledUmbrellas);
+    }
+  }
+
   auto Refs = findReferencedLocations(AST);
   auto ReferencedFiles =
       findReferencedFiles(Refs, AST.getIncludeStructure(),
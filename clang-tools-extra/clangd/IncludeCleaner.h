@@ -23,9 +23,14 @@
 #include "index/CanonicalIncludes.h"
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Tooling/Inclusions/StandardLibrary.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLFunctionalExtras.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace clang {
@@ -95,6 +100,52 @@ getUnused(ParsedAST &AST,
           const llvm::DenseSet<IncludeStructure::HeaderID> &ReferencedFiles,
           const llvm::StringSet<> &ReferencedPublicHeaders);
 
+/// Parts of the unused-include analysis that can be reused across rebuilds of
+/// the main file with the same preamble. It is stored with the preamble.
+///
+/// - The header responsible for, and the umbrella header of, each file from
+///   the preamble.
+/// - The headers referenced by each top-level decl of the main file, as long
+///   as the text up to the end of the decl doesn't change. Edits usually only
+///   touch one decl, so those before it don't have to be traversed again.
+///   Decls whose references resolve through code after them, e.g. the later
+///   definition of a record, aren't recorded. Neither is anything if a header
+///   is included outside of the preamble, since that header may change
+///   without the main file changing.
+class IncludeCleanerCache {
+public:
+  /// Headers referenced from a top-level decl.
+  struct DeclReferences {
+    llvm::DenseSet<IncludeStructure::HeaderID> Headers;
+    std::vector<std::string> SpelledUmbrellas;
+  };
+  /// The hash of the text up to the end of a decl, and its references.
+  using DeclEntry = std::pair<uint64_t, std::shared_ptr<const DeclReferences>>;
+
+  FileID headerResponsible(FileID ID, const SourceManager &SM,
+                           const IncludeStructure &Includes);
+  Optional<StringRef> umbrellaHeader(FileID ID, const SourceManager &SM,
+                                     const CanonicalIncludes &CanonIncludes);
+
+  /// Returns the references of the top-level decl at \p Index, if the text up
+  /// to the end of the decl hashed to \p Key when they were recorded and they
+  /// could be reused.
+  std::shared_ptr<const DeclReferences> lookupDecl(unsigned Index,
+                                                   uint64_t Key) const;
+  /// Replaces the recorded decl references with those of the latest build.
+  void setDecls(std::vector<DeclEntry> Decls);
+
+private:
+  mutable std::mutex Mu;
+  llvm::DenseMap<FileID, FileID> Responsible;
+  llvm::DenseMap<FileID, Optional<StringRef>> Umbrellas;
+  llvm::BumpPtrAllocator Arena;
+  llvm::StringSaver Saver{Arena};
+  std::vector<DeclEntry> Decls;
+};
+
+/// Retrieves headers that are referenced from the main file but not used.
+/// Reuses and updates the IncludeCleanerCache of the AST's preamble, if any.
 std::vector<const Inclusion *> computeUnusedIncludes(ParsedAST &AST);
 
 std::vector<Diag> issueUnusedIncludesDiagnostics(ParsedAST &AST,
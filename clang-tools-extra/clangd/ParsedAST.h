@@ -112,13 +112,20 @@ public:
   /// AST. Might be None if no Preamble is used.
   llvm::Optional<llvm::StringRef> preambleVersion() const;
 
+  /// Returns the preamble this AST was built with, if it was used as is.
+  /// Returns null if there was no preamble, or it was patched because it is
+  /// stale.
+  const PreambleData *getExactPreamble() const {
+    return PreamblePatched ? nullptr : Preamble.get();
+  }
+
   const HeuristicResolver *getHeuristicResolver() const {
     return Resolver.get();
   }
 
 private:
   ParsedAST(llvm::StringRef Version,
-            std::shared_ptr<const PreambleData> Preamble,
+            std::shared_ptr<const PreambleData> Preamble, bool PreamblePatched,
             std::unique_ptr<CompilerInstance> Clang,
             std::unique_ptr<FrontendAction> Action, syntax::TokenBuffer Tokens,
             MainFileMacros Macros, std::vector<PragmaMark> Marks,
@@ -130,6 +137,8 @@ private:
   // In-memory preambles must outlive the AST, it is important that this member
   // goes before Clang and Action.
   std::shared_ptr<const PreambleData> Preamble;
+  // Whether Preamble is stale, and was patched to build the AST.
+  bool PreamblePatched;
   // We store an "incomplete" FrontendAction (i.e. no EndSourceFile was called
   // on it) and CompilerInstance used to run it. That way we don't have to do
   // complex memory management of all Clang structures on our own. (They are
@@ -10,6 +10,7 @@
 #include "Compiler.h"
 #include "Config.h"
 #include "Headers.h"
+#include "IncludeCleaner.h"
 #include "SourceCode.h"
 #include "support/Logger.h"
 #include "support/ThreadsafeFS.h"
@@ -38,6 +39,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
@@ -62,6 +64,32 @@ bool compileCommandsAreEqual(const tooling::CompileCommand &LHS,
          llvm::makeArrayRef(LHS.CommandLine).equals(RHS.CommandLine);
 }
 
+std::string absoluteFilename(const tooling::CompileCommand &Cmd,
+                             llvm::StringRef Filename) {
+  llvm::SmallString<256> Path(Filename);
+  llvm::sys::fs::make_absolute(Cmd.Directory, Path);
+  llvm::sys::path::remove_dots(Path, /*remove_dot_dot=*/true);
+  return Path.str().str();
+}
+
+// Like compileCommandsAreEqual, but allows the commands to compile different
+// files.
+bool compileCommandsAreEqualButFile(const tooling::CompileCommand &LHS,
+                                    const tooling::CompileCommand &RHS) {
+  if (LHS.Directory != RHS.Directory ||
+      LHS.CommandLine.size() != RHS.CommandLine.size())
+    return false;
+  std::string LHSFile = absoluteFilename(LHS, LHS.Filename);
+  std::string RHSFile = absoluteFilename(RHS, RHS.Filename);
+  for (size_t I = 0; I < LHS.CommandLine.size(); ++I) {
+    const std::string &L = LHS.CommandLine[I], &R = RHS.CommandLine[I];
+    if (L != R && !(absoluteFilename(LHS, L) == LHSFile &&
+                    absoluteFilename(RHS, R) == RHSFile))
+      return false;
+  }
+  return true;
+}
+
 class CppFilePreambleCallbacks : public PreambleCallbacks {
 public:
   CppFilePreambleCallbacks(
@@ -566,6 +594,7 @@ buildPreamble(PathRef FileName, CompilerInvocation CI,
     Result->CanonIncludes = CapturedInfo.takeCanonicalIncludes();
     Result->StatCache = std::move(StatCache);
     Result->MainIsIncludeGuarded = CapturedInfo.isMainFileIncludeGuarded();
+    Result->IncludeCleaner = std::make_shared<IncludeCleanerCache>();
     return Result;
   }
 
@@ -586,6 +615,33 @@ bool isPreambleCompatible(const PreambleData &Preamble,
          Preamble.Preamble.CanReuse(CI, *ContentsBuffer, Bounds, *VFS);
 }
 
+bool isPreambleShareable(const PreambleData &Preamble,
+                         const ParseInputs &Inputs, PathRef FileName,
+                         const CompilerInvocation &CI) {
+  // Locations in the preamble section of the main file point into the file
+  // the preamble was built for. That is only unobservable if the section holds
+  // nothing but includes and comments, so that no macro, mark or diagnostic
+  // is located there.
+  if (!Preamble.Diags.empty() || !Preamble.Macros.Names.empty() ||
+      !Preamble.Macros.MacroRefs.empty() ||
+      !Preamble.Macros.UnknownMacros.empty() || !Preamble.Marks.empty() ||
+      Preamble.MainIsIncludeGuarded)
+    return false;
+  // Quoted includes are resolved relative to the directory of the main file.
+  std::string PreambleFile = absoluteFilename(Preamble.CompileCommand,
+                                              Preamble.CompileCommand.Filename);
+  if (llvm::sys::path::parent_path(PreambleFile) !=
+      llvm::sys::path::parent_path(FileName))
+    return false;
+  auto ContentsBuffer =
+      llvm::MemoryBuffer::getMemBuffer(Inputs.Contents, FileName);
+  auto Bounds = ComputePreambleBounds(*CI.getLangOpts(), *ContentsBuffer, 0);
+  auto VFS = Inputs.TFS->view(Inputs.CompileCommand.Directory);
+  return compileCommandsAreEqualButFile(Inputs.CompileCommand,
+                                        Preamble.CompileCommand) &&
+         Preamble.Preamble.CanReuse(CI, *ContentsBuffer, Bounds, *VFS);
+}
+
 void escapeBackslashAndQuotes(llvm::StringRef Text, llvm::raw_ostream &OS) {
   for (char C : Text) {
     switch (C) {
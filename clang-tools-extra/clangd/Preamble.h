@@ -42,6 +42,8 @@
 namespace clang {
 namespace clangd {
 
+class IncludeCleanerCache;
+
 /// The parsed preamble and associated data.
 ///
 /// As we must avoid re-parsing the preamble, any information that can only
@@ -70,6 +72,9 @@ struct PreambleData {
   // Whether there was a (possibly-incomplete) include-guard on the main file.
   // We need to propagate this information "by hand" to subsequent parses.
   bool MainIsIncludeGuarded = false;
+  // Results of the unused-include analysis that rebuilds of the main file with
+  // this preamble can reuse.
+  std::shared_ptr<IncludeCleanerCache> IncludeCleaner;
 };
 
 using PreambleParsedCallback = std::function<void(ASTContext &, Preprocessor &,
@@ -111,6 +116,14 @@ bool isPreambleCompatible(const PreambleData &Preamble,
                           const ParseInputs &Inputs, PathRef FileName,
                           const CompilerInvocation &CI);
 
+/// Returns true if \p Preamble, built for another file, can be used for
+/// \p Inputs of \p FileName. This requires both files to be in the same
+/// directory, to be compiled with the same flags and to start with the same
+/// preamble section, which must contain only includes and comments.
+bool isPreambleShareable(const PreambleData &Preamble,
+                         const ParseInputs &Inputs, PathRef FileName,
+                         const CompilerInvocation &CI);
+
 /// Stores information required to parse a TU using a (possibly stale) Baseline
 /// preamble. Later on this information can be injected into the main file by
 /// updating compiler invocation with \c apply. This injected section
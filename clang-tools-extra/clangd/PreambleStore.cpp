@@ -0,0 +1,437 @@
+//===--- PreambleStore.cpp - Persisting preambles across restarts -*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "PreambleStore.h"
+#include "CollectMacros.h"
+#include "FS.h"
+#include "Headers.h"
+#include "IncludeCleaner.h"
+#include "SourceCode.h"
+#include "index/BinaryIO.h"
+#include "index/CanonicalIncludes.h"
+#include "support/Logger.h"
+#include "support/Trace.h"
+#include "clang/Basic/Version.h"
+#include "clang/Tooling/Inclusions/StandardLibrary.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace clang {
+namespace clangd {
+namespace {
+
+// A stored preamble holds the fields of PreambleData that were collected while
+// building it, followed by the serialized PrecompiledPreamble.
+// The version must be bumped whenever the layout changes.
+constexpr uint32_t StoredPreambleMagic = 0x50444443; // "CDDP"
+constexpr uint32_t StoredPreambleVersion = 1;
+constexpr llvm::StringLiteral StoredPreambleExtension = ".preamble";
+
+void writeRange(const Range &R, llvm::raw_ostream &OS) {
+  writeVar(R.start.line, OS);
+  writeVar(R.start.character, OS);
+  writeVar(R.end.line, OS);
+  writeVar(R.end.character, OS);
+}
+
+Range readRange(BinaryReader &R) {
+  Range Result;
+  Result.start.line = R.consumeVar();
+  Result.start.character = R.consumeVar();
+  Result.end.line = R.consumeVar();
+  Result.end.character = R.consumeVar();
+  return Result;
+}
+
+void writeOccurrences(llvm::ArrayRef<MacroOccurrence> Occurrences,
+                      llvm::raw_ostream &OS) {
+  writeVar(Occurrences.size(), OS);
+  for (const MacroOccurrence &O : Occurrences) {
+    writeRange(O.Rng, OS);
+    OS.write(O.IsDefinition);
+  }
+}
+
+std::vector<MacroOccurrence> readOccurrences(BinaryReader &R) {
+  std::vector<MacroOccurrence> Result(R.consumeSize());
+  for (MacroOccurrence &O : Result) {
+    O.Rng = readRange(R);
+    O.IsDefinition = R.consume8();
+  }
+  return Result;
+}
+
+llvm::Error writePreamble(const PreambleData &Preamble,
+                          llvm::vfs::FileSystem &FS, llvm::raw_ostream &OS) {
+  write32(StoredPreambleMagic, OS);
+  write32(StoredPreambleVersion, OS);
+  // PCH files can only be read by the compiler that wrote them.
+  writeString(getClangFullVersion(), OS);
+
+  const tooling::CompileCommand &Cmd = Preamble.CompileCommand;
+  writeString(Cmd.Directory, OS);
+  writeString(Cmd.Filename, OS);
+  writeString(Cmd.Output, OS);
+  writeString(Cmd.Heuristic, OS);
+  writeVar(Cmd.CommandLine.size(), OS);
+  for (llvm::StringRef Arg : Cmd.CommandLine)
+    writeString(Arg, OS);
+  OS.write(Preamble.MainIsIncludeGuarded);
+
+  // Headers are keyed by UniqueID in memory, which is only meaningful to the
+  // filesystem that produced it. Store paths, and look IDs up again on load.
+  const IncludeStructure &Includes = Preamble.Includes;
+  llvm::ArrayRef<std::string> Headers = Includes.allHeaders();
+  writeVar(Headers.size(), OS);
+  for (unsigned I = 0; I < Headers.size(); ++I) {
+    auto ID = static_cast<IncludeStructure::HeaderID>(I);
+    llvm::StringRef Mapping;
+    if (ID != IncludeStructure::MainFileID) {
+      auto Status = FS.status(Headers[I]);
+      if (!Status)
+        return error("Couldn't stat header {0}", Headers[I]);
+      Mapping = Preamble.CanonIncludes.mappingFor(Status->getUniqueID());
+    }
+    writeString(Headers[I], OS);
+    uint8_t Flags =
+        Includes.isSelfContained(ID) | Includes.hasIWYUExport(ID) << 1;
+    OS.write(Flags);
+    writeString(Mapping, OS);
+  }
+  writeVar(Includes.MainFileIncludes.size(), OS);
+  for (const Inclusion &Inc : Includes.MainFileIncludes) {
+    writeVar(Inc.Directive, OS);
+    writeString(Inc.Written, OS);
+    writeString(Inc.Resolved, OS);
+    writeVar(Inc.HashOffset, OS);
+    writeVar(Inc.HashLine, OS);
+    OS.write(Inc.FileKind);
+    writeVar(Inc.HeaderID ? *Inc.HeaderID + 1 : 0, OS);
+    OS.write(Inc.BehindPragmaKeep);
+  }
+  writeVar(Includes.IncludeChildren.size(), OS);
+  for (const auto &Entry : Includes.IncludeChildren) {
+    writeVar(static_cast<unsigned>(Entry.first), OS);
+    writeVar(Entry.second.size(), OS);
+    for (IncludeStructure::HeaderID Child : Entry.second)
+      writeVar(static_cast<unsigned>(Child), OS);
+  }
+  writeVar(Includes.StdlibHeaders.size(), OS);
+  for (const auto &Entry : Includes.StdlibHeaders) {
+    writeString(Entry.first.name(), OS);
+    writeVar(Entry.second.size(), OS);
+    for (IncludeStructure::HeaderID ID : Entry.second)
+      writeVar(static_cast<unsigned>(ID), OS);
+  }
+
+  const MainFileMacros &Macros = Preamble.Macros;
+  writeVar(Macros.Names.size(), OS);
+  for (const auto &Name : Macros.Names)
+    writeString(Name.getKey(), OS);
+  writeVar(Macros.MacroRefs.size(), OS);
+  for (const auto &Entry : Macros.MacroRefs) {
+    OS << Entry.first.raw();
+    writeOccurrences(Entry.second, OS);
+  }
+  writeOccurrences(Macros.UnknownMacros, OS);
+  writeVar(Macros.SkippedRanges.size(), OS);
+  for (const Range &R : Macros.SkippedRanges)
+    writeRange(R, OS);
+
+  writeVar(Preamble.Marks.size(), OS);
+  for (const PragmaMark &Mark : Preamble.Marks) {
+    writeRange(Mark.Rng, OS);
+    writeString(Mark.Trivia, OS);
+  }
+
+  if (!Preamble.Preamble.serialize(OS))
+    return error("Couldn't read the PCH");
+  return llvm::Error::success();
+}
+
+// Headers are looked up in \p FS, which should be the filesystem the preamble
+// will be used with.
+llvm::Expected<std::unique_ptr<PreambleData>>
+readPreamble(llvm::StringRef Data, llvm::vfs::FileSystem &FS,
+             const CompilerInvocation &CI, bool StoreInMemory) {
+  BinaryReader R(Data);
+  if (R.consume32() != StoredPreambleMagic ||
+      R.consume32() != StoredPreambleVersion)
+    return error("Unsupported preamble format");
+  if (R.consumeString() != getClangFullVersion())
+    return error("Preamble was built by another version of clang");
+
+  tooling::CompileCommand Cmd;
+  Cmd.Directory = R.consumeString().str();
+  Cmd.Filename = R.consumeString().str();
+  Cmd.Output = R.consumeString().str();
+  Cmd.Heuristic = R.consumeString().str();
+  Cmd.CommandLine.resize(R.consumeSize());
+  for (std::string &Arg : Cmd.CommandLine)
+    Arg = R.consumeString().str();
+  bool MainIsIncludeGuarded = R.consume8();
+
+  IncludeStructure Includes;
+  CanonicalIncludes CanonIncludes;
+  CanonIncludes.addSystemHeadersMapping(*CI.getLangOpts());
+  for (uint32_t I = 0, N = R.consumeSize(); I < N && !R.err(); ++I) {
+    auto ID = static_cast<IncludeStructure::HeaderID>(I);
+    llvm::StringRef Path = R.consumeString();
+    uint8_t Flags = R.consume8();
+    llvm::StringRef Mapping = R.consumeString();
+    llvm::sys::fs::UniqueID UID;
+    if (ID != IncludeStructure::MainFileID) {
+      auto Status = FS.status(Path);
+      if (!Status)
+        return error("Couldn't stat header {0}", Path);
+      UID = Status->getUniqueID();
+      if (!Mapping.empty())
+        CanonIncludes.addMapping(UID, Mapping);
+    }
+    Includes.restoreHeader(ID, Path, UID, /*SelfContained=*/Flags & 1,
+                           /*IWYUExport=*/Flags & 2);
+  }
+  size_t NumHeaders = Includes.allHeaders().size();
+  auto ReadHeaderID = [&] {
+    uint32_t ID = R.consumeVar();
+    if (ID >= NumHeaders) {
+      R.markError();
+      ID = 0;
+    }
+    return static_cast<IncludeStructure::HeaderID>(ID);
+  };
+  Includes.MainFileIncludes.resize(R.consumeSize());
+  for (Inclusion &Inc : Includes.MainFileIncludes) {
+    Inc.Directive = static_cast<tok::PPKeywordKind>(R.consumeVar());
+    Inc.Written = R.consumeString().str();
+    Inc.Resolved = R.consumeString().str();
+    Inc.HashOffset = R.consumeVar();
+    Inc.HashLine = R.consumeVar();
+    Inc.FileKind = static_cast<SrcMgr::CharacteristicKind>(R.consume8());
+    if (uint32_t ID = R.consumeVar()) {
+      if (ID > NumHeaders)
+        R.markError();
+      Inc.HeaderID = ID - 1;
+    }
+    Inc.BehindPragmaKeep = R.consume8();
+  }
+  for (uint32_t I = 0, N = R.consumeSize(); I < N && !R.err(); ++I) {
+    auto &Children = Includes.IncludeChildren[ReadHeaderID()];
+    Children.resize(R.consumeSize());
+    for (IncludeStructure::HeaderID &Child : Children)
+      Child = ReadHeaderID();
+  }
+  for (uint32_t I = 0, N = R.consumeSize(); I < N && !R.err(); ++I) {
+    auto Header = tooling::stdlib::Header::named(R.consumeString());
+    if (!Header)
+      return error("Unknown standard library header");
+    auto &IDs = Includes.StdlibHeaders[*Header];
+    IDs.resize(R.consumeSize());
+    for (IncludeStructure::HeaderID &ID : IDs)
+      ID = ReadHeaderID();
+  }
+
+  MainFileMacros Macros;
+  for (uint32_t I = 0, N = R.consumeSize(); I < N && !R.err(); ++I)
+    Macros.Names.insert(R.consumeString());
+  for (uint32_t I = 0, N = R.consumeSize(); I < N && !R.err(); ++I) {
+    SymbolID ID = R.consumeID();
+    Macros.MacroRefs[ID] = readOccurrences(R);
+  }
+  Macros.UnknownMacros = readOccurrences(R);
+  Macros.SkippedRanges.resize(R.consumeSize());
+  for (Range &SkippedRange : Macros.SkippedRanges)
+    SkippedRange = readRange(R);
+
+  std::vector<PragmaMark> Marks(R.consumeSize());
+  for (PragmaMark &Mark : Marks) {
+    Mark.Rng = readRange(R);
+    Mark.Trivia = R.consumeString().str();
+  }
+  if (R.err())
+    return error("Malformed preamble");
+
+  auto PCH = PrecompiledPreamble::deserialize(R.rest(), StoreInMemory);
+  if (!PCH)
+    return error("Couldn't restore PCH: {0}", PCH.getError().message());
+  auto Result = std::make_unique<PreambleData>(std::move(*PCH));
+  Result->CompileCommand = std::move(Cmd);
+  Result->Includes = std::move(Includes);
+  Result->Macros = std::move(Macros);
+  Result->Marks = std::move(Marks);
+  Result->CanonIncludes = std::move(CanonIncludes);
+  Result->MainIsIncludeGuarded = MainIsIncludeGuarded;
+  Result->IncludeCleaner = std::make_shared<IncludeCleanerCache>();
+  return Result;
+}
+
+} // namespace
+
+PreambleStore::PreambleStore(llvm::StringRef Directory, uint64_t MaxBytes)
+    : Directory(Directory), MaxBytes(MaxBytes) {
+  if (auto EC = llvm::sys::fs::create_directories(Directory))
+    elog("Failed to create directory {0} for preambles: {1}", Directory,
+         EC.message());
+  prune();
+}
+
+std::string PreambleStore::pathFor(PathRef FileName,
+                                   const tooling::CompileCommand &Cmd,
+                                   llvm::StringRef PreambleText) const {
+  std::string Key;
+  llvm::raw_string_ostream OS(Key);
+  OS << FileName << '\0' << Cmd.Directory << '\0' << Cmd.Filename << '\0';
+  for (llvm::StringRef Arg : Cmd.CommandLine)
+    OS << Arg << '\0';
+  OS << PreambleText;
+  llvm::SmallString<128> Path(Directory);
+  llvm::sys::path::append(Path, llvm::sys::path::filename(FileName) + "." +
+                                    llvm::toHex(digest(OS.str())) +
+                                    StoredPreambleExtension);
+  return std::string(Path.str());
+}
+
+std::shared_ptr<const PreambleData>
+PreambleStore::load(PathRef FileName, const ParseInputs &Inputs,
+                    const CompilerInvocation &CI, bool StoreInMemory) const {
+  auto ContentsBuffer =
+      llvm::MemoryBuffer::getMemBuffer(Inputs.Contents, FileName);
+  auto Bounds = ComputePreambleBounds(*CI.getLangOpts(), *ContentsBuffer, 0);
+  std::string Path =
+      pathFor(FileName, Inputs.CompileCommand,
+              llvm::StringRef(Inputs.Contents).take_front(Bounds.Size));
+  int FD;
+  if (llvm::sys::fs::openFileForRead(Path, FD))
+    return nullptr;
+  auto CloseFD = llvm::make_scope_exit(
+      [FD] { llvm::sys::Process::SafelyCloseFileDescriptor(FD); });
+
+  trace::Span Tracer("LoadStoredPreamble");
+  SPAN_ATTACH(Tracer, "File", FileName);
+  auto Buffer = llvm::MemoryBuffer::getOpenFile(
+      llvm::sys::fs::convertFDToNativeFile(FD), Path, /*FileSize=*/-1);
+  if (!Buffer)
+    return nullptr;
+
+  auto VFS = Inputs.TFS->view(Inputs.CompileCommand.Directory);
+  llvm::SmallString<32> AbsFileName(FileName);
+  VFS->makeAbsolute(AbsFileName);
+  // Headers are stat()ed while reading the preamble, make sure the results can
+  // be reused when building ASTs.
+  auto StatCache = std::make_unique<PreambleFileStatusCache>(AbsFileName);
+  auto Preamble = readPreamble((*Buffer)->getBuffer(),
+                               *StatCache->getProducingFS(VFS), CI,
+                               StoreInMemory);
+  if (!Preamble) {
+    vlog("Couldn't load stored preamble for {0}: {1}", FileName,
+         Preamble.takeError());
+    return nullptr;
+  }
+  (*Preamble)->Version = Inputs.Version;
+  (*Preamble)->StatCache = std::move(StatCache);
+  if (!isPreambleCompatible(**Preamble, Inputs, FileName, CI)) {
+    vlog("Stored preamble for {0} is out of date", FileName);
+    return nullptr;
+  }
+  // Mark the preamble as recently used, so that it isn't pruned.
+  llvm::sys::fs::setLastAccessAndModificationTime(
+      FD, std::chrono::system_clock::now());
+  vlog("Loaded stored preamble of size {0} for {1}",
+       (*Preamble)->Preamble.getSize(), FileName);
+  return std::move(*Preamble);
+}
+
+void PreambleStore::store(PathRef FileName, const ThreadsafeFS &TFS,
+                          std::shared_ptr<const PreambleData> Preamble) {
+  if (!Preamble->Diags.empty())
+    return;
+  Writes.runAsync("StorePreamble:" + llvm::sys::path::filename(FileName),
+                  [this, FileName = FileName.str(),
+                   VFS = TFS.view(Preamble->CompileCommand.Directory),
+                   Preamble = std::move(Preamble)] {
+                    write(FileName, *VFS, *Preamble);
+                  });
+}
+
+bool PreambleStore::blockUntilIdle(Deadline D) const { return Writes.wait(D); }
+
+void PreambleStore::write(PathRef FileName, llvm::vfs::FileSystem &FS,
+                          const PreambleData &Preamble) {
+  trace::Span Tracer("StorePreamble");
+  SPAN_ATTACH(Tracer, "File", FileName);
+  std::string Path = pathFor(FileName, Preamble.CompileCommand,
+                             Preamble.Preamble.getContents());
+  if (auto Err = llvm::writeFileAtomically(
+          Path + ".tmp.%%%%%%%%", Path, [&](llvm::raw_ostream &OS) {
+            return writePreamble(Preamble, FS, OS);
+          })) {
+    elog("Failed to store preamble for {0}: {1}", FileName, std::move(Err));
+    return;
+  }
+  uint64_t Size = 0;
+  llvm::sys::fs::file_size(Path, Size);
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    KnownBytes += Size;
+    if (KnownBytes <= MaxBytes)
+      return;
+  }
+  prune();
+}
+
+void PreambleStore::prune() {
+  struct Entry {
+    std::string Path;
+    uint64_t Size;
+    llvm::sys::TimePoint<> LastUsed;
+  };
+  std::lock_guard<std::mutex> Lock(Mu);
+  std::vector<Entry> Entries;
+  uint64_t TotalBytes = 0;
+  auto UpdateKnownBytes =
+      llvm::make_scope_exit([&] { KnownBytes = TotalBytes; });
+  std::error_code EC;
+  for (llvm::sys::fs::directory_iterator It(Directory, EC), End;
+       It != End && !EC; It.increment(EC)) {
+    if (llvm::sys::path::extension(It->path()) != StoredPreambleExtension)
+      continue;
+    llvm::sys::fs::file_status Status;
+    if (llvm::sys::fs::status(It->path(), Status))
+      continue;
+    Entries.push_back(
+        {It->path(), Status.getSize(), Status.getLastModificationTime()});
+    TotalBytes += Status.getSize();
+  }
+  if (TotalBytes <= MaxBytes)
+    return;
+  llvm::sort(Entries, [](const Entry &L, const Entry &R) {
+    return L.LastUsed < R.LastUsed;
+  });
+  for (const Entry &E : Entries) {
+    if (TotalBytes <= MaxBytes)
+      break;
+    // Another clangd may have removed it already, that's fine.
+    llvm::sys::fs::remove(E.Path);
+    TotalBytes -= E.Size;
+  }
+}
+
+} // namespace clangd
+} // namespace clang
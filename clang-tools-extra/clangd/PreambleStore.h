@@ -0,0 +1,95 @@
+//===--- PreambleStore.h - Persisting preambles across restarts --*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Preambles are lost when clangd exits, so the first time each file is opened
+// after a restart its preamble has to be built from scratch. For large
+// translation units that takes many seconds.
+//
+// PreambleStore keeps preambles in a directory on disk, so that they can be
+// picked up by later clangd instances. A stored preamble is found by hashing
+// the main file path, its compile command and its preamble section. Whether it
+// is still usable (e.g. the included headers haven't changed) is then checked
+// with isPreambleCompatible(), as for any other preamble.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_PREAMBLESTORE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_PREAMBLESTORE_H
+
+#include "Compiler.h"
+#include "Preamble.h"
+#include "support/Path.h"
+#include "support/Threading.h"
+#include "support/ThreadsafeFS.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace clang {
+namespace clangd {
+
+/// Stores preambles on disk, one file per preamble.
+/// When the stored preambles exceed a total size, the least recently used ones
+/// are removed. The size is tracked as preambles are stored, so that the
+/// directory is only scanned on construction and when it may be too large.
+/// This class is threadsafe, and several clangd instances may share the
+/// directory.
+class PreambleStore {
+public:
+  /// Stores preambles in \p Directory, creating it if needed.
+  PreambleStore(llvm::StringRef Directory, uint64_t MaxBytes);
+
+  /// Returns a stored preamble that can be used for \p Inputs, if any.
+  /// \p CI is the compiler invocation for \p Inputs.
+  std::shared_ptr<const PreambleData> load(PathRef FileName,
+                                           const ParseInputs &Inputs,
+                                           const CompilerInvocation &CI,
+                                           bool StoreInMemory) const;
+
+  /// Stores \p Preamble, built for \p FileName. \p TFS must be the filesystem
+  /// it was built with.
+  /// The preamble is written out asynchronously, so that storing it doesn't
+  /// delay the next preamble build.
+  /// Preambles with diagnostics are not stored: they are rare, usually about
+  /// to change, and would need all of their diagnostics stored too.
+  void store(PathRef FileName, const ThreadsafeFS &TFS,
+             std::shared_ptr<const PreambleData> Preamble);
+
+  /// Removes the least recently used preambles until at most MaxBytes remain.
+  void prune();
+
+  /// Waits until the preambles passed to store() are written out.
+  /// Mostly useful for synchronizing tests.
+  bool blockUntilIdle(Deadline D) const;
+
+private:
+  std::string pathFor(PathRef FileName,
+                      const tooling::CompileCommand &Cmd,
+                      llvm::StringRef PreambleText) const;
+  void write(PathRef FileName, llvm::vfs::FileSystem &FS,
+             const PreambleData &Preamble);
+
+  std::string Directory;
+  uint64_t MaxBytes;
+  std::mutex Mu;
+  /// The size of the directory when it was last scanned, plus that of the
+  /// preambles stored since. Other clangd instances may have stored more.
+  uint64_t KnownBytes = 0; /* GUARDED_BY(Mu) */
+  /// Runs the writes. Declared last, so that it waits for them before the
+  /// other members are destroyed.
+  AsyncTaskRunner Writes;
+};
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_PREAMBLESTORE_H
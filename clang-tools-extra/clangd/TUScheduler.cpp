@@ -53,6 +53,7 @@
 #include "GlobalCompilationDatabase.h"
 #include "ParsedAST.h"
 #include "Preamble.h"
+#include "PreambleStore.h"
 #include "index/CanonicalIncludes.h"
 #include "support/Cancellation.h"
 #include "support/Context.h"
@@ -218,6 +219,118 @@ private:
   std::vector<KVPair> LRU; /* GUARDED_BY(Mut) */
 };
 
+/// Shares preambles between files, and retains those of recently closed files.
+///
+/// Files in the same directory that are compiled with the same flags often
+/// start with the same block of includes, and so get identical preambles.
+/// Rather than building and holding a copy for each of them, a preamble built
+/// for one file is handed to the others (see isPreambleShareable()). Closed
+/// files are often reopened soon after (e.g. when navigating back), so the
+/// preambles of the most recently closed ones are kept alive too.
+/// All methods are threadsafe.
+class TUScheduler::PreambleCache {
+public:
+  PreambleCache(unsigned MaxRetainedPreambles)
+      : MaxRetainedPreambles(MaxRetainedPreambles) {}
+
+  /// Makes \p Preamble, which \p File uses, available to other files for as
+  /// long as something else keeps it alive.
+  void add(PathRef File, const std::shared_ptr<const PreambleData> &Preamble) {
+    std::lock_guard<std::mutex> Lock(Mut);
+    // Forget about the preambles that are gone.
+    for (auto It = Shared.begin(); It != Shared.end();) {
+      auto Current = It++;
+      llvm::erase_if(Current->second, [&](const SharedEntry &E) {
+        return E.Preamble.expired();
+      });
+      if (Current->second.empty())
+        Shared.erase(Current);
+    }
+    auto &Entries = Shared[Preamble->Preamble.getContents()];
+    // A preamble shared by several files only needs to be found once.
+    if (llvm::none_of(Entries, [&](const SharedEntry &E) {
+          return !E.Preamble.owner_before(Preamble) &&
+                 !Preamble.owner_before(E.Preamble);
+        }))
+      Entries.push_back({File.str(), Preamble});
+  }
+
+  /// Returns a preamble that can be used for \p Inputs of \p File, other than
+  /// \p Current. It was built either for another file, or for \p File before
+  /// it was closed. Returns nullptr if there is none.
+  std::shared_ptr<const PreambleData>
+  find(PathRef File, const ParseInputs &Inputs, const CompilerInvocation &CI,
+       const PreambleData *Current) {
+    auto Bounds = ComputePreambleBounds(
+        *CI.getLangOpts(), llvm::MemoryBufferRef(Inputs.Contents, File), 0);
+    llvm::StringRef Key =
+        llvm::StringRef(Inputs.Contents).take_front(Bounds.Size);
+    std::vector<std::pair<std::string, std::shared_ptr<const PreambleData>>>
+        Candidates;
+    {
+      std::lock_guard<std::mutex> Lock(Mut);
+      auto It = Shared.find(Key);
+      if (It == Shared.end())
+        return nullptr;
+      for (const SharedEntry &E : It->second)
+        if (auto Preamble = E.Preamble.lock())
+          if (Preamble.get() != Current)
+            Candidates.emplace_back(E.File, std::move(Preamble));
+    }
+    // Checking the candidates stats the files they include, don't hold the
+    // lock meanwhile.
+    for (auto &Candidate : Candidates) {
+      if (Candidate.first == File
+              ? isPreambleCompatible(*Candidate.second, Inputs, File, CI)
+              : isPreambleShareable(*Candidate.second, Inputs, File, CI))
+        return std::move(Candidate.second);
+    }
+    return nullptr;
+  }
+
+  /// Keeps the preamble of the closed file \p File alive, possibly releasing
+  /// that of the least recently closed one.
+  void retain(PathRef File, std::shared_ptr<const PreambleData> Preamble) {
+    if (!MaxRetainedPreambles || !Preamble)
+      return;
+    std::unique_lock<std::mutex> Lock(Mut);
+    llvm::erase_if(Retained, [&](const KVPair &P) { return P.first == File; });
+    Retained.insert(Retained.begin(), {File.str(), std::move(Preamble)});
+    if (Retained.size() <= MaxRetainedPreambles)
+      return;
+    std::shared_ptr<const PreambleData> ForCleanup =
+        std::move(Retained.back().second);
+    Retained.pop_back();
+    // Run the expensive destructor outside the lock.
+    Lock.unlock();
+    ForCleanup.reset();
+  }
+
+  /// Returns the total size of the preambles kept alive for closed files.
+  size_t getUsedBytes() const {
+    std::lock_guard<std::mutex> Lock(Mut);
+    size_t Bytes = 0;
+    for (const auto &Elem : Retained)
+      Bytes += Elem.second->Preamble.getSize();
+    return Bytes;
+  }
+
+private:
+  struct SharedEntry {
+    std::string File;
+    std::weak_ptr<const PreambleData> Preamble;
+  };
+  using KVPair = std::pair<std::string, std::shared_ptr<const PreambleData>>;
+
+  mutable std::mutex Mut;
+  const unsigned MaxRetainedPreambles;
+  /// Preambles by the contents of their preamble section.
+  llvm::StringMap<std::vector<SharedEntry>> Shared; /* GUARDED_BY(Mut) */
+  /// Preambles of closed files, sorted in LRU order, i.e. first item is the
+  /// most recently closed one.
+  std::vector<KVPair> Retained; /* GUARDED_BY(Mut) */
+};
+
 /// A map from header files to an opened "proxy" file that includes them.
 /// If you open the header, the compile command from the proxy file is used.
 ///
@@ -424,13 +537,14 @@ class PreambleThread {
 public:
   PreambleThread(llvm::StringRef FileName, ParsingCallbacks &Callbacks,
                  bool StorePreambleInMemory, bool RunSync,
-                 PreambleThrottler *Throttler, SynchronizedTUStatus &Status,
+                 PreambleThrottler *Throttler, PreambleStore *Store,
+                 SynchronizedTUStatus &Status,
                  TUScheduler::HeaderIncluderCache &HeaderIncluders,
-                 ASTWorker &AW)
+                 TUScheduler::PreambleCache &SharedPreambles, ASTWorker &AW)
       : FileName(FileName), Callbacks(Callbacks),
         StoreInMemory(StorePreambleInMemory), RunSync(RunSync),
-        Throttler(Throttler), Status(Status), ASTPeer(AW),
-        HeaderIncluders(HeaderIncluders) {}
+        Throttler(Throttler), Store(Store), Status(Status), ASTPeer(AW),
+        HeaderIncluders(HeaderIncluders), SharedPreambles(SharedPreambles) {}
 
   /// It isn't guaranteed that each requested version will be built. If there
   /// are multiple update requests while building a preamble, only the last one
@@ -571,10 +685,12 @@ private:
   const bool StoreInMemory;
   const bool RunSync;
   PreambleThrottler *Throttler;
+  PreambleStore *Store;
 
   SynchronizedTUStatus &Status;
   ASTWorker &ASTPeer;
   TUScheduler::HeaderIncluderCache &HeaderIncluders;
+  TUScheduler::PreambleCache &SharedPreambles;
 };
 
 class ASTWorkerHandle;
@@ -594,7 +710,8 @@ class ASTWorker {
   ASTWorker(PathRef FileName, const GlobalCompilationDatabase &CDB,
             TUScheduler::ASTCache &LRUCache,
             TUScheduler::HeaderIncluderCache &HeaderIncluders,
-            Semaphore &Barrier, bool RunSync, const TUScheduler::Options &Opts,
+            TUScheduler::PreambleCache &SharedPreambles, Semaphore &Barrier,
+            bool RunSync, const TUScheduler::Options &Opts,
             ParsingCallbacks &Callbacks);
 
 public:
@@ -607,8 +724,9 @@ public:
   create(PathRef FileName, const GlobalCompilationDatabase &CDB,
          TUScheduler::ASTCache &IdleASTs,
          TUScheduler::HeaderIncluderCache &HeaderIncluders,
-         AsyncTaskRunner *Tasks, Semaphore &Barrier,
-         const TUScheduler::Options &Opts, ParsingCallbacks &Callbacks);
+         TUScheduler::PreambleCache &SharedPreambles, AsyncTaskRunner *Tasks,
+         Semaphore &Barrier, const TUScheduler::Options &Opts,
+         ParsingCallbacks &Callbacks);
   ~ASTWorker();
 
   void update(ParseInputs Inputs, WantDiagnostics, bool ContentChanged);
@@ -625,9 +743,12 @@ public:
   /// Diagnostics are only published through this callback. This ensures they
   /// are always for newer versions of the file, as the callback gets called in
   /// the same order as update requests.
+  /// \p PreambleIndexed is false if the preamble was reused without being
+  /// built, so that its headers are indexed from the next AST instead.
   void updatePreamble(std::unique_ptr<CompilerInvocation> CI, ParseInputs PI,
                       std::shared_ptr<const PreambleData> Preamble,
-                      std::vector<Diag> CIDiags, WantDiagnostics WantDiags);
+                      std::vector<Diag> CIDiags, WantDiagnostics WantDiags,
+                      bool PreambleIndexed);
 
   /// Obtain a preamble reflecting all updates so far. Threadsafe.
   /// It may be delivered immediately, or later on the worker thread.
@@ -702,6 +823,7 @@ private:
   /// Handles retention of ASTs.
   TUScheduler::ASTCache &IdleASTs;
   TUScheduler::HeaderIncluderCache &HeaderIncluders;
+  TUScheduler::PreambleCache &SharedPreambles;
   const bool RunSync;
   /// Time to wait after an update to see whether another update obsoletes it.
   const DebouncePolicy UpdateDebounce;
@@ -716,6 +838,9 @@ private:
   Semaphore &Barrier;
   /// Whether the 'onMainAST' callback ran for the current FileInputs.
   bool RanASTCallback = false;
+  /// The invocation of the latest preamble if onPreambleAST() hasn't run for
+  /// it, e.g. because it was loaded from disk. Only used by the worker thread.
+  std::unique_ptr<CompilerInvocation> UnindexedPreambleCI;
   /// Guards members used by both TUScheduler and the worker thread.
   mutable std::mutex Mutex;
   /// File inputs, currently being used by the worker.
@@ -804,12 +929,13 @@ ASTWorkerHandle
 ASTWorker::create(PathRef FileName, const GlobalCompilationDatabase &CDB,
                   TUScheduler::ASTCache &IdleASTs,
                   TUScheduler::HeaderIncluderCache &HeaderIncluders,
+                  TUScheduler::PreambleCache &SharedPreambles,
                   AsyncTaskRunner *Tasks, Semaphore &Barrier,
                   const TUScheduler::Options &Opts,
                   ParsingCallbacks &Callbacks) {
-  std::shared_ptr<ASTWorker> Worker(
-      new ASTWorker(FileName, CDB, IdleASTs, HeaderIncluders, Barrier,
-                    /*RunSync=*/!Tasks, Opts, Callbacks));
+  std::shared_ptr<ASTWorker> Worker(new ASTWorker(
+      FileName, CDB, IdleASTs, HeaderIncluders, SharedPreambles, Barrier,
+      /*RunSync=*/!Tasks, Opts, Callbacks));
   if (Tasks) {
     Tasks->runAsync("ASTWorker:" + llvm::sys::path::filename(FileName),
                     [Worker]() { Worker->run(); });
@@ -823,15 +949,18 @@ ASTWorker::create(PathRef FileName, const GlobalCompilationDatabase &CDB,
 ASTWorker::ASTWorker(PathRef FileName, const GlobalCompilationDatabase &CDB,
                      TUScheduler::ASTCache &LRUCache,
                      TUScheduler::HeaderIncluderCache &HeaderIncluders,
+                     TUScheduler::PreambleCache &SharedPreambles,
                      Semaphore &Barrier, bool RunSync,
                      const TUScheduler::Options &Opts,
                      ParsingCallbacks &Callbacks)
-    : IdleASTs(LRUCache), HeaderIncluders(HeaderIncluders), RunSync(RunSync),
+    : IdleASTs(LRUCache), HeaderIncluders(HeaderIncluders),
+      SharedPreambles(SharedPreambles), RunSync(RunSync),
       UpdateDebounce(Opts.UpdateDebounce), FileName(FileName),
       ContextProvider(Opts.ContextProvider), CDB(CDB), Callbacks(Callbacks),
       Barrier(Barrier), Done(false), Status(FileName, Callbacks),
       PreamblePeer(FileName, Callbacks, Opts.StorePreamblesInMemory, RunSync,
-                   Opts.PreambleThrottler, Status, HeaderIncluders, *this) {
+                   Opts.PreambleThrottler, Opts.PreambleStore, Status,
+                   HeaderIncluders, SharedPreambles, *this) {
   // Set a fallback command because compile command can be accessed before
   // `Inputs` is initialized. Other fields are only used after initialization
   // from client inputs.
@@ -1030,27 +1159,58 @@ static void crashDumpParseInputs(llvm::raw_ostream &OS,
 void PreambleThread::build(Request Req) {
   assert(Req.CI && "Got preamble request with null compiler invocation");
   const ParseInputs &Inputs = Req.Inputs;
+  const ThreadsafeFS &TFS = *Inputs.TFS;
   bool ReusedPreamble = false;
+  bool LoadedPreamble = false;
+  bool BuiltPreamble = false;
 
   Status.update([&](TUStatus &Status) {
     Status.PreambleActivity = PreambleAction::Building;
   });
-  auto _ = llvm::make_scope_exit([this, &Req, &ReusedPreamble] {
+  auto _ = llvm::make_scope_exit([this, &Req, &ReusedPreamble, &LoadedPreamble,
+                                  &BuiltPreamble, &TFS] {
     ASTPeer.updatePreamble(std::move(Req.CI), std::move(Req.Inputs),
                            LatestBuild, std::move(Req.CIDiags),
-                           std::move(Req.WantDiags));
+                           std::move(Req.WantDiags),
+                           /*PreambleIndexed=*/!LoadedPreamble);
     if (!ReusedPreamble)
       Callbacks.onPreamblePublished(FileName);
+    // Store the preamble once it's published. It's written out on another
+    // thread, so that doesn't delay diagnostics or the next preamble either.
+    if (BuiltPreamble && Store)
+      Store->store(FileName, TFS, LatestBuild);
   });
 
-  if (!LatestBuild || Inputs.ForceRebuild) {
-    vlog("Building first preamble for {0} version {1}", FileName,
-         Inputs.Version);
-  } else if (isPreambleCompatible(*LatestBuild, Inputs, FileName, *Req.CI)) {
+  if (LatestBuild && !Inputs.ForceRebuild &&
+      isPreambleCompatible(*LatestBuild, Inputs, FileName, *Req.CI)) {
     vlog("Reusing preamble version {0} for version {1} of {2}",
          LatestBuild->Version, Inputs.Version, FileName);
     ReusedPreamble = true;
     return;
+  }
+
+  if (!Inputs.ForceRebuild) {
+    // Another file may have the same preamble, or this file may have been
+    // closed and reopened, possibly by an earlier clangd instance.
+    auto Previous =
+        SharedPreambles.find(FileName, Inputs, *Req.CI, LatestBuild.get());
+    if (!Previous && !LatestBuild && Store)
+      Previous = Store->load(FileName, Inputs, *Req.CI, StoreInMemory);
+    if (Previous) {
+      vlog("Using existing preamble version {0} for version {1} of {2}",
+           Previous->Version, Inputs.Version, FileName);
+      LatestBuild = std::move(Previous);
+      LoadedPreamble = true;
+      SharedPreambles.add(FileName, LatestBuild);
+      if (isReliable(LatestBuild->CompileCommand))
+        HeaderIncluders.update(FileName, LatestBuild->Includes.allHeaders());
+      return;
+    }
+  }
+
+  if (!LatestBuild || Inputs.ForceRebuild) {
+    vlog("Building first preamble for {0} version {1}", FileName,
+         Inputs.Version);
   } else {
     vlog("Rebuilding invalidated preamble for {0} version {1} (previous was "
          "version {2})",
@@ -1074,6 +1234,8 @@ void PreambleThread::build(Request Req) {
       &Stats);
   if (!LatestBuild)
     return;
+  BuiltPreamble = true;
+  SharedPreambles.add(FileName, LatestBuild);
   reportPreambleBuild(Stats, IsFirstPreamble);
   if (isReliable(LatestBuild->CompileCommand))
     HeaderIncluders.update(FileName, LatestBuild->Includes.allHeaders());
@@ -1083,17 +1245,21 @@ void ASTWorker::updatePreamble(std::unique_ptr<CompilerInvocation> CI,
                                ParseInputs PI,
                                std::shared_ptr<const PreambleData> Preamble,
                                std::vector<Diag> CIDiags,
-                               WantDiagnostics WantDiags) {
+                               WantDiagnostics WantDiags,
+                               bool PreambleIndexed) {
   llvm::StringLiteral TaskName = "Build AST";
   // Store preamble and build diagnostics with new preamble if requested.
   auto Task = [this, Preamble = std::move(Preamble), CI = std::move(CI),
                PI = std::move(PI), CIDiags = std::move(CIDiags),
-               WantDiags = std::move(WantDiags)]() mutable {
+               WantDiags = std::move(WantDiags), PreambleIndexed]() mutable {
     // Update the preamble inside ASTWorker queue to ensure atomicity. As a task
     // running inside ASTWorker assumes internals won't change until it
     // finishes.
     if (!LatestPreamble || Preamble != *LatestPreamble) {
       ++PreambleBuildCount;
+      UnindexedPreambleCI = PreambleIndexed || !Preamble
+                                ? nullptr
+                                : std::make_unique<CompilerInvocation>(*CI);
       // Cached AST is no longer valid.
       IdleASTs.take(this);
       RanASTCallback = false;
@@ -1218,6 +1384,14 @@ void ASTWorker::generateDiagnostics(
     if (CanPublishResults)
       Publish();
   };
+  if (*AST && UnindexedPreambleCI) {
+    // The preamble wasn't built, so its headers are indexed from the AST.
+    trace::Span Span("Running preamble AST callback");
+    Callbacks.onPreambleAST(FileName, (*AST)->version(), *UnindexedPreambleCI,
+                            (*AST)->getASTContext(), (*AST)->getPreprocessor(),
+                            (*AST)->getCanonicalIncludes());
+    UnindexedPreambleCI.reset();
+  }
   if (*AST) {
     trace::Span Span("Running main AST callback");
     Callbacks.onMainAST(FileName, **AST, RunPublish);
@@ -1277,11 +1451,16 @@ void ASTWorker::stop() {
     std::lock_guard<std::mutex> Lock(PublishMu);
     CanPublishResults = false;
   }
+  std::shared_ptr<const PreambleData> Preamble;
   {
     std::lock_guard<std::mutex> Lock(Mutex);
     assert(!Done && "stop() called twice");
     Done = true;
+    if (LatestPreamble)
+      Preamble = *LatestPreamble;
   }
+  // The file is being closed, keep its preamble in case it gets reopened.
+  SharedPreambles.retain(FileName, std::move(Preamble));
   PreamblePeer.stop();
   // We are no longer going to build any preambles, let the waiters know that.
   PreambleCV.notify_all();
@@ -1606,7 +1785,9 @@ TUScheduler::TUScheduler(const GlobalCompilationDatabase &CDB,
       Barrier(Opts.AsyncThreadsCount), QuickRunBarrier(Opts.AsyncThreadsCount),
       IdleASTs(
           std::make_unique<ASTCache>(Opts.RetentionPolicy.MaxRetainedASTs)),
-      HeaderIncluders(std::make_unique<HeaderIncluderCache>()) {
+      HeaderIncluders(std::make_unique<HeaderIncluderCache>()),
+      SharedPreambles(std::make_unique<PreambleCache>(
+          Opts.RetentionPolicy.MaxRetainedPreambles)) {
   // Avoid null checks everywhere.
   if (!Opts.ContextProvider) {
     this->Opts.ContextProvider = [](llvm::StringRef) {
@@ -1649,6 +1830,7 @@ bool TUScheduler::update(PathRef File, ParseInputs Inputs,
     // Create a new worker to process the AST-related tasks.
     ASTWorkerHandle Worker =
         ASTWorker::create(File, CDB, *IdleASTs, *HeaderIncluders,
+                          *SharedPreambles,
                           WorkerThreads ? WorkerThreads.getPointer() : nullptr,
                           Barrier, Opts, *Callbacks);
     FD = std::unique_ptr<FileData>(
@@ -1839,6 +2021,9 @@ void TUScheduler::profile(MemoryTree &MT) const {
     MT.detail(Elem.first()).child("ast").addUsage(Elem.second.UsedBytesAST);
     MT.child("header_includer_cache").addUsage(HeaderIncluders->getUsedBytes());
   }
+  MT.child("closed_preambles")
+      .addUsage(Opts.StorePreamblesInMemory ? SharedPreambles->getUsedBytes()
+                                            : 0);
 }
 } // namespace clangd
 } // namespace clang
@@ -28,6 +28,7 @@ namespace clang {
 namespace clangd {
 class ParsedAST;
 struct PreambleData;
+class PreambleStore;
 
 /// Returns a number of a default async threads to use for TUScheduler.
 /// Returned value is always >= 1 (i.e. will not cause requests to be processed
@@ -63,6 +64,11 @@ struct ASTRetentionPolicy {
   /// Maximum number of ASTs to be retained in memory when there are no pending
   /// requests for them.
   unsigned MaxRetainedASTs = 3;
+  /// Maximum number of preambles of closed files to be retained. If a file is
+  /// reopened with the same compile command and preamble, or another file
+  /// with the same flags and preamble is opened, it is reused instead of
+  /// rebuilt.
+  unsigned MaxRetainedPreambles = 3;
 };
 
 /// Clangd may wait after an update to see if another one comes along.
@@ -161,6 +167,9 @@ public:
   /// Called on the AST that was built for emitting the preamble. The built AST
   /// contains only AST nodes from the #include directives at the start of the
   /// file. AST node in the current file should be observed on onMainAST call.
+  /// If the preamble was reused without being built, e.g. it was loaded from
+  /// disk, this is called with the first AST of the main file instead. Only
+  /// the AST nodes from included headers should be observed then.
   virtual void onPreambleAST(PathRef Path, llvm::StringRef Version,
                              const CompilerInvocation &CI, ASTContext &Ctx,
                              Preprocessor &PP, const CanonicalIncludes &) {}
@@ -232,6 +241,9 @@ public:
     /// This throttler controls which preambles may be built at a given time.
     clangd::PreambleThrottler *PreambleThrottler = nullptr;
 
+    /// If set, preambles are stored here and reused by later clangd instances.
+    clangd::PreambleStore *PreambleStore = nullptr;
+
     /// Used to create a context that wraps each single operation.
     /// Typically to inject per-file configuration.
     /// If the path is empty, context sholud be "generic".
@@ -345,6 +357,9 @@ public:
   class ASTCache;
   /// Tracks headers included by open files, to get known-good compile commands.
   class HeaderIncluderCache;
+  /// Shares preambles between files with the same flags and preamble, and
+  /// retains those of recently closed files.
+  class PreambleCache;
 
   // The file being built/processed in the current thread. This is a hack in
   // order to get the file name into the index implementations. Do not depend on
@@ -368,6 +383,7 @@ private:
   llvm::StringMap<std::unique_ptr<FileData>> Files;
   std::unique_ptr<ASTCache> IdleASTs;
   std::unique_ptr<HeaderIncluderCache> HeaderIncluders;
+  std::unique_ptr<PreambleCache> SharedPreambles;
   // None when running tasks synchronously and non-None when running tasks
   // asynchronously.
   llvm::Optional<AsyncTaskRunner> PreambleTasks;
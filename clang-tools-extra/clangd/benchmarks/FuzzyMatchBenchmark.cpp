@@ -0,0 +1,89 @@
+//===--- FuzzyMatchBenchmark.cpp - FuzzyMatcher benchmarks ------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "../FuzzyMatch.h"
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringRef.h"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace clangd {
+namespace {
+
+// Generates identifiers in a mix of styles, e.g. "getHTTPResponse",
+// "parse_token_list", "XMLDocument".
+std::vector<std::string> generateIdentifiers(size_t Count) {
+  static const char *Segments[] = {
+      "get",   "set",    "http",    "request", "response", "token",
+      "parse", "list",   "xml",     "document", "node",    "visit",
+      "expr",  "decl",   "stmt",    "type",    "builder",  "factory",
+      "impl",  "buffer", "context", "manager", "id",       "index"};
+  constexpr size_t NumSegments = sizeof(Segments) / sizeof(Segments[0]);
+  std::mt19937 Generator(0);
+  std::uniform_int_distribution<size_t> Segment(0, NumSegments - 1);
+  std::uniform_int_distribution<int> Length(1, 4), Style(0, 2);
+  std::vector<std::string> Result;
+  Result.reserve(Count);
+  for (size_t I = 0; I < Count; ++I) {
+    std::string Name;
+    int Case = Style(Generator);
+    for (int S = 0, N = Length(Generator); S < N; ++S) {
+      std::string Part = Segments[Segment(Generator)];
+      if (Case == 0 && S) // camelCase
+        Part[0] = Part[0] - 'a' + 'A';
+      else if (Case == 1 && S) // snake_case
+        Part.insert(Part.begin(), '_');
+      else if (Case == 2) // SHOUTING
+        for (char &C : Part)
+          C = C - 'a' + 'A';
+      Name += Part;
+    }
+    Result.push_back(std::move(Name));
+  }
+  return Result;
+}
+
+const std::vector<std::string> &identifiers() {
+  static auto *Identifiers =
+      new std::vector<std::string>(generateIdentifiers(100000));
+  return *Identifiers;
+}
+
+const char *Patterns[] = {"g", "ghr", "parsetok", "XMLDoc", "zzq"};
+
+static void scalarMatch(benchmark::State &State) {
+  FuzzyMatcher Matcher(Patterns[State.range(0)]);
+  const auto &Words = identifiers();
+  for (auto _ : State)
+    for (const auto &Word : Words)
+      benchmark::DoNotOptimize(Matcher.match(Word));
+  State.SetItemsProcessed(State.iterations() * Words.size());
+}
+BENCHMARK(scalarMatch)->DenseRange(0, 4);
+
+static void batchMatch(benchmark::State &State) {
+  FuzzyMatcher Matcher(Patterns[State.range(0)]);
+  const auto &Identifiers = identifiers();
+  std::vector<llvm::StringRef> Words(Identifiers.begin(), Identifiers.end());
+  std::vector<llvm::Optional<float>> Scores(Words.size());
+  for (auto _ : State) {
+    Matcher.matchBatch(Words, Scores);
+    benchmark::DoNotOptimize(Scores.data());
+  }
+  State.SetItemsProcessed(State.iterations() * Words.size());
+}
+BENCHMARK(batchMatch)->DenseRange(0, 4);
+
+} // namespace
+} // namespace clangd
+} // namespace clang
+
+BENCHMARK_MAIN();
@@ -8,11 +8,15 @@
 
 #include "../index/Serialization.h"
 #include "../index/dex/Dex.h"
+#include "../index/dex/Iterator.h"
+#include "../index/dex/PostingList.h"
 #include "benchmark/benchmark.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Regex.h"
+#include <limits>
+#include <random>
 #include <string>
 
 const char *IndexFilename;
@@ -97,6 +101,53 @@ static void dexBuild(benchmark::State &State) {
 }
 BENCHMARK(dexBuild);
 
+// Generates a sorted list of Count DocIDs with gaps uniformly distributed in
+// [1, MaxGap].
+std::vector<dex::DocID> generateDocs(size_t Count, dex::DocID MaxGap) {
+  std::mt19937 Generator(42);
+  std::uniform_int_distribution<dex::DocID> Gap(1, MaxGap);
+  std::vector<dex::DocID> Docs(Count);
+  dex::DocID Doc = 0;
+  for (auto &D : Docs)
+    D = Doc += Gap(Generator);
+  return Docs;
+}
+
+// Args: encoding, maximum gap between DocIDs.
+static void postingListIterate(benchmark::State &State) {
+  const dex::PostingList List(
+      generateDocs(1000000, State.range(1)),
+      static_cast<dex::PostingEncoding>(State.range(0)));
+  for (auto _ : State) {
+    auto It = List.iterator();
+    for (; !It->reachedEnd(); It->advance())
+      benchmark::DoNotOptimize(It->peek());
+  }
+  State.counters["bytes"] = List.bytes();
+}
+BENCHMARK(postingListIterate)
+    ->ArgsProduct({{static_cast<int>(dex::PostingEncoding::VByte),
+                    static_cast<int>(dex::PostingEncoding::Packed)},
+                   {4, 1000}});
+
+// Intersects a dense list with a sparse one, which is dominated by advanceTo()
+// calls skipping through the dense list.
+// Args: encoding, maximum gap between DocIDs of the sparse list.
+static void postingListIntersect(benchmark::State &State) {
+  auto Encoding = static_cast<dex::PostingEncoding>(State.range(0));
+  const dex::PostingList Dense(generateDocs(1000000, 4), Encoding);
+  const dex::PostingList Sparse(generateDocs(1000, State.range(1)), Encoding);
+  dex::Corpus C(std::numeric_limits<dex::DocID>::max());
+  for (auto _ : State) {
+    auto And = C.intersect(Dense.iterator(), Sparse.iterator());
+    benchmark::DoNotOptimize(dex::consume(*And));
+  }
+}
+BENCHMARK(postingListIntersect)
+    ->ArgsProduct({{static_cast<int>(dex::PostingEncoding::VByte),
+                    static_cast<int>(dex::PostingEncoding::Packed)},
+                   {100, 2000}});
+
 } // namespace
 } // namespace clangd
 } // namespace clang
@@ -97,6 +97,7 @@ BackgroundIndex::BackgroundIndex(
       IndexedSymbols(IndexContents::All),
       Rebuilder(this, &IndexedSymbols, Opts.ThreadPoolSize),
       IndexStorageFactory(std::move(IndexStorageFactory)),
+      ShardLoadingThreads(Opts.ThreadPoolSize),
       Queue(std::move(Opts.OnProgress)),
       CommandsChanged(
           CDB.watch([&](const std::vector<std::string> &ChangedFiles) {
@@ -173,6 +174,10 @@ BackgroundQueue::Task BackgroundIndex::indexFileTask(std::string Path) {
 }
 
 void BackgroundIndex::boostRelated(llvm::StringRef Path) {
+  {
+    std::lock_guard<std::mutex> Lock(BoostedStemsMu);
+    BoostedStems.insert(filenameWithoutExtension(Path));
+  }
   if (isHeaderFile(Path))
     Queue.boost(filenameWithoutExtension(Path), IndexBoostedFile);
 }
@@ -361,15 +366,48 @@ BackgroundIndex::loadProject(std::vector<std::string> MainFiles) {
       return Config::current().Index.Background ==
              Config::BackgroundPolicy::Skip;
     });
+  // TUs related to files the user has open are loaded (and served) first, so
+  // that their cross-references work without waiting for the whole project.
+  // The stems are only used by one load: they are for the files opened since
+  // the last one.
+  llvm::StringSet<> Boosted;
+  {
+    std::lock_guard<std::mutex> Lock(BoostedStemsMu);
+    std::swap(Boosted, BoostedStems);
+  }
+  auto Rest = std::stable_partition(
+      MainFiles.begin(), MainFiles.end(), [&](const std::string &TU) {
+        return Boosted.contains(filenameWithoutExtension(TU));
+      });
+  std::vector<std::vector<std::string>> Batches;
+  if (Rest != MainFiles.begin()) {
+    vlog("Background-index: loading shards of {0} TUs related to open files",
+         std::distance(MainFiles.begin(), Rest));
+    Batches.emplace_back(MainFiles.begin(), Rest);
+  }
+  Batches.emplace_back(Rest, MainFiles.end());
+
+  // A single loader goes through the batches, so the shards they share, e.g.
+  // of common headers, are only loaded once.
+  llvm::StringSet<> NeedsReIndexing;
+  loadIndexShards(Batches, IndexStorageFactory, CDB, ShardLoadingThreads,
+                  [&](std::vector<LoadedShard> Shards) {
+                    loadShards(std::move(Shards), NeedsReIndexing);
+                  });
+  std::vector<std::string> Result;
+  for (const auto &TU : NeedsReIndexing)
+    Result.push_back(TU.getKey().str());
+  return Result;
+}
+
+void BackgroundIndex::loadShards(std::vector<LoadedShard> Shards,
+                                 llvm::StringSet<> &TUsToIndex) {
   Rebuilder.startLoading();
-  // Load shards for all of the mainfiles.
-  const std::vector<LoadedShard> Result =
-      loadIndexShards(MainFiles, IndexStorageFactory, CDB);
   size_t LoadedShards = 0;
   {
     // Update in-memory state.
     std::lock_guard<std::mutex> Lock(ShardVersionsMu);
-    for (auto &LS : Result) {
+    for (auto &LS : Shards) {
       if (!LS.Shard)
         continue;
       auto SS =
@@ -397,10 +435,9 @@ BackgroundIndex::loadProject(std::vector<std::string> MainFiles) {
   Rebuilder.doneLoading();
 
   auto FS = TFS.view(/*CWD=*/llvm::None);
-  llvm::DenseSet<PathRef> TUsToIndex;
   // We'll accept data from stale shards, but ensure the files get reindexed
   // soon.
-  for (auto &LS : Result) {
+  for (auto &LS : Shards) {
     if (!shardIsStale(LS, FS.get()))
       continue;
     PathRef TUForFile = LS.DependentTU;
@@ -413,14 +450,12 @@ BackgroundIndex::loadProject(std::vector<std::string> MainFiles) {
     // for this TU, i.e TU was deleted after we performed indexing.
     TUsToIndex.insert(TUForFile);
   }
-
-  return {TUsToIndex.begin(), TUsToIndex.end()};
 }
 
 void BackgroundIndex::profile(MemoryTree &MT) const {
   IndexedSymbols.profile(MT.child("slabs"));
   // We don't want to mix memory used by index and symbols, so call base class.
-  MT.child("index").addUsage(SwapIndex::estimateMemoryUsage());
+  SwapIndex::profile(MT.child("index"));
 }
 } // namespace clangd
 } // namespace clang
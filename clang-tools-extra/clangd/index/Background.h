@@ -22,6 +22,7 @@
 #include "support/ThreadsafeFS.h"
 #include "clang/Tooling/CompilationDatabase.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Threading.h"
 #include <atomic>
 #include <condition_variable>
@@ -35,6 +36,8 @@
 namespace clang {
 namespace clangd {
 
+struct LoadedShard;
+
 // Handles storage and retrieval of index shards. Both store and load
 // operations can be called from multiple-threads concurrently.
 class BackgroundIndexStorage {
@@ -162,6 +165,7 @@ public:
 
   /// Boosts priority of indexing related to Path.
   /// Typically used to index TUs when headers are opened.
+  /// Stored shards of related TUs are also loaded before the rest.
   void boostRelated(llvm::StringRef Path);
 
   // Cause background threads to stop after ther current task, any remaining
@@ -177,7 +181,7 @@ public:
     return Queue.blockUntilIdleForTest(TimeoutSeconds);
   }
 
-  void profile(MemoryTree &MT) const;
+  void profile(MemoryTree &MT) const override;
 
 private:
   /// Represents the state of a single file when indexing was performed.
@@ -207,8 +211,19 @@ private:
   std::mutex ShardVersionsMu;
 
   BackgroundIndexStorage::Factory IndexStorageFactory;
+  // Number of threads used to load shards.
+  const size_t ShardLoadingThreads;
   // Tries to load shards for the MainFiles and their dependencies.
   std::vector<std::string> loadProject(std::vector<std::string> MainFiles);
+  // Publishes a batch of loaded shards, see loadProject(). Adds the TUs that
+  // need to be indexed again to \p TUsToIndex.
+  void loadShards(std::vector<LoadedShard> Shards,
+                  llvm::StringSet<> &TUsToIndex);
+
+  // Filenames (without extension) of files passed to boostRelated() since the
+  // last loadProject().
+  llvm::StringSet<> BoostedStems;
+  std::mutex BoostedStemsMu;
 
   BackgroundQueue::Task
   changedFilesTask(const std::vector<std::string> &ChangedFiles);
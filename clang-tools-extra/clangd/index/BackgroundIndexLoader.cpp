@@ -11,8 +11,11 @@
 #include "index/Background.h"
 #include "support/Logger.h"
 #include "support/Path.h"
+#include "support/Threading.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <utility>
 #include <vector>
@@ -23,45 +26,40 @@ namespace {
 
 /// A helper class to cache BackgroundIndexStorage operations and keep the
 /// inverse dependency mapping.
+///
+/// The include graph is walked breadth-first, one level at a time, and the
+/// shards of each level are read and decoded in parallel.
 class BackgroundIndexLoader {
 public:
-  BackgroundIndexLoader(BackgroundIndexStorage::Factory &IndexStorageFactory)
-      : IndexStorageFactory(IndexStorageFactory) {}
-  /// Load the shards for \p MainFile and all of its dependencies.
-  void load(PathRef MainFile);
-
-  /// Consumes the loader and returns all shards.
-  std::vector<LoadedShard> takeResult() &&;
+  BackgroundIndexLoader(BackgroundIndexStorage::Factory &IndexStorageFactory,
+                        unsigned Concurrency)
+      : IndexStorageFactory(IndexStorageFactory),
+        Concurrency(std::max(Concurrency, 1u)) {}
+  /// Loads the shards for \p MainFiles and all of their dependencies, and
+  /// returns them. Shards returned by earlier calls aren't loaded again.
+  std::vector<LoadedShard> load(llvm::ArrayRef<Path> MainFiles);
 
 private:
-  /// Returns the Shard for \p StartSourceFile from cache or loads it from \p
-  /// Storage. Also returns paths for dependencies of \p StartSourceFile if it
-  /// wasn't cached yet.
-  std::pair<const LoadedShard &, std::vector<Path>>
-  loadShard(PathRef StartSourceFile, PathRef DependentTU);
+  /// Loads the shard for \p LS.AbsolutePath from storage, and returns paths for
+  /// its dependencies. Only touches \p LS, so it can run concurrently.
+  std::vector<Path> loadShard(LoadedShard &LS);
 
-  /// Cache for Storage lookups.
+  /// Cache for Storage lookups. The shards are moved out once returned, the
+  /// keys remain.
   llvm::StringMap<LoadedShard> LoadedShards;
 
   BackgroundIndexStorage::Factory &IndexStorageFactory;
+  const unsigned Concurrency;
 };
 
-std::pair<const LoadedShard &, std::vector<Path>>
-BackgroundIndexLoader::loadShard(PathRef StartSourceFile, PathRef DependentTU) {
-  auto It = LoadedShards.try_emplace(StartSourceFile);
-  LoadedShard &LS = It.first->getValue();
+std::vector<Path> BackgroundIndexLoader::loadShard(LoadedShard &LS) {
+  PathRef StartSourceFile = LS.AbsolutePath;
   std::vector<Path> Edges = {};
-  // Return the cached shard.
-  if (!It.second)
-    return {LS, Edges};
-
-  LS.AbsolutePath = StartSourceFile.str();
-  LS.DependentTU = std::string(DependentTU);
   BackgroundIndexStorage *Storage = IndexStorageFactory(LS.AbsolutePath);
   auto Shard = Storage->loadShard(StartSourceFile);
   if (!Shard || !Shard->Sources) {
     vlog("Failed to load shard: {0}", StartSourceFile);
-    return {LS, Edges};
+    return Edges;
   }
 
   LS.Shard = std::move(Shard);
@@ -84,34 +82,56 @@ BackgroundIndexLoader::loadShard(PathRef StartSourceFile, PathRef DependentTU) {
     LS.HadErrors = IGN.Flags & IncludeGraphNode::SourceFlag::HadErrors;
   }
   assert(LS.Digest != FileDigest{{0}} && "Digest is empty?");
-  return {LS, Edges};
+  return Edges;
 }
 
-void BackgroundIndexLoader::load(PathRef MainFile) {
-  llvm::StringSet<> InQueue;
-  // Following containers points to strings inside InQueue.
-  std::queue<PathRef> ToVisit;
-  InQueue.insert(MainFile);
-  ToVisit.push(MainFile);
+std::vector<LoadedShard>
+BackgroundIndexLoader::load(llvm::ArrayRef<Path> MainFiles) {
+  // Shards to be loaded at the current level, and all shards loaded by this
+  // call. Point into LoadedShards, whose entries have stable addresses.
+  std::vector<LoadedShard *> ToVisit, Visited;
+  auto Enqueue = [&](PathRef SourceFile, PathRef DependentTU) {
+    auto It = LoadedShards.try_emplace(SourceFile);
+    if (!It.second) // Already loaded or queued.
+      return;
+    LoadedShard &LS = It.first->getValue();
+    LS.AbsolutePath = SourceFile.str();
+    LS.DependentTU = DependentTU.str();
+    ToVisit.push_back(&LS);
+  };
+  for (PathRef MainFile : MainFiles) {
+    assert(llvm::sys::path::is_absolute(MainFile));
+    Enqueue(MainFile, MainFile);
+  }
 
   while (!ToVisit.empty()) {
-    PathRef SourceFile = ToVisit.front();
-    ToVisit.pop();
-
-    auto ShardAndEdges = loadShard(SourceFile, MainFile);
-    for (PathRef Edge : ShardAndEdges.second) {
-      auto It = InQueue.insert(Edge);
-      if (It.second)
-        ToVisit.push(It.first->getKey());
-    }
+    std::vector<LoadedShard *> Level = std::move(ToVisit);
+    ToVisit.clear();
+    Visited.insert(Visited.end(), Level.begin(), Level.end());
+    std::vector<std::vector<Path>> Edges(Level.size());
+    {
+      std::atomic<size_t> Next = {0};
+      Context Ctx = Context::current().clone();
+      auto Work = [&] {
+        WithContext WithCtx(Ctx.clone());
+        for (size_t I = Next++; I < Level.size(); I = Next++)
+          Edges[I] = loadShard(*Level[I]);
+      };
+      AsyncTaskRunner Tasks;
+      for (unsigned T = 1; T < std::min<size_t>(Concurrency, Level.size());
+           ++T)
+        Tasks.runAsync("shard-loader-" + llvm::Twine(T), Work);
+      Work();
+    } // Tasks waits for all workers.
+    for (size_t I = 0; I < Level.size(); ++I)
+      for (PathRef Edge : Edges[I])
+        Enqueue(Edge, Level[I]->DependentTU);
   }
-}
 
-std::vector<LoadedShard> BackgroundIndexLoader::takeResult() && {
   std::vector<LoadedShard> Result;
-  Result.reserve(LoadedShards.size());
-  for (auto &It : LoadedShards)
-    Result.push_back(std::move(It.getValue()));
+  Result.reserve(Visited.size());
+  for (LoadedShard *LS : Visited)
+    Result.push_back(std::move(*LS));
   return Result;
 }
 } // namespace
@@ -119,13 +139,19 @@ std::vector<LoadedShard> BackgroundIndexLoader::takeResult() && {
 std::vector<LoadedShard>
 loadIndexShards(llvm::ArrayRef<Path> MainFiles,
                 BackgroundIndexStorage::Factory &IndexStorageFactory,
-                const GlobalCompilationDatabase &CDB) {
-  BackgroundIndexLoader Loader(IndexStorageFactory);
-  for (llvm::StringRef MainFile : MainFiles) {
-    assert(llvm::sys::path::is_absolute(MainFile));
-    Loader.load(MainFile);
-  }
-  return std::move(Loader).takeResult();
+                const GlobalCompilationDatabase &CDB, unsigned Concurrency) {
+  BackgroundIndexLoader Loader(IndexStorageFactory, Concurrency);
+  return Loader.load(MainFiles);
+}
+
+void loadIndexShards(
+    llvm::ArrayRef<std::vector<Path>> Batches,
+    BackgroundIndexStorage::Factory &IndexStorageFactory,
+    const GlobalCompilationDatabase &CDB, unsigned Concurrency,
+    llvm::function_ref<void(std::vector<LoadedShard>)> OnBatch) {
+  BackgroundIndexLoader Loader(IndexStorageFactory, Concurrency);
+  for (const std::vector<Path> &MainFiles : Batches)
+    OnBatch(Loader.load(MainFiles));
 }
 
 } // namespace clangd
@@ -12,6 +12,7 @@
 #include "index/Background.h"
 #include "support/Path.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
 #include <memory>
 #include <vector>
 
@@ -37,11 +38,23 @@ struct LoadedShard {
   std::unique_ptr<IndexFileIn> Shard;
 };
 
-/// Loads all shards for the TU \p MainFile from \p Storage.
+/// Loads all shards for the TUs \p MainFiles from \p Storage.
+/// Shards are read and decoded on up to \p Concurrency threads, the storage
+/// must support concurrent loadShard() calls.
 std::vector<LoadedShard>
 loadIndexShards(llvm::ArrayRef<Path> MainFiles,
                 BackgroundIndexStorage::Factory &IndexStorageFactory,
-                const GlobalCompilationDatabase &CDB);
+                const GlobalCompilationDatabase &CDB, unsigned Concurrency = 1);
+
+/// Loads all shards for the TUs of each of \p Batches in turn, and passes the
+/// shards of each batch to \p OnBatch before loading the next one. A shard
+/// shared with an earlier batch, e.g. that of a common header, is only loaded
+/// and passed once.
+void loadIndexShards(
+    llvm::ArrayRef<std::vector<Path>> Batches,
+    BackgroundIndexStorage::Factory &IndexStorageFactory,
+    const GlobalCompilationDatabase &CDB, unsigned Concurrency,
+    llvm::function_ref<void(std::vector<LoadedShard>)> OnBatch);
 
 } // namespace clangd
 } // namespace clang
@@ -8,8 +8,11 @@
 
 #include "index/BackgroundRebuild.h"
 #include "index/FileIndex.h"
+#include "index/Merge.h"
 #include "support/Logger.h"
+#include "support/MemoryTree.h"
 #include "support/Trace.h"
+#include "llvm/ADT/DenseSet.h"
 
 #include <atomic>
 #include <chrono>
@@ -24,6 +27,86 @@
 
 namespace clang {
 namespace clangd {
+namespace {
+
+// Serves a full build of the index, with an incremental build of the files
+// updated since then layered on top (if any).
+// The incremental build has the up to date version of the symbols listed in
+// Replaced (see FileSymbols::buildDeltaIndex), so the full build's are hidden.
+// Refs and relations are merged as by MergedIndex: relations of the updated
+// files may be stale until the next full build.
+class LayeredIndex : public SymbolIndex {
+public:
+  LayeredIndex(std::shared_ptr<SymbolIndex> Full,
+               std::unique_ptr<SymbolIndex> Updated,
+               llvm::DenseSet<SymbolID> Replaced)
+      : Full(std::move(Full)), Updated(std::move(Updated)),
+        Replaced(std::move(Replaced)),
+        Merged(this->Updated.get(), this->Full.get()) {}
+
+  bool fuzzyFind(const FuzzyFindRequest &Req,
+                 llvm::function_ref<void(const Symbol &)> CB) const override {
+    if (!Updated)
+      return Full->fuzzyFind(Req, CB);
+    bool More = Updated->fuzzyFind(Req, CB);
+    More |= Full->fuzzyFind(Req, [&](const Symbol &S) {
+      if (!Replaced.count(S.ID))
+        CB(S);
+    });
+    return More;
+  }
+  void lookup(const LookupRequest &Req,
+              llvm::function_ref<void(const Symbol &)> CB) const override {
+    if (!Updated)
+      return Full->lookup(Req, CB);
+    Updated->lookup(Req, CB);
+    Full->lookup(Req, [&](const Symbol &S) {
+      if (!Replaced.count(S.ID))
+        CB(S);
+    });
+  }
+  bool refs(const RefsRequest &Req,
+            llvm::function_ref<void(const Ref &)> CB) const override {
+    return serving().refs(Req, CB);
+  }
+  void relations(const RelationsRequest &Req,
+                 llvm::function_ref<void(const SymbolID &, const Symbol &)> CB)
+      const override {
+    serving().relations(Req, CB);
+  }
+  llvm::unique_function<IndexContents(llvm::StringRef) const>
+  indexedFiles() const override {
+    return serving().indexedFiles();
+  }
+  size_t estimateMemoryUsage() const override {
+    if (!Updated)
+      return Full->estimateMemoryUsage();
+    return Full->estimateMemoryUsage() + Updated->estimateMemoryUsage() +
+           Replaced.getMemorySize();
+  }
+  void profile(MemoryTree &MT) const override {
+    Full->profile(MT.child("full"));
+    if (Updated) {
+      MemoryTree &Child = MT.child("updated");
+      Updated->profile(Child);
+      Child.child("replaced").addUsage(Replaced.getMemorySize());
+    }
+  }
+
+private:
+  const SymbolIndex &serving() const {
+    if (Updated)
+      return Merged;
+    return *Full;
+  }
+
+  std::shared_ptr<SymbolIndex> Full;
+  std::unique_ptr<SymbolIndex> Updated;
+  llvm::DenseSet<SymbolID> Replaced;
+  MergedIndex Merged;
+};
+
+} // namespace
 
 bool BackgroundIndexRebuilder::enoughTUsToRebuild() const {
   if (!ActiveVersion)                         // never built
@@ -70,7 +153,7 @@ void BackgroundIndexRebuilder::doneLoading() {
       return false; // rebuild once the last batch is done.
     // Rebuild if we loaded any shards, or if we stopped an indexedTU rebuild.
     return LoadedShards > 0 || enoughTUsToRebuild();
-  });
+  }, /*Full=*/true);
 }
 
 void BackgroundIndexRebuilder::shutdown() {
@@ -78,8 +161,33 @@ void BackgroundIndexRebuilder::shutdown() {
   ShouldStop = true;
 }
 
+std::unique_ptr<SymbolIndex> BackgroundIndexRebuilder::build(bool Full) {
+  std::lock_guard<std::mutex> Lock(BuildMu);
+  if (!LastFullBuild)
+    Full = true;
+  size_t Updated = Source->updatedKeys();
+  if (!Full)
+    Full = Updated * 100 > Source->keys() * MaxUpdatedPercent;
+  if (Full) {
+    LastFullBuild =
+        Source->buildIndex(IndexType::Heavy, DuplicateHandling::Merge);
+    return std::make_unique<LayeredIndex>(LastFullBuild, nullptr,
+                                          llvm::DenseSet<SymbolID>());
+  }
+  if (Updated == 0)
+    return std::make_unique<LayeredIndex>(LastFullBuild, nullptr,
+                                          llvm::DenseSet<SymbolID>());
+  vlog("BackgroundIndex: indexing {0} updated files incrementally", Updated);
+  llvm::DenseSet<SymbolID> Replaced;
+  auto Delta = Source->buildDeltaIndex(IndexType::Heavy,
+                                       DuplicateHandling::Merge, Replaced);
+  return std::make_unique<LayeredIndex>(LastFullBuild, std::move(Delta),
+                                        std::move(Replaced));
+}
+
 void BackgroundIndexRebuilder::maybeRebuild(const char *Reason,
-                                            std::function<bool()> Check) {
+                                            std::function<bool()> Check,
+                                            bool Full) {
   unsigned BuildVersion = 0;
   {
     std::lock_guard<std::mutex> Lock(Mu);
@@ -94,7 +202,7 @@ void BackgroundIndexRebuilder::maybeRebuild(const char *Reason,
       vlog("BackgroundIndex: building version {0} {1}", BuildVersion, Reason);
       trace::Span Tracer("RebuildBackgroundIndex");
       SPAN_ATTACH(Tracer, "reason", Reason);
-      NewIndex = Source->buildIndex(IndexType::Heavy, DuplicateHandling::Merge);
+      NewIndex = build(Full);
     }
     {
       std::lock_guard<std::mutex> Lock(Mu);
@@ -17,6 +17,8 @@
 #include "index/FileIndex.h"
 #include "index/Index.h"
 #include <cstddef>
+#include <memory>
+#include <mutex>
 
 namespace clang {
 namespace clangd {
@@ -39,6 +41,12 @@ namespace clangd {
 //
 // The index is rebuilt every time the queue goes idle, if it's stale.
 //
+// Rebuilds after indexing are incremental: only the files updated since the
+// last full build, and the symbols they contribute to, are indexed and layered
+// over that build. Once the updated files make up more than MaxUpdatedPercent
+// of all files, the index is fully rebuilt (compacted) instead. Loading shards
+// from disk always triggers a full build.
+//
 // All methods are threadsafe. They're called after FileSymbols is updated
 // etc. Without external locking, the rebuilt index may include more updates
 // than intended, which is fine.
@@ -72,11 +80,16 @@ public:
   // Thresholds for rebuilding as TUs get indexed. Exposed for testing.
   const unsigned TUsBeforeFirstBuild; // Typically one per worker thread.
   const unsigned TUsBeforeRebuild = 100;
+  // Threshold for compacting incremental updates. Exposed for testing.
+  unsigned MaxUpdatedPercent = 10;
 
 private:
   // Run Check under the lock, and rebuild if it returns true.
-  void maybeRebuild(const char *Reason, std::function<bool()> Check);
+  // Unless Full is set, the rebuild may be incremental.
+  void maybeRebuild(const char *Reason, std::function<bool()> Check,
+                    bool Full = false);
   bool enoughTUsToRebuild() const;
+  std::unique_ptr<SymbolIndex> build(bool Full);
 
   // All transient state is guarded by the mutex.
   std::mutex Mu;
@@ -91,6 +104,11 @@ private:
   unsigned Loading = 0;
   unsigned LoadedShards; // In the current loading session.
 
+  // Builds are serialized, so that each incremental build is layered over the
+  // full build preceding it.
+  std::mutex BuildMu;
+  std::shared_ptr<SymbolIndex> LastFullBuild; // Guarded by BuildMu.
+
   SwapIndex *Target;
   FileSymbols *Source;
 };
@@ -0,0 +1,174 @@
+//===--- BinaryIO.h - Primitives of clangd's binary formats ------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The binary formats clangd writes (index files, stored preambles) are built
+// from little-endian 32 bit ints, sometimes with variable-length encoding.
+//
+// Variable-length int encoding (varint) uses the bottom 7 bits of each byte
+// to encode the number, and the top bit to indicate whether more bytes follow.
+// e.g. 9a 2f means [0x1a and keep reading, 0x2f and stop].
+// This represents 0x1a | 0x2f<<7 = 6042.
+// A 32-bit integer takes 1-5 bytes to encode; small numbers are more compact.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_BINARYIO_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_BINARYIO_H
+
+#include "index/SymbolID.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace clang {
+namespace clangd {
+
+// Reads binary data from a StringRef, and keeps track of position.
+class BinaryReader {
+  const char *Begin, *End;
+  bool Err = false;
+
+public:
+  BinaryReader(llvm::StringRef Data) : Begin(Data.begin()), End(Data.end()) {}
+  // The "error" bit is set by reading past EOF or reading invalid data.
+  // When in an error state, reads may return zero values: callers should check.
+  bool err() const { return Err; }
+  // Sets the "error" bit, for data that was read but turned out invalid.
+  void markError() { Err = true; }
+  // Did we read all the data, or encounter an error?
+  bool eof() const { return Begin == End || Err; }
+  // All the data we didn't read yet.
+  llvm::StringRef rest() const { return llvm::StringRef(Begin, End - Begin); }
+
+  uint8_t consume8() {
+    if (LLVM_UNLIKELY(Begin == End)) {
+      Err = true;
+      return 0;
+    }
+    return *Begin++;
+  }
+
+  uint32_t consume32() {
+    if (LLVM_UNLIKELY(Begin + 4 > End)) {
+      Err = true;
+      return 0;
+    }
+    auto Ret = llvm::support::endian::read32le(Begin);
+    Begin += 4;
+    return Ret;
+  }
+
+  llvm::StringRef consume(size_t N) {
+    if (LLVM_UNLIKELY(N > size_t(End - Begin))) {
+      Err = true;
+      return llvm::StringRef();
+    }
+    llvm::StringRef Ret(Begin, N);
+    Begin += N;
+    return Ret;
+  }
+
+  uint32_t consumeVar() {
+    constexpr static uint8_t More = 1 << 7;
+
+    // Use a 32 bit unsigned here to prevent promotion to signed int (unless int
+    // is wider than 32 bits).
+    uint32_t B = consume8();
+    if (LLVM_LIKELY(!(B & More)))
+      return B;
+    uint32_t Val = B & ~More;
+    for (int Shift = 7; B & More && Shift < 32; Shift += 7) {
+      B = consume8();
+      // 5th byte of a varint can only have lowest 4 bits set.
+      assert((Shift != 28 || B == (B & 0x0f)) && "Invalid varint encoding");
+      Val |= (B & ~More) << Shift;
+    }
+    return Val;
+  }
+
+  // Reads a string stored inline, prefixed with its size (see writeString).
+  llvm::StringRef consumeString() { return consume(consumeVar()); }
+
+  // Reads a string stored as its index into a string table.
+  llvm::StringRef consumeString(llvm::ArrayRef<llvm::StringRef> Strings) {
+    auto StringIndex = consumeVar();
+    if (LLVM_UNLIKELY(StringIndex >= Strings.size())) {
+      Err = true;
+      return llvm::StringRef();
+    }
+    return Strings[StringIndex];
+  }
+
+  SymbolID consumeID() {
+    llvm::StringRef Raw = consume(SymbolID::RawSize); // short if truncated.
+    return LLVM_UNLIKELY(err()) ? SymbolID() : SymbolID::fromRaw(Raw);
+  }
+
+  // Reads a count of elements that are at least one byte each.
+  // If it can't be right, marks an error and returns zero.
+  uint32_t consumeSize() {
+    uint32_t Size = consumeVar();
+    if (Size > size_t(End - Begin)) {
+      Err = true;
+      return 0;
+    }
+    return Size;
+  }
+
+  // Read a varint (as consumeVar) and resize the container accordingly.
+  // If the size is invalid, return false and mark an error.
+  // (The caller should abort in this case).
+  template <typename T> LLVM_NODISCARD bool consumeSize(T &Container) {
+    auto Size = consumeVar();
+    // Conservatively assume each element is at least one byte.
+    if (Size > (size_t)(End - Begin)) {
+      Err = true;
+      return false;
+    }
+    Container.resize(Size);
+    return true;
+  }
+};
+
+inline void write32(uint32_t I, llvm::raw_ostream &OS) {
+  char Buf[4];
+  llvm::support::endian::write32le(Buf, I);
+  OS.write(Buf, sizeof(Buf));
+}
+
+inline void writeVar(uint32_t I, llvm::raw_ostream &OS) {
+  constexpr static uint8_t More = 1 << 7;
+  if (LLVM_LIKELY(I < 1 << 7)) {
+    OS.write(I);
+    return;
+  }
+  for (;;) {
+    OS.write(I | More);
+    I >>= 7;
+    if (I < 1 << 7) {
+      OS.write(I);
+      return;
+    }
+  }
+}
+
+// Writes a string inline, prefixed with its size.
+inline void writeString(llvm::StringRef S, llvm::raw_ostream &OS) {
+  writeVar(S.size(), OS);
+  OS << S;
+}
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_BINARYIO_H
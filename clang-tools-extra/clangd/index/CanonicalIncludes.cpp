@@ -671,7 +671,20 @@ const std::pair<llvm::StringRef, llvm::StringRef> IncludeMappings[] = {
 
 void CanonicalIncludes::addMapping(FileEntryRef Header,
                                    llvm::StringRef CanonicalPath) {
-  FullPathMapping[Header.getUniqueID()] = std::string(CanonicalPath);
+  addMapping(Header.getUniqueID(), CanonicalPath);
+}
+
+void CanonicalIncludes::addMapping(llvm::sys::fs::UniqueID UID,
+                                   llvm::StringRef CanonicalPath) {
+  FullPathMapping[UID] = std::string(CanonicalPath);
+}
+
+llvm::StringRef
+CanonicalIncludes::mappingFor(llvm::sys::fs::UniqueID UID) const {
+  auto MapIt = FullPathMapping.find(UID);
+  if (MapIt != FullPathMapping.end())
+    return MapIt->second;
+  return "";
 }
 
 /// The maximum number of path components in a key from StdSuffixHeaderMapping.
@@ -679,9 +692,9 @@ void CanonicalIncludes::addMapping(FileEntryRef Header,
 constexpr int MaxSuffixComponents = 3;
 
 llvm::StringRef CanonicalIncludes::mapHeader(FileEntryRef Header) const {
-  auto MapIt = FullPathMapping.find(Header.getUniqueID());
-  if (MapIt != FullPathMapping.end())
-    return MapIt->second;
+  llvm::StringRef Mapped = mappingFor(Header.getUniqueID());
+  if (!Mapped.empty())
+    return Mapped;
 
   if (!StdSuffixHeaderMapping)
     return "";
@@ -42,9 +42,16 @@ public:
   /// Returns the overridden include for symbol with \p QualifiedName, or "".
   llvm::StringRef mapSymbol(llvm::StringRef QualifiedName) const;
 
+  /// Adds a file-to-string mapping for the file with \p UID.
+  void addMapping(llvm::sys::fs::UniqueID UID, llvm::StringRef CanonicalPath);
+
   /// Returns the overridden include for for files in \p Header, or "".
   llvm::StringRef mapHeader(FileEntryRef Header) const;
 
+  /// Returns the include added by addMapping() for the file with \p UID, or "".
+  /// Unlike mapHeader(), system header mappings are not considered.
+  llvm::StringRef mappingFor(llvm::sys::fs::UniqueID UID) const;
+
   /// Adds mapping for system headers and some special symbols (e.g. STL symbols
   /// in <iosfwd> need to be mapped individually). Approximately, the following
   /// system headers are handled:
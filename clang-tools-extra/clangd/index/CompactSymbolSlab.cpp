@@ -0,0 +1,130 @@
+//===--- CompactSymbolSlab.cpp -----------------------------------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "index/CompactSymbolSlab.h"
+#include "llvm/ADT/StringMap.h"
+#include <cassert>
+#include <limits>
+
+namespace clang {
+namespace clangd {
+
+CompactSymbolSlab::CompactSymbolSlab(llvm::ArrayRef<const Symbol *> Symbols) {
+  llvm::StringMap<StringIndex> Interned;
+  StringData.push_back('\0');
+  StringOffsets = {0, 1};
+  auto Intern = [&](llvm::StringRef S) -> StringIndex {
+    if (S.empty())
+      return 0;
+    auto R = Interned.try_emplace(S, StringOffsets.size() - 1);
+    if (R.second) {
+      StringData.insert(StringData.end(), S.begin(), S.end());
+      StringData.push_back('\0');
+      assert(StringData.size() <= std::numeric_limits<uint32_t>::max() &&
+             "String table too large");
+      StringOffsets.push_back(StringData.size());
+    }
+    return R.first->second;
+  };
+  auto Loc = [&](const SymbolLocation &L) {
+    Location Result;
+    Result.FileURI = Intern(L.FileURI);
+    Result.Start = L.Start;
+    Result.End = L.End;
+    return Result;
+  };
+
+  IDs.reserve(Symbols.size());
+  Names.reserve(Symbols.size());
+  Scopes.reserve(Symbols.size());
+  Flags.reserve(Symbols.size());
+  Cold.reserve(Symbols.size());
+  for (const Symbol *S : Symbols) {
+    IDs.push_back(S->ID);
+    Names.push_back(Intern(S->Name));
+    Scopes.push_back(Intern(S->Scope));
+    Flags.push_back(S->Flags);
+
+    ColdFields C;
+    C.SymInfo = S->SymInfo;
+    C.Origin = S->Origin;
+    C.References = S->References;
+    C.Definition = Loc(S->Definition);
+    C.CanonicalDeclaration = Loc(S->CanonicalDeclaration);
+    C.Signature = Intern(S->Signature);
+    C.TemplateSpecializationArgs = Intern(S->TemplateSpecializationArgs);
+    C.CompletionSnippetSuffix = Intern(S->CompletionSnippetSuffix);
+    C.Documentation = Intern(S->Documentation);
+    C.ReturnType = Intern(S->ReturnType);
+    C.Type = Intern(S->Type);
+    C.FirstInclude = Includes.size();
+    C.NumIncludes = S->IncludeHeaders.size();
+    for (const auto &Include : S->IncludeHeaders)
+      Includes.push_back({Intern(Include.IncludeHeader), Include.References});
+    Cold.push_back(C);
+  }
+  // The interning map is discarded, don't keep its slack around either.
+  StringData.shrink_to_fit();
+  StringOffsets.shrink_to_fit();
+  Includes.shrink_to_fit();
+}
+
+Symbol CompactSymbolSlab::get(size_t Row) const {
+  const ColdFields &C = Cold[Row];
+  auto Loc = [&](const Location &L) {
+    SymbolLocation Result;
+    Result.FileURI = cString(L.FileURI);
+    Result.Start = L.Start;
+    Result.End = L.End;
+    return Result;
+  };
+
+  Symbol S;
+  S.ID = IDs[Row];
+  S.SymInfo = C.SymInfo;
+  S.Name = name(Row);
+  S.Scope = scope(Row);
+  S.Definition = Loc(C.Definition);
+  S.CanonicalDeclaration = Loc(C.CanonicalDeclaration);
+  S.References = C.References;
+  S.Origin = C.Origin;
+  S.Signature = string(C.Signature);
+  S.TemplateSpecializationArgs = string(C.TemplateSpecializationArgs);
+  S.CompletionSnippetSuffix = string(C.CompletionSnippetSuffix);
+  S.Documentation = string(C.Documentation);
+  S.ReturnType = string(C.ReturnType);
+  S.Type = string(C.Type);
+  for (const IncludeHeader &Include : llvm::makeArrayRef(Includes).slice(
+           C.FirstInclude, C.NumIncludes))
+    S.IncludeHeaders.emplace_back(string(Include.Header), Include.References);
+  S.Flags = Flags[Row];
+  return S;
+}
+
+template <typename T> static size_t vectorBytes(const std::vector<T> &V) {
+  return V.capacity() * sizeof(T);
+}
+
+size_t CompactSymbolSlab::bytes() const {
+  return sizeof(*this) + vectorBytes(IDs) + vectorBytes(Names) +
+         vectorBytes(Scopes) + vectorBytes(Flags) + vectorBytes(Cold) +
+         vectorBytes(Includes) + vectorBytes(StringData) +
+         vectorBytes(StringOffsets);
+}
+
+void CompactSymbolSlab::profile(MemoryTree &MT) const {
+  MT.child("ids").addUsage(vectorBytes(IDs));
+  MT.child("names").addUsage(vectorBytes(Names) + vectorBytes(Scopes));
+  MT.child("flags").addUsage(vectorBytes(Flags));
+  MT.child("cold").addUsage(vectorBytes(Cold) + vectorBytes(Includes));
+  MT.child("strings").addUsage(vectorBytes(StringData) +
+                               vectorBytes(StringOffsets));
+}
+
+} // namespace clangd
+} // namespace clang
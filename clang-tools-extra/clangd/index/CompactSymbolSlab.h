@@ -0,0 +1,115 @@
+//===--- CompactSymbolSlab.h - Columnar symbol storage -----------*- C++-*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// A read-only, memory-efficient alternative to SymbolSlab for large indexes.
+//
+// Symbol is a wide struct: most of its fields are StringRefs (16 bytes each),
+// and it carries a SmallVector of include headers. For an index with millions
+// of symbols most of that is padding and duplicated strings.
+//
+// CompactSymbolSlab stores symbols in columns instead. Fields needed to filter
+// and rank query results (ID, name, scope, flags) are kept in separate arrays,
+// the rest in a cold record per symbol. All strings are interned in a single
+// table and referenced by 32-bit indices.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_COMPACTSYMBOLSLAB_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_COMPACTSYMBOLSLAB_H
+
+#include "index/Symbol.h"
+#include "support/MemoryTree.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
+#include <vector>
+
+namespace clang {
+namespace clangd {
+
+class CompactSymbolSlab {
+public:
+  CompactSymbolSlab() = default;
+  /// Copies \p Symbols, which need not outlive the slab.
+  /// Rows are numbered in the order of \p Symbols.
+  explicit CompactSymbolSlab(llvm::ArrayRef<const Symbol *> Symbols);
+
+  size_t size() const { return IDs.size(); }
+  bool empty() const { return IDs.empty(); }
+
+  /// Hot fields can be read without materializing the symbol.
+  const SymbolID &id(size_t Row) const { return IDs[Row]; }
+  llvm::StringRef name(size_t Row) const { return string(Names[Row]); }
+  llvm::StringRef scope(size_t Row) const { return string(Scopes[Row]); }
+  Symbol::SymbolFlag flags(size_t Row) const { return Flags[Row]; }
+
+  /// Reconstructs the symbol at \p Row. Strings point into the slab.
+  Symbol get(size_t Row) const;
+
+  // Estimates the total memory usage.
+  size_t bytes() const;
+  void profile(MemoryTree &MT) const;
+
+private:
+  using StringIndex = uint32_t;
+
+  struct Location {
+    StringIndex FileURI = 0;
+    SymbolLocation::Position Start, End;
+  };
+
+  // Fields that are only needed once a symbol is returned to the caller.
+  struct ColdFields {
+    index::SymbolInfo SymInfo;
+    SymbolOrigin Origin;
+    unsigned References;
+    Location Definition;
+    Location CanonicalDeclaration;
+    StringIndex Signature;
+    StringIndex TemplateSpecializationArgs;
+    StringIndex CompletionSnippetSuffix;
+    StringIndex Documentation;
+    StringIndex ReturnType;
+    StringIndex Type;
+    // IncludeHeaders are Includes[FirstInclude, FirstInclude + NumIncludes).
+    uint32_t FirstInclude;
+    uint32_t NumIncludes;
+  };
+
+  struct IncludeHeader {
+    StringIndex Header;
+    unsigned References;
+  };
+
+  // Strings are null-terminated, so that FileURIs can point into StringData.
+  const char *cString(StringIndex I) const {
+    return StringData.data() + StringOffsets[I];
+  }
+  llvm::StringRef string(StringIndex I) const {
+    return llvm::StringRef(cString(I),
+                           StringOffsets[I + 1] - StringOffsets[I] - 1);
+  }
+
+  // Hot columns, one entry per row.
+  std::vector<SymbolID> IDs;
+  std::vector<StringIndex> Names;
+  std::vector<StringIndex> Scopes;
+  std::vector<Symbol::SymbolFlag> Flags;
+  // Cold data.
+  std::vector<ColdFields> Cold;
+  std::vector<IncludeHeader> Includes;
+  // String table. String I spans [StringOffsets[I], StringOffsets[I + 1]),
+  // including the null terminator. String 0 is "".
+  std::vector<char> StringData;
+  std::vector<uint32_t> StringOffsets;
+};
+
+} // namespace clangd
+} // namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_COMPACTSYMBOLSLAB_H
@@ -229,9 +229,13 @@ SlabTuple indexMainDecls(ParsedAST &AST) {
 SlabTuple indexHeaderSymbols(llvm::StringRef Version, ASTContext &AST,
                              Preprocessor &PP,
                              const CanonicalIncludes &Includes) {
-  std::vector<Decl *> DeclsToIndex(
-      AST.getTranslationUnitDecl()->decls().begin(),
-      AST.getTranslationUnitDecl()->decls().end());
+  // \p AST may be that of the main file, built with a preamble that wasn't
+  // indexed.
+  const auto &SM = AST.getSourceManager();
+  std::vector<Decl *> DeclsToIndex;
+  for (Decl *D : AST.getTranslationUnitDecl()->decls())
+    if (!SM.isWrittenInMainFile(SM.getExpansionLoc(D->getLocation())))
+      DeclsToIndex.push_back(D);
   return indexSymbols(AST, PP, DeclsToIndex,
                       /*MainFileMacros=*/nullptr, Includes,
                       /*IsIndexMainAST=*/false, Version,
@@ -248,6 +252,20 @@ void FileSymbols::update(llvm::StringRef Key,
                          bool CountReferences) {
   std::lock_guard<std::mutex> Lock(Mutex);
   ++Version;
+  auto Updated = UpdatedKeys.try_emplace(Key);
+  if (Updated.second) {
+    // First update since the last full build: keep what that build saw.
+    auto Syms = SymbolsSnapshot.find(Key);
+    if (Syms != SymbolsSnapshot.end())
+      Updated.first->second.Symbols = Syms->second;
+    auto OldRefs = RefsSnapshot.find(Key);
+    if (OldRefs != RefsSnapshot.end() && OldRefs->second.CountReferences)
+      Updated.first->second.MainFileRefs = OldRefs->second.Slab;
+  }
+  if (Symbols || Refs || Relations)
+    Keys.insert(Key);
+  else
+    Keys.erase(Key);
   if (!Symbols)
     SymbolsSnapshot.erase(Key);
   else
@@ -269,31 +287,114 @@ void FileSymbols::update(llvm::StringRef Key,
 std::unique_ptr<SymbolIndex>
 FileSymbols::buildIndex(IndexType Type, DuplicateHandling DuplicateHandle,
                         size_t *Version) {
+  return buildIndex(Type, DuplicateHandle, Version, /*Replaced=*/nullptr);
+}
+
+std::unique_ptr<SymbolIndex>
+FileSymbols::buildDeltaIndex(IndexType Type, DuplicateHandling DuplicateHandle,
+                             llvm::DenseSet<SymbolID> &Replaced) {
+  return buildIndex(Type, DuplicateHandle, /*Version=*/nullptr, &Replaced);
+}
+
+size_t FileSymbols::updatedKeys() const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return UpdatedKeys.size();
+}
+
+size_t FileSymbols::keys() const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return Keys.size();
+}
+
+std::unique_ptr<SymbolIndex>
+FileSymbols::buildIndex(IndexType Type, DuplicateHandling DuplicateHandle,
+                        size_t *Version, llvm::DenseSet<SymbolID> *Replaced) {
   std::vector<std::shared_ptr<SymbolSlab>> SymbolSlabs;
   std::vector<std::shared_ptr<RefSlab>> RefSlabs;
   std::vector<std::shared_ptr<RelationSlab>> RelationSlabs;
   llvm::StringSet<> Files;
   std::vector<RefSlab *> MainFileRefs;
+  // For a delta index: the data of the other keys, and of the updated keys
+  // as of the last full build.
+  std::vector<std::shared_ptr<SymbolSlab>> OtherSymbolSlabs, BaseSymbolSlabs;
+  std::vector<std::shared_ptr<RefSlab>> OtherMainFileRefs, BaseMainFileRefs;
   {
     std::lock_guard<std::mutex> Lock(Mutex);
+    auto Included = [&](llvm::StringRef Key) {
+      return !Replaced || UpdatedKeys.count(Key);
+    };
     for (const auto &FileAndSymbols : SymbolsSnapshot) {
+      if (!Included(FileAndSymbols.first())) {
+        OtherSymbolSlabs.push_back(FileAndSymbols.second);
+        continue;
+      }
       SymbolSlabs.push_back(FileAndSymbols.second);
       Files.insert(FileAndSymbols.first());
     }
     for (const auto &FileAndRefs : RefsSnapshot) {
+      if (!Included(FileAndRefs.first())) {
+        if (FileAndRefs.second.CountReferences)
+          OtherMainFileRefs.push_back(FileAndRefs.second.Slab);
+        continue;
+      }
       RefSlabs.push_back(FileAndRefs.second.Slab);
       Files.insert(FileAndRefs.first());
       if (FileAndRefs.second.CountReferences)
         MainFileRefs.push_back(RefSlabs.back().get());
     }
     for (const auto &FileAndRelations : RelationsSnapshot) {
+      if (!Included(FileAndRelations.first()))
+        continue;
       Files.insert(FileAndRelations.first());
       RelationSlabs.push_back(FileAndRelations.second);
     }
 
+    if (Replaced) {
+      for (const auto &KeyAndBase : UpdatedKeys) {
+        // Claim removed keys too, so that stale data from the full index is
+        // hidden when the two are merged.
+        Files.insert(KeyAndBase.first());
+        if (KeyAndBase.second.Symbols)
+          BaseSymbolSlabs.push_back(KeyAndBase.second.Symbols);
+        if (KeyAndBase.second.MainFileRefs)
+          BaseMainFileRefs.push_back(KeyAndBase.second.MainFileRefs);
+      }
+    } else {
+      UpdatedKeys.clear();
+    }
     if (Version)
       *Version = this->Version;
   }
+  // The slabs of the other keys are shared with the full index.
+  size_t OwnSymbolSlabs = SymbolSlabs.size();
+  if (Replaced) {
+    // The symbols the updated keys contribute to, now or in the full index.
+    for (const auto &Slab : SymbolSlabs)
+      for (const auto &Sym : *Slab)
+        Replaced->insert(Sym.ID);
+    for (const auto &Slab : BaseSymbolSlabs)
+      for (const auto &Sym : *Slab)
+        Replaced->insert(Sym.ID);
+    if (DuplicateHandle == DuplicateHandling::Merge) {
+      for (const RefSlab *Refs : MainFileRefs)
+        for (const auto &Sym : *Refs)
+          Replaced->insert(Sym.first);
+      for (const auto &Refs : BaseMainFileRefs)
+        for (const auto &Sym : *Refs)
+          Replaced->insert(Sym.first);
+    }
+    // Their declarations and references in the other keys are merged too.
+    for (auto &Slab : OtherSymbolSlabs)
+      if (llvm::any_of(*Slab, [&](const Symbol &Sym) {
+            return Replaced->count(Sym.ID);
+          }))
+        SymbolSlabs.push_back(std::move(Slab));
+    for (const auto &Refs : OtherMainFileRefs)
+      MainFileRefs.push_back(Refs.get());
+  }
+  auto Wanted = [&](const Symbol &Sym) {
+    return !Replaced || Replaced->count(Sym.ID);
+  };
   std::vector<const Symbol *> AllSymbols;
   std::vector<Symbol> SymsStorage;
   switch (DuplicateHandle) {
@@ -303,6 +404,8 @@ FileSymbols::buildIndex(IndexType Type, DuplicateHandling DuplicateHandle,
       for (const auto &Sym : *Slab) {
         assert(Sym.References == 0 &&
                "Symbol with non-zero references sent to FileSymbols");
+        if (!Wanted(Sym))
+          continue;
         auto I = Merged.try_emplace(Sym.ID, Sym);
         if (!I.second)
           I.first->second = mergeSymbol(I.first->second, Sym);
@@ -329,7 +432,7 @@ FileSymbols::buildIndex(IndexType Type, DuplicateHandling DuplicateHandle,
       for (const auto &Sym : *Slab) {
         assert(Sym.References == 0 &&
                "Symbol with non-zero references sent to FileSymbols");
-        if (AddedSymbols.insert(Sym.ID).second)
+        if (Wanted(Sym) && AddedSymbols.insert(Sym.ID).second)
           AllSymbols.push_back(&Sym);
       }
     break;
@@ -374,8 +477,8 @@ FileSymbols::buildIndex(IndexType Type, DuplicateHandling DuplicateHandle,
 
   size_t StorageSize =
       RefsStorage.size() * sizeof(Ref) + SymsStorage.size() * sizeof(Symbol);
-  for (const auto &Slab : SymbolSlabs)
-    StorageSize += Slab->bytes();
+  for (size_t I = 0; I < OwnSymbolSlabs; ++I)
+    StorageSize += SymbolSlabs[I]->bytes();
   for (const auto &RefSlab : RefSlabs)
     StorageSize += RefSlab->bytes();
 
@@ -493,13 +596,9 @@ void FileIndex::updateMain(PathRef Path, ParsedAST &AST) {
 
 void FileIndex::profile(MemoryTree &MT) const {
   PreambleSymbols.profile(MT.child("preamble").child("slabs"));
-  MT.child("preamble")
-      .child("index")
-      .addUsage(PreambleIndex.estimateMemoryUsage());
+  PreambleIndex.profile(MT.child("preamble").child("index"));
   MainFileSymbols.profile(MT.child("main_file").child("slabs"));
-  MT.child("main_file")
-      .child("index")
-      .addUsage(MainFileIndex.estimateMemoryUsage());
+  MainFileIndex.profile(MT.child("main_file").child("index"));
 }
 } // namespace clangd
 } // namespace clang
@@ -30,6 +30,7 @@
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include <memory>
 #include <vector>
 
@@ -87,9 +88,36 @@ public:
              DuplicateHandling DuplicateHandle = DuplicateHandling::PickOne,
              size_t *Version = nullptr);
 
+  /// Builds an index of only the keys updated since the last buildIndex(), to
+  /// be layered over the last full index. This is much cheaper than
+  /// buildIndex() when few keys were updated.
+  ///
+  /// The refs and relations are those of the updated keys. Keys whose data was
+  /// removed are still reported by indexedFiles(), so that the refs of the
+  /// full index can be filtered as with a MergedIndex.
+  ///
+  /// The symbols are those the updated keys contribute to, now or at the last
+  /// buildIndex(). They are merged from all keys, with References counted over
+  /// all main files, as buildIndex() would. Their IDs are added to
+  /// \p Replaced: the full index's symbols with these IDs are stale, and must
+  /// be hidden, whether the delta has them or not.
+  std::unique_ptr<SymbolIndex>
+  buildDeltaIndex(IndexType, DuplicateHandling DuplicateHandle,
+                  llvm::DenseSet<SymbolID> &Replaced);
+
+  /// Number of keys updated since the last buildIndex(), and in total.
+  size_t updatedKeys() const;
+  size_t keys() const;
+
   void profile(MemoryTree &MT) const;
 
 private:
+  /// Builds an index of all keys, or of the updated keys only if \p Replaced
+  /// is set (see buildDeltaIndex()).
+  std::unique_ptr<SymbolIndex> buildIndex(IndexType, DuplicateHandling,
+                                          size_t *Version,
+                                          llvm::DenseSet<SymbolID> *Replaced);
+
   IndexContents IdxContents;
 
   struct RefSlabAndCountReferences {
@@ -102,6 +130,15 @@ private:
   llvm::StringMap<std::shared_ptr<SymbolSlab>> SymbolsSnapshot;
   llvm::StringMap<RefSlabAndCountReferences> RefsSnapshot;
   llvm::StringMap<std::shared_ptr<RelationSlab>> RelationsSnapshot;
+  // The data of the keys updated since the last full build, as of that build.
+  // The symbols it contributed to are stale in the full index.
+  struct BaseSlabs {
+    std::shared_ptr<SymbolSlab> Symbols;
+    std::shared_ptr<RefSlab> MainFileRefs; // Only if counting references.
+  };
+  llvm::StringMap<BaseSlabs> UpdatedKeys;
+  // Keys with any data.
+  llvm::StringSet<> Keys;
 };
 
 /// This manages symbols from files and an in-memory index on all symbols.
@@ -120,7 +157,7 @@ public:
   /// `indexMainDecls`.
   void updateMain(PathRef Path, ParsedAST &AST);
 
-  void profile(MemoryTree &MT) const;
+  void profile(MemoryTree &MT) const override;
 
 private:
   // Contains information from each file's preamble only. Symbols and relations
@@ -22,6 +22,10 @@ void SwapIndex::reset(std::unique_ptr<SymbolIndex> Index) {
     this->Index = std::move(Index);
   }
 }
+void SymbolIndex::profile(MemoryTree &MT) const {
+  MT.addUsage(estimateMemoryUsage());
+}
+
 std::shared_ptr<SymbolIndex> SwapIndex::snapshot() const {
   std::lock_guard<std::mutex> Lock(Mutex);
   return Index;
@@ -87,5 +91,7 @@ size_t SwapIndex::estimateMemoryUsage() const {
   return snapshot()->estimateMemoryUsage();
 }
 
+void SwapIndex::profile(MemoryTree &MT) const { snapshot()->profile(MT); }
+
 } // namespace clangd
 } // namespace clang
@@ -13,6 +13,7 @@
 #include "index/Relation.h"
 #include "index/Symbol.h"
 #include "index/SymbolID.h"
+#include "support/MemoryTree.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FunctionExtras.h"
 #include "llvm/ADT/Optional.h"
@@ -157,6 +158,10 @@ public:
 
   /// Returns estimated size of index (in bytes).
   virtual size_t estimateMemoryUsage() const = 0;
+
+  /// Records the memory used by the index under \p MT. Without a breakdown of
+  /// its own, an index records estimateMemoryUsage().
+  virtual void profile(MemoryTree &MT) const;
 };
 
 // Delegating implementation of SymbolIndex whose delegate can be swapped out.
@@ -183,6 +188,7 @@ public:
   indexedFiles() const override;
 
   size_t estimateMemoryUsage() const override;
+  void profile(MemoryTree &MT) const override;
 
 private:
   std::shared_ptr<SymbolIndex> snapshot() const;
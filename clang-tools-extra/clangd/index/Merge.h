@@ -46,6 +46,10 @@ public:
   size_t estimateMemoryUsage() const override {
     return Dynamic->estimateMemoryUsage() + Static->estimateMemoryUsage();
   }
+  void profile(MemoryTree &MT) const override {
+    Dynamic->profile(MT.child("dynamic"));
+    Static->profile(MT.child("static"));
+  }
 };
 
 } // namespace clangd
@@ -9,147 +9,29 @@
 #include "Serialization.h"
 #include "Headers.h"
 #include "RIFF.h"
+#include "index/BinaryIO.h"
 #include "index/MemIndex.h"
 #include "index/SymbolLocation.h"
 #include "index/SymbolOrigin.h"
 #include "index/dex/Dex.h"
 #include "support/Logger.h"
+#include "support/MemoryTree.h"
 #include "support/Trace.h"
 #include "clang/Tooling/CompilationDatabase.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Compression.h"
-#include "llvm/Support/Endian.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdint>
+#include <limits>
 #include <vector>
 
 namespace clang {
 namespace clangd {
 namespace {
 
-// IO PRIMITIVES
-// We use little-endian 32 bit ints, sometimes with variable-length encoding.
-//
-// Variable-length int encoding (varint) uses the bottom 7 bits of each byte
-// to encode the number, and the top bit to indicate whether more bytes follow.
-// e.g. 9a 2f means [0x1a and keep reading, 0x2f and stop].
-// This represents 0x1a | 0x2f<<7 = 6042.
-// A 32-bit integer takes 1-5 bytes to encode; small numbers are more compact.
-
-// Reads binary data from a StringRef, and keeps track of position.
-class Reader {
-  const char *Begin, *End;
-  bool Err = false;
-
-public:
-  Reader(llvm::StringRef Data) : Begin(Data.begin()), End(Data.end()) {}
-  // The "error" bit is set by reading past EOF or reading invalid data.
-  // When in an error state, reads may return zero values: callers should check.
-  bool err() const { return Err; }
-  // Did we read all the data, or encounter an error?
-  bool eof() const { return Begin == End || Err; }
-  // All the data we didn't read yet.
-  llvm::StringRef rest() const { return llvm::StringRef(Begin, End - Begin); }
-
-  uint8_t consume8() {
-    if (LLVM_UNLIKELY(Begin == End)) {
-      Err = true;
-      return 0;
-    }
-    return *Begin++;
-  }
-
-  uint32_t consume32() {
-    if (LLVM_UNLIKELY(Begin + 4 > End)) {
-      Err = true;
-      return 0;
-    }
-    auto Ret = llvm::support::endian::read32le(Begin);
-    Begin += 4;
-    return Ret;
-  }
-
-  llvm::StringRef consume(int N) {
-    if (LLVM_UNLIKELY(Begin + N > End)) {
-      Err = true;
-      return llvm::StringRef();
-    }
-    llvm::StringRef Ret(Begin, N);
-    Begin += N;
-    return Ret;
-  }
-
-  uint32_t consumeVar() {
-    constexpr static uint8_t More = 1 << 7;
-
-    // Use a 32 bit unsigned here to prevent promotion to signed int (unless int
-    // is wider than 32 bits).
-    uint32_t B = consume8();
-    if (LLVM_LIKELY(!(B & More)))
-      return B;
-    uint32_t Val = B & ~More;
-    for (int Shift = 7; B & More && Shift < 32; Shift += 7) {
-      B = consume8();
-      // 5th byte of a varint can only have lowest 4 bits set.
-      assert((Shift != 28 || B == (B & 0x0f)) && "Invalid varint encoding");
-      Val |= (B & ~More) << Shift;
-    }
-    return Val;
-  }
-
-  llvm::StringRef consumeString(llvm::ArrayRef<llvm::StringRef> Strings) {
-    auto StringIndex = consumeVar();
-    if (LLVM_UNLIKELY(StringIndex >= Strings.size())) {
-      Err = true;
-      return llvm::StringRef();
-    }
-    return Strings[StringIndex];
-  }
-
-  SymbolID consumeID() {
-    llvm::StringRef Raw = consume(SymbolID::RawSize); // short if truncated.
-    return LLVM_UNLIKELY(err()) ? SymbolID() : SymbolID::fromRaw(Raw);
-  }
-
-  // Read a varint (as consumeVar) and resize the container accordingly.
-  // If the size is invalid, return false and mark an error.
-  // (The caller should abort in this case).
-  template <typename T> LLVM_NODISCARD bool consumeSize(T &Container) {
-    auto Size = consumeVar();
-    // Conservatively assume each element is at least one byte.
-    if (Size > (size_t)(End - Begin)) {
-      Err = true;
-      return false;
-    }
-    Container.resize(Size);
-    return true;
-  }
-};
-
-void write32(uint32_t I, llvm::raw_ostream &OS) {
-  char Buf[4];
-  llvm::support::endian::write32le(Buf, I);
-  OS.write(Buf, sizeof(Buf));
-}
-
-void writeVar(uint32_t I, llvm::raw_ostream &OS) {
-  constexpr static uint8_t More = 1 << 7;
-  if (LLVM_LIKELY(I < 1 << 7)) {
-    OS.write(I);
-    return;
-  }
-  for (;;) {
-    OS.write(I | More);
-    I >>= 7;
-    if (I < 1 << 7) {
-      OS.write(I);
-      return;
-    }
-  }
-}
-
 // STRING TABLE ENCODING
 // Index data has many string fields, and many strings are identical.
 // We store each string once, and refer to them by index.
@@ -161,6 +43,8 @@ void writeVar(uint32_t I, llvm::raw_ostream &OS) {
 // CompressedData is a zlib-compressed byte[UncompressedSize].
 // It contains a sequence of null-terminated strings, e.g. "foo\0bar\0".
 // These are sorted to improve compression.
+//
+// An uncompressed table is read in place: strings point into the file data.
 
 // Maps each string to a canonical representation.
 // Strings remain owned externally (e.g. by SymbolSlab).
@@ -179,7 +63,7 @@ public:
   // Add a string to the table. Overwrites S if an identical string exists.
   void intern(llvm::StringRef &S) { S = *Unique.insert(S).first; };
   // Finalize the table and write it to OS. No more strings may be added.
-  void finalize(llvm::raw_ostream &OS) {
+  void finalize(llvm::raw_ostream &OS, bool Compress) {
     Sorted = {Unique.begin(), Unique.end()};
     llvm::sort(Sorted);
     for (unsigned I = 0; I < Sorted.size(); ++I)
@@ -190,7 +74,7 @@ public:
       RawTable.append(std::string(S));
       RawTable.push_back(0);
     }
-    if (llvm::compression::zlib::isAvailable()) {
+    if (Compress && llvm::compression::zlib::isAvailable()) {
       llvm::SmallString<1> Compressed;
       llvm::compression::zlib::compress(RawTable, Compressed);
       write32(RawTable.size(), OS);
@@ -208,13 +92,15 @@ public:
   }
 };
 
+// Strings either point into Arena (compressed tables), or into the data the
+// table was read from (uncompressed tables).
 struct StringTableIn {
   llvm::BumpPtrAllocator Arena;
   std::vector<llvm::StringRef> Strings;
 };
 
 llvm::Expected<StringTableIn> readStringTable(llvm::StringRef Data) {
-  Reader R(Data);
+  BinaryReader R(Data);
   size_t UncompressedSize = R.consume32();
   if (R.err())
     return error("Truncated string table");
@@ -242,12 +128,14 @@ llvm::Expected<StringTableIn> readStringTable(llvm::StringRef Data) {
 
   StringTableIn Table;
   llvm::StringSaver Saver(Table.Arena);
-  R = Reader(Uncompressed);
-  for (Reader R(Uncompressed); !R.eof();) {
+  bool InPlace = UncompressedSize == 0;
+  R = BinaryReader(Uncompressed);
+  for (BinaryReader R(Uncompressed); !R.eof();) {
     auto Len = R.rest().find(0);
     if (Len == llvm::StringRef::npos)
       return error("Bad string table: not null terminated");
-    Table.Strings.push_back(Saver.save(R.consume(Len)));
+    llvm::StringRef S = R.consume(Len);
+    Table.Strings.push_back(InPlace ? S : Saver.save(S));
     R.consume8();
   }
   if (R.err())
@@ -270,7 +158,7 @@ void writeLocation(const SymbolLocation &Loc, const StringTableOut &Strings,
   }
 }
 
-SymbolLocation readLocation(Reader &Data,
+SymbolLocation readLocation(BinaryReader &Data,
                             llvm::ArrayRef<llvm::StringRef> Strings) {
   SymbolLocation Loc;
   Loc.FileURI = Data.consumeString(Strings).data();
@@ -281,7 +169,7 @@ SymbolLocation readLocation(Reader &Data,
   return Loc;
 }
 
-IncludeGraphNode readIncludeGraphNode(Reader &Data,
+IncludeGraphNode readIncludeGraphNode(BinaryReader &Data,
                                       llvm::ArrayRef<llvm::StringRef> Strings) {
   IncludeGraphNode IGN;
   IGN.Flags = static_cast<IncludeGraphNode::SourceFlag>(Data.consume8());
@@ -336,7 +224,7 @@ void writeSymbol(const Symbol &Sym, const StringTableOut &Strings,
     WriteInclude(Include);
 }
 
-Symbol readSymbol(Reader &Data, llvm::ArrayRef<llvm::StringRef> Strings,
+Symbol readSymbol(BinaryReader &Data, llvm::ArrayRef<llvm::StringRef> Strings,
                   SymbolOrigin Origin) {
   Symbol Sym;
   Sym.ID = Data.consumeID();
@@ -383,7 +271,7 @@ void writeRefs(const SymbolID &ID, llvm::ArrayRef<Ref> Refs,
 }
 
 std::pair<SymbolID, std::vector<Ref>>
-readRefs(Reader &Data, llvm::ArrayRef<llvm::StringRef> Strings) {
+readRefs(BinaryReader &Data, llvm::ArrayRef<llvm::StringRef> Strings) {
   std::pair<SymbolID, std::vector<Ref>> Result;
   Result.first = Data.consumeID();
   if (!Data.consumeSize(Result.second))
@@ -396,6 +284,154 @@ readRefs(Reader &Data, llvm::ArrayRef<llvm::StringRef> Strings) {
   return Result;
 }
 
+// REF OFFSETS ENCODING
+// An optional section that locates the refs of each symbol in the refs
+// section, so that they can be read lazily without scanning all of them:
+//  - NumRefs: 4 bytes, the total number of refs
+//  - for each symbol with refs:
+//    - SymbolID: 8 bytes
+//    - Offset: 4 bytes, of its refs bundle in the refs section
+
+// Refs make up most of a typical static index. When the index file stays
+// mapped, we only record where the refs of each symbol start, and decode them
+// when they're queried.
+struct RefsTable {
+  StringTableIn Strings;
+  // The refs section of the mapped file.
+  llvm::StringRef Data;
+  // Offset of each symbol's refs bundle in Data.
+  llvm::DenseMap<SymbolID, uint32_t> Offsets;
+  size_t NumRefs = 0;
+};
+
+// Validates the refs section and fills in the offset of each refs bundle.
+llvm::Error indexRefs(llvm::StringRef Data,
+                      llvm::ArrayRef<llvm::StringRef> Strings,
+                      RefsTable &Table) {
+  Table.Data = Data;
+  BinaryReader RefsReader(Data);
+  while (!RefsReader.eof()) {
+    uint32_t Offset = Data.size() - RefsReader.rest().size();
+    SymbolID ID = RefsReader.consumeID();
+    // Writers group refs by symbol, we rely on that to skip merging.
+    if (!Table.Offsets.try_emplace(ID, Offset).second)
+      return error("duplicate refs for symbol {0}", ID);
+    uint32_t NumRefs = RefsReader.consumeVar();
+    for (uint32_t I = 0; I < NumRefs && !RefsReader.err(); ++I) {
+      RefsReader.consume8();
+      readLocation(RefsReader, Strings);
+      RefsReader.consumeID();
+    }
+    Table.NumRefs += NumRefs;
+  }
+  if (RefsReader.err())
+    return error("malformed or truncated refs");
+  return llvm::Error::success();
+}
+
+// Fills in the offset of each refs bundle from a ref offsets section, without
+// reading the refs. They are validated as they're decoded.
+llvm::Error readRefOffsets(llvm::StringRef Data, llvm::StringRef Offsets,
+                           RefsTable &Table) {
+  Table.Data = Data;
+  BinaryReader OffsetsReader(Offsets);
+  Table.NumRefs = OffsetsReader.consume32();
+  while (!OffsetsReader.eof()) {
+    SymbolID ID = OffsetsReader.consumeID();
+    uint32_t Offset = OffsetsReader.consume32();
+    if (OffsetsReader.err())
+      break;
+    if (Offset >= Data.size())
+      return error("ref offset {0} out of bounds", Offset);
+    if (!Table.Offsets.try_emplace(ID, Offset).second)
+      return error("duplicate ref offset for symbol {0}", ID);
+  }
+  if (OffsetsReader.err())
+    return error("malformed or truncated ref offsets");
+  return llvm::Error::success();
+}
+
+// Serves refs from a RefsTable, and everything else from the Base index.
+class LazyRefsIndex : public SymbolIndex {
+public:
+  LazyRefsIndex(std::unique_ptr<SymbolIndex> Base, RefsTable Refs,
+                std::unique_ptr<llvm::MemoryBuffer> File)
+      : Base(std::move(Base)), Refs(std::move(Refs)), File(std::move(File)) {}
+
+  bool
+  fuzzyFind(const FuzzyFindRequest &Req,
+            llvm::function_ref<void(const Symbol &)> Callback) const override {
+    return Base->fuzzyFind(Req, Callback);
+  }
+
+  void
+  lookup(const LookupRequest &Req,
+         llvm::function_ref<void(const Symbol &)> Callback) const override {
+    Base->lookup(Req, Callback);
+  }
+
+  bool refs(const RefsRequest &Req,
+            llvm::function_ref<void(const Ref &)> Callback) const override {
+    trace::Span Tracer("LazyRefsIndex refs");
+    uint32_t Remaining =
+        Req.Limit.value_or(std::numeric_limits<uint32_t>::max());
+    for (const auto &ID : Req.IDs) {
+      auto It = Refs.Offsets.find(ID);
+      if (It == Refs.Offsets.end())
+        continue;
+      BinaryReader RefsReader(Refs.Data.drop_front(It->second));
+      auto Bundle = readRefs(RefsReader, Refs.Strings.Strings);
+      // Bundles located by the ref offsets section haven't been read yet.
+      if (RefsReader.err() || Bundle.first != ID) {
+        elog("Malformed refs for symbol {0} in static index", ID);
+        continue;
+      }
+      for (const auto &Ref : Bundle.second) {
+        if (!static_cast<int>(Req.Filter & Ref.Kind))
+          continue;
+        if (Remaining == 0)
+          return true; // More refs were available.
+        --Remaining;
+        Callback(Ref);
+      }
+    }
+    return false; // We reported all refs.
+  }
+
+  void relations(const RelationsRequest &Req,
+                 llvm::function_ref<void(const SymbolID &, const Symbol &)>
+                     Callback) const override {
+    Base->relations(Req, Callback);
+  }
+
+  llvm::unique_function<IndexContents(llvm::StringRef) const>
+  indexedFiles() const override {
+    return Base->indexedFiles();
+  }
+
+  // The mapped file is not included, only the parts of it that are touched
+  // are paged in.
+  size_t estimateMemoryUsage() const override {
+    return Base->estimateMemoryUsage() + refsMemoryUsage();
+  }
+
+  void profile(MemoryTree &MT) const override {
+    Base->profile(MT);
+    MT.child("lazy_refs").addUsage(refsMemoryUsage());
+  }
+
+private:
+  size_t refsMemoryUsage() const {
+    return Refs.Offsets.getMemorySize() + Refs.Strings.Arena.getTotalMemory() +
+           Refs.Strings.Strings.capacity() * sizeof(llvm::StringRef);
+  }
+
+
+  std::unique_ptr<SymbolIndex> Base;
+  RefsTable Refs;
+  std::unique_ptr<llvm::MemoryBuffer> File;
+};
+
 // RELATIONS ENCODING
 // A relations section is a flat list of relations. Each relation has:
 //  - SymbolID (subject): 8 bytes
@@ -409,7 +445,7 @@ void writeRelation(const Relation &R, llvm::raw_ostream &OS) {
   OS << R.Object.raw();
 }
 
-Relation readRelation(Reader &Data) {
+Relation readRelation(BinaryReader &Data) {
   SymbolID Subject = Data.consumeID();
   RelationKind Predicate = static_cast<RelationKind>(Data.consume8());
   SymbolID Object = Data.consumeID();
@@ -431,7 +467,8 @@ void writeCompileCommand(const InternedCompileCommand &Cmd,
 }
 
 InternedCompileCommand
-readCompileCommand(Reader CmdReader, llvm::ArrayRef<llvm::StringRef> Strings) {
+readCompileCommand(BinaryReader CmdReader,
+                   llvm::ArrayRef<llvm::StringRef> Strings) {
   InternedCompileCommand Cmd;
   Cmd.Directory = CmdReader.consumeString(Strings);
   if (!CmdReader.consumeSize(Cmd.CommandLine))
@@ -449,14 +486,17 @@ readCompileCommand(Reader CmdReader, llvm::ArrayRef<llvm::StringRef> Strings) {
 //   - stri: string table
 //   - symb: symbols
 //   - refs: references to symbols
+//   - rfof: offsets of the references of each symbol (optional)
 
 // The current versioning scheme is simple - non-current versions are rejected.
 // If you make a breaking change, bump this version number to invalidate stored
 // data. Later we may want to support some backward compatibility.
 constexpr static uint32_t Version = 17;
 
-llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data,
-                                     SymbolOrigin Origin) {
+// If LazyRefs is set, the refs section is indexed into it rather than read.
+// LazyRefs then refers to Data, which must outlive it.
+llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data, SymbolOrigin Origin,
+                                     RefsTable *LazyRefs = nullptr) {
   auto RIFF = riff::readFile(Data);
   if (!RIFF)
     return RIFF.takeError();
@@ -469,7 +509,7 @@ llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data,
 
   if (!Chunks.count("meta"))
     return error("missing meta chunk");
-  Reader Meta(Chunks.lookup("meta"));
+  BinaryReader Meta(Chunks.lookup("meta"));
   auto SeenVersion = Meta.consume32();
   if (SeenVersion != Version)
     return error("wrong version: want {0}, got {1}", Version, SeenVersion);
@@ -485,7 +525,7 @@ llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data,
 
   IndexFileIn Result;
   if (Chunks.count("srcs")) {
-    Reader SrcsReader(Chunks.lookup("srcs"));
+    BinaryReader SrcsReader(Chunks.lookup("srcs"));
     Result.Sources.emplace();
     while (!SrcsReader.eof()) {
       auto IGN = readIncludeGraphNode(SrcsReader, Strings->Strings);
@@ -502,7 +542,7 @@ llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data,
   }
 
   if (Chunks.count("symb")) {
-    Reader SymbolReader(Chunks.lookup("symb"));
+    BinaryReader SymbolReader(Chunks.lookup("symb"));
     SymbolSlab::Builder Symbols;
     while (!SymbolReader.eof())
       Symbols.insert(readSymbol(SymbolReader, Strings->Strings, Origin));
@@ -510,8 +550,16 @@ llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data,
       return error("malformed or truncated symbol");
     Result.Symbols = std::move(Symbols).build();
   }
-  if (Chunks.count("refs")) {
-    Reader RefsReader(Chunks.lookup("refs"));
+  if (Chunks.count("refs") && LazyRefs) {
+    // Without the offsets, finding them takes a pass over all the refs.
+    if (llvm::Error E =
+            Chunks.count("rfof")
+                ? readRefOffsets(Chunks.lookup("refs"), Chunks.lookup("rfof"),
+                                 *LazyRefs)
+                : indexRefs(Chunks.lookup("refs"), Strings->Strings, *LazyRefs))
+      return std::move(E);
+  } else if (Chunks.count("refs")) {
+    BinaryReader RefsReader(Chunks.lookup("refs"));
     RefSlab::Builder Refs;
     while (!RefsReader.eof()) {
       auto RefsBundle = readRefs(RefsReader, Strings->Strings);
@@ -523,7 +571,7 @@ llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data,
     Result.Refs = std::move(Refs).build();
   }
   if (Chunks.count("rela")) {
-    Reader RelationsReader(Chunks.lookup("rela"));
+    BinaryReader RelationsReader(Chunks.lookup("rela"));
     RelationSlab::Builder Relations;
     while (!RelationsReader.eof())
       Relations.insert(readRelation(RelationsReader));
@@ -532,7 +580,7 @@ llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data,
     Result.Relations = std::move(Relations).build();
   }
   if (Chunks.count("cmdl")) {
-    Reader CmdReader(Chunks.lookup("cmdl"));
+    BinaryReader CmdReader(Chunks.lookup("cmdl"));
     InternedCompileCommand Cmd =
         readCompileCommand(CmdReader, Strings->Strings);
     if (CmdReader.err())
@@ -543,6 +591,8 @@ llvm::Expected<IndexFileIn> readRIFF(llvm::StringRef Data,
     for (llvm::StringRef C : Cmd.CommandLine)
       Result.Cmd->CommandLine.emplace_back(C);
   }
+  if (LazyRefs)
+    LazyRefs->Strings = std::move(*Strings);
   return std::move(Result);
 }
 
@@ -614,7 +664,7 @@ void writeRIFF(const IndexFileOut &Data, llvm::raw_ostream &OS) {
   std::string StringSection;
   {
     llvm::raw_string_ostream StringOS(StringSection);
-    Strings.finalize(StringOS);
+    Strings.finalize(StringOS, Data.CompressStrings);
   }
   RIFF.Chunks.push_back({riff::fourCC("stri"), StringSection});
 
@@ -627,13 +677,24 @@ void writeRIFF(const IndexFileOut &Data, llvm::raw_ostream &OS) {
   RIFF.Chunks.push_back({riff::fourCC("symb"), SymbolSection});
 
   std::string RefsSection;
+  std::string RefOffsetsSection;
   if (Data.Refs) {
     {
       llvm::raw_string_ostream RefsOS(RefsSection);
-      for (const auto &Sym : Refs)
+      llvm::raw_string_ostream RefOffsetsOS(RefOffsetsSection);
+      if (Data.RefOffsets)
+        write32(Data.Refs->numRefs(), RefOffsetsOS);
+      for (const auto &Sym : Refs) {
+        if (Data.RefOffsets) {
+          RefOffsetsOS << Sym.first.raw();
+          write32(RefsOS.tell(), RefOffsetsOS);
+        }
         writeRefs(Sym.first, Sym.second, Strings, RefsOS);
+      }
     }
     RIFF.Chunks.push_back({riff::fourCC("refs"), RefsSection});
+    if (Data.RefOffsets)
+      RIFF.Chunks.push_back({riff::fourCC("rfof"), RefOffsetsSection});
   }
 
   std::string RelationSection;
@@ -700,7 +761,8 @@ llvm::Expected<IndexFileIn> readIndexFile(llvm::StringRef Data,
 }
 
 std::unique_ptr<SymbolIndex> loadIndex(llvm::StringRef SymbolFilename,
-                                       SymbolOrigin Origin, bool UseDex) {
+                                       SymbolOrigin Origin, bool UseDex,
+                                       bool LazyRefs) {
   trace::Span OverallTracer("LoadIndex");
   auto Buffer = llvm::MemoryBuffer::getFile(SymbolFilename);
   if (!Buffer) {
@@ -711,9 +773,15 @@ std::unique_ptr<SymbolIndex> loadIndex(llvm::StringRef SymbolFilename,
   SymbolSlab Symbols;
   RefSlab Refs;
   RelationSlab Relations;
+  RefsTable MappedRefs;
   {
     trace::Span Tracer("ParseIndex");
-    if (auto I = readIndexFile(Buffer->get()->getBuffer(), Origin)) {
+    llvm::StringRef Data = Buffer->get()->getBuffer();
+    // Only the binary format can be read lazily.
+    LazyRefs &= Data.startswith("RIFF");
+    auto I = LazyRefs ? readRIFF(Data, Origin, &MappedRefs)
+                      : readIndexFile(Data, Origin);
+    if (I) {
       if (I->Symbols)
         Symbols = std::move(*I->Symbols);
       if (I->Refs)
@@ -727,7 +795,7 @@ std::unique_ptr<SymbolIndex> loadIndex(llvm::StringRef SymbolFilename,
   }
 
   size_t NumSym = Symbols.size();
-  size_t NumRefs = Refs.numRefs();
+  size_t NumRefs = LazyRefs ? MappedRefs.NumRefs : Refs.numRefs();
   size_t NumRelations = Relations.size();
 
   trace::Span Tracer("BuildIndex");
@@ -735,6 +803,9 @@ std::unique_ptr<SymbolIndex> loadIndex(llvm::StringRef SymbolFilename,
                                         std::move(Relations))
                       : MemIndex::build(std::move(Symbols), std::move(Refs),
                                         std::move(Relations));
+  if (LazyRefs)
+    Index = std::make_unique<LazyRefsIndex>(
+        std::move(Index), std::move(MappedRefs), std::move(*Buffer));
   vlog("Loaded {0} from {1} with estimated memory usage {2} bytes\n"
        "  - number of symbols: {3}\n"
        "  - number of refs: {4}\n"
@@ -60,6 +60,12 @@ struct IndexFileOut {
   const IncludeGraph *Sources = nullptr;
   // TODO: Support serializing Dex posting lists.
   IndexFileFormat Format = IndexFileFormat::RIFF;
+  // Whether to compress the RIFF string table. Uncompressed tables are larger,
+  // but are read in place instead of being decompressed and copied.
+  bool CompressStrings = true;
+  // Whether to write the offset of each symbol's refs in the RIFF format, so
+  // that loadIndex() can read them lazily without scanning all of them first.
+  bool RefOffsets = false;
   const tooling::CompileCommand *Cmd = nullptr;
 
   IndexFileOut() = default;
@@ -81,8 +87,16 @@ std::string toYAML(const Ref &);
 
 // Build an in-memory static index from an index file.
 // The size should be relatively small, so data can be managed in memory.
+//
+// If LazyRefs is set, the file stays mapped for the lifetime of the index and
+// refs are decoded from it when queried, instead of being loaded up front.
+// Only refs are read lazily: symbols and relations are still loaded into the
+// index. Files written with IndexFileOut::RefOffsets are loaded without a pass
+// over the refs, others need one to locate them. The file must be replaced
+// rather than modified in place.
 std::unique_ptr<SymbolIndex> loadIndex(llvm::StringRef Filename,
-                                       SymbolOrigin Origin, bool UseDex = true);
+                                       SymbolOrigin Origin, bool UseDex = true,
+                                       bool LazyRefs = false);
 
 } // namespace clangd
 } // namespace clang
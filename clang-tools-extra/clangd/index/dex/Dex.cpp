@@ -33,12 +33,14 @@ namespace dex {
 
 std::unique_ptr<SymbolIndex> Dex::build(SymbolSlab Symbols, RefSlab Refs,
                                         RelationSlab Rels) {
-  auto Size = Symbols.bytes() + Refs.bytes();
+  auto Size = Refs.bytes();
   // There is no need to include "Rels" in Data because the relations are self-
   // contained, without references into a backing store.
-  auto Data = std::make_pair(std::move(Symbols), std::move(Refs));
-  return std::make_unique<Dex>(Data.first, Data.second, Rels, std::move(Data),
-                                Size);
+  // Symbols are only needed until they're copied by compactSymbols().
+  auto Index =
+      std::make_unique<Dex>(Symbols, Refs, Rels, std::move(Refs), Size);
+  Index->compactSymbols();
+  return Index;
 }
 
 namespace {
@@ -125,7 +127,6 @@ void Dex::buildIndex() {
 
   for (size_t I = 0; I < Symbols.size(); ++I) {
     const Symbol *Sym = Symbols[I];
-    LookupTable[Sym->ID] = Sym;
     ScoredSymbols[I] = {quality(*Sym), Sym};
   }
 
@@ -136,9 +137,11 @@ void Dex::buildIndex() {
   // SymbolQuality was empty up until now.
   SymbolQuality.resize(Symbols.size());
   // Populate internal storage using Symbol + Score pairs.
+  LookupTable.reserve(Symbols.size());
   for (size_t I = 0; I < ScoredSymbols.size(); ++I) {
     SymbolQuality[I] = ScoredSymbols[I].first;
     Symbols[I] = ScoredSymbols[I].second;
+    LookupTable[Symbols[I]->ID] = I;
   }
 
   // Build posting lists for symbols.
@@ -148,6 +151,23 @@ void Dex::buildIndex() {
   InvertedIndex = std::move(Builder).build();
 }
 
+void Dex::compactSymbols() {
+  CompactSymbols = CompactSymbolSlab(Symbols);
+  Symbols = {};
+}
+
+llvm::StringRef Dex::symbolName(DocID D) const {
+  return Symbols.empty() ? CompactSymbols.name(D) : Symbols[D]->Name;
+}
+
+void Dex::reportSymbol(
+    DocID D, llvm::function_ref<void(const Symbol &)> Callback) const {
+  if (Symbols.empty())
+    Callback(CompactSymbols.get(D));
+  else
+    Callback(*Symbols[D]);
+}
+
 std::unique_ptr<Iterator> Dex::iterator(const Token &Tok) const {
   auto It = InvertedIndex.find(Tok);
   return It == InvertedIndex.end() ? Corpus.none()
@@ -264,10 +284,16 @@ bool Dex::fuzzyFind(const FuzzyFindRequest &Req,
   };
   TopN<IDAndScore, decltype(Compare)> Top(
       Req.Limit ? *Req.Limit : std::numeric_limits<size_t>::max(), Compare);
-  for (const auto &IDAndScore : IDAndScores) {
+  std::vector<llvm::StringRef> Names;
+  Names.reserve(IDAndScores.size());
+  for (const auto &IDAndScore : IDAndScores)
+    Names.push_back(symbolName(IDAndScore.first));
+  std::vector<llvm::Optional<float>> Scores(Names.size());
+  Filter.matchBatch(Names, Scores);
+  for (size_t I = 0; I < IDAndScores.size(); ++I) {
+    const auto &IDAndScore = IDAndScores[I];
     const DocID SymbolDocID = IDAndScore.first;
-    const auto *Sym = Symbols[SymbolDocID];
-    const llvm::Optional<float> Score = Filter.match(Sym->Name);
+    const llvm::Optional<float> &Score = Scores[I];
     if (!Score)
       continue;
     // Combine Fuzzy Matching score, precomputed symbol quality and boosting
@@ -283,7 +309,7 @@ bool Dex::fuzzyFind(const FuzzyFindRequest &Req,
   // Apply callback to the top Req.Limit items in the descending
   // order of cumulative score.
   for (const auto &Item : std::move(Top).items())
-    Callback(*Symbols[Item.first]);
+    reportSymbol(Item.first, Callback);
   return More;
 }
 
@@ -293,7 +319,7 @@ void Dex::lookup(const LookupRequest &Req,
   for (const auto &ID : Req.IDs) {
     auto I = LookupTable.find(ID);
     if (I != LookupTable.end())
-      Callback(*I->second);
+      reportSymbol(I->second, Callback);
   }
 }
 
@@ -343,6 +369,7 @@ Dex::indexedFiles() const {
 
 size_t Dex::estimateMemoryUsage() const {
   size_t Bytes = Symbols.size() * sizeof(const Symbol *);
+  Bytes += CompactSymbols.bytes();
   Bytes += SymbolQuality.size() * sizeof(float);
   Bytes += LookupTable.getMemorySize();
   Bytes += InvertedIndex.getMemorySize();
@@ -353,6 +380,20 @@ size_t Dex::estimateMemoryUsage() const {
   return Bytes + BackingDataSize;
 }
 
+void Dex::profile(MemoryTree &MT) const {
+  MT.child("symbols").addUsage(Symbols.size() * sizeof(const Symbol *) +
+                               SymbolQuality.size() * sizeof(float) +
+                               LookupTable.getMemorySize());
+  CompactSymbols.profile(MT.child("compact_symbols"));
+  size_t PostingListBytes = InvertedIndex.getMemorySize();
+  for (const auto &TokenToPostingList : InvertedIndex)
+    PostingListBytes += TokenToPostingList.second.bytes();
+  MT.child("posting_lists").addUsage(PostingListBytes);
+  MT.child("refs").addUsage(Refs.getMemorySize());
+  MT.child("relations").addUsage(Relations.getMemorySize());
+  MT.child("backing_data").addUsage(BackingDataSize);
+}
+
 std::vector<std::string> generateProximityURIs(llvm::StringRef URIPath) {
   std::vector<std::string> Result;
   auto ParsedURI = URI::parse(URIPath);
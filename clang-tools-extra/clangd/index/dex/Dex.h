@@ -21,10 +21,12 @@
 #define LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_DEX_DEX_H
 
 #include "index/dex/Iterator.h"
+#include "index/CompactSymbolSlab.h"
 #include "index/Index.h"
 #include "index/Relation.h"
 #include "index/dex/PostingList.h"
 #include "index/dex/Token.h"
+#include "support/MemoryTree.h"
 #include "llvm/ADT/StringSet.h"
 
 namespace clang {
@@ -73,6 +75,7 @@ public:
   }
 
   /// Builds an index from slabs. The index takes ownership of the slab.
+  /// Symbols are copied into a CompactSymbolSlab and the SymbolSlab is freed.
   static std::unique_ptr<SymbolIndex> build(SymbolSlab, RefSlab, RelationSlab);
 
   bool
@@ -94,8 +97,16 @@ public:
 
   size_t estimateMemoryUsage() const override;
 
+  void profile(MemoryTree &MT) const override;
+
 private:
   void buildIndex();
+  /// Copies symbols into CompactSymbols, after which the backing data no
+  /// longer needs to keep them alive.
+  void compactSymbols();
+  llvm::StringRef symbolName(DocID) const;
+  void reportSymbol(DocID,
+                    llvm::function_ref<void(const Symbol &)> Callback) const;
   std::unique_ptr<Iterator> iterator(const Token &Tok) const;
   std::unique_ptr<Iterator>
   createFileProximityIterator(llvm::ArrayRef<std::string> ProximityPaths) const;
@@ -103,10 +114,13 @@ private:
   createTypeBoostingIterator(llvm::ArrayRef<std::string> Types) const;
 
   /// Stores symbols sorted in the descending order of symbol quality..
+  /// Empty once symbols have been moved to CompactSymbols.
   std::vector<const Symbol *> Symbols;
+  /// Same order as Symbols, used instead of it if non-empty.
+  CompactSymbolSlab CompactSymbols;
   /// SymbolQuality[I] is the quality of Symbols[I].
   std::vector<float> SymbolQuality;
-  llvm::DenseMap<SymbolID, const Symbol *> LookupTable;
+  llvm::DenseMap<SymbolID, DocID> LookupTable;
   /// Inverted index is a mapping from the search token to the posting list,
   /// which contains all items which can be characterized by such search token.
   /// For example, if the search token is scope "std::", the corresponding
@@ -123,8 +123,188 @@ private:
   static constexpr size_t ApproxEntriesPerChunk = 15;
 };
 
+/// Reads the Index-th Width-bit entry of a bit-packed sequence starting at
+/// Words. Entries may straddle a word boundary, so the storage is padded.
+DocID unpack(const uint32_t *Words, unsigned Width, size_t Index) {
+  size_t Bit = Index * Width;
+  const uint32_t *W = Words + Bit / 32;
+  uint64_t Bits = uint64_t(W[0]) | (uint64_t(W[1]) << 32);
+  return (Bits >> (Bit % 32)) & ((uint64_t(1) << Width) - 1);
+}
+
+/// Implements iterator over bit-packed PostingList blocks. Entries are read
+/// directly from the packed storage: nothing is decompressed, and advanceTo()
+/// skips whole blocks using their last DocID and binary searches the packed
+/// entries of the target block in place.
+class PackedIterator : public Iterator {
+public:
+  explicit PackedIterator(const Token *Tok, llvm::ArrayRef<PackedBlock> Blocks,
+                          llvm::ArrayRef<uint32_t> Words)
+      : Tok(Tok), Blocks(Blocks), Words(Words), CurrentBlock(Blocks.begin()) {
+    if (!Blocks.empty())
+      CurrentDoc = CurrentBlock->Head;
+  }
+
+  bool reachedEnd() const override { return CurrentBlock == Blocks.end(); }
+
+  void advance() override {
+    assert(!reachedEnd() &&
+           "Posting List iterator can't advance() at the end.");
+    if (++Index == CurrentBlock->Size)
+      enterBlock(CurrentBlock + 1);
+    else
+      CurrentDoc = entry(Index);
+  }
+
+  void advanceTo(DocID ID) override {
+    assert(!reachedEnd() &&
+           "Posting List iterator can't advance() at the end.");
+    if (ID <= CurrentDoc)
+      return;
+    if (ID > CurrentBlock->Last) {
+      enterBlock(std::partition_point(
+          CurrentBlock + 1, Blocks.end(),
+          [&](const PackedBlock &B) { return B.Last < ID; }));
+      if (reachedEnd() || ID <= CurrentDoc)
+        return;
+    }
+    // The block contains an entry >= ID, find the first one.
+    size_t Lo = Index, Hi = CurrentBlock->Size - 1;
+    while (Lo < Hi) {
+      size_t Mid = Lo + (Hi - Lo) / 2;
+      if (entry(Mid) < ID)
+        Lo = Mid + 1;
+      else
+        Hi = Mid;
+    }
+    Index = Lo;
+    CurrentDoc = entry(Index);
+  }
+
+  DocID peek() const override {
+    assert(!reachedEnd() && "Posting List iterator can't peek() at the end.");
+    return CurrentDoc;
+  }
+
+  float consume() override {
+    assert(!reachedEnd() &&
+           "Posting List iterator can't consume() at the end.");
+    return 1;
+  }
+
+  size_t estimateSize() const override {
+    if (Blocks.empty())
+      return 0;
+    return (Blocks.size() - 1) * PackedBlock::MaxSize + Blocks.back().Size;
+  }
+
+private:
+  llvm::raw_ostream &dump(llvm::raw_ostream &OS) const override {
+    if (Tok != nullptr)
+      return OS << *Tok;
+    OS << '[';
+    const char *Sep = "";
+    for (const PackedBlock &B : Blocks)
+      for (size_t I = 0; I < B.Size; ++I) {
+        OS << Sep << B.Head + unpack(&Words[B.Offset], B.Width, I);
+        Sep = " ";
+      }
+    return OS << ']';
+  }
+
+  DocID entry(size_t I) const {
+    return CurrentBlock->Head +
+           unpack(&Words[CurrentBlock->Offset], CurrentBlock->Width, I);
+  }
+
+  void enterBlock(llvm::ArrayRef<PackedBlock>::iterator Block) {
+    CurrentBlock = Block;
+    Index = 0;
+    if (!reachedEnd())
+      CurrentDoc = CurrentBlock->Head;
+  }
+
+  const Token *Tok;
+  llvm::ArrayRef<PackedBlock> Blocks;
+  llvm::ArrayRef<uint32_t> Words;
+  decltype(Blocks)::const_iterator CurrentBlock;
+  /// Position of the cursor within CurrentBlock.
+  size_t Index = 0;
+  /// Cached value of the entry under the cursor.
+  DocID CurrentDoc = 0;
+};
+
+/// Splits sorted DocIDs into blocks of PackedBlock::MaxSize entries and stores
+/// each entry as a fixed-width offset from the block's first DocID. The width
+/// is the number of bits needed for the offset of the block's last DocID.
+///
+/// Unlike delta encoding, entries don't depend on their predecessors: unpacking
+/// a block is a loop without carried dependencies (which compilers vectorize),
+/// and any entry can be read directly, which allows binary search.
+void encodePacked(llvm::ArrayRef<DocID> Documents,
+                  std::vector<PackedBlock> &Blocks,
+                  std::vector<uint32_t> &Words) {
+  // An empty list has no blocks, and its iterator starts at the end.
+  if (Documents.empty())
+    return;
+  for (size_t Begin = 0; Begin < Documents.size();
+       Begin += PackedBlock::MaxSize) {
+    auto Docs = Documents.slice(
+        Begin, std::min(PackedBlock::MaxSize, Documents.size() - Begin));
+    PackedBlock B;
+    B.Head = Docs.front();
+    B.Last = Docs.back();
+    B.Offset = Words.size();
+    B.Width = B.Last == B.Head ? 0 : 1 + llvm::findLastSet(B.Last - B.Head);
+    B.Size = Docs.size();
+    Words.resize(Words.size() + (Docs.size() * B.Width + 31) / 32);
+    // The first entry is always 0, leave it to the zero-initialized storage.
+    for (size_t I = 1; I < Docs.size(); ++I) {
+      size_t Bit = I * B.Width;
+      uint64_t Value = uint64_t(Docs[I] - B.Head) << (Bit % 32);
+      Words[B.Offset + Bit / 32] |= static_cast<uint32_t>(Value);
+      if (Bit % 32 + B.Width > 32)
+        Words[B.Offset + Bit / 32 + 1] |= static_cast<uint32_t>(Value >> 32);
+    }
+    Blocks.push_back(B);
+  }
+  // unpack() always reads two words, even for zero-width blocks.
+  Words.resize(Words.size() + 2);
+  Blocks.shrink_to_fit();
+  Words.shrink_to_fit();
+}
+
 static constexpr size_t BitsPerEncodingByte = 7;
 
+/// Returns whether Documents are long enough for skipping whole blocks to pay
+/// off, and dense enough for bit-packing them to take no more memory than VByte
+/// chunks. The widest offset of a block sets the width of all its entries, so
+/// packing sparse lists wastes bits that VByte doesn't.
+bool shouldPack(llvm::ArrayRef<DocID> Documents) {
+  if (Documents.size() < PackedBlock::MaxSize)
+    return false;
+  // unpack() reads past the last entry, so the storage is padded.
+  size_t PackedBits = 64;
+  for (size_t Begin = 0; Begin < Documents.size();
+       Begin += PackedBlock::MaxSize) {
+    auto Docs = Documents.slice(
+        Begin, std::min(PackedBlock::MaxSize, Documents.size() - Begin));
+    unsigned Width = Docs.back() == Docs.front()
+                         ? 0
+                         : 1 + llvm::findLastSet(Docs.back() - Docs.front());
+    PackedBits += sizeof(PackedBlock) * 8 + Docs.size() * Width;
+  }
+  // A lower bound of the VByte size: chunks are assumed to be full, and their
+  // heads are counted as one more delta byte.
+  size_t VByteBytes = 1;
+  for (size_t I = 1; I < Documents.size(); ++I)
+    VByteBytes +=
+        1 + llvm::findLastSet(Documents[I] - Documents[I - 1]) /
+                BitsPerEncodingByte;
+  size_t Chunks = llvm::divideCeil(VByteBytes, Chunk::PayloadSize + 1);
+  return llvm::divideCeil(PackedBits, 8) <= Chunks * sizeof(Chunk);
+}
+
 /// Writes a variable length DocID into the buffer and updates the buffer size.
 /// If it doesn't fit, returns false and doesn't write to the buffer.
 bool encodeVByte(DocID Delta, llvm::MutableArrayRef<uint8_t> &Payload) {
@@ -214,10 +394,27 @@ llvm::SmallVector<DocID, Chunk::PayloadSize + 1> Chunk::decompress() const {
   return llvm::SmallVector<DocID, Chunk::PayloadSize + 1>{Result};
 }
 
-PostingList::PostingList(llvm::ArrayRef<DocID> Documents)
-    : Chunks(encodeStream(Documents)) {}
+PostingList::PostingList(llvm::ArrayRef<DocID> Documents,
+                         PostingEncoding Encoding) {
+  switch (Encoding) {
+  case PostingEncoding::VByte:
+    Chunks = encodeStream(Documents);
+    break;
+  case PostingEncoding::Packed:
+    encodePacked(Documents, Blocks, PackedWords);
+    break;
+  case PostingEncoding::Auto:
+    if (shouldPack(Documents))
+      encodePacked(Documents, Blocks, PackedWords);
+    else
+      Chunks = encodeStream(Documents);
+    break;
+  }
+}
 
 std::unique_ptr<Iterator> PostingList::iterator(const Token *Tok) const {
+  if (!Blocks.empty())
+    return std::make_unique<PackedIterator>(Tok, Blocks, PackedWords);
   return std::make_unique<ChunkIterator>(Tok, Chunks);
 }
 
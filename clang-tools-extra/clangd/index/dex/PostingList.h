@@ -18,6 +18,11 @@
 /// algorithm can be found in "Introduction to Information Retrieval" book:
 /// https://nlp.stanford.edu/IR-book/html/htmledition/variable-byte-codes-1.html
 ///
+/// Alternatively, DocIDs can be stored in bit-packed frame-of-reference blocks.
+/// These take more space than VByte for sparse lists, but all entries of a
+/// block have the same width, so they can be unpacked without data
+/// dependencies between entries and searched without decompressing the block.
+///
 //===----------------------------------------------------------------------===//
 
 #ifndef LLVM_CLANG_TOOLS_EXTRA_CLANGD_INDEX_DEX_POSTINGLIST_H
@@ -52,24 +57,70 @@ struct Chunk {
 };
 static_assert(sizeof(Chunk) == 32, "Chunk should take 32 bytes of memory.");
 
+/// NOTE: This is an implementation detail.
+///
+/// PackedBlock describes up to MaxSize consecutive DocIDs of a PostingList
+/// stored as fixed-width offsets from Head. The offsets are bit-packed into
+/// the PostingList's word storage starting at Offset.
+struct PackedBlock {
+  static constexpr size_t MaxSize = 128;
+
+  /// The first (smallest) DocID of the block.
+  DocID Head;
+  /// The last (largest) DocID of the block, used to skip whole blocks.
+  DocID Last;
+  /// Index of the first storage word of this block.
+  uint32_t Offset;
+  /// Number of bits each entry takes.
+  uint8_t Width;
+  /// Number of entries in the block, including Head.
+  uint8_t Size;
+};
+static_assert(sizeof(PackedBlock) == 16,
+              "PackedBlock should take 16 bytes of memory.");
+
+/// Storage layout of the DocIDs in a PostingList.
+enum class PostingEncoding {
+  /// Delta-encoded VByte chunks. This is the most compact layout.
+  VByte,
+  /// Bit-packed frame-of-reference blocks. Faster to iterate and to skip
+  /// through, at the cost of some memory on sparse lists.
+  Packed,
+  /// Packed for long lists that are dense enough to take no more memory than
+  /// with VByte, VByte otherwise.
+  Auto,
+};
+
 /// PostingList is the storage of DocIDs which can be inserted to the Query
 /// Tree as a leaf by constructing Iterator over the PostingList object. DocIDs
-/// are stored in underlying chunks. Compression saves memory at a small cost
-/// in access time, which is still fast enough in practice.
+/// are stored either in VByte chunks or in bit-packed blocks, see
+/// PostingEncoding. Compression saves memory at a small cost in access time,
+/// which is still fast enough in practice.
 class PostingList {
 public:
-  explicit PostingList(llvm::ArrayRef<DocID> Documents);
+  explicit PostingList(llvm::ArrayRef<DocID> Documents,
+                       PostingEncoding Encoding = PostingEncoding::Auto);
 
-  /// Constructs DocumentIterator over given posting list. DocumentIterator will
-  /// go through the chunks and decompress them on-the-fly when necessary.
+  /// Constructs DocumentIterator over given posting list. Over VByte chunks,
+  /// DocumentIterator decompresses them on-the-fly when necessary. Over packed
+  /// blocks, it reads entries in place: advanceTo() skips the blocks whose Last
+  /// DocID is smaller than the target, then binary searches within the block.
   /// If given, Tok is only used for the string representation.
   std::unique_ptr<Iterator> iterator(const Token *Tok = nullptr) const;
 
   /// Returns in-memory size of external storage.
-  size_t bytes() const { return Chunks.capacity() * sizeof(Chunk); }
+  size_t bytes() const {
+    return Chunks.capacity() * sizeof(Chunk) +
+           Blocks.capacity() * sizeof(PackedBlock) +
+           PackedWords.capacity() * sizeof(uint32_t);
+  }
 
 private:
-  const std::vector<Chunk> Chunks;
+  /// Non-empty iff the list is VByte-encoded.
+  std::vector<Chunk> Chunks;
+  /// Non-empty iff the list is bit-packed.
+  std::vector<PackedBlock> Blocks;
+  std::vector<uint32_t> PackedWords;
 };
 
 } // namespace dex
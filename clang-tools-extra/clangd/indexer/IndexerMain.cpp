@@ -38,6 +38,13 @@ static llvm::cl::opt<IndexFileFormat>
                                        "binary RIFF format")),
            llvm::cl::init(IndexFileFormat::RIFF));
 
+static llvm::cl::opt<bool> CompressStrings(
+    "compress-strings",
+    llvm::cl::desc("Compress the string table of binary index files. "
+                   "Uncompressed tables are larger, but clangd can read them "
+                   "in place"),
+    llvm::cl::init(true));
+
 class IndexActionFactory : public tooling::FrontendActionFactory {
 public:
   IndexActionFactory(IndexFileIn &Result) : Result(Result) {}
@@ -155,6 +162,9 @@ int main(int argc, const char **argv) {
   // Emit collected data.
   clang::clangd::IndexFileOut Out(Data);
   Out.Format = clang::clangd::Format;
+  Out.CompressStrings = clang::clangd::CompressStrings;
+  // Lets clangd --lazy-index-refs locate the refs without reading them.
+  Out.RefOffsets = true;
   llvm::outs() << Out;
   return 0;
 }
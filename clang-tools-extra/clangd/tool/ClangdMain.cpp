@@ -14,6 +14,7 @@
 #include "Feature.h"
 #include "IncludeCleaner.h"
 #include "PathMapping.h"
+#include "PreambleStore.h"
 #include "Protocol.h"
 #include "TidyProvider.h"
 #include "Transport.h"
@@ -361,6 +362,18 @@ opt<Path> IndexFile{
     Hidden,
 };
 
+opt<bool> LazyIndexRefs{
+    "lazy-index-refs",
+    cat(Misc),
+    desc("Keep static index files mapped and decode references from them on "
+         "demand, rather than loading all references up front. Symbols and "
+         "relations are still loaded up front, and files not written by "
+         "clangd-indexer need a pass over their references to locate them. "
+         "Index files must be replaced, not modified in place"),
+    init(false),
+    Hidden,
+};
+
 opt<bool> Test{
     "lit-test",
     cat(Misc),
@@ -412,6 +425,22 @@ opt<PCHStorageFlag> PCHStorage{
     init(PCHStorageFlag::Disk),
 };
 
+opt<bool> PersistPreambles{
+    "persist-preambles",
+    cat(Misc),
+    desc("Store preambles on disk, so that files open quickly after clangd "
+         "restarts"),
+    init(false),
+};
+
+opt<unsigned> PersistedPreamblesLimit{
+    "persisted-preambles-limit",
+    cat(Misc),
+    desc("Total size of preambles to keep on disk, in megabytes"),
+    init(2048),
+    Hidden,
+};
+
 opt<bool> Sync{
     "sync",
     cat(Misc),
@@ -621,7 +650,8 @@ loadExternalIndex(const Config::ExternalIndexSpec &External,
     auto NewIndex = std::make_unique<SwapIndex>(std::make_unique<MemIndex>());
     auto IndexLoadTask = [File = External.Location,
                           PlaceHolder = NewIndex.get()] {
-      if (auto Idx = loadIndex(File, SymbolOrigin::Static, /*UseDex=*/true))
+      if (auto Idx = loadIndex(File, SymbolOrigin::Static, /*UseDex=*/true,
+                               LazyIndexRefs))
         PlaceHolder->reset(std::move(Idx));
     };
     if (Tasks) {
@@ -870,6 +900,18 @@ clangd accepts flags on the commandline, and in the CLANGD_FLAGS environment var
     Opts.StorePreamblesInMemory = false;
     break;
   }
+  std::unique_ptr<PreambleStore> StoredPreambles;
+  if (PersistPreambles) {
+    llvm::SmallString<128> Dir;
+    if (llvm::sys::path::cache_directory(Dir)) {
+      llvm::sys::path::append(Dir, "clangd", "preambles");
+      StoredPreambles = std::make_unique<PreambleStore>(
+          Dir, uint64_t(PersistedPreamblesLimit) << 20);
+      Opts.PreambleStore = StoredPreambles.get();
+    } else {
+      elog("Couldn't find a cache directory, not persisting preambles");
+    }
+  }
   if (!ResourceDir.empty())
     Opts.ResourceDir = ResourceDir;
   Opts.BuildDynamicSymbolIndex = true;
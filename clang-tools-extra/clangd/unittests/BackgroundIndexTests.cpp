@@ -5,8 +5,10 @@
 #include "TestFS.h"
 #include "TestTU.h"
 #include "index/Background.h"
+#include "index/BackgroundIndexLoader.h"
 #include "index/BackgroundRebuild.h"
 #include "index/MemIndex.h"
+#include "support/MemoryTree.h"
 #include "clang/Tooling/ArgumentsAdjusters.h"
 #include "clang/Tooling/CompilationDatabase.h"
 #include "llvm/ADT/STLExtras.h"
@@ -455,6 +457,99 @@ TEST_F(BackgroundIndexTest, ShardStorageLoad) {
               Contains(AllOf(named("f_b"), declared(), defined())));
 }
 
+TEST_F(BackgroundIndexTest, ShardStorageParallelLoad) {
+  MockFS FS;
+  FS.Files[testPath("root/A.h")] = "#include \"B.h\"\nvoid a();";
+  FS.Files[testPath("root/B.h")] = "void b();";
+  std::vector<Path> MainFiles;
+  for (llvm::StringRef Name : {"X", "Y", "Z"}) {
+    Path MainFile = testPath(("root/" + Name + ".cc").str());
+    FS.Files[MainFile] = "#include \"A.h\"";
+    MainFiles.push_back(MainFile);
+  }
+
+  llvm::StringMap<std::string> Storage;
+  size_t CacheHits = 0;
+  MemoryShardStorage MSS(Storage, CacheHits);
+  OverlayCDB CDB(/*Base=*/nullptr);
+  {
+    BackgroundIndex Idx(FS, CDB, [&](llvm::StringRef) { return &MSS; },
+                        /*Opts=*/{});
+    for (const Path &MainFile : MainFiles) {
+      tooling::CompileCommand Cmd;
+      Cmd.Filename = MainFile;
+      Cmd.Directory = testPath("root");
+      Cmd.CommandLine = {"clang++", MainFile};
+      CDB.setCompileCommand(MainFile, Cmd);
+    }
+    ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  }
+
+  CacheHits = 0;
+  BackgroundIndexStorage::Factory Factory = [&](llvm::StringRef) {
+    return &MSS;
+  };
+  auto Loaded = loadIndexShards(MainFiles, Factory, CDB, /*Concurrency=*/4);
+  // Each shard is loaded exactly once, even though headers are shared.
+  EXPECT_EQ(CacheHits, 5U);
+  llvm::StringMap<Path> DependentTUs;
+  for (const auto &LS : Loaded) {
+    EXPECT_NE(LS.Shard, nullptr) << LS.AbsolutePath;
+    DependentTUs[LS.AbsolutePath] = LS.DependentTU;
+  }
+  EXPECT_EQ(DependentTUs.size(), 5U);
+  for (const Path &MainFile : MainFiles)
+    EXPECT_EQ(DependentTUs.lookup(MainFile), MainFile);
+  EXPECT_TRUE(llvm::is_contained(MainFiles,
+                                 DependentTUs.lookup(testPath("root/B.h"))));
+}
+
+TEST_F(BackgroundIndexTest, ShardStorageBatchedLoad) {
+  MockFS FS;
+  FS.Files[testPath("root/A.h")] = "void a();";
+  std::vector<Path> MainFiles;
+  for (llvm::StringRef Name : {"X", "Y"}) {
+    Path MainFile = testPath(("root/" + Name + ".cc").str());
+    FS.Files[MainFile] = "#include \"A.h\"";
+    MainFiles.push_back(MainFile);
+  }
+
+  llvm::StringMap<std::string> Storage;
+  size_t CacheHits = 0;
+  MemoryShardStorage MSS(Storage, CacheHits);
+  OverlayCDB CDB(/*Base=*/nullptr);
+  {
+    BackgroundIndex Idx(FS, CDB, [&](llvm::StringRef) { return &MSS; },
+                        /*Opts=*/{});
+    for (const Path &MainFile : MainFiles) {
+      tooling::CompileCommand Cmd;
+      Cmd.Filename = MainFile;
+      Cmd.Directory = testPath("root");
+      Cmd.CommandLine = {"clang++", MainFile};
+      CDB.setCompileCommand(MainFile, Cmd);
+    }
+    ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  }
+
+  CacheHits = 0;
+  BackgroundIndexStorage::Factory Factory = [&](llvm::StringRef) {
+    return &MSS;
+  };
+  std::vector<std::vector<Path>> Batches = {{MainFiles[1]}, {MainFiles[0]}};
+  std::vector<std::vector<Path>> Loaded;
+  loadIndexShards(Batches, Factory, CDB, /*Concurrency=*/1,
+                  [&](std::vector<LoadedShard> Shards) {
+                    Loaded.emplace_back();
+                    for (const auto &LS : Shards)
+                      Loaded.back().push_back(LS.AbsolutePath);
+                  });
+  // The batches are loaded in order, and the header they share only once.
+  EXPECT_EQ(CacheHits, 3U);
+  EXPECT_THAT(Loaded, ElementsAre(UnorderedElementsAre(MainFiles[1],
+                                                       testPath("root/A.h")),
+                                  ElementsAre(MainFiles[0])));
+}
+
 TEST_F(BackgroundIndexTest, ShardStorageEmptyFile) {
   MockFS FS;
   FS.Files[testPath("root/A.h")] = R"cpp(
@@ -680,6 +775,15 @@ TEST_F(BackgroundIndexTest, Reindex) {
   EXPECT_EQ(OldShard, Storage.lookup(testPath("A.cc")));
 }
 
+std::unique_ptr<RefSlab> refSlab(const SymbolID &ID, const char *Path) {
+  RefSlab::Builder Slab;
+  Ref R;
+  R.Location.FileURI = Path;
+  R.Kind = RefKind::Reference;
+  Slab.insert(ID, R);
+  return std::make_unique<RefSlab>(std::move(Slab).build());
+}
+
 class BackgroundIndexRebuilderTest : public testing::Test {
 protected:
   BackgroundIndexRebuilderTest()
@@ -755,6 +859,62 @@ TEST_F(BackgroundIndexRebuilderTest, LoadingShards) {
   EXPECT_TRUE(checkRebuild([&] { Rebuilder.doneLoading(); }));
 }
 
+TEST_F(BackgroundIndexRebuilderTest, IncrementalRebuild) {
+  // Other files, so that updates to TestSymbol's file are incremental.
+  for (llvm::StringRef File : {"a", "b", "c", "d", "e", "f"}) {
+    SymbolSlab::Builder SB;
+    Symbol Sym;
+    Sym.ID = SymbolID(File);
+    Sym.Name = File;
+    Sym.CanonicalDeclaration.FileURI = File.data();
+    SB.insert(Sym);
+    Source.update(File, std::make_unique<SymbolSlab>(std::move(SB).build()),
+                  nullptr, nullptr, false);
+  }
+  Rebuilder.MaxUpdatedPercent = 50;
+  Rebuilder.startLoading();
+  Rebuilder.loadedShard(7);
+  EXPECT_TRUE(checkRebuild([&] { Rebuilder.doneLoading(); }));
+  auto IndexTUs = [&] {
+    for (unsigned I = 0; I < Rebuilder.TUsBeforeRebuild - 1; ++I)
+      Rebuilder.indexedTU();
+    return checkRebuild([&] { Rebuilder.indexedTU(); });
+  };
+  EXPECT_TRUE(IndexTUs());
+  EXPECT_TRUE(IndexTUs());
+
+  // Symbols from files that weren't updated are still served, and removed
+  // files are hidden.
+  Source.update("c", nullptr, nullptr, nullptr, false);
+  EXPECT_TRUE(IndexTUs());
+  LookupRequest Req;
+  for (llvm::StringRef File : {"a", "b", "c", "d", "e", "f"})
+    Req.IDs.insert(SymbolID(File));
+  std::vector<std::string> Names;
+  Target.lookup(Req, [&](const Symbol &S) { Names.push_back(S.Name.str()); });
+  EXPECT_THAT(Names, UnorderedElementsAre("a", "b", "d", "e", "f"));
+
+  // References from the files that weren't updated are still counted.
+  Source.update("main", nullptr, refSlab(SymbolID("a"), "main"), nullptr,
+                /*CountReferences=*/true);
+  EXPECT_TRUE(IndexTUs());
+  Source.update("other", nullptr, refSlab(SymbolID("a"), "other"), nullptr,
+                /*CountReferences=*/true);
+  EXPECT_TRUE(IndexTUs());
+  LookupRequest ReqA;
+  ReqA.IDs.insert(SymbolID("a"));
+  unsigned References = 0;
+  Target.lookup(ReqA, [&](const Symbol &S) { References = S.References; });
+  EXPECT_EQ(References, 2u);
+
+  // Both builds are profiled.
+  llvm::BumpPtrAllocator Alloc;
+  MemoryTree MT(&Alloc);
+  Target.profile(MT);
+  EXPECT_THAT(MT.children(), UnorderedElementsAre(Pair("full", _),
+                                                  Pair("updated", _)));
+}
+
 TEST(BackgroundQueueTest, Priority) {
   // Create high and low priority tasks.
   // Once a bunch of high priority tasks have run, the queue is stopped.
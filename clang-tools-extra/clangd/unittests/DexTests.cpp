@@ -65,6 +65,70 @@ TEST(DexIterators, DocumentIterator) {
   EXPECT_TRUE(DocIterator->reachedEnd());
 }
 
+TEST(DexIterators, PackedDocumentIterator) {
+  const PostingList L({4, 7, 8, 20, 42, 100}, PostingEncoding::Packed);
+  auto DocIterator = L.iterator();
+
+  EXPECT_EQ(DocIterator->peek(), 4U);
+  DocIterator->advance();
+  EXPECT_EQ(DocIterator->peek(), 7U);
+  DocIterator->advanceTo(20);
+  EXPECT_EQ(DocIterator->peek(), 20U);
+  DocIterator->advanceTo(65);
+  EXPECT_EQ(DocIterator->peek(), 100U);
+  EXPECT_FALSE(DocIterator->reachedEnd());
+  DocIterator->advanceTo(420);
+  EXPECT_TRUE(DocIterator->reachedEnd());
+}
+
+TEST(DexIterators, PackedMatchesVByte) {
+  // Spans several blocks with a mix of small and large gaps.
+  std::vector<DocID> Docs;
+  DocID Doc = 0;
+  for (DocID I = 0; I < 1000; ++I)
+    Docs.push_back(Doc += 1 + (I % 7 == 0 ? 100000 : I % 5));
+  const PostingList VByte(Docs, PostingEncoding::VByte),
+      Packed(Docs, PostingEncoding::Packed);
+  EXPECT_EQ(consumeIDs(*Packed.iterator()), Docs);
+
+  auto VByteIt = VByte.iterator(), PackedIt = Packed.iterator();
+  for (DocID Target = 0; !VByteIt->reachedEnd(); Target += 12345) {
+    ASSERT_FALSE(PackedIt->reachedEnd());
+    EXPECT_EQ(VByteIt->peek(), PackedIt->peek());
+    VByteIt->advanceTo(Target);
+    PackedIt->advanceTo(Target);
+  }
+  EXPECT_TRUE(PackedIt->reachedEnd());
+}
+
+TEST(DexIterators, PackedEmpty) {
+  const PostingList L({}, PostingEncoding::Packed);
+  EXPECT_TRUE(L.iterator()->reachedEnd());
+  EXPECT_EQ(L.bytes(), 0U);
+}
+
+TEST(DexIterators, AutoEncoding) {
+  std::vector<DocID> Dense, Sparse;
+  DocID Doc = 0;
+  for (DocID I = 0; I < 1000; ++I) {
+    Dense.push_back(I);
+    Sparse.push_back(Doc += I % 2 ? 1 : 100000);
+  }
+  // Dense lists are packed. In sparse ones, the large gaps would widen every
+  // packed entry, so they are VByte-encoded.
+  EXPECT_EQ(PostingList(Dense).bytes(),
+            PostingList(Dense, PostingEncoding::Packed).bytes());
+  EXPECT_LE(PostingList(Dense).bytes(),
+            PostingList(Dense, PostingEncoding::VByte).bytes());
+  EXPECT_EQ(PostingList(Sparse).bytes(),
+            PostingList(Sparse, PostingEncoding::VByte).bytes());
+  EXPECT_EQ(consumeIDs(*PostingList(Dense).iterator()), Dense);
+  EXPECT_EQ(consumeIDs(*PostingList(Sparse).iterator()), Sparse);
+  // Short lists aren't worth packing.
+  EXPECT_EQ(PostingList({1, 2, 3}).bytes(),
+            PostingList({1, 2, 3}, PostingEncoding::VByte).bytes());
+}
+
 TEST(DexIterators, AndTwoLists) {
   Corpus C{10000};
   const PostingList L0({0, 5, 7, 10, 42, 320, 9000});
@@ -141,6 +141,86 @@ TEST(FileSymbolsTest, MergeOverlap) {
             AllOf(qName("x"), declURI("file:///x1"), defURI("file:///x2"))));
 }
 
+TEST(FileSymbolsTest, DeltaIndex) {
+  FileSymbols FS(IndexContents::All);
+  FS.update("f1", numSlab(1, 3), nullptr, nullptr, false);
+  FS.update("f2", numSlab(4, 5), nullptr, nullptr, false);
+  EXPECT_EQ(FS.updatedKeys(), 2u);
+  FS.buildIndex(IndexType::Light);
+  EXPECT_EQ(FS.updatedKeys(), 0u);
+
+  FS.update("f2", numSlab(6, 6), nullptr, nullptr, false);
+  FS.update("f3", nullptr, nullptr, nullptr, false);
+  EXPECT_EQ(FS.updatedKeys(), 2u);
+  EXPECT_EQ(FS.keys(), 2u);
+  for (auto Type : {IndexType::Light, IndexType::Heavy}) {
+    llvm::DenseSet<SymbolID> Replaced;
+    auto Delta = FS.buildDeltaIndex(Type, DuplicateHandling::PickOne, Replaced);
+    EXPECT_THAT(runFuzzyFind(*Delta, ""), UnorderedElementsAre(qName("6")));
+    // The symbols f2 had at the last full build are stale too.
+    EXPECT_THAT(Replaced, UnorderedElementsAre(SymbolID("4"), SymbolID("5"),
+                                               SymbolID("6")));
+    auto Files = Delta->indexedFiles();
+    EXPECT_EQ(Files("f1"), IndexContents::None);
+    EXPECT_EQ(Files("f2"), IndexContents::All);
+    // Removed keys are claimed, to hide stale data in a full index.
+    EXPECT_EQ(Files("f3"), IndexContents::All);
+  }
+  // Delta builds accumulate until the next full build.
+  EXPECT_EQ(FS.updatedKeys(), 2u);
+}
+
+TEST(FileSymbolsTest, DeltaIndexMergesOtherKeys) {
+  FileSymbols FS(IndexContents::All);
+  auto X = symbol("x");
+  X.CanonicalDeclaration.FileURI = "file:///x.h";
+  auto XDef = symbol("x");
+  XDef.Definition.FileURI = "file:///x.cc";
+  SymbolSlab::Builder Header, Source;
+  Header.insert(X);
+  Source.insert(XDef);
+  FS.update("x.h", std::make_unique<SymbolSlab>(std::move(Header).build()),
+            nullptr, nullptr, false);
+  FS.update("x.cc", std::make_unique<SymbolSlab>(std::move(Source).build()),
+            nullptr, nullptr, false);
+  FS.update("a.cc", nullptr, refSlab(X.ID, "a.cc"), nullptr, true);
+  FS.update("b.cc", nullptr, refSlab(X.ID, "b.cc"), nullptr, true);
+  EXPECT_THAT(runFuzzyFind(*FS.buildIndex(IndexType::Heavy,
+                                          DuplicateHandling::Merge),
+                           "x"),
+              ElementsAre(numReferences(2u)));
+
+  // Only b.cc is updated, but x is merged as a full build would merge it.
+  RefSlab::Builder Refs;
+  Ref R;
+  R.Location.FileURI = "b.cc";
+  R.Kind = RefKind::Reference;
+  Refs.insert(X.ID, R);
+  R.Location.Start.setLine(1);
+  Refs.insert(X.ID, R);
+  FS.update("b.cc", nullptr, std::make_unique<RefSlab>(std::move(Refs).build()),
+            nullptr, true);
+  for (auto Type : {IndexType::Light, IndexType::Heavy}) {
+    llvm::DenseSet<SymbolID> Replaced;
+    auto Delta = FS.buildDeltaIndex(Type, DuplicateHandling::Merge, Replaced);
+    EXPECT_THAT(Replaced, ElementsAre(X.ID));
+    EXPECT_THAT(runFuzzyFind(*Delta, "x"),
+                ElementsAre(AllOf(declURI("file:///x.h"),
+                                  defURI("file:///x.cc"), numReferences(3u))));
+    EXPECT_THAT(getRefs(*Delta, X.ID), refsAre({fileURI("b.cc"),
+                                                fileURI("b.cc")}));
+  }
+
+  // Symbols that the updated keys no longer contribute to are replaced too.
+  FS.update("x.h", nullptr, nullptr, nullptr, false);
+  llvm::DenseSet<SymbolID> Replaced;
+  auto Delta =
+      FS.buildDeltaIndex(IndexType::Heavy, DuplicateHandling::Merge, Replaced);
+  EXPECT_THAT(Replaced, ElementsAre(X.ID));
+  EXPECT_THAT(runFuzzyFind(*Delta, "x"),
+              ElementsAre(AllOf(declURI(""), defURI("file:///x.cc"))));
+}
+
 TEST(FileSymbolsTest, SnapshotAliveAfterRemove) {
   FileSymbols FS(IndexContents::All);
 
@@ -703,6 +783,9 @@ TEST(FileIndexTest, Profile) {
 
   ASSERT_THAT(MT.child("preamble").child("index").total(), Gt(0U));
   ASSERT_THAT(MT.child("main_file").child("index").total(), Gt(0U));
+  // The preamble index is a Dex, which breaks its usage down.
+  EXPECT_THAT(MT.child("preamble").child("index").children(),
+              Contains(Pair("posting_lists", _)));
 }
 
 TEST(FileSymbolsTest, Profile) {
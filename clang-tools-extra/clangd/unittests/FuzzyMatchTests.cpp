@@ -283,6 +283,36 @@ TEST(FuzzyMatch, InitialismAndPrefix) {
   EXPECT_THAT("up", matches("[up]per_bound", 1.f));
 }
 
+TEST(FuzzyMatch, Batch) {
+  std::vector<llvm::StringRef> Words = {
+      "",
+      "a",
+      "foo",
+      "barefoot",
+      "XMLHttpRequest",
+      "xml_http_request",
+      "HTTP",
+      "get_HTTP_response",
+      "std::basic_string",
+      "t3h PeNgU1N oF d00m!!!!!!!!",
+      "AbstractVisitorFactoryImplementationThatIsMuchLongerThanMaxWord"
+      "AndKeepsGoingForeverAndEverSoThatItIsTruncated",
+  };
+  // Enough words for a partial group after some full ones.
+  for (int I = 0; I < 40; ++I)
+    Words.push_back(Words[I % Words.size()]);
+  for (llvm::StringRef Pattern :
+       {"", "f", "foo", "xhr", "XHR", "HTTP", "bs", "pengu", "Abs", "zzz",
+        "abstractvisitorfactoryimpl"}) {
+    FuzzyMatcher Matcher(Pattern);
+    std::vector<llvm::Optional<float>> Scores(Words.size());
+    Matcher.matchBatch(Words, Scores);
+    for (size_t I = 0; I < Words.size(); ++I)
+      EXPECT_EQ(Scores[I], Matcher.match(Words[I]))
+          << "[" << Pattern << "] ~ " << Words[I];
+  }
+}
+
 // Returns pretty-printed segmentation of Text.
 // e.g. std::basic_string --> +--  +---- +-----
 std::string segment(llvm::StringRef Text) {
@@ -7,7 +7,10 @@
 //===----------------------------------------------------------------------===//
 
 #include "Annotations.h"
+#include "Compiler.h"
 #include "IncludeCleaner.h"
+#include "ParsedAST.h"
+#include "Preamble.h"
 #include "SourceCode.h"
 #include "TestFS.h"
 #include "TestTU.h"
@@ -379,6 +382,153 @@ TEST(IncludeCleaner, GetUnusedHeaders) {
               UnorderedElementsAre("\"unused.h\"", "\"dir/unused.h\""));
 }
 
+TEST(IncludeCleaner, ReusedAcrossRebuilds) {
+  TestTU TU;
+  TU.Filename = "foo.cpp";
+  TU.AdditionalFiles["a.h"] = guard("int a();");
+  TU.AdditionalFiles["b.h"] = guard("int b();");
+  TU.Code = R"cpp(
+    #include "a.h"
+    #include "b.h"
+    int x = a();
+    int y = b();
+  )cpp";
+  MockFS FS;
+  IgnoreDiagnostics Diags;
+  auto Inputs = TU.inputs(FS);
+  auto CI = buildCompilerInvocation(Inputs, Diags);
+  ASSERT_TRUE(CI);
+  auto Preamble = buildPreamble(testPath(TU.Filename), *CI, Inputs,
+                                /*StoreInMemory=*/true, nullptr);
+  ASSERT_TRUE(Preamble);
+  ASSERT_TRUE(Preamble->IncludeCleaner);
+
+  auto Unused = [&](llvm::StringRef Code) {
+    TU.Code = Code.str();
+    auto Inputs = TU.inputs(FS);
+    auto AST = ParsedAST::build(testPath(TU.Filename), Inputs,
+                                buildCompilerInvocation(Inputs, Diags), {},
+                                Preamble);
+    EXPECT_TRUE(AST);
+    EXPECT_EQ(AST->getExactPreamble(), Preamble.get());
+    std::vector<std::string> Result;
+    for (const auto *Include : computeUnusedIncludes(*AST))
+      Result.push_back(Include->Written);
+    return Result;
+  };
+
+  EXPECT_THAT(Unused(TU.Code), IsEmpty());
+  // The first decl is unchanged, and reused from the previous build.
+  EXPECT_THAT(Unused(R"cpp(
+    #include "a.h"
+    #include "b.h"
+    int x = a();
+    int y = 0;
+  )cpp"),
+              ElementsAre("\"b.h\""));
+  EXPECT_THAT(Unused(R"cpp(
+    #include "a.h"
+    #include "b.h"
+    int x = 0;
+    int y = b();
+  )cpp"),
+              ElementsAre("\"a.h\""));
+  EXPECT_THAT(Unused(R"cpp(
+    #include "a.h"
+    #include "b.h"
+    int x = 0;
+    int y = b(), z = a();
+  )cpp"),
+              IsEmpty());
+}
+
+TEST(IncludeCleaner, NotReusedThroughLaterRedecls) {
+  TestTU TU;
+  TU.Filename = "foo.cpp";
+  TU.AdditionalFiles["a.h"] = guard("struct S;");
+  TU.Code = R"cpp(
+    #include "a.h"
+    S *p;
+    struct S {};
+  )cpp";
+  MockFS FS;
+  IgnoreDiagnostics Diags;
+  auto Inputs = TU.inputs(FS);
+  auto CI = buildCompilerInvocation(Inputs, Diags);
+  ASSERT_TRUE(CI);
+  auto Preamble = buildPreamble(testPath(TU.Filename), *CI, Inputs,
+                                /*StoreInMemory=*/true, nullptr);
+  ASSERT_TRUE(Preamble);
+
+  auto Unused = [&](llvm::StringRef Code) {
+    TU.Code = Code.str();
+    auto Inputs = TU.inputs(FS);
+    auto AST = ParsedAST::build(testPath(TU.Filename), Inputs,
+                                buildCompilerInvocation(Inputs, Diags), {},
+                                Preamble);
+    EXPECT_TRUE(AST);
+    EXPECT_EQ(AST->getExactPreamble(), Preamble.get());
+    std::vector<std::string> Result;
+    for (const auto *Include : computeUnusedIncludes(*AST))
+      Result.push_back(Include->Written);
+    return Result;
+  };
+
+  // S is defined in the main file, after the decl using it.
+  EXPECT_THAT(Unused(TU.Code), ElementsAre("\"a.h\""));
+  EXPECT_THAT(Unused(R"cpp(
+    #include "a.h"
+    S *p;
+  )cpp"),
+              IsEmpty());
+  EXPECT_THAT(Unused(R"cpp(
+    #include "a.h"
+    S *p;
+    struct S {};
+  )cpp"),
+              ElementsAre("\"a.h\""));
+}
+
+TEST(IncludeCleaner, NotReusedAfterHeaderOutsidePreamble) {
+  TestTU TU;
+  TU.Filename = "foo.cpp";
+  TU.AdditionalFiles["a.h"] = guard("struct S;");
+  TU.AdditionalFiles["b.h"] = guard("int b();");
+  // b.h isn't part of the preamble.
+  TU.Code = R"cpp(
+    #include "a.h"
+    int x;
+    #include "b.h"
+    S *p;
+  )cpp";
+  MockFS FS;
+  IgnoreDiagnostics Diags;
+  auto Inputs = TU.inputs(FS);
+  auto CI = buildCompilerInvocation(Inputs, Diags);
+  ASSERT_TRUE(CI);
+  auto Preamble = buildPreamble(testPath(TU.Filename), *CI, Inputs,
+                                /*StoreInMemory=*/true, nullptr);
+  ASSERT_TRUE(Preamble);
+
+  auto Unused = [&] {
+    auto Inputs = TU.inputs(FS);
+    auto AST = ParsedAST::build(testPath(TU.Filename), Inputs,
+                                buildCompilerInvocation(Inputs, Diags), {},
+                                Preamble);
+    EXPECT_TRUE(AST);
+    EXPECT_EQ(AST->getExactPreamble(), Preamble.get());
+    std::vector<std::string> Result;
+    for (const auto *Include : computeUnusedIncludes(*AST))
+      Result.push_back(Include->Written);
+    return Result;
+  };
+
+  EXPECT_THAT(Unused(), ElementsAre("\"b.h\""));
+  // The main file is unchanged, but S is now defined in b.h.
+  TU.AdditionalFiles["b.h"] = guard("struct S {};");
+  EXPECT_THAT(Unused(), ElementsAre("\"a.h\""));
+}
+
 TEST(IncludeCleaner, VirtualBuffers) {
   TestTU TU;
   TU.Code = R"cpp(
@@ -10,6 +10,7 @@
 #include "SyncAPI.h"
 #include "TestIndex.h"
 #include "TestTU.h"
+#include "index/CompactSymbolSlab.h"
 #include "index/FileIndex.h"
 #include "index/Index.h"
 #include "index/MemIndex.h"
@@ -77,6 +78,69 @@ TEST(SymbolSlab, FindAndIterate) {
     EXPECT_THAT(*S.find(SymbolID(Sym)), named(Sym));
 }
 
+TEST(CompactSymbolSlab, RoundTrip) {
+  Symbol Full = symbol("ns::foo");
+  Full.SymInfo.Kind = index::SymbolKind::Function;
+  Full.SymInfo.Lang = index::SymbolLanguage::CXX;
+  Full.Definition.FileURI = "unittest:///foo.cc";
+  Full.Definition.Start.setLine(3);
+  Full.Definition.End.setColumn(7);
+  Full.CanonicalDeclaration.FileURI = "unittest:///foo.h";
+  Full.References = 42;
+  Full.Origin = SymbolOrigin::Static;
+  Full.Signature = "(int x)";
+  Full.TemplateSpecializationArgs = "<int>";
+  Full.CompletionSnippetSuffix = "(${1:int x})";
+  Full.Documentation = "Does foo.";
+  Full.ReturnType = "void";
+  Full.Type = "ty";
+  Full.IncludeHeaders.emplace_back("\"foo.h\"", 2);
+  Full.IncludeHeaders.emplace_back("<foo>", 1);
+  Full.Flags = Symbol::IndexedForCodeCompletion | Symbol::Deprecated;
+  Symbol Empty = symbol("bar");
+
+  CompactSymbolSlab Slab({&Full, &Empty});
+  ASSERT_EQ(Slab.size(), 2u);
+  EXPECT_EQ(Slab.id(0), Full.ID);
+  EXPECT_EQ(Slab.name(0), "foo");
+  EXPECT_EQ(Slab.scope(0), "ns::");
+  EXPECT_EQ(Slab.flags(0), Full.Flags);
+
+  Symbol S = Slab.get(0);
+  EXPECT_EQ(S.ID, Full.ID);
+  EXPECT_EQ(S.SymInfo.Kind, Full.SymInfo.Kind);
+  EXPECT_EQ(S.SymInfo.Lang, Full.SymInfo.Lang);
+  EXPECT_EQ(S.Name, Full.Name);
+  EXPECT_EQ(S.Scope, Full.Scope);
+  EXPECT_EQ(S.Definition, Full.Definition);
+  EXPECT_EQ(S.CanonicalDeclaration, Full.CanonicalDeclaration);
+  EXPECT_EQ(S.References, Full.References);
+  EXPECT_EQ(S.Origin, Full.Origin);
+  EXPECT_EQ(S.Signature, Full.Signature);
+  EXPECT_EQ(S.TemplateSpecializationArgs, Full.TemplateSpecializationArgs);
+  EXPECT_EQ(S.CompletionSnippetSuffix, Full.CompletionSnippetSuffix);
+  EXPECT_EQ(S.Documentation, Full.Documentation);
+  EXPECT_EQ(S.ReturnType, Full.ReturnType);
+  EXPECT_EQ(S.Type, Full.Type);
+  ASSERT_EQ(S.IncludeHeaders.size(), 2u);
+  EXPECT_EQ(S.IncludeHeaders[0].IncludeHeader, "\"foo.h\"");
+  EXPECT_EQ(S.IncludeHeaders[0].References, 2u);
+  EXPECT_EQ(S.IncludeHeaders[1].IncludeHeader, "<foo>");
+  EXPECT_EQ(S.Flags, Full.Flags);
+
+  S = Slab.get(1);
+  EXPECT_EQ(S.ID, Empty.ID);
+  EXPECT_EQ(S.Name, "bar");
+  EXPECT_EQ(S.Scope, "");
+  EXPECT_FALSE(S.Definition);
+  EXPECT_THAT(S.IncludeHeaders, IsEmpty());
+
+  // All memory is attributed to some column.
+  MemoryTree MT;
+  Slab.profile(MT);
+  EXPECT_EQ(MT.total(), Slab.bytes() - sizeof(Slab));
+}
+
 TEST(RelationSlab, Lookup) {
   SymbolID A{"A"};
   SymbolID B{"B"};
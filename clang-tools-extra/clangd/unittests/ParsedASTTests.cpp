@@ -599,6 +599,45 @@ MATCHER_P(diag, Desc, "") {
 }
 
 // Check our understanding of whether the main file is header guarded or not.
+TEST(ParsedASTTest, ExactPreamble) {
+  TestTU TU;
+  TU.Filename = "foo.cpp";
+  TU.AdditionalFiles["foo.h"] = "void foo();";
+  TU.AdditionalFiles["bar.h"] = "void bar();";
+  TU.Code = "#include \"foo.h\"\nvoid a() { foo(); }";
+
+  StoreDiags Diags;
+  MockFS FS;
+  auto Inputs = TU.inputs(FS);
+  auto CI = buildCompilerInvocation(Inputs, Diags);
+  auto Preamble =
+      buildPreamble(testPath("foo.cpp"), *CI, Inputs, true, nullptr);
+  ASSERT_TRUE(Preamble);
+
+  // Only the main file changed past the preamble: it is used as is.
+  TU.Code = "#include \"foo.h\"\nvoid b() { foo(); }";
+  Inputs = TU.inputs(FS);
+  auto AST = ParsedAST::build(testPath("foo.cpp"), Inputs,
+                              buildCompilerInvocation(Inputs, Diags), {},
+                              Preamble);
+  ASSERT_TRUE(AST);
+  EXPECT_EQ(AST->getExactPreamble(), Preamble.get());
+
+  // An include was added: the preamble is patched.
+  TU.Code = "#include \"foo.h\"\n#include \"bar.h\"\nvoid c() { bar(); }";
+  Inputs = TU.inputs(FS);
+  AST = ParsedAST::build(testPath("foo.cpp"), Inputs,
+                         buildCompilerInvocation(Inputs, Diags), {}, Preamble);
+  ASSERT_TRUE(AST);
+  EXPECT_EQ(AST->getExactPreamble(), nullptr);
+
+  // No preamble at all.
+  AST = ParsedAST::build(testPath("foo.cpp"), Inputs,
+                         buildCompilerInvocation(Inputs, Diags), {}, nullptr);
+  ASSERT_TRUE(AST);
+  EXPECT_EQ(AST->getExactPreamble(), nullptr);
+}
+
 TEST(ParsedASTTest, HeaderGuards) {
   TestTU TU;
   TU.ImplicitHeaderGuard = false;
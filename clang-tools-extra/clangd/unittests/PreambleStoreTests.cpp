@@ -0,0 +1,153 @@
+//===--- PreambleStoreTests.cpp ---------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "Compiler.h"
+#include "ParsedAST.h"
+#include "Preamble.h"
+#include "PreambleStore.h"
+#include "TestFS.h"
+#include "TestTU.h"
+#include "support/Threading.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include <memory>
+
+namespace clang {
+namespace clangd {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+
+class PreambleStoreTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("preamble-store", Dir));
+  }
+  void TearDown() override { llvm::sys::fs::remove_directories(Dir); }
+
+  unsigned countStored() {
+    unsigned Count = 0;
+    std::error_code EC;
+    for (llvm::sys::fs::directory_iterator It(Dir, EC), End;
+         It != End && !EC; It.increment(EC))
+      ++Count;
+    return Count;
+  }
+
+  llvm::SmallString<128> Dir;
+};
+
+TEST_F(PreambleStoreTest, RoundTrip) {
+  MockFS FS;
+  IgnoreDiagnostics Diags;
+  TestTU TU = TestTU::withCode(R"cpp(
+    #include "foo.h"
+    #define BAR 2
+    #pragma mark Section
+    int x = FOO + BAR;
+  )cpp");
+  TU.AdditionalFiles["foo.h"] = R"cpp(
+    #pragma once
+    // IWYU pragma: private, include "public.h"
+    #define FOO 1
+  )cpp";
+  auto Inputs = TU.inputs(FS);
+  auto CI = buildCompilerInvocation(Inputs, Diags);
+  ASSERT_TRUE(CI);
+  auto FileName = testPath(TU.Filename);
+  auto Built = buildPreamble(FileName, *CI, Inputs, /*StoreInMemory=*/true,
+                             /*PreambleCallback=*/nullptr);
+  ASSERT_TRUE(Built);
+
+  PreambleStore Store(Dir, /*MaxBytes=*/1 << 30);
+  EXPECT_EQ(Store.load(FileName, Inputs, *CI, /*StoreInMemory=*/true),
+            nullptr);
+  Store.store(FileName, *Inputs.TFS, Built);
+  ASSERT_TRUE(Store.blockUntilIdle(timeoutSeconds(10)));
+  auto Loaded = Store.load(FileName, Inputs, *CI, /*StoreInMemory=*/true);
+  ASSERT_TRUE(Loaded);
+
+  EXPECT_EQ(Loaded->CompileCommand, Built->CompileCommand);
+  EXPECT_EQ(Loaded->Preamble.getContents(), Built->Preamble.getContents());
+  EXPECT_EQ(Loaded->Includes.MainFileIncludes,
+            Built->Includes.MainFileIncludes);
+  EXPECT_THAT(Loaded->Includes.allHeaders(),
+              ElementsAreArray(Built->Includes.allHeaders()));
+  EXPECT_EQ(Loaded->Macros.Names.count("BAR"), 1u);
+  EXPECT_EQ(Loaded->Marks.size(), 1u);
+  auto Header = FS.view(llvm::None)->status(testPath("foo.h"));
+  ASSERT_TRUE(bool(Header));
+  EXPECT_EQ(Loaded->CanonIncludes.mappingFor(Header->getUniqueID()),
+            "\"public.h\"");
+
+  // The loaded preamble can be used to build ASTs.
+  auto AST = ParsedAST::build(FileName, Inputs, std::move(CI), {}, Loaded);
+  ASSERT_TRUE(AST);
+  EXPECT_THAT(*AST->getDiagnostics(), IsEmpty());
+}
+
+TEST_F(PreambleStoreTest, Invalidation) {
+  MockFS FS;
+  IgnoreDiagnostics Diags;
+  TestTU TU = TestTU::withCode("#include \"foo.h\"\nint x = FOO;");
+  TU.AdditionalFiles["foo.h"] = "#define FOO 1";
+  auto Inputs = TU.inputs(FS);
+  auto CI = buildCompilerInvocation(Inputs, Diags);
+  ASSERT_TRUE(CI);
+  auto FileName = testPath(TU.Filename);
+  auto Built = buildPreamble(FileName, *CI, Inputs, /*StoreInMemory=*/false,
+                             /*PreambleCallback=*/nullptr);
+  ASSERT_TRUE(Built);
+  PreambleStore Store(Dir, /*MaxBytes=*/1 << 30);
+  Store.store(FileName, *Inputs.TFS, Built);
+  ASSERT_TRUE(Store.blockUntilIdle(timeoutSeconds(10)));
+  EXPECT_TRUE(Store.load(FileName, Inputs, *CI, /*StoreInMemory=*/false));
+
+  // Edits outside the preamble don't matter.
+  auto Edited = Inputs;
+  Edited.Contents += "\nint y;";
+  EXPECT_TRUE(Store.load(FileName, Edited, *CI, /*StoreInMemory=*/false));
+
+  // Changes to the preamble do.
+  Edited.Contents = "#define BAR\n" + Inputs.Contents;
+  EXPECT_FALSE(Store.load(FileName, Edited, *CI, /*StoreInMemory=*/false));
+
+  // As do changes to the compile command.
+  Edited = Inputs;
+  Edited.CompileCommand.CommandLine.push_back("-DBAZ");
+  EXPECT_FALSE(Store.load(FileName, Edited, *CI, /*StoreInMemory=*/false));
+
+  // And to headers.
+  FS.Files[testPath("foo.h")] = "#define FOO 42";
+  EXPECT_FALSE(Store.load(FileName, Inputs, *CI, /*StoreInMemory=*/false));
+}
+
+TEST_F(PreambleStoreTest, Prune) {
+  MockFS FS;
+  IgnoreDiagnostics Diags;
+  TestTU TU = TestTU::withCode("#define FOO\nint x;");
+  auto Inputs = TU.inputs(FS);
+  auto CI = buildCompilerInvocation(Inputs, Diags);
+  ASSERT_TRUE(CI);
+  auto FileName = testPath(TU.Filename);
+  auto Built = buildPreamble(FileName, *CI, Inputs, /*StoreInMemory=*/true,
+                             /*PreambleCallback=*/nullptr);
+  ASSERT_TRUE(Built);
+  PreambleStore(Dir, /*MaxBytes=*/1 << 30)
+      .store(FileName, *Inputs.TFS, Built); // Waits for the write.
+  EXPECT_EQ(countStored(), 1u);
+  PreambleStore(Dir, /*MaxBytes=*/0).prune();
+  EXPECT_EQ(countStored(), 0u);
+}
+
+} // namespace
+} // namespace clangd
+} // namespace clang
@@ -10,10 +10,13 @@
 #include "RIFF.h"
 #include "index/Serialization.h"
 #include "support/Logger.h"
+#include "support/MemoryTree.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ScopedPrinter.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -21,7 +24,10 @@
 #include <sys/resource.h>
 #endif
 
+using ::testing::_;
+using ::testing::Contains;
 using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
 using ::testing::Pair;
 using ::testing::UnorderedElementsAre;
 using ::testing::UnorderedElementsAreArray;
@@ -236,6 +242,68 @@ TEST(SerializationTest, BinaryConversions) {
               UnorderedElementsAreArray(yamlFromRelations(*In->Relations)));
 }
 
+TEST(SerializationTest, UncompressedStrings) {
+  auto In = readIndexFile(YAML);
+  EXPECT_TRUE(bool(In)) << In.takeError();
+
+  IndexFileOut Out(*In);
+  Out.Format = IndexFileFormat::RIFF;
+  Out.CompressStrings = false;
+  std::string Serialized = llvm::to_string(Out);
+
+  auto In2 = readIndexFile(Serialized);
+  ASSERT_TRUE(bool(In2)) << In2.takeError();
+  ASSERT_TRUE(In2->Symbols);
+  ASSERT_TRUE(In2->Refs);
+  EXPECT_THAT(yamlFromSymbols(*In2->Symbols),
+              UnorderedElementsAreArray(yamlFromSymbols(*In->Symbols)));
+  EXPECT_THAT(yamlFromRefs(*In2->Refs),
+              UnorderedElementsAreArray(yamlFromRefs(*In->Refs)));
+}
+
+TEST(SerializationTest, LazyRefs) {
+  auto In = readIndexFile(YAML);
+  ASSERT_TRUE(bool(In)) << In.takeError();
+  ASSERT_TRUE(In->Refs);
+
+  llvm::SmallString<128> Path;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("clangd-index", "idx", Path));
+  auto RemoveFile = llvm::make_scope_exit([&] { llvm::sys::fs::remove(Path); });
+  for (bool Compress : {true, false}) {
+    for (bool RefOffsets : {true, false}) {
+      {
+        std::error_code EC;
+        llvm::raw_fd_ostream OS(Path, EC);
+        ASSERT_FALSE(EC) << EC.message();
+        IndexFileOut Out(*In);
+        Out.CompressStrings = Compress;
+        Out.RefOffsets = RefOffsets;
+        OS << Out;
+      }
+      auto Index = loadIndex(Path, SymbolOrigin::Static, /*UseDex=*/true,
+                             /*LazyRefs=*/true);
+      ASSERT_TRUE(Index);
+      for (const auto &Refs : *In->Refs) {
+        RefsRequest Req;
+        Req.IDs.insert(Refs.first);
+        std::vector<std::string> Got;
+        EXPECT_FALSE(Index->refs(
+            Req, [&](const Ref &R) { Got.push_back(toYAML(R)); }));
+        std::vector<std::string> Want;
+        for (const auto &R : Refs.second)
+          Want.push_back(toYAML(R));
+        EXPECT_THAT(Got, ElementsAreArray(Want));
+      }
+
+      llvm::BumpPtrAllocator Alloc;
+      MemoryTree MT(&Alloc);
+      Index->profile(MT);
+      EXPECT_THAT(MT.children(), Contains(Pair("lazy_refs", _)));
+      EXPECT_THAT(MT.children(), Contains(Pair("posting_lists", _)));
+    }
+  }
+}
+
 TEST(SerializationTest, SrcsTest) {
   auto In = readIndexFile(YAML);
   EXPECT_TRUE(bool(In)) << In.takeError();
@@ -831,6 +831,78 @@ TEST_F(TUSchedulerTests, NoopOnEmptyChanges) {
   ASSERT_EQ(S.fileStats().lookup(Source).PreambleBuilds, 3u);
 }
 
+TEST_F(TUSchedulerTests, ReopenReusesPreamble) {
+  TUScheduler S(CDB, optsForTest(), captureDiags());
+  auto Source = testPath("foo.cpp");
+  FS.Files[testPath("foo.h")] = "int a;";
+  auto Inputs = getInputs(Source, "#include \"foo.h\"\nint b = a;");
+  auto GetPreamble = [&] {
+    const PreambleData *Result = nullptr;
+    S.runWithPreamble("", Source, TUScheduler::Stale,
+                      [&](Expected<InputsAndPreamble> Preamble) {
+                        ASSERT_TRUE(bool(Preamble));
+                        Result = Preamble->Preamble;
+                      });
+    EXPECT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+    return Result;
+  };
+
+  S.update(Source, Inputs, WantDiagnostics::Yes);
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  const PreambleData *First = GetPreamble();
+  ASSERT_NE(First, nullptr);
+
+  // Closing and reopening the file doesn't rebuild the preamble.
+  S.remove(Source);
+  S.update(Source, Inputs, WantDiagnostics::Yes);
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  EXPECT_EQ(GetPreamble(), First);
+
+  // Unless the preamble has changed in the meantime.
+  S.remove(Source);
+  Inputs.Contents = "#include \"foo.h\"\n#define X\nint b = a;";
+  S.update(Source, Inputs, WantDiagnostics::Yes);
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  EXPECT_NE(GetPreamble(), First);
+}
+
+TEST_F(TUSchedulerTests, SharedPreambles) {
+  TUScheduler S(CDB, optsForTest(), captureDiags());
+  FS.Files[testPath("foo.h")] = "int a;";
+  FS.Files[testPath("sub/foo.h")] = "int a;";
+  auto Open = [&](PathRef File, llvm::StringRef Contents) {
+    S.update(File, getInputs(File, Contents.str()), WantDiagnostics::Yes);
+    EXPECT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+    const PreambleData *Result = nullptr;
+    S.runWithPreamble("", File, TUScheduler::Stale,
+                      [&](Expected<InputsAndPreamble> Preamble) {
+                        ASSERT_TRUE(bool(Preamble));
+                        Result = Preamble->Preamble;
+                      });
+    EXPECT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+    return Result;
+  };
+
+  const PreambleData *A =
+      Open(testPath("a.cpp"), "#include \"foo.h\"\nint b = a;");
+  ASSERT_NE(A, nullptr);
+  // Files in the same directory with the same preamble share it.
+  EXPECT_EQ(Open(testPath("b.cpp"), "#include \"foo.h\"\nint c = a;"), A);
+  // Quoted includes of a file in another directory may resolve differently.
+  EXPECT_NE(Open(testPath("sub/c.cpp"), "#include \"foo.h\"\nint b = a;"), A);
+  // Macros in the preamble section would be located in the wrong file.
+  const PreambleData *D =
+      Open(testPath("d.cpp"), "#define X\n#include \"foo.h\"\nint b = a;");
+  ASSERT_NE(D, nullptr);
+  EXPECT_NE(Open(testPath("e.cpp"), "#define X\n#include \"foo.h\"\nint c;"),
+            D);
+
+  // The shared preamble stays usable after the file it was built for closes.
+  S.remove(testPath("a.cpp"));
+  S.remove(testPath("b.cpp"));
+  EXPECT_EQ(Open(testPath("f.cpp"), "#include \"foo.h\"\nint d = a;"), A);
+}
+
 // We rebuild if a completely missing header exists, but not if one is added
 // on a higher-priority include path entry (for performance).
 // (Previously we wouldn't automatically rebuild when files were added).
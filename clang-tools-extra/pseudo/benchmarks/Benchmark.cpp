@@ -71,6 +71,15 @@ static void buildSLR(benchmark::State &State) {
 }
 BENCHMARK(buildSLR);
 
+static void deserializeLRTable(benchmark::State &State) {
+  std::string Data = Lang->Table.serialize(Lang->G);
+  for (auto _ : State)
+    LRTable::deserialize(Data, Lang->G);
+  State.SetBytesProcessed(static_cast<uint64_t>(State.iterations()) *
+                          Data.size());
+}
+BENCHMARK(deserializeLRTable);
+
 TokenStream lexAndPreprocess() {
   clang::LangOptions LangOpts = genericLangOpts();
   TokenStream RawStream = pseudo::lex(*SourceText, LangOpts);
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang-pseudo/grammar/Grammar.h"
+#include "clang-pseudo/grammar/LRTable.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
@@ -32,6 +33,7 @@ namespace {
 enum EmitType {
   EmitSymbolList,
   EmitGrammarContent,
+  EmitLRTable,
 };
 
 opt<std::string> Grammar("grammar", desc("Parse a BNF grammar file."),
@@ -41,7 +43,9 @@ opt<EmitType>
          values(clEnumValN(EmitSymbolList, "emit-symbol-list",
                            "Print nonterminal symbols (default)"),
                 clEnumValN(EmitGrammarContent, "emit-grammar-content",
-                           "Print the BNF grammar content as a string")));
+                           "Print the BNF grammar content as a string"),
+                clEnumValN(EmitLRTable, "emit-lr-table",
+                           "Print the serialized LR table as a byte array")));
 
 opt<std::string> OutputFilename("o", init("-"), desc("Output"),
                                 value_desc("file"));
@@ -112,6 +116,17 @@ int main(int argc, char *argv[]) {
       Out.os() << "\"\n";
     }
     break;
+  case EmitLRTable: {
+    std::string Table = clang::pseudo::LRTable::buildSLR(G).serialize(G);
+    for (unsigned I = 0; I < Table.size(); ++I) {
+      Out.os() << static_cast<unsigned>(static_cast<uint8_t>(Table[I]))
+               << ',';
+      if (I % 32 == 31)
+        Out.os() << '\n';
+    }
+    Out.os() << '\n';
+    break;
+  }
   }
 
   Out.keep();
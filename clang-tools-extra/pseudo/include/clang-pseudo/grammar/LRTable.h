@@ -43,6 +43,7 @@
 #include "llvm/Support/Capacity.h"
 #include "llvm/Support/MathExtras.h"
 #include <cstdint>
+#include <limits>
 #include <vector>
 
 namespace clang {
@@ -77,14 +78,15 @@ public:
   // If the nonterminal is invalid here, returns None.
   llvm::Optional<StateID> getGoToState(StateID State,
                                        SymbolID Nonterminal) const {
-    return Gotos.get(gotoIndex(State, Nonterminal, numStates()));
+    assert(isNonterminal(Nonterminal));
+    return Gotos.get(State, Nonterminal);
   }
   // Returns the state after we shift a terminal.
   // Expected to be called by LR parsers.
   // If the terminal is invalid here, returns None.
   llvm::Optional<StateID> getShiftState(StateID State,
                                         SymbolID Terminal) const {
-    return Shifts.get(shiftIndex(State, Terminal, numStates()));
+    return Shifts.get(State, symbolToToken(Terminal));
   }
 
   // Returns the possible reductions from a state.
@@ -136,6 +138,16 @@ public:
   std::string dumpStatistics() const;
   std::string dumpForTests(const Grammar &G) const;
 
+  // Serializes the table built from G into a compact binary form, which is
+  // cheap to load. This allows a table to be computed at build time and
+  // embedded in a binary, instead of being built from the grammar at startup.
+  // A hash of G is recorded along with the table.
+  std::string serialize(const Grammar &G) const;
+  // Loads a table written by serialize(). Returns None if Data is truncated,
+  // was written by another version, or for a grammar other than G.
+  static llvm::Optional<LRTable> deserialize(llvm::StringRef Data,
+                                             const Grammar &G);
+
   // Build a SLR(1) parsing table.
   static LRTable buildSLR(const Grammar &G);
 
@@ -166,87 +178,63 @@ public:
 private:
   unsigned numStates() const { return ReduceOffset.size() - 1; }
 
-  // A map from unsigned key => StateID, used to store actions.
-  // The keys should be sequential but the values are somewhat sparse.
+  // A map from (Row, Column) => StateID, used to store actions.
   //
-  // In practice, the keys encode (origin state, symbol) pairs, and the values
-  // are the state we should move to after seeing that symbol.
+  // In practice, the rows are origin states and the columns are symbols, and
+  // the values are the state we should move to after seeing that symbol.
+  // Each state only has transitions on a few symbols, so the rows are sparse,
+  // and many states have exactly the same transitions.
   //
-  // We store one bit for presence/absence of the value for each key.
-  // At every 64th key, we store the offset into the table of values.
-  //   e.g. key 0x500 is checkpoint 0x500/64 = 20
-  //                     Checkpoints[20] = 34
-  //        get(0x500) = Values[34]                (assuming it has a value)
-  // To look up values in between, we count the set bits:
-  //        get(0x509) has a value if HasValue[20] & (1<<9)
-  //        #values between 0x500 and 0x509: popcnt(HasValue[20] & (1<<9 - 1))
-  //        get(0x509) = Values[34 + popcnt(...)]
+  // The rows are overlaid onto a single array of slots (a "comb vector"):
+  // each distinct row is placed at its own offset, such that its entries land
+  // in slots no other row uses. Each slot records the column it belongs to:
+  //   get(Row, Col) = Slots[RowOffset[Row] + Col].Value
+  //                   if Slots[RowOffset[Row] + Col].Column == Col
+  // As offsets are unique to a row, a slot with the right column belongs to
+  // the right row. Identical rows share an offset. The slots are padded so
+  // that any column of any row is in bounds.
   //
-  // Overall size is 1.25 bits/key + 16 bits/value.
-  // Lookup is constant time with a low factor (no hashing).
+  // Rows are placed densest first, at the first offset that fits. Overall
+  // size is 32 bits/slot; shifts take less than one slot per value, gotos
+  // about 2.5.
+  // Lookup is two dependent loads, and the transitions of a state (which the
+  // parser looks up together) are close to each other in memory.
   class TransitionTable {
-    using Word = uint64_t;
-    constexpr static unsigned WordBits = CHAR_BIT * sizeof(Word);
+    struct Slot {
+      uint16_t Column;
+      StateID Value;
+    };
+    static constexpr uint16_t EmptyColumn =
+        std::numeric_limits<uint16_t>::max();
 
-    std::vector<StateID> Values;
-    std::vector<Word> HasValue;
-    std::vector<uint16_t> Checkpoints;
+    std::vector<uint32_t> RowOffset;
+    std::vector<Slot> Slots;
+    unsigned NumValues = 0;
+
+    friend class LRTable;
 
   public:
     TransitionTable() = default;
-    TransitionTable(const llvm::DenseMap<unsigned, StateID> &Entries,
-                    unsigned NumKeys) {
-      assert(
-          Entries.size() <
-              std::numeric_limits<decltype(Checkpoints)::value_type>::max() &&
-          "16 bits too small for value offsets!");
-      unsigned NumWords = (NumKeys + WordBits - 1) / WordBits;
-      HasValue.resize(NumWords, 0);
-      Checkpoints.reserve(NumWords);
-      Values.reserve(Entries.size());
-      for (unsigned I = 0; I < NumKeys; ++I) {
-        if ((I % WordBits) == 0)
-          Checkpoints.push_back(Values.size());
-        auto It = Entries.find(I);
-        if (It != Entries.end()) {
-          HasValue[I / WordBits] |= (Word(1) << (I % WordBits));
-          Values.push_back(It->second);
-        }
-      }
-    }
+    // Rows[R] lists the (column, value) pairs of row R, sorted by column.
+    TransitionTable(
+        llvm::ArrayRef<std::vector<std::pair<unsigned, StateID>>> Rows,
+        unsigned NumColumns);
 
-    llvm::Optional<StateID> get(unsigned Key) const {
-      // Do we have a value for this key?
-      Word KeyMask = Word(1) << (Key % WordBits);
-      unsigned KeyWord = Key / WordBits;
-      if ((HasValue[KeyWord] & KeyMask) == 0)
+    llvm::Optional<StateID> get(StateID Row, unsigned Col) const {
+      assert(Row < RowOffset.size());
+      const Slot &S = Slots[RowOffset[Row] + Col];
+      if (S.Column != Col)
         return llvm::None;
-      // Count the number of values since the checkpoint.
-      Word BelowKeyMask = KeyMask - 1;
-      unsigned CountSinceCheckpoint =
-          llvm::countPopulation(HasValue[KeyWord] & BelowKeyMask);
-      // Find the value relative to the last checkpoint.
-      return Values[Checkpoints[KeyWord] + CountSinceCheckpoint];
+      return S.Value;
     }
 
-    unsigned size() const { return Values.size(); }
+    unsigned size() const { return NumValues; }
 
     size_t bytes() const {
-      return llvm::capacity_in_bytes(HasValue) +
-             llvm::capacity_in_bytes(Values) +
-             llvm::capacity_in_bytes(Checkpoints);
+      return llvm::capacity_in_bytes(RowOffset) +
+             llvm::capacity_in_bytes(Slots);
     }
   };
-  // Shift and Goto tables are keyed by encoded (State, Symbol).
-  static unsigned shiftIndex(StateID State, SymbolID Terminal,
-                             unsigned NumStates) {
-    return NumStates * symbolToToken(Terminal) + State;
-  }
-  static unsigned gotoIndex(StateID State, SymbolID Nonterminal,
-                            unsigned NumStates) {
-    assert(isNonterminal(Nonterminal));
-    return NumStates * Nonterminal + State;
-  }
   TransitionTable Shifts;
   TransitionTable Gotos;
 
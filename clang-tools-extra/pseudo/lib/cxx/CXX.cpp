@@ -20,6 +20,10 @@ namespace {
 static const char *CXXBNF =
 #include "CXXBNF.inc"
     ;
+// The LR table for CXXBNF, built by clang-pseudo-gen.
+static const unsigned char CXXLRTable[] = {
+#include "CXXLRTable.inc"
+};
 
 bool guardOverride(llvm::ArrayRef<const ForestNode *> RHS,
                    const TokenStream &Tokens) {
@@ -66,10 +70,17 @@ const Language &getLanguage() {
     std::vector<std::string> Diags;
     auto G = Grammar::parseBNF(CXXBNF, Diags);
     assert(Diags.empty());
-    LRTable Table = LRTable::buildSLR(G);
+    // The table is rejected if it wasn't built from CXXBNF, e.g. when only
+    // one of them was regenerated.
+    auto Table = LRTable::deserialize(
+        llvm::StringRef(reinterpret_cast<const char *>(CXXLRTable),
+                        sizeof(CXXLRTable)),
+        G);
+    if (!Table)
+      Table = LRTable::buildSLR(G);
     const Language *PL = new Language{
         std::move(G),
-        std::move(Table),
+        std::move(*Table),
         buildGuards(),
         buildRecoveryStrategies(),
     };
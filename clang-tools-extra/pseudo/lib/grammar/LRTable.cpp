@@ -11,12 +11,102 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/BinaryByteStream.h"
+#include "llvm/Support/BinaryStreamReader.h"
+#include "llvm/Support/BinaryStreamWriter.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <map>
+#include <numeric>
 
 namespace clang {
 namespace pseudo {
 
+LRTable::TransitionTable::TransitionTable(
+    llvm::ArrayRef<std::vector<std::pair<unsigned, StateID>>> Rows,
+    unsigned NumColumns) {
+  assert(NumColumns < EmptyColumn && "too many columns!");
+  RowOffset.assign(Rows.size(), 0);
+
+  // Place the densest rows first: they are the hardest to fit, and the sparse
+  // ones fill the gaps they leave.
+  std::vector<unsigned> Order(Rows.size());
+  std::iota(Order.begin(), Order.end(), 0);
+  llvm::stable_sort(Order, [&](unsigned L, unsigned R) {
+    return Rows[L].size() > Rows[R].size();
+  });
+
+  std::vector<bool> UsedSlot, UsedOffset;
+  auto IsUsed = [](const std::vector<bool> &Used, unsigned I) {
+    return I < Used.size() && Used[I];
+  };
+  auto Use = [](std::vector<bool> &Used, unsigned I) {
+    if (Used.size() <= I)
+      Used.resize(I + 1, false);
+    Used[I] = true;
+  };
+  // Many states have the same transitions, and share a single copy.
+  auto Less = [](const std::vector<std::pair<unsigned, StateID>> *L,
+                 const std::vector<std::pair<unsigned, StateID>> *R) {
+    return *L < *R;
+  };
+  std::map<const std::vector<std::pair<unsigned, StateID>> *, unsigned,
+           decltype(Less)>
+      Placed(Less);
+  unsigned FirstFree = 0;
+  for (unsigned Row : Order) {
+    const auto &Entries = Rows[Row];
+    if (Entries.empty())
+      break;
+    NumValues += Entries.size();
+    auto It = Placed.try_emplace(&Entries, 0);
+    if (!It.second) {
+      RowOffset[Row] = It.first->second;
+      continue;
+    }
+    // Distinct rows need distinct offsets, as slots are checked by column.
+    auto Fits = [&](unsigned Offset) {
+      return !IsUsed(UsedOffset, Offset) &&
+             llvm::none_of(Entries, [&](const auto &E) {
+               return IsUsed(UsedSlot, Offset + E.first);
+             });
+    };
+    // The first entry must land on a free slot, so start looking at the first
+    // free slot.
+    unsigned Offset = FirstFree > Entries.front().first
+                          ? FirstFree - Entries.front().first
+                          : 0;
+    while (!Fits(Offset))
+      ++Offset;
+    RowOffset[Row] = It.first->second = Offset;
+    Use(UsedOffset, Offset);
+    for (const auto &E : Entries)
+      Use(UsedSlot, Offset + E.first);
+    while (IsUsed(UsedSlot, FirstFree))
+      ++FirstFree;
+  }
+
+  // Rows without transitions share an offset no other row uses.
+  unsigned EmptyOffset = 0;
+  while (IsUsed(UsedOffset, EmptyOffset))
+    ++EmptyOffset;
+  for (unsigned Row = 0; Row < Rows.size(); ++Row)
+    if (Rows[Row].empty())
+      RowOffset[Row] = EmptyOffset;
+
+  // Pad so that every column of every row is in bounds.
+  unsigned MaxOffset = 0;
+  for (unsigned Offset : RowOffset)
+    MaxOffset = std::max(MaxOffset, Offset);
+  Slots.assign(std::max<size_t>(UsedSlot.size(), MaxOffset + NumColumns),
+               Slot{EmptyColumn, 0});
+  for (const auto &P : Placed)
+    for (const auto &E : *P.first)
+      Slots[P.second + E.first] = Slot{static_cast<uint16_t>(E.first),
+                                       E.second};
+}
+
 std::string LRTable::dumpStatistics() const {
   return llvm::formatv(R"(
 Statistics of the LR parsing table:
@@ -64,6 +154,136 @@ std::string LRTable::dumpForTests(const Grammar &G) const {
   return OS.str();
 }
 
+// The serialized table is the hash of the grammar it was built from, then a
+// sequence of arrays, each prefixed by its size. All integers are
+// little-endian.
+static constexpr uint32_t SerializationVersion = 2;
+
+// Identifies the grammar a table was built from: its symbols and its rules,
+// including their attributes.
+static uint64_t grammarHash(const Grammar &G) {
+  return llvm::xxHash64(G.dump());
+}
+
+namespace {
+class Writer {
+public:
+  Writer() : Stream(llvm::support::little), W(Stream) {}
+
+  // Appending to a byte stream can't fail.
+  void write(uint32_t V) { llvm::cantFail(W.writeInteger(V)); }
+  void write64(uint64_t V) { llvm::cantFail(W.writeInteger(V)); }
+  template <typename T> void write(const std::vector<T> &Values) {
+    write(Values.size());
+    for (const T &V : Values)
+      writeElement(V);
+  }
+  llvm::StringRef data() { return llvm::toStringRef(Stream.data()); }
+
+private:
+  void writeElement(uint16_t V) { llvm::cantFail(W.writeInteger(V)); }
+  void writeElement(uint32_t V) { llvm::cantFail(W.writeInteger(V)); }
+  template <typename A, typename B>
+  void writeElement(const std::pair<A, B> &P) {
+    writeElement(P.first);
+    writeElement(P.second);
+  }
+
+  llvm::AppendingBinaryByteStream Stream;
+  llvm::BinaryStreamWriter W;
+};
+
+class Reader {
+public:
+  Reader(llvm::StringRef Data) : R(Data, llvm::support::little) {}
+
+  bool read(uint32_t &V) { return readElement(V); }
+  bool read64(uint64_t &V) { return readElement(V); }
+  template <typename T> bool read(std::vector<T> &Values) {
+    uint32_t Size;
+    if (!read(Size) || Size > R.bytesRemaining())
+      return false;
+    Values.resize(Size);
+    for (T &V : Values)
+      if (!readElement(V))
+        return false;
+    return true;
+  }
+  bool done() const { return R.empty(); }
+
+private:
+  template <typename T> bool readElement(T &V) {
+    return !llvm::errorToBool(R.readInteger(V));
+  }
+  template <typename A, typename B> bool readElement(std::pair<A, B> &P) {
+    return readElement(P.first) && readElement(P.second);
+  }
+
+  llvm::BinaryStreamReader R;
+};
+} // namespace
+
+std::string LRTable::serialize(const Grammar &G) const {
+  Writer W;
+  W.write(SerializationVersion);
+  W.write64(grammarHash(G));
+  for (const TransitionTable *T : {&Shifts, &Gotos}) {
+    W.write(T->NumValues);
+    W.write(T->RowOffset);
+    std::vector<std::pair<uint16_t, uint16_t>> Slots;
+    for (const auto &S : T->Slots)
+      Slots.emplace_back(S.Column, S.Value);
+    W.write(Slots);
+  }
+  W.write(StartStates);
+  W.write(ReduceOffset);
+  W.write(Reduces);
+  W.write(FollowSets.size());
+  std::vector<uint32_t> FollowWords((FollowSets.size() + 31) / 32);
+  for (unsigned I : FollowSets.set_bits())
+    FollowWords[I / 32] |= uint32_t(1) << (I % 32);
+  W.write(FollowWords);
+  W.write(RecoveryOffset);
+  std::vector<std::pair<uint16_t, uint16_t>> Recovery;
+  for (const auto &R : Recoveries)
+    Recovery.emplace_back(R.Strategy, R.Result);
+  W.write(Recovery);
+  return W.data().str();
+}
+
+llvm::Optional<LRTable> LRTable::deserialize(llvm::StringRef Data,
+                                             const Grammar &G) {
+  LRTable Table;
+  Reader R(Data);
+  uint32_t Version;
+  uint64_t Hash;
+  if (!R.read(Version) || Version != SerializationVersion || !R.read64(Hash) ||
+      Hash != grammarHash(G))
+    return llvm::None;
+  for (TransitionTable *T : {&Table.Shifts, &Table.Gotos}) {
+    std::vector<std::pair<uint16_t, uint16_t>> Slots;
+    if (!R.read(T->NumValues) || !R.read(T->RowOffset) || !R.read(Slots))
+      return llvm::None;
+    T->Slots.reserve(Slots.size());
+    for (const auto &S : Slots)
+      T->Slots.push_back({S.first, S.second});
+  }
+  uint32_t FollowBits;
+  std::vector<uint32_t> FollowWords;
+  if (!R.read(Table.StartStates) || !R.read(Table.ReduceOffset) ||
+      !R.read(Table.Reduces) || !R.read(FollowBits) || !R.read(FollowWords) ||
+      FollowWords.size() != (FollowBits + 31) / 32)
+    return llvm::None;
+  Table.FollowSets.resize(FollowBits);
+  Table.FollowSets.setBitsInMask(FollowWords.data(), FollowWords.size());
+  std::vector<std::pair<uint16_t, uint16_t>> Recovery;
+  if (!R.read(Table.RecoveryOffset) || !R.read(Recovery) || !R.done())
+    return llvm::None;
+  for (const auto &Rec : Recovery)
+    Table.Recoveries.push_back({Rec.first, Rec.second});
+  return Table;
+}
+
 LRTable::StateID LRTable::getStartState(SymbolID Target) const {
   assert(llvm::is_sorted(StartStates) && "StartStates must be sorted!");
   auto It = llvm::partition_point(
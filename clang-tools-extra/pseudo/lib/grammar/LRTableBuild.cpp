@@ -31,18 +31,20 @@ LRTable LRTable::Builder::build() && {
   Table.StartStates = std::move(StartStates);
 
   // Compile the goto and shift actions into transition tables.
-  llvm::DenseMap<unsigned, SymbolID> Gotos;
-  llvm::DenseMap<unsigned, SymbolID> Shifts;
+  std::vector<std::vector<std::pair<unsigned, StateID>>> Shifts(NumStates);
+  std::vector<std::vector<std::pair<unsigned, StateID>>> Gotos(NumStates);
   for (const auto &E : Transition) {
     if (isToken(E.first.second))
-      Shifts.try_emplace(shiftIndex(E.first.first, E.first.second, NumStates),
-                         E.second);
+      Shifts[E.first.first].emplace_back(symbolToToken(E.first.second),
+                                         E.second);
     else
-      Gotos.try_emplace(gotoIndex(E.first.first, E.first.second, NumStates),
-                        E.second);
+      Gotos[E.first.first].emplace_back(E.first.second, E.second);
   }
-  Table.Shifts = TransitionTable(Shifts, NumStates * NumTerminals);
-  Table.Gotos = TransitionTable(Gotos, NumStates * NumNonterminals);
+  for (auto *Rows : {&Shifts, &Gotos})
+    for (auto &Row : *Rows)
+      llvm::sort(Row);
+  Table.Shifts = TransitionTable(Shifts, NumTerminals);
+  Table.Gotos = TransitionTable(Gotos, NumNonterminals);
 
   // Compile the follow sets into a bitmap.
   Table.FollowSets.resize(tok::NUM_TOKENS * FollowSets.size());
@@ -71,6 +71,42 @@ TEST(LRTable, Builder) {
   EXPECT_FALSE(T.canFollow(Term, Int));
 }
 
+TEST(LRTable, Serialize) {
+  std::vector<std::string> GrammarDiags;
+  Grammar G = Grammar::parseBNF(R"bnf(
+    _ := stmt
+    stmt := expr ;
+    stmt := IDENTIFIER ;
+    expr := term
+    expr := expr + term
+    term := IDENTIFIER
+    term := ( expr )
+  )bnf",
+                                GrammarDiags);
+  EXPECT_THAT(GrammarDiags, testing::IsEmpty());
+  LRTable T = LRTable::buildSLR(G);
+
+  std::string Data = T.serialize(G);
+  llvm::Optional<LRTable> Loaded = LRTable::deserialize(Data, G);
+  ASSERT_TRUE(Loaded.hasValue());
+  EXPECT_EQ(Loaded->dumpForTests(G), T.dumpForTests(G));
+  EXPECT_EQ(Loaded->serialize(G), Data);
+
+  EXPECT_EQ(LRTable::deserialize("", G), llvm::None);
+  EXPECT_EQ(LRTable::deserialize(llvm::StringRef(Data).drop_back(), G),
+            llvm::None);
+
+  // A table built from another grammar is rejected.
+  Grammar Other = Grammar::parseBNF(R"bnf(
+    _ := stmt
+    stmt := expr ;
+    expr := IDENTIFIER
+  )bnf",
+                                    GrammarDiags);
+  EXPECT_THAT(GrammarDiags, testing::IsEmpty());
+  EXPECT_EQ(LRTable::deserialize(Data, Other), llvm::None);
+}
+
 } // namespace
 } // namespace pseudo
 } // namespace clang
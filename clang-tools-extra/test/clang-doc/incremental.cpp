@@ -0,0 +1,22 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: echo 'class A {};' > %t/a.cpp
+// RUN: echo 'class B {};' > %t/b.cpp
+
+// The first run maps both files, and records a TU each in the cache.
+// RUN: clang-doc --format=md --output=%t/docs --incremental-cache=%t/cache %t/a.cpp %t/b.cpp --
+// RUN: ls %t/cache | count 3
+// RUN: FileCheck %s --input-file=%t/docs/GlobalNamespace/A.md --check-prefix=A
+// RUN: FileCheck %s --input-file=%t/docs/GlobalNamespace/B.md --check-prefix=B
+
+// Only the infos of the changed file are written again.
+// RUN: echo 'MARKER' >> %t/docs/GlobalNamespace/A.md
+// RUN: echo 'class B2 {};' > %t/b.cpp
+// RUN: clang-doc --format=md --output=%t/docs --incremental-cache=%t/cache %t/a.cpp %t/b.cpp --
+// RUN: ls %t/cache | count 3
+// RUN: FileCheck %s --input-file=%t/docs/GlobalNamespace/A.md --check-prefixes=A,KEPT
+// RUN: FileCheck %s --input-file=%t/docs/GlobalNamespace/B2.md --check-prefix=B2
+
+// A: # class A
+// KEPT: MARKER
+// B: # class B
+// B2: # class B2
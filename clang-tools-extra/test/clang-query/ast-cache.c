@@ -0,0 +1,38 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: sed -e 's/NAME/foo/' %s > %t/input.c
+
+// The first run builds the AST and saves it.
+// RUN: clang-query -ast-cache=%t/cache -c "match functionDecl()" %t/input.c -- 2>&1 \
+// RUN:   | FileCheck %s --check-prefixes=BUILT,FOO
+// RUN: ls %t/cache | count 1
+
+// The second run loads it, so the warning isn't reported again.
+// RUN: clang-query -ast-cache=%t/cache -c "match functionDecl()" %t/input.c -- 2>&1 \
+// RUN:   | FileCheck %s --check-prefixes=CACHED,FOO
+// RUN: ls %t/cache | count 1
+
+// Editing the file makes the cached AST stale.
+// RUN: sed -e 's/NAME/bar/' %s > %t/input.c
+// RUN: clang-query -ast-cache=%t/cache -c "match functionDecl()" %t/input.c -- 2>&1 \
+// RUN:   | FileCheck %s --check-prefixes=BUILT,BAR
+// RUN: ls %t/cache | count 2
+
+// ASTs with errors aren't saved, so the errors are reported on every run.
+// RUN: clang-query -ast-cache=%t/cache -c "match functionDecl()" %t/input.c -- -DBROKEN 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=ERROR
+// RUN: clang-query -ast-cache=%t/cache -c "match functionDecl()" %t/input.c -- -DBROKEN 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=ERROR
+// RUN: ls %t/cache | count 2
+
+#warning "building"
+// BUILT: warning: "building"
+// CACHED-NOT: warning:
+
+void NAME(void) {}
+// FOO: input.c:[[@LINE-1]]:1: note: "root" binds here
+// BAR: input.c:[[@LINE-2]]:1: note: "root" binds here
+
+#ifdef BROKEN
+int broken = undeclared;
+// ERROR: error: use of undeclared identifier 'undeclared'
+#endif
@@ -0,0 +1 @@
+inline int inHeader() { return undeclared; }
@@ -0,0 +1,5 @@
+inline int header() {
+  int x = 1;
+  x = 2;
+  return 0;
+}
@@ -0,0 +1,42 @@
+// RUN: printf '%%s\n%%s\n%%s\n' '-line-filter=[{"name":"%s","lines":[[6,6]]}]' '-line-filter=[{"name":"%s","lines":[[12,12]]}]' '%s' \
+// RUN:   | clang-tidy -batch -checks='-*,google-explicit-constructor' -- 2>&1 \
+// RUN:   | FileCheck %s
+
+class A { A(int); };
+class B { B(int); };
+// CHECK-NOT: warning
+// CHECK: :[[@LINE-2]]:11: warning: single-argument constructors {{.*}}
+// CHECK-NOT: warning
+// CHECK: --- clang-tidy: end of job ---
+
+class C { C(int); };
+// CHECK-NOT: warning
+// CHECK: :[[@LINE-2]]:11: warning: single-argument constructors {{.*}}
+// CHECK-NOT: warning
+// CHECK: --- clang-tidy: end of job ---
+
+// A file without a line filter.
+// CHECK: :5:11: warning: single-argument constructors {{.*}}
+// CHECK: :6:11: warning: single-argument constructors {{.*}}
+// CHECK: :12:11: warning: single-argument constructors {{.*}}
+// CHECK: --- clang-tidy: end of job ---
+
+// Each job's fixes are written to their own file as soon as it is done.
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: printf '%%s\n%%s\n' '-line-filter=[{"name":"%s","lines":[[6,6]]}]' '-line-filter=[{"name":"%s","lines":[[12,12]]}]' \
+// RUN:   | clang-tidy -batch -checks='-*,google-explicit-constructor' -export-fixes=%t/fixes.yaml -- > /dev/null 2>&1
+// RUN: FileCheck -input-file=%t/fixes-1.yaml -check-prefix=FIXES1 %s
+// RUN: FileCheck -input-file=%t/fixes-2.yaml -check-prefix=FIXES2 %s
+// FIXES1: DiagnosticName: google-explicit-constructor
+// FIXES1: Message: single-argument constructors must be marked explicit to avoid unintentional implicit conversions
+// FIXES1-NOT: DiagnosticName
+// FIXES2: DiagnosticName: google-explicit-constructor
+// FIXES2-NOT: DiagnosticName
+
+// A job that finds compiler errors is reported as failed.
+// RUN: echo 'int x = ;' > %t/error.cpp
+// RUN: echo %t/error.cpp | not clang-tidy -batch -checks='-*,google-explicit-constructor' -- 2>&1 \
+// RUN:   | FileCheck -check-prefix=FAILED %s
+// FAILED: error: expected expression [clang-diagnostic-error]
+// FAILED: --- clang-tidy: job failed ---
+// FAILED-NEXT: --- clang-tidy: end of job ---
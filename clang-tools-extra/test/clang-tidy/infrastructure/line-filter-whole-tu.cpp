@@ -0,0 +1,20 @@
+// RUN: clang-tidy -checks='-*,google-explicit-constructor,misc-unused-using-decls' -line-filter='[{"name":"line-filter-whole-tu.cpp","lines":[[10,14]]}]' %s -- 2>&1 | FileCheck %s
+
+namespace n {
+void used();
+void unused();
+} // namespace n
+
+// Only the using declarations are in the line filter, not their uses. Checks
+// that need the whole translation unit still see them.
+using n::used;
+using n::unused;
+// CHECK: :[[@LINE-1]]:10: warning: using decl 'unused' is unused
+class A { A(int); };
+// CHECK: :[[@LINE-1]]:11: warning: single-argument constructors
+
+void f() { used(); }
+class B { B(int); };
+
+// CHECK-NOT: warning:
+// CHECK-NOT: Suppressed
@@ -24,4 +24,5 @@ class C { C(int); };
 
 // CHECK-NOT: warning:
 
-// CHECK: Suppressed 3 warnings (1 in non-user code, 2 due to line filter)
+// Declarations outside of the line filter are not analyzed at all.
+// CHECK: Suppressed 1 warnings (1 in non-user code)
@@ -0,0 +1,18 @@
+// RUN: clang-tidy -checks='-*,readability-duplicate-include' %s -- -I %S/../checkers/readability/Inputs/duplicate-include 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=PP-ONLY --implicit-check-not=error
+// RUN: not clang-tidy -checks='-*,readability-duplicate-include,readability-else-after-return' %s -- -I %S/../checkers/readability/Inputs/duplicate-include 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=PARSED
+// RUN: not clang-tidy -checks='-*,readability-duplicate-include,clang-diagnostic-unused-variable' %s -- -I %S/../checkers/readability/Inputs/duplicate-include 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=PARSED
+
+// When all the enabled checks only need the preprocessor, the translation unit
+// isn't parsed, so its semantic errors go unnoticed. Enabling a compiler
+// warning as a check needs the parse.
+
+#include "duplicate-include.h"
+#include "duplicate-include.h"
+// PP-ONLY: :[[@LINE-1]]:1: warning: duplicate include [readability-duplicate-include]
+// PARSED: :[[@LINE-2]]:1: warning: duplicate include [readability-duplicate-include]
+
+int x = undeclared;
+// PARSED: :[[@LINE-1]]:9: error: use of undeclared identifier 'undeclared'
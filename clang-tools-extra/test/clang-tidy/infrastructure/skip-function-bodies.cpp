@@ -0,0 +1,19 @@
+// RUN: clang-tidy -checks='-*,llvm-namespace-comment' %s -- 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=SKIPPED --implicit-check-not=error
+// RUN: not clang-tidy -checks='-*,llvm-namespace-comment,readability-else-after-return' %s -- 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=PARSED
+// RUN: not clang-tidy -checks='-*,llvm-namespace-comment,clang-diagnostic-unused-variable' %s -- 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=PARSED
+
+// When no enabled check needs function bodies, they aren't parsed, so their
+// semantic errors go unnoticed. Enabling a compiler warning as a check needs
+// the bodies.
+
+namespace n {
+void f() {
+  int x = undeclared;
+  // PARSED: :[[@LINE-1]]:11: error: use of undeclared identifier 'undeclared'
+}
+}
+// SKIPPED: :[[@LINE-1]]:1: warning: namespace 'n' not terminated with a closing comment [llvm-namespace-comment]
+// PARSED: :[[@LINE-2]]:1: warning: namespace 'n' not terminated with a closing comment [llvm-namespace-comment]
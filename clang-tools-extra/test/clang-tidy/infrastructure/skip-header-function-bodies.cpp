@@ -0,0 +1,21 @@
+// RUN: clang-tidy -checks='-*,readability-else-after-return' -skip-header-function-bodies %s -- -I %S/Inputs/skip-header-function-bodies 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=SKIPPED --implicit-check-not=error
+// RUN: not clang-tidy -checks='-*,readability-else-after-return' -skip-header-function-bodies -header-filter=header.h %s -- -I %S/Inputs/skip-header-function-bodies 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=PARSED
+// RUN: not clang-tidy -checks='-*,readability-else-after-return,misc-no-recursion' -skip-header-function-bodies %s -- -I %S/Inputs/skip-header-function-bodies 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=PARSED
+
+// With -skip-header-function-bodies, the bodies of the functions in headers
+// that don't pass the header filter aren't parsed, unless a check needs them,
+// so their semantic errors go unnoticed.
+
+#include "header.h"
+// PARSED: header.h:1:32: error: use of undeclared identifier 'undeclared'
+
+int f(int X) {
+  if (X)
+    return 1;
+  else
+    return inHeader();
+  // SKIPPED: :[[@LINE-2]]:3: warning: do not use 'else' after 'return' [readability-else-after-return]
+}
@@ -0,0 +1,30 @@
+// REQUIRES: static-analyzer
+// RUN: clang-tidy %s -checks='-*,clang-analyzer-deadcode.DeadStores' -- -I %S/Inputs/static-analyzer-filters 2>&1 | FileCheck --check-prefix=CHECK-MAIN -implicit-check-not='{{warning:|Suppressed}}' %s
+// RUN: clang-tidy %s -checks='-*,clang-analyzer-deadcode.DeadStores' -header-filter='header\.h' -- -I %S/Inputs/static-analyzer-filters 2>&1 | FileCheck --check-prefixes=CHECK-MAIN,CHECK-HEADER %s
+// RUN: clang-tidy %s -checks='-*,clang-analyzer-deadcode.DeadStores' -line-filter='[{"name":"static-analyzer-filters.cpp","lines":[[22,22]]}]' -- -I %S/Inputs/static-analyzer-filters 2>&1 | FileCheck --check-prefix=CHECK-LINE -implicit-check-not='{{warning:|Suppressed}}' %s
+// RUN: clang-tidy %s -checks='-*,clang-analyzer-deadcode.DeadStores' -enable-check-profile -- -I %S/Inputs/static-analyzer-filters 2>&1 | FileCheck --check-prefix=CHECK-PROFILE %s
+// RUN: clang-tidy %s -checks='-*,clang-analyzer-deadcode.DeadStores' -config='{CheckOptions: [{key: clang-analyzer-max-nodes, value: many}]}' -- -I %S/Inputs/static-analyzer-filters 2>&1 | FileCheck --check-prefix=CHECK-CONFIG %s
+
+#include "header.h"
+
+// Functions in headers that don't pass the header filter aren't analyzed, so
+// their reports aren't even suppressed.
+// CHECK-HEADER: header.h:3:3: warning: Value stored to 'x' is never read [clang-analyzer-deadcode.DeadStores]
+
+void f() {
+  int y = 1;
+  y = 2;
+}
+// CHECK-MAIN: :[[@LINE-2]]:3: warning: Value stored to 'y' is never read [clang-analyzer-deadcode.DeadStores]
+
+void g() {
+  int z = 1;
+  z = 2;
+}
+// CHECK-MAIN: :[[@LINE-2]]:3: warning: Value stored to 'z' is never read [clang-analyzer-deadcode.DeadStores]
+// CHECK-LINE: :[[@LINE-3]]:3: warning: Value stored to 'z' is never read [clang-analyzer-deadcode.DeadStores]
+
+// CHECK-PROFILE-DAG: {{.*}}  clang-analyzer: f()
+// CHECK-PROFILE-DAG: {{.*}}  clang-analyzer: g()
+
+// CHECK-CONFIG: warning: invalid configuration value 'many' for option 'clang-analyzer-max-nodes' [clang-tidy-config]
@@ -0,0 +1,47 @@
+//===-- clang-doc/BitcodeShardsTest.cpp -----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "BitcodeShards.h"
+#include "llvm/ADT/StringMap.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace doc {
+
+TEST(BitcodeShardsTest, GroupsByKey) {
+  auto Shards = BitcodeShards::create(3);
+  ASSERT_TRUE(bool(Shards)) << llvm::toString(Shards.takeError());
+  ASSERT_EQ((*Shards)->size(), 3u);
+
+  (*Shards)->add("A", "one");
+  (*Shards)->add("B", "two");
+  (*Shards)->add("A", llvm::StringRef("th\0ree", 6));
+  (*Shards)->add("C", "");
+  ASSERT_FALSE(bool((*Shards)->finish()));
+
+  llvm::StringMap<std::vector<std::string>> Groups;
+  for (unsigned I = 0; I < (*Shards)->size(); ++I) {
+    auto Err = (*Shards)->forEachGroup(
+        I, [&](llvm::StringRef Key, llvm::ArrayRef<llvm::StringRef> Bitcode) {
+          EXPECT_EQ(Groups.count(Key), 0u) << Key << " is in several shards";
+          auto &Group = Groups[Key];
+          for (llvm::StringRef B : Bitcode)
+            Group.push_back(B.str());
+        });
+    ASSERT_FALSE(bool(Err));
+  }
+
+  ASSERT_EQ(Groups.size(), 3u);
+  EXPECT_EQ(Groups["A"],
+            (std::vector<std::string>{"one", std::string("th\0ree", 6)}));
+  EXPECT_EQ(Groups["B"], std::vector<std::string>{"two"});
+  EXPECT_EQ(Groups["C"], std::vector<std::string>{""});
+}
+
+} // namespace doc
+} // namespace clang
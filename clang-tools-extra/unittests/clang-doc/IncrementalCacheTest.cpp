@@ -0,0 +1,147 @@
+//===-- clang-doc/IncrementalCacheTest.cpp --------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "IncrementalCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace doc {
+
+class IncrementalCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("clang-doc-cache", Dir));
+    Header = Dir;
+    llvm::sys::path::append(Header, "header.h");
+    Missing = Dir;
+    llvm::sys::path::append(Missing, "missing.h");
+    writeHeader("int x;");
+  }
+  void TearDown() override { llvm::sys::fs::remove_directories(Dir); }
+
+  void writeHeader(llvm::StringRef Contents) {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Header, EC);
+    ASSERT_FALSE(EC);
+    OS << Contents;
+    HeaderHash = IncrementalCache::hashContents(Contents);
+  }
+
+  std::unique_ptr<IncrementalCache> open(llvm::StringRef Config = "config") {
+    llvm::SmallString<128> CacheDir(Dir);
+    llvm::sys::path::append(CacheDir, "cache");
+    auto Cache = IncrementalCache::open(CacheDir, Config);
+    EXPECT_TRUE(bool(Cache)) << llvm::toString(Cache.takeError());
+    return Cache ? std::move(*Cache) : nullptr;
+  }
+
+  void store(IncrementalCache &Cache, llvm::StringRef Command = "command") {
+    Cache.store("main.cpp", Command, {{std::string(Header.str()), HeaderHash}},
+                {std::string(Missing.str())},
+                {{"A", "bitcode-a"}, {"B", "bitcode-b"}});
+  }
+
+  std::vector<std::pair<std::string, std::string>>
+  replay(IncrementalCache &Cache, llvm::StringRef Command = "command") {
+    std::vector<std::pair<std::string, std::string>> Results;
+    bool Replayed =
+        Cache.replay("main.cpp", Command,
+                     [&](llvm::StringRef Key, llvm::StringRef Bitcode) {
+                       Results.emplace_back(Key.str(), Bitcode.str());
+                     });
+    EXPECT_EQ(Replayed, !Results.empty());
+    return Results;
+  }
+
+  llvm::SmallString<128> Dir;
+  llvm::SmallString<128> Header;
+  // A header the TU looked up but didn't find.
+  llvm::SmallString<128> Missing;
+  uint64_t HeaderHash;
+};
+
+TEST_F(IncrementalCacheTest, Replay) {
+  auto Cache = open();
+  EXPECT_TRUE(replay(*Cache).empty());
+  EXPECT_TRUE(Cache->isAffected("A"));
+  store(*Cache);
+
+  Cache = open();
+  std::vector<std::pair<std::string, std::string>> Expected = {
+      {"A", "bitcode-a"}, {"B", "bitcode-b"}};
+  EXPECT_EQ(replay(*Cache), Expected);
+  ASSERT_FALSE(bool(Cache->finish()));
+  EXPECT_FALSE(Cache->isAffected("A"));
+  EXPECT_FALSE(Cache->isAffected("B"));
+}
+
+TEST_F(IncrementalCacheTest, Invalidation) {
+  store(*open());
+
+  // A different command: the TU recorded with the old one is gone.
+  auto Cache = open();
+  EXPECT_TRUE(replay(*Cache, "other command").empty());
+  ASSERT_FALSE(bool(Cache->finish()));
+  EXPECT_TRUE(Cache->isAffected("A"));
+  EXPECT_FALSE(Cache->isAffected("C"));
+
+  // A changed dependency.
+  store(*open());
+  writeHeader("int y;");
+  Cache = open();
+  EXPECT_TRUE(replay(*Cache).empty());
+  EXPECT_TRUE(Cache->isAffected("B"));
+
+  // A file that the TU didn't find was created.
+  store(*open());
+  {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Missing, EC);
+    ASSERT_FALSE(EC);
+  }
+  Cache = open();
+  EXPECT_TRUE(replay(*Cache).empty());
+  EXPECT_TRUE(Cache->isAffected("A"));
+
+  // Other options.
+  store(*open());
+  Cache = open("other config");
+  EXPECT_TRUE(replay(*Cache).empty());
+  EXPECT_TRUE(Cache->isAffected("C"));
+}
+
+TEST_F(IncrementalCacheTest, SeveralCommands) {
+  // A file compiled with two commands has a TU for each.
+  auto Cache = open();
+  store(*Cache, "command");
+  store(*Cache, "other command");
+  Cache = open();
+  EXPECT_FALSE(replay(*Cache, "command").empty());
+  EXPECT_FALSE(replay(*Cache, "other command").empty());
+  ASSERT_FALSE(bool(Cache->finish()));
+  EXPECT_FALSE(Cache->isAffected("A"));
+}
+
+TEST_F(IncrementalCacheTest, RemovedTU) {
+  store(*open());
+
+  // The TU isn't part of this run, so its infos are affected and it is
+  // forgotten.
+  auto Cache = open();
+  ASSERT_FALSE(bool(Cache->finish()));
+  EXPECT_TRUE(Cache->isAffected("A"));
+  EXPECT_FALSE(Cache->isAffected("C"));
+  EXPECT_TRUE(replay(*open()).empty());
+}
+
+} // namespace doc
+} // namespace clang
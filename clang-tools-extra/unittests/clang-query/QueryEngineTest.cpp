@@ -159,3 +159,23 @@ TEST_F(QueryEngineTest, LetAndMatch) {
             "1:10: Value not found: x\n", OS.str());
   Str.clear();
 }
+
+TEST_F(QueryEngineTest, ParallelMatch) {
+  DynTypedMatcher FnMatcher = functionDecl();
+  EXPECT_TRUE(EnableOutputQuery(&QuerySession::PrintOutput).run(OS, S));
+  EXPECT_TRUE(MatchQuery("functionDecl()", FnMatcher).run(OS, S));
+  std::string Serial = OS.str();
+  Str.clear();
+
+  // Matching the ASTs concurrently gives the same output, in the same order.
+  S.Jobs = 2;
+  EXPECT_TRUE(MatchQuery("functionDecl()", FnMatcher).run(OS, S));
+  EXPECT_EQ(Serial, OS.str());
+  EXPECT_LT(OS.str().find("foo.cc:1:1"), OS.str().find("bar.cc:1:1"));
+  EXPECT_TRUE(OS.str().find("Match #4:") != std::string::npos);
+  Str.clear();
+
+  DynTypedMatcher NotTopLevel = templateArgument();
+  EXPECT_FALSE(MatchQuery("templateArgument()", NotTopLevel).run(OS, S));
+  EXPECT_EQ("Not a valid top-level matcher.\n", OS.str());
+}
@@ -0,0 +1,85 @@
+#include "ClangTidy.h"
+#include "ClangTidyDiagnosticConsumer.h"
+#include "ClangTidyOptions.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace tidy {
+namespace test {
+namespace {
+
+class ApplyFixesTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("clang-tidy-fixes", Dir));
+    File = Dir;
+    llvm::sys::path::append(File, "file.cpp");
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(File, EC);
+    ASSERT_FALSE(EC);
+    OS << "int a; int b;\n";
+  }
+  void TearDown() override { llvm::sys::fs::remove_directories(Dir); }
+
+  // A warning with a fix replacing Length bytes at Offset of the file.
+  ClangTidyError error(unsigned Offset, unsigned Length, StringRef Text) {
+    ClangTidyError Error("test-check", ClangTidyError::Warning, "",
+                         /*IsWarningAsError=*/false);
+    Error.Message.Message = "warning";
+    Error.Message.FilePath = std::string(File.str());
+    Error.Message.FileOffset = Offset;
+    tooling::Replacement R(File, Offset, Length, Text);
+    EXPECT_FALSE(bool(Error.Message.Fix[File].add(R)));
+    return Error;
+  }
+
+  // Applies the fixes of Errors, and returns what clang-tidy reported.
+  std::string applyFixes(llvm::ArrayRef<ClangTidyError> Errors) {
+    ClangTidyContext Context(std::make_unique<DefaultOptionsProvider>(
+        ClangTidyGlobalOptions(), ClangTidyOptions::getDefaults()));
+    unsigned WarningsAsErrors = 0;
+    testing::internal::CaptureStderr();
+    handleErrors(Errors, Context, FB_Fix, WarningsAsErrors,
+                 llvm::vfs::getRealFileSystem());
+    return testing::internal::GetCapturedStderr();
+  }
+
+  std::string contents() {
+    auto Buffer = llvm::MemoryBuffer::getFile(File);
+    return Buffer ? (*Buffer)->getBuffer().str() : "<error>";
+  }
+
+  llvm::SmallString<128> Dir;
+  llvm::SmallString<128> File;
+};
+
+TEST_F(ApplyFixesTest, AppliesFixes) {
+  std::string Output = applyFixes({error(0, 3, "long"), error(7, 3, "long")});
+  EXPECT_EQ(contents(), "long a; long b;\n");
+  EXPECT_NE(Output.find("applied 2 of 2 suggested fixes"), std::string::npos)
+      << Output;
+}
+
+TEST_F(ApplyFixesTest, ConflictingFixes) {
+  // The second fix conflicts with the first one, the last one no longer fits
+  // in the file: the others are still applied.
+  std::string Output =
+      applyFixes({error(0, 3, "long"), error(0, 3, "char"),
+                  error(7, 3, "long"), error(12, 5, "")});
+  EXPECT_EQ(contents(), "long a; long b;\n");
+  EXPECT_NE(Output.find("Can't resolve conflict"), std::string::npos)
+      << Output;
+  EXPECT_NE(Output.find("applied 2 of 4 suggested fixes"), std::string::npos)
+      << Output;
+}
+
+} // namespace
+} // namespace test
+} // namespace tidy
+} // namespace clang
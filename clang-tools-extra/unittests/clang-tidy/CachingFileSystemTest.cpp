@@ -0,0 +1,153 @@
+#include "CachingFileSystem.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace tidy {
+namespace {
+
+class CountingFileSystem : public llvm::vfs::ProxyFileSystem {
+public:
+  CountingFileSystem(llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS)
+      : ProxyFileSystem(std::move(FS)) {}
+
+  llvm::ErrorOr<llvm::vfs::Status> status(const llvm::Twine &Path) override {
+    ++Accesses;
+    if (Failure)
+      return Failure;
+    return ProxyFileSystem::status(Path);
+  }
+  llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+  openFileForRead(const llvm::Twine &Path) override {
+    ++Accesses;
+    if (Failure)
+      return Failure;
+    return ProxyFileSystem::openFileForRead(Path);
+  }
+
+  unsigned Accesses = 0;
+  // If set, every access fails with this error.
+  std::error_code Failure;
+};
+
+class CachingFileSystemTest : public ::testing::Test {
+protected:
+  CachingFileSystemTest()
+      : MemFS(new llvm::vfs::InMemoryFileSystem),
+        CountingFS(new CountingFileSystem(MemFS)),
+        FS(new CachingFileSystem(CountingFS)) {
+    MemFS->setCurrentWorkingDirectory("/src");
+    MemFS->addFile("/src/a.h", 0, llvm::MemoryBuffer::getMemBuffer("int a;"));
+    MemFS->addFile("/inc/b.h", 0, llvm::MemoryBuffer::getMemBuffer("int b;"));
+  }
+
+  std::string read(const llvm::Twine &Path) {
+    auto File = FS->openFileForRead(Path);
+    if (!File)
+      return "<error>";
+    auto Buffer = (*File)->getBuffer(Path);
+    return Buffer ? (*Buffer)->getBuffer().str() : "<error>";
+  }
+
+  llvm::IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> MemFS;
+  llvm::IntrusiveRefCntPtr<CountingFileSystem> CountingFS;
+  llvm::IntrusiveRefCntPtr<CachingFileSystem> FS;
+};
+
+TEST_F(CachingFileSystemTest, CachesStatus) {
+  EXPECT_TRUE(FS->status("/src/a.h"));
+  EXPECT_FALSE(FS->status("/src/.clang-tidy"));
+  EXPECT_EQ(CountingFS->Accesses, 2u);
+
+  auto Status = FS->status("a.h");
+  ASSERT_TRUE(Status);
+  EXPECT_EQ(Status->getName(), "a.h");
+  EXPECT_FALSE(FS->status("./.clang-tidy"));
+  EXPECT_EQ(CountingFS->Accesses, 2u);
+
+  CachingFileSystem::Statistics Stats = FS->getStatistics();
+  EXPECT_EQ(Stats.StatHits, 2u);
+  EXPECT_EQ(Stats.StatMisses, 2u);
+}
+
+TEST_F(CachingFileSystemTest, CachesContents) {
+  EXPECT_EQ(read("/src/a.h"), "int a;");
+  EXPECT_EQ(read("/src/missing.h"), "<error>");
+  EXPECT_EQ(CountingFS->Accesses, 2u);
+
+  // The contents are kept from the second read on.
+  EXPECT_EQ(read("a.h"), "int a;");
+  EXPECT_EQ(read("/src/missing.h"), "<error>");
+  EXPECT_TRUE(FS->status("/src/a.h"));
+  EXPECT_EQ(CountingFS->Accesses, 3u);
+
+  EXPECT_EQ(read("/src/a.h"), "int a;");
+  EXPECT_EQ(CountingFS->Accesses, 3u);
+
+  CachingFileSystem::Statistics Stats = FS->getStatistics();
+  EXPECT_EQ(Stats.ReadHits, 2u);
+  EXPECT_EQ(Stats.ReadMisses, 3u);
+}
+
+TEST_F(CachingFileSystemTest, ContentsSizeLimit) {
+  FS = new CachingFileSystem(CountingFS, /*MaxContentsSize=*/4);
+  for (int I = 0; I < 3; ++I)
+    EXPECT_EQ(read("/src/a.h"), "int a;");
+  EXPECT_EQ(CountingFS->Accesses, 3u);
+}
+
+TEST_F(CachingFileSystemTest, ScannedDirectories) {
+  FS->scanDirectory("/inc");
+  EXPECT_FALSE(FS->status("/inc/a.h"));
+  EXPECT_EQ(read("/inc/a.h"), "<error>");
+  EXPECT_EQ(CountingFS->Accesses, 0u);
+
+  EXPECT_EQ(read("/inc/b.h"), "int b;");
+  EXPECT_EQ(CountingFS->Accesses, 1u);
+}
+
+TEST_F(CachingFileSystemTest, Invalidate) {
+  EXPECT_EQ(read("/src/a.h"), "int a;");
+  auto File = FS->openFileForRead("/src/a.h");
+  ASSERT_TRUE(File);
+
+  MemFS->addFile("/src/c.h", 0, llvm::MemoryBuffer::getMemBuffer("int c;"));
+  FS->invalidate();
+  EXPECT_EQ(read("/src/c.h"), "int c;");
+  EXPECT_EQ(read("/src/a.h"), "int a;");
+  EXPECT_EQ(CountingFS->Accesses, 4u);
+
+  // Files opened before stay valid.
+  auto Buffer = (*File)->getBuffer("/src/a.h");
+  ASSERT_TRUE(Buffer);
+  EXPECT_EQ((*Buffer)->getBuffer(), "int a;");
+}
+
+TEST_F(CachingFileSystemTest, InvalidateFile) {
+  EXPECT_EQ(read("/src/a.h"), "int a;");
+  EXPECT_EQ(read("/src/a.h"), "int a;");
+  EXPECT_EQ(read("/inc/b.h"), "int b;");
+  EXPECT_EQ(CountingFS->Accesses, 3u);
+
+  FS->invalidate("/src/a.h");
+  EXPECT_EQ(read("/src/a.h"), "int a;");
+  EXPECT_EQ(CountingFS->Accesses, 4u);
+  // The other files are still cached.
+  EXPECT_TRUE(FS->status("/inc/b.h"));
+  EXPECT_EQ(CountingFS->Accesses, 4u);
+}
+
+TEST_F(CachingFileSystemTest, TransientErrorsAreNotCached) {
+  CountingFS->Failure = std::make_error_code(std::errc::permission_denied);
+  EXPECT_FALSE(FS->status("/src/a.h"));
+  EXPECT_EQ(read("/inc/b.h"), "<error>");
+  EXPECT_EQ(CountingFS->Accesses, 2u);
+
+  CountingFS->Failure = std::error_code();
+  EXPECT_TRUE(FS->status("/src/a.h"));
+  EXPECT_EQ(read("/inc/b.h"), "int b;");
+  EXPECT_EQ(CountingFS->Accesses, 4u);
+}
+
+} // namespace
+} // namespace tidy
+} // namespace clang
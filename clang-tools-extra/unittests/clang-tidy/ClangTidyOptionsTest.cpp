@@ -122,6 +122,7 @@ TEST(ParseConfiguration, MergeConfigurations) {
       ExtraArgs: ['arg3', 'arg4']
       ExtraArgsBefore: ['arg-before3', 'arg-before4']
       UseColor: true
+      SkipHeaderFunctionBodies: true
   )",
                                                "Options2"));
   ASSERT_TRUE(!!Options2);
@@ -138,6 +139,8 @@ TEST(ParseConfiguration, MergeConfigurations) {
                        Options.ExtraArgsBefore->end(), ","));
   ASSERT_TRUE(Options.UseColor.hasValue());
   EXPECT_TRUE(*Options.UseColor);
+  ASSERT_TRUE(Options.SkipHeaderFunctionBodies.hasValue());
+  EXPECT_TRUE(*Options.SkipHeaderFunctionBodies);
 }
 
 namespace {
@@ -44,6 +44,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Timer.h"
+#include <functional>
 
 namespace clang {
 
@@ -138,9 +139,23 @@ public:
     ///
     /// It prints a report after match.
     llvm::Optional<Profiling> CheckProfiling;
+
+    /// Limits the traversal of matchAST().
+    ///
+    /// Declarations for which this returns false are neither matched nor
+    /// traversed. Unlike ASTContext's traversal scope, this doesn't affect the
+    /// parent map, so matchers on ancestors still see the whole AST.
+    std::function<bool(const Decl &)> TraversalFilter;
+
+    /// Don't traverse implicit template instantiations in matchAST().
+    ///
+    /// Only the templates as written are matched, as if every matcher was
+    /// wrapped in \c unless(isInTemplateInstantiation()).
+    bool IgnoreTemplateInstantiations = false;
   };
 
-  MatchFinder(MatchFinderOptions Options = MatchFinderOptions());
+  MatchFinder();
+  MatchFinder(MatchFinderOptions Options);
   ~MatchFinder();
 
   /// Adds a matcher to execute when running over the AST.
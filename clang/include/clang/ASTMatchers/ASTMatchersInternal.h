@@ -333,6 +333,7 @@ private:
 };
 
 class ASTMatchFinder;
+class DynTypedMatcher;
 
 /// Generic interface for all matchers.
 ///
@@ -354,6 +355,20 @@ public:
   virtual llvm::Optional<clang::TraversalKind> TraversalKind() const {
     return llvm::None;
   }
+
+  /// Returns true if the matcher only inspects the node it is given: it
+  /// doesn't look at other nodes, bind nodes or change the traversal kind.
+  ///
+  /// Such matchers are cheap, and allOf() evaluates them first.
+  virtual bool isSingleNodeMatcher() const { return false; }
+
+  /// Returns the operands if this is an allOf() matcher, so that nested
+  /// allOf()s can be flattened.
+  virtual ArrayRef<DynTypedMatcher> allOfOperands() const { return None; }
+
+  /// Returns the operands if this is an anyOf() matcher, so that nested
+  /// anyOf()s can be flattened.
+  virtual ArrayRef<DynTypedMatcher> anyOfOperands() const { return None; }
 };
 
 /// Generic interface for matchers on an AST node of type T.
@@ -390,6 +405,8 @@ public:
   /// A subclass must implement this instead of Matches().
   virtual bool matchesNode(const T &Node) const = 0;
 
+  bool isSingleNodeMatcher() const override { return true; }
+
 private:
   /// Implements MatcherInterface::Matches.
   bool matches(const T &Node,
@@ -541,12 +558,23 @@ public:
     return Implementation->TraversalKind();
   }
 
+  /// Returns true if the matcher only inspects the node it is given.
+  /// See DynMatcherInterface::isSingleNodeMatcher().
+  bool isSingleNodeMatcher() const {
+    return Implementation->isSingleNodeMatcher();
+  }
+
 private:
   DynTypedMatcher(ASTNodeKind SupportedKind, ASTNodeKind RestrictKind,
                   IntrusiveRefCntPtr<DynMatcherInterface> Implementation)
       : SupportedKind(SupportedKind), RestrictKind(RestrictKind),
         Implementation(std::move(Implementation)) {}
 
+  /// Replaces the elements of \p InnerMatchers that are themselves \p Op
+  /// (allOf() or anyOf()) by their operands.
+  static void flattenOperands(VariadicOperator Op,
+                              std::vector<DynTypedMatcher> &InnerMatchers);
+
   bool AllowBind = false;
   ASTNodeKind SupportedKind;
 
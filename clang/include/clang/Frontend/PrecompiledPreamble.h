@@ -26,6 +26,7 @@
 namespace llvm {
 class MemoryBuffer;
 class MemoryBufferRef;
+class raw_ostream;
 namespace vfs {
 class FileSystem;
 }
@@ -102,6 +103,16 @@ public:
     return {PreambleBytes.data(), PreambleBytes.size()};
   }
 
+  /// Writes the PCH to \p OS, along with the information needed to check
+  /// whether it can be reused. The result can be restored by deserialize(),
+  /// possibly in another process. Returns false if the PCH can't be read.
+  bool serialize(llvm::raw_ostream &OS) const;
+
+  /// Restores a preamble written by serialize(). As with Build(), the PCH is
+  /// stored in memory or in a temporary file according to \p StoreInMemory.
+  static llvm::ErrorOr<PrecompiledPreamble> deserialize(llvm::StringRef Data,
+                                                        bool StoreInMemory);
+
   /// Check whether PrecompiledPreamble can be reused for the new contents(\p
   /// MainFileBuffer) of the main file.
   bool CanReuse(const CompilerInvocation &Invocation,
@@ -239,7 +250,8 @@ enum class BuildPreambleError {
   CouldntCreateTargetInfo,
   BeginSourceFileFailed,
   CouldntEmitPCH,
-  BadInputs
+  BadInputs,
+  BadSerializedPreamble
 };
 
 class BuildPreambleErrorCategory final : public std::error_category {
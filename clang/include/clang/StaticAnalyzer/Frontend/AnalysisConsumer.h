@@ -19,9 +19,14 @@
 #include <functional>
 #include <memory>
 
+namespace llvm {
+class TimeRecord;
+} // namespace llvm
+
 namespace clang {
 
 class CompilerInstance;
+class Decl;
 
 namespace ento {
 class PathDiagnosticConsumer;
@@ -43,6 +48,16 @@ public:
   ///   });
   virtual void
   AddCheckerRegistrationFn(std::function<void(CheckerRegistry &)> Fn) = 0;
+
+  /// Restricts the analysis to the declarations for which \p Filter returns
+  /// true. The functions they call may still be inlined into their analysis.
+  virtual void SetDeclFilter(std::function<bool(const Decl *)> Filter) = 0;
+
+  /// Calls \p Callback with the time spent on each analysis of a declaration.
+  /// A declaration may be analyzed several times, e.g. by syntax and by path
+  /// sensitive checkers.
+  virtual void SetDeclTimeCallback(
+      std::function<void(const Decl *, const llvm::TimeRecord &)> Callback) = 0;
 };
 
 /// CreateAnalysisConsumer - Creates an ASTConsumer to run various code
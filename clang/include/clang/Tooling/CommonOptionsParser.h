@@ -91,6 +91,16 @@ public:
     return *Compilations;
   }
 
+  /// Loads the compilations database as it's loaded for the source files given
+  /// on the command line: from the compile command after "--", from the build
+  /// path given with "-p", or else detected from \p File. The commands are
+  /// adjusted by "--extra-arg" and "--extra-arg-before".
+  ///
+  /// This lets tools that don't require source files on the command line,
+  /// and read them from elsewhere, load the database later. If it was already
+  /// loaded, returns the same database as getCompilations().
+  CompilationDatabase &loadCompilations(StringRef File);
+
   /// Returns a list of source file paths to process.
   const std::vector<std::string> &getSourcePathList() const {
     return SourcePathList;
@@ -111,7 +121,9 @@ private:
                    const char *Overview);
 
   std::unique_ptr<CompilationDatabase> Compilations;
+  bool CompilationsLoaded = false;
   std::vector<std::string> SourcePathList;
+  std::string BuildPath;
   ArgumentsAdjuster Adjuster;
 };
 
@@ -115,16 +115,32 @@ using VariadicOperatorFunction = bool (*)(
 template <VariadicOperatorFunction Func>
 class VariadicMatcher : public DynMatcherInterface {
 public:
-  VariadicMatcher(std::vector<DynTypedMatcher> InnerMatchers)
-      : InnerMatchers(std::move(InnerMatchers)) {}
+  VariadicMatcher(std::vector<DynTypedMatcher> InnerMatchers,
+                  bool SingleNode = false)
+      : InnerMatchers(std::move(InnerMatchers)), SingleNode(SingleNode) {}
 
   bool dynMatches(const DynTypedNode &DynNode, ASTMatchFinder *Finder,
                   BoundNodesTreeBuilder *Builder) const override {
     return Func(DynNode, Finder, Builder, InnerMatchers);
   }
 
+  bool isSingleNodeMatcher() const override { return SingleNode; }
+
+  ArrayRef<DynTypedMatcher> allOfOperands() const override {
+    if (Func == allOfVariadicOperator)
+      return InnerMatchers;
+    return None;
+  }
+
+  ArrayRef<DynTypedMatcher> anyOfOperands() const override {
+    if (Func == anyOfVariadicOperator)
+      return InnerMatchers;
+    return None;
+  }
+
 private:
   std::vector<DynTypedMatcher> InnerMatchers;
+  bool SingleNode;
 };
 
 class IdDynMatcher : public DynMatcherInterface {
@@ -158,6 +174,8 @@ public:
                   BoundNodesTreeBuilder *) const override {
     return true;
   }
+
+  bool isSingleNodeMatcher() const override { return true; }
 };
 
 /// A matcher that specifies a particular \c TraversalKind.
@@ -185,6 +203,17 @@ private:
   IntrusiveRefCntPtr<DynMatcherInterface> InnerMatcher;
 };
 
+const llvm::IntrusiveRefCntPtr<TrueMatcherImpl> &trueMatcherImpl() {
+  // We only ever need one instance of TrueMatcherImpl, so we create a static
+  // instance and reuse it to reduce the overhead of the matcher and increase
+  // the chance of cache hits.
+  static const llvm::IntrusiveRefCntPtr<TrueMatcherImpl> Instance =
+      new TrueMatcherImpl();
+  return Instance;
+}
+
+bool isSingleNode(const DynTypedMatcher &M) { return M.isSingleNodeMatcher(); }
+
 } // namespace
 
 bool ASTMatchFinder::isTraversalIgnoringImplicitNodes() const {
@@ -192,6 +221,31 @@ bool ASTMatchFinder::isTraversalIgnoringImplicitNodes() const {
          TK_IgnoreUnlessSpelledInSource;
 }
 
+void DynTypedMatcher::flattenOperands(
+    VariadicOperator Op, std::vector<DynTypedMatcher> &InnerMatchers) {
+  assert(Op == VO_AllOf || Op == VO_AnyOf);
+  std::vector<DynTypedMatcher> Flat;
+  for (DynTypedMatcher &IM : InnerMatchers) {
+    ArrayRef<DynTypedMatcher> Nested =
+        Op == VO_AllOf ? IM.Implementation->allOfOperands()
+                       : IM.Implementation->anyOfOperands();
+    // The nested operands stay restricted to the kind of the matcher they
+    // came from, which may have been narrowed after it was constructed.
+    auto KindFor = [&](const DynTypedMatcher &N) {
+      return ASTNodeKind::getMostDerivedType(N.RestrictKind, IM.RestrictKind);
+    };
+    if (Nested.empty() || llvm::any_of(Nested, [&](const DynTypedMatcher &N) {
+          return KindFor(N).isNone();
+        })) {
+      Flat.push_back(std::move(IM));
+      continue;
+    }
+    for (const DynTypedMatcher &N : Nested)
+      Flat.push_back(constructRestrictedWrapper(N, KindFor(N)));
+  }
+  InnerMatchers = std::move(Flat);
+}
+
 DynTypedMatcher
 DynTypedMatcher::constructVariadic(DynTypedMatcher::VariadicOperator Op,
                                    ASTNodeKind SupportedKind,
@@ -210,7 +264,7 @@ DynTypedMatcher::constructVariadic(DynTypedMatcher::VariadicOperator Op,
   auto RestrictKind = SupportedKind;
 
   switch (Op) {
-  case VO_AllOf:
+  case VO_AllOf: {
     // In the case of allOf() we must pass all the checks, so making
     // RestrictKind the most restrictive can save us time. This way we reject
     // invalid types earlier and we can elide the kind checks inside the
@@ -219,14 +273,32 @@ DynTypedMatcher::constructVariadic(DynTypedMatcher::VariadicOperator Op,
       RestrictKind =
           ASTNodeKind::getMostDerivedType(RestrictKind, IM.RestrictKind);
     }
-    return DynTypedMatcher(
-        SupportedKind, RestrictKind,
-        new VariadicMatcher<allOfVariadicOperator>(std::move(InnerMatchers)));
+    flattenOperands(Op, InnerMatchers);
+    // Operands that only check the kind of the node are redundant, as
+    // RestrictKind covers them.
+    auto IsTrueMatcher = [](const DynTypedMatcher &IM) {
+      return IM.Implementation == trueMatcherImpl();
+    };
+    if (!llvm::all_of(InnerMatchers, IsTrueMatcher))
+      llvm::erase_if(InnerMatchers, IsTrueMatcher);
+    // Operands that only inspect the node are cheap, and their result doesn't
+    // depend on the other operands, so they are evaluated first. E.g. a
+    // hasName() check avoids traversals of nodes with other names.
+    std::stable_partition(InnerMatchers.begin(), InnerMatchers.end(),
+                          isSingleNode);
+    bool SingleNode = llvm::all_of(InnerMatchers, isSingleNode);
+    return DynTypedMatcher(SupportedKind, RestrictKind,
+                           new VariadicMatcher<allOfVariadicOperator>(
+                               std::move(InnerMatchers), SingleNode));
+  }
 
-  case VO_AnyOf:
-    return DynTypedMatcher(
-        SupportedKind, RestrictKind,
-        new VariadicMatcher<anyOfVariadicOperator>(std::move(InnerMatchers)));
+  case VO_AnyOf: {
+    flattenOperands(Op, InnerMatchers);
+    bool SingleNode = llvm::all_of(InnerMatchers, isSingleNode);
+    return DynTypedMatcher(SupportedKind, RestrictKind,
+                           new VariadicMatcher<anyOfVariadicOperator>(
+                               std::move(InnerMatchers), SingleNode));
+  }
 
   case VO_EachOf:
     return DynTypedMatcher(
@@ -238,12 +310,14 @@ DynTypedMatcher::constructVariadic(DynTypedMatcher::VariadicOperator Op,
                            new VariadicMatcher<optionallyVariadicOperator>(
                                std::move(InnerMatchers)));
 
-  case VO_UnaryNot:
+  case VO_UnaryNot: {
     // FIXME: Implement the Not operator to take a single matcher instead of a
     // vector.
-    return DynTypedMatcher(
-        SupportedKind, RestrictKind,
-        new VariadicMatcher<notUnaryOperator>(std::move(InnerMatchers)));
+    bool SingleNode = llvm::all_of(InnerMatchers, isSingleNode);
+    return DynTypedMatcher(SupportedKind, RestrictKind,
+                           new VariadicMatcher<notUnaryOperator>(
+                               std::move(InnerMatchers), SingleNode));
+  }
   }
   llvm_unreachable("Invalid Op value.");
 }
@@ -264,12 +338,7 @@ DynTypedMatcher DynTypedMatcher::withTraversalKind(TraversalKind TK) {
 }
 
 DynTypedMatcher DynTypedMatcher::trueMatcher(ASTNodeKind NodeKind) {
-  // We only ever need one instance of TrueMatcherImpl, so we create a static
-  // instance and reuse it to reduce the overhead of the matcher and increase
-  // the chance of cache hits.
-  static const llvm::IntrusiveRefCntPtr<TrueMatcherImpl> Instance =
-      new TrueMatcherImpl();
-  return DynTypedMatcher(NodeKind, NodeKind, Instance);
+  return DynTypedMatcher(NodeKind, NodeKind, trueMatcherImpl());
 }
 
 bool DynTypedMatcher::canMatchNodesOfKind(ASTNodeKind Kind) const {
@@ -1383,6 +1383,7 @@ ASTUnit::getMainBufferWithPrecompiledPreamble(
       case BuildPreambleError::BeginSourceFileFailed:
       case BuildPreambleError::CouldntEmitPCH:
       case BuildPreambleError::BadInputs:
+      case BuildPreambleError::BadSerializedPreamble:
         // These erros are more likely to repeat, retry after some period.
         PreambleRebuildCountdown = DefaultPreambleRebuildInterval;
         return nullptr;
@@ -27,7 +27,10 @@
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/VirtualFileSystem.h"
@@ -585,6 +588,128 @@ std::size_t PrecompiledPreamble::getSize() const {
   llvm_unreachable("Unhandled storage kind");
 }
 
+// Serialized preambles start with a magic number and a format version. The
+// version must be bumped whenever the layout below changes.
+static constexpr uint32_t SerializedPreambleMagic = 0x50435043; // "CPCP"
+static constexpr uint32_t SerializedPreambleVersion = 1;
+
+bool PrecompiledPreamble::serialize(llvm::raw_ostream &OS) const {
+  std::unique_ptr<llvm::MemoryBuffer> PCHFile;
+  StringRef PCH;
+  switch (Storage->getKind()) {
+  case PCHStorage::Kind::InMemory:
+    PCH = Storage->memoryContents();
+    break;
+  case PCHStorage::Kind::TempFile: {
+    auto Buf = llvm::MemoryBuffer::getFile(Storage->filePath());
+    if (!Buf)
+      return false;
+    PCHFile = std::move(*Buf);
+    PCH = PCHFile->getBuffer();
+    break;
+  }
+  }
+
+  llvm::support::endian::Writer W(OS, llvm::support::little);
+  auto WriteString = [&](StringRef S) {
+    W.write<uint32_t>(S.size());
+    OS << S;
+  };
+  W.write<uint32_t>(SerializedPreambleMagic);
+  W.write<uint32_t>(SerializedPreambleVersion);
+  W.write<uint8_t>(PreambleEndsAtStartOfLine);
+  WriteString(getContents());
+  W.write<uint32_t>(FilesInPreamble.size());
+  for (const auto &Entry : FilesInPreamble) {
+    WriteString(Entry.getKey());
+    W.write<uint64_t>(Entry.getValue().Size);
+    W.write<int64_t>(Entry.getValue().ModTime);
+    OS.write(reinterpret_cast<const char *>(Entry.getValue().MD5.data()),
+             Entry.getValue().MD5.size());
+  }
+  W.write<uint32_t>(MissingFiles.size());
+  for (const auto &Entry : MissingFiles)
+    WriteString(Entry.getKey());
+  // The PCH takes up the rest of the data.
+  OS << PCH;
+  return true;
+}
+
+llvm::ErrorOr<PrecompiledPreamble>
+PrecompiledPreamble::deserialize(StringRef Data, bool StoreInMemory) {
+  bool Err = false;
+  auto Consume = [&](size_t N) {
+    if (Err || Data.size() < N) {
+      Err = true;
+      return StringRef();
+    }
+    StringRef Result = Data.take_front(N);
+    Data = Data.drop_front(N);
+    return Result;
+  };
+  auto Read32 = [&] {
+    StringRef Bytes = Consume(sizeof(uint32_t));
+    return Err ? 0 : llvm::support::endian::read32le(Bytes.data());
+  };
+  auto Read64 = [&] {
+    StringRef Bytes = Consume(sizeof(uint64_t));
+    return Err ? 0 : llvm::support::endian::read64le(Bytes.data());
+  };
+  auto ReadString = [&] { return Consume(Read32()); };
+
+  if (Read32() != SerializedPreambleMagic ||
+      Read32() != SerializedPreambleVersion)
+    return BuildPreambleError::BadSerializedPreamble;
+  StringRef EndsAtStartOfLine = Consume(1);
+  bool PreambleEndsAtStartOfLine = !Err && EndsAtStartOfLine.front();
+  StringRef Contents = ReadString();
+  std::vector<char> PreambleBytes(Contents.begin(), Contents.end());
+
+  llvm::StringMap<PreambleFileHash> FilesInPreamble;
+  for (uint32_t I = 0, N = Read32(); I < N && !Err; ++I) {
+    StringRef Name = ReadString();
+    PreambleFileHash Hash;
+    Hash.Size = Read64();
+    Hash.ModTime = Read64();
+    StringRef MD5 = Consume(Hash.MD5.size());
+    if (!Err)
+      std::copy(MD5.begin(), MD5.end(), Hash.MD5.begin());
+    FilesInPreamble[Name] = Hash;
+  }
+  llvm::StringSet<> MissingFiles;
+  for (uint32_t I = 0, N = Read32(); I < N && !Err; ++I)
+    MissingFiles.insert(ReadString());
+  if (Err)
+    return BuildPreambleError::BadSerializedPreamble;
+
+  std::unique_ptr<PCHStorage> Storage;
+  if (StoreInMemory) {
+    auto Buffer = std::make_shared<PCHBuffer>();
+    Buffer->Data.assign(Data.begin(), Data.end());
+    Buffer->IsComplete = true;
+    Storage = PCHStorage::inMemory(std::move(Buffer));
+  } else {
+    std::unique_ptr<TempPCHFile> PreamblePCHFile = TempPCHFile::create();
+    if (!PreamblePCHFile)
+      return BuildPreambleError::CouldntCreateTempFile;
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(PreamblePCHFile->getFilePath(), EC);
+    if (EC)
+      return BuildPreambleError::CouldntCreateTempFile;
+    OS << Data;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      return BuildPreambleError::CouldntCreateTempFile;
+    }
+    Storage = PCHStorage::file(std::move(PreamblePCHFile));
+  }
+  return PrecompiledPreamble(std::move(Storage), std::move(PreambleBytes),
+                             PreambleEndsAtStartOfLine,
+                             std::move(FilesInPreamble),
+                             std::move(MissingFiles));
+}
+
 bool PrecompiledPreamble::CanReuse(const CompilerInvocation &Invocation,
                                    const llvm::MemoryBufferRef &MainFileBuffer,
                                    PreambleBounds Bounds,
@@ -839,6 +964,8 @@ std::string BuildPreambleErrorCategory::message(int condition) const {
     return "Could not emit PCH";
   case BuildPreambleError::BadInputs:
     return "Command line arguments must contain exactly one source file";
+  case BuildPreambleError::BadSerializedPreamble:
+    return "Serialized preamble is malformed or has an unsupported version";
   }
   llvm_unreachable("unexpected BuildPreambleError");
 }
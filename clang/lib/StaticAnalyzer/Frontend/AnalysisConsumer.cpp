@@ -84,6 +84,12 @@ class AnalysisConsumer : public AnalysisASTConsumer,
 
   std::vector<std::function<void(CheckerRegistry &)>> CheckerRegistrationFns;
 
+  /// If set, only the declarations it accepts are analyzed.
+  std::function<bool(const Decl *)> DeclFilter;
+
+  /// If set, receives the time spent on each analysis of a declaration.
+  std::function<void(const Decl *, const llvm::TimeRecord &)> DeclTimeCallback;
+
 public:
   ASTContext *Ctx;
   Preprocessor &PP;
@@ -350,6 +356,16 @@ public:
     CheckerRegistrationFns.push_back(std::move(Fn));
   }
 
+  void SetDeclFilter(std::function<bool(const Decl *)> Filter) override {
+    DeclFilter = std::move(Filter);
+  }
+
+  void SetDeclTimeCallback(
+      std::function<void(const Decl *, const llvm::TimeRecord &)> Callback)
+      override {
+    DeclTimeCallback = std::move(Callback);
+  }
+
 private:
   void storeTopLevelDecls(DeclGroupRef DG);
 
@@ -628,6 +644,9 @@ AnalysisConsumer::getModeForDecl(Decl *D, AnalysisMode Mode) {
       AnalysisDeclContext::getFunctionName(D) != Opts->AnalyzeSpecificFunction)
     return AM_None;
 
+  if (DeclFilter && !DeclFilter(D))
+    return AM_None;
+
   // Unless -analyze-all is specified, treat decls differently depending on
   // where they came from:
   // - Main source file: run both path-sensitive and non-path-sensitive checks.
@@ -670,6 +689,10 @@ void AnalysisConsumer::HandleCode(Decl *D, AnalysisMode Mode,
   if (Mgr->getAnalysisDeclContext(D)->isBodyAutosynthesized())
     return;
 
+  llvm::TimeRecord StartTime;
+  if (DeclTimeCallback)
+    StartTime = llvm::TimeRecord::getCurrentTime(/*Start=*/true);
+
   CFG *DeclCFG = Mgr->getCFG(D);
   if (DeclCFG)
     MaxCFGSize.updateMax(DeclCFG->size());
@@ -699,6 +722,13 @@ void AnalysisConsumer::HandleCode(Decl *D, AnalysisMode Mode,
     if (IMode != ExprEngine::Inline_Minimal)
       NumFunctionsAnalyzed++;
   }
+
+  if (DeclTimeCallback) {
+    llvm::TimeRecord EndTime =
+        llvm::TimeRecord::getCurrentTime(/*Start=*/false);
+    EndTime -= StartTime;
+    DeclTimeCallback(D, EndTime);
+  }
 }
 
 //===----------------------------------------------------------------------===//
@@ -122,16 +122,30 @@ llvm::Error CommonOptionsParser::init(
   cl::PrintOptionValues();
 
   SourcePathList = SourcePaths;
+  this->BuildPath = BuildPath;
+  Adjuster =
+      getInsertArgumentAdjuster(ArgsBefore, ArgumentInsertPosition::BEGIN);
+  Adjuster = combineAdjusters(
+      std::move(Adjuster),
+      getInsertArgumentAdjuster(ArgsAfter, ArgumentInsertPosition::END));
   if ((OccurrencesFlag == cl::ZeroOrMore || OccurrencesFlag == cl::Optional) &&
       SourcePathList.empty())
     return llvm::Error::success();
+  loadCompilations(SourcePathList[0]);
+  return llvm::Error::success();
+}
+
+CompilationDatabase &CommonOptionsParser::loadCompilations(StringRef File) {
+  if (CompilationsLoaded)
+    return *Compilations;
   if (!Compilations) {
+    std::string ErrorMessage;
     if (!BuildPath.empty()) {
       Compilations =
           CompilationDatabase::autoDetectFromDirectory(BuildPath, ErrorMessage);
     } else {
-      Compilations = CompilationDatabase::autoDetectFromSource(SourcePaths[0],
-                                                               ErrorMessage);
+      Compilations =
+          CompilationDatabase::autoDetectFromSource(File, ErrorMessage);
     }
     if (!Compilations) {
       llvm::errs() << "Error while trying to load a compilation database:\n"
@@ -143,14 +157,10 @@ llvm::Error CommonOptionsParser::init(
   auto AdjustingCompilations =
       std::make_unique<ArgumentsAdjustingCompilations>(
           std::move(Compilations));
-  Adjuster =
-      getInsertArgumentAdjuster(ArgsBefore, ArgumentInsertPosition::BEGIN);
-  Adjuster = combineAdjusters(
-      std::move(Adjuster),
-      getInsertArgumentAdjuster(ArgsAfter, ArgumentInsertPosition::END));
   AdjustingCompilations->appendArgumentsAdjuster(Adjuster);
   Compilations = std::move(AdjustingCompilations);
-  return llvm::Error::success();
+  CompilationsLoaded = true;
+  return *Compilations;
 }
 
 llvm::Expected<CommonOptionsParser> CommonOptionsParser::create(
@@ -148,6 +148,93 @@ TEST(ConstructVariadic, MismatchedTypes_Regression) {
                                       .convertTo<QualType>()));
 }
 
+TEST(ConstructVariadic, SingleNodeOperands) {
+  using internal::DynTypedMatcher;
+  using internal::Matcher;
+  auto NamedDeclKind = ASTNodeKind::getFromNodeKind<NamedDecl>();
+  EXPECT_TRUE(DynTypedMatcher(hasName("a")).isSingleNodeMatcher());
+  EXPECT_FALSE(
+      DynTypedMatcher(Matcher<Decl>(has(decl()))).isSingleNodeMatcher());
+  EXPECT_FALSE(
+      DynTypedMatcher(namedDecl(hasName("a")).bind("x")).isSingleNodeMatcher());
+
+  auto NodeOnly = DynTypedMatcher::constructVariadic(
+      DynTypedMatcher::VO_AllOf, NamedDeclKind,
+      {namedDecl(), hasAnyName("a", "b"),
+       Matcher<NamedDecl>(unless(hasName("c")))});
+  EXPECT_TRUE(NodeOnly.isSingleNodeMatcher());
+  auto Traversal = DynTypedMatcher::constructVariadic(
+      DynTypedMatcher::VO_AnyOf, NamedDeclKind,
+      {NodeOnly, Matcher<NamedDecl>(has(decl()))});
+  EXPECT_FALSE(Traversal.isSingleNodeMatcher());
+}
+
+TEST(ConstructVariadic, OptimizationKeepsResults) {
+  // Nested allOf() and anyOf() are flattened, and hasName() is evaluated
+  // before the traversals. Neither changes the results or their order.
+  StringRef Code = "void f() { int a; int b; } void g() { int c; }";
+  EXPECT_TRUE(matchAndVerifyResultTrue(
+      Code,
+      functionDecl(allOf(forEachDescendant(varDecl().bind("v")),
+                         allOf(isDefinition(), hasName("f")))),
+      std::make_unique<VerifyIdIsBoundTo<VarDecl>>("v", 2)));
+  EXPECT_TRUE(matchAndVerifyResultTrue(
+      Code,
+      functionDecl(anyOf(allOf(hasName("x"), has(compoundStmt().bind("s"))),
+                         anyOf(hasName("g"), hasName("f"))),
+                   hasDescendant(varDecl(hasName("c")).bind("v"))),
+      std::make_unique<VerifyIdIsBoundTo<VarDecl>>("v", 1)));
+  EXPECT_TRUE(notMatches(
+      Code, functionDecl(hasName("g"), hasDescendant(varDecl(hasName("a"))))));
+  // Kind-only operands are dropped in favor of the kind check of allOf().
+  EXPECT_TRUE(
+      matches(Code, functionDecl(allOf(decl(), namedDecl(), hasName("g")))));
+  EXPECT_TRUE(matches(Code, varDecl(allOf(decl(), namedDecl()))));
+  EXPECT_TRUE(notMatches(Code, functionDecl(allOf(decl(), hasName("h")))));
+}
+
+TEST(ConstructVariadic, OptimizationKeepsBindingOrder) {
+  // allOf() evaluates the operands that only inspect the node first. They
+  // never bind or read bindings, so the matches and the nodes bound by each
+  // of them must stay as written.
+  std::unique_ptr<ASTUnit> AST = tooling::buildASTFromCode(
+      "void f() { int a; int b; } void g() { int c; }");
+  auto Bound = [&](const DeclarationMatcher &M) {
+    std::vector<std::string> Result;
+    for (const BoundNodes &Nodes : match(M, AST->getASTContext())) {
+      std::string Match;
+      for (const auto &Entry : Nodes.getMap())
+        Match += Entry.first + "=" +
+                 Entry.second.get<NamedDecl>()->getNameAsString() + " ";
+      Result.push_back(Match);
+    }
+    return Result;
+  };
+
+  std::vector<std::string> FVars = {"fn=f v=a ", "fn=f v=b "};
+  EXPECT_EQ(Bound(functionDecl(forEachDescendant(varDecl().bind("v")),
+                               hasName("f"))
+                      .bind("fn")),
+            FVars);
+  EXPECT_EQ(Bound(functionDecl(hasName("f"),
+                               forEachDescendant(varDecl().bind("v")))
+                      .bind("fn")),
+            FVars);
+  EXPECT_EQ(Bound(functionDecl(
+                      anyOf(anyOf(hasName("x"),
+                                  hasDescendant(varDecl().bind("v"))),
+                            hasDescendant(varDecl(hasName("c")).bind("w"))))
+                      .bind("fn")),
+            (std::vector<std::string>{"fn=f v=a ", "fn=g v=c "}));
+  EXPECT_EQ(
+      Bound(functionDecl(
+                eachOf(allOf(hasDescendant(varDecl().bind("v")), hasName("g")),
+                       allOf(hasName("f"),
+                             hasDescendant(varDecl(hasName("b")).bind("w")))))
+                .bind("fn")),
+      (std::vector<std::string>{"fn=f w=b ", "fn=g v=c "}));
+}
+
 // For testing AST_MATCHER_P().
 AST_MATCHER_P(Decl, just, internal::Matcher<Decl>, AMatcher) {
   // Make sure all special variables are used: node, match_finder,
@@ -214,6 +301,60 @@ TEST(MatchFinder, CheckProfiling) {
   EXPECT_EQ("MyID", Records.begin()->getKey());
 }
 
+TEST(MatchFinder, TraversalFilter) {
+  MatchFinder::MatchFinderOptions Options;
+  Options.TraversalFilter = [](const Decl &D) {
+    const auto *ND = dyn_cast<NamedDecl>(&D);
+    return !ND || ND->getName() != "skipped";
+  };
+  MatchFinder Finder(std::move(Options));
+
+  struct NameCollector : public MatchFinder::MatchCallback {
+    void run(const MatchFinder::MatchResult &Result) override {
+      Names.push_back(
+          Result.Nodes.getNodeAs<NamedDecl>("x")->getNameAsString());
+    }
+    std::vector<std::string> Names;
+  } Callback;
+  // Ancestors outside of the traversal are still visible.
+  Finder.addMatcher(
+      varDecl(hasAncestor(namespaceDecl(hasName("ns")))).bind("x"),
+      &Callback);
+  std::unique_ptr<ASTUnit> AST(tooling::buildASTFromCode(R"cpp(
+    namespace ns {
+    void skipped() { int a; }
+    void kept() { int b; }
+    }
+  )cpp"));
+  ASSERT_TRUE(AST.get());
+  Finder.matchAST(AST->getASTContext());
+  EXPECT_EQ(Callback.Names, std::vector<std::string>{"b"});
+}
+
+TEST(MatchFinder, IgnoreTemplateInstantiations) {
+  MatchFinder::MatchFinderOptions Options;
+  Options.IgnoreTemplateInstantiations = true;
+  MatchFinder Finder(std::move(Options));
+
+  struct Counter : public MatchFinder::MatchCallback {
+    void run(const MatchFinder::MatchResult &Result) override { ++Count; }
+    unsigned Count = 0;
+  } Callback;
+  Finder.addMatcher(varDecl(hasName("a")).bind("x"), &Callback);
+  std::unique_ptr<ASTUnit> AST(tooling::buildASTFromCode(R"cpp(
+    template <typename T> void f() { T a; }
+    template <typename T> struct S { void g() { T a; } };
+    void h() {
+      f<int>();
+      f<char>();
+      S<int>().g();
+    }
+  )cpp"));
+  ASSERT_TRUE(AST.get());
+  Finder.matchAST(AST->getASTContext());
+  EXPECT_EQ(Callback.Count, 2u);
+}
+
 class VerifyStartOfTranslationUnit : public MatchFinder::MatchCallback {
 public:
   VerifyStartOfTranslationUnit() : Called(false) {}
@@ -0,0 +1,116 @@
+//===- unittests/Frontend/PrecompiledPreambleTest.cpp - Preamble tests ----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Frontend/PrecompiledPreamble.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendOptions.h"
+#include "clang/Serialization/PCHContainerOperations.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace clang;
+
+namespace {
+
+const char *MainName = "//./main.cpp";
+const char *HeaderName = "//./header.h";
+const char *MainCode = "#include \"header.h\"\nint main() { return ZERO; }\n";
+
+class PrecompiledPreambleTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    CI = std::make_shared<CompilerInvocation>();
+    CI->getFrontendOpts().Inputs.push_back(
+        FrontendInputFile(MainName, Language::CXX));
+    CI->getTargetOpts().Triple = "i386-unknown-linux-gnu";
+    Main = MemoryBuffer::getMemBufferCopy(MainCode, MainName);
+    Bounds = ComputePreambleBounds(*CI->getLangOpts(), *Main, 0);
+  }
+
+  IntrusiveRefCntPtr<vfs::FileSystem> makeVFS(StringRef Header) {
+    IntrusiveRefCntPtr<vfs::InMemoryFileSystem> VFS(
+        new vfs::InMemoryFileSystem);
+    // See PCHPreambleTest: the working directory must be absolute.
+    VFS->setCurrentWorkingDirectory("//./");
+    VFS->addFile(MainName, 0, MemoryBuffer::getMemBufferCopy(MainCode));
+    VFS->addFile(HeaderName, 0, MemoryBuffer::getMemBufferCopy(Header));
+    return VFS;
+  }
+
+  ErrorOr<PrecompiledPreamble> build(IntrusiveRefCntPtr<vfs::FileSystem> VFS) {
+    IntrusiveRefCntPtr<DiagnosticsEngine> Diags =
+        CompilerInstance::createDiagnostics(new DiagnosticOptions,
+                                            new DiagnosticConsumer);
+    PreambleCallbacks Callbacks;
+    return PrecompiledPreamble::Build(
+        *CI, Main.get(), Bounds, *Diags, std::move(VFS),
+        std::make_shared<PCHContainerOperations>(), /*StoreInMemory=*/true,
+        Callbacks);
+  }
+
+  bool canReuse(const PrecompiledPreamble &Preamble, vfs::FileSystem &VFS) {
+    return Preamble.CanReuse(*CI, Main->getMemBufferRef(), Bounds, VFS);
+  }
+
+  std::shared_ptr<CompilerInvocation> CI;
+  std::unique_ptr<MemoryBuffer> Main;
+  PreambleBounds Bounds{0, false};
+};
+
+TEST_F(PrecompiledPreambleTest, SerializeRoundTrip) {
+  auto VFS = makeVFS("#define ZERO 0\n");
+  auto Built = build(VFS);
+  ASSERT_TRUE(Built) << Built.getError().message();
+  ASSERT_TRUE(canReuse(*Built, *VFS));
+
+  std::string Serialized;
+  raw_string_ostream OS(Serialized);
+  ASSERT_TRUE(Built->serialize(OS));
+  OS.flush();
+
+  for (bool StoreInMemory : {true, false}) {
+    auto Loaded = PrecompiledPreamble::deserialize(Serialized, StoreInMemory);
+    ASSERT_TRUE(Loaded) << Loaded.getError().message();
+    EXPECT_EQ(Loaded->getContents(), Built->getContents());
+    EXPECT_EQ(Loaded->getBounds().Size, Built->getBounds().Size);
+    EXPECT_EQ(Loaded->getBounds().PreambleEndsAtStartOfLine,
+              Built->getBounds().PreambleEndsAtStartOfLine);
+    EXPECT_EQ(Loaded->getSize(), Built->getSize());
+    EXPECT_TRUE(canReuse(*Loaded, *VFS));
+    // The file hashes were restored too: an edited header invalidates it.
+    EXPECT_FALSE(canReuse(*Loaded, *makeVFS("#define ZERO 1\n")));
+  }
+}
+
+TEST_F(PrecompiledPreambleTest, DeserializeRejectsBadData) {
+  auto Built = build(makeVFS("#define ZERO 0\n"));
+  ASSERT_TRUE(Built) << Built.getError().message();
+  std::string Serialized;
+  raw_string_ostream OS(Serialized);
+  ASSERT_TRUE(Built->serialize(OS));
+  OS.flush();
+
+  EXPECT_EQ(PrecompiledPreamble::deserialize("", true).getError(),
+            BuildPreambleError::BadSerializedPreamble);
+  EXPECT_EQ(PrecompiledPreamble::deserialize("not a preamble", true).getError(),
+            BuildPreambleError::BadSerializedPreamble);
+  // Truncated in the middle of the file list.
+  EXPECT_EQ(PrecompiledPreamble::deserialize(
+                StringRef(Serialized).take_front(
+                    13 + Built->getContents().size()),
+                true)
+                .getError(),
+            BuildPreambleError::BadSerializedPreamble);
+}
+
+} // anonymous namespace